@@ -100,6 +100,64 @@ namespace Google {
       }
     }
 
+    /// <summary>
+    /// Resolves the Java classes and methods used by the plugin on a
+    /// background thread.
+    /// </summary>
+    /// <remarks>Call this as early as possible, for example while the first
+    /// scene loads, so creating the DefaultInstance does less work on the
+    /// main thread.  It does nothing on platforms other than Android.
+    /// </remarks>
+    public static void Prewarm() {
+#if UNITY_ANDROID
+      GoogleSignInImpl.Prewarm();
+#endif
+    }
+
+    /// <summary>
+    /// Returns the trace of the sign-in stages recorded so far, in the Chrome
+    /// trace event JSON format.
+    /// </summary>
+    /// <remarks>Save it to a file and load it in chrome://tracing or
+    /// Perfetto.  The trace is empty unless the native library was built
+    /// with GOOGLESIGNIN_TRACE, and on platforms other than Android.
+    /// </remarks>
+    public static string ExportTrace() {
+#if UNITY_ANDROID
+      return GoogleSignInImpl.ExportTrace();
+#else
+      return "{\"traceEvents\":[]}";
+#endif
+    }
+
+    /// <summary>
+    /// Starts recording the calls between the plugin and Google Play
+    /// services, discarding the previous recording, or stops recording.
+    /// </summary>
+    /// <remarks>The recording keeps the timing of each call.  Names, email
+    /// addresses and tokens are replaced by hashes.  It does nothing on
+    /// platforms other than Android.
+    /// </remarks>
+    public static void EnableRecording(bool enable) {
+#if UNITY_ANDROID
+      GoogleSignInImpl.EnableRecording(enable);
+#endif
+    }
+
+    /// <summary>
+    /// Returns the recording started by EnableRecording().
+    /// </summary>
+    /// <remarks>The binary format is described in jni_recorder.h.  Empty if
+    /// recording was never enabled, and on platforms other than Android.
+    /// </remarks>
+    public static byte[] ExportRecording() {
+#if UNITY_ANDROID
+      return GoogleSignInImpl.ExportRecording();
+#else
+      return new byte[0];
+#endif
+    }
+
     internal GoogleSignIn(GoogleSignInImpl impl) {
       this.impl = impl;
     }
@@ -108,6 +166,23 @@ namespace Google {
             impl.EnableDebugLogging(flag);
     }
 
+    /// <summary>
+    /// Connects to Google Play services for the configuration in the
+    /// background, ahead of signing in.
+    /// </summary>
+    /// <remarks>Call this when the sign-in button is shown so SignIn() only
+    /// has to show the account picker.  It does nothing on platforms other
+    /// than Android.
+    /// </remarks>
+    public void WarmUp() {
+#if UNITY_ANDROID
+      GoogleSignInImpl androidImpl = impl as GoogleSignInImpl;
+      if (androidImpl != null) {
+        androidImpl.WarmUp();
+      }
+#endif
+    }
+
     /// <summary>Starts the authentication process.</summary>
     /// <remarks>
     /// The authenication process is started and may display account picker
@@ -158,6 +233,23 @@ namespace Google {
       impl.Disconnect();
     }
 
+    /// <summary>
+    /// Returns the ID token of the most recently signed in user, kept fresh
+    /// when GoogleSignInConfiguration.RefreshIdToken is set.
+    /// </summary>
+    /// <remarks>Returns null if no sign-in succeeded yet, or if the token is
+    /// not refreshed.  Only supported on Android.
+    /// </remarks>
+    public string GetRefreshedIdToken() {
+#if UNITY_ANDROID
+      GoogleSignInImpl androidImpl = impl as GoogleSignInImpl;
+      if (androidImpl != null) {
+        return androidImpl.GetRefreshedIdToken();
+      }
+#endif
+      return null;
+    }
+
     /// <summary>
     /// Sign in exception.  This is a checked exception for handling specific
     /// errors during the sign-in process.
@@ -58,6 +58,20 @@ namespace Google {
     public string AccountName = null;
     /// <summary>Additional scopes to request, requires consent.</summary>
     public IEnumerable<string> AdditionalScopes = null;
+    /// <summary>Set to true to cache the signed in user on the device.
+    /// </summary>
+    /// <remarks>When set, SignInSilently() returns the user from the last
+    /// session right away with the status SuccessCached, while the sign-in
+    /// is revalidated in the background.  Only supported on Android.
+    /// </remarks>
+    public bool UseSessionCache = false;
+    /// <summary>Set to true to refresh the ID token before it expires.
+    /// </summary>
+    /// <remarks>A silent sign-in is started a few minutes before the ID token
+    /// of the signed in user expires.  The refreshed token is returned by
+    /// GoogleSignIn.GetRefreshedIdToken().  Only supported on Android.
+    /// </remarks>
+    public bool RefreshIdToken = false;
   }
 }
 
@@ -66,5 +66,21 @@ namespace Google.Impl {
       }
       return str;
     }
+
+    /// <summary>
+    /// Decodes a UTF-8 string of the given length from native memory.
+    /// </summary>
+    internal static String PtrToString(IntPtr ptr, UIntPtr len) {
+      if (ptr == IntPtr.Zero) {
+        return null;
+      }
+      int size = (int)len.ToUInt32();
+      if (size == 0) {
+        return string.Empty;
+      }
+      byte[] array = new byte[size];
+      Marshal.Copy(ptr, array, 0, size);
+      return Encoding.UTF8.GetString(array, 0, size);
+    }
   }
 }
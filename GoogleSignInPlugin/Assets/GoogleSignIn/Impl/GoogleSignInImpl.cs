@@ -23,6 +23,10 @@ namespace Google.Impl {
 
 #if UNITY_ANDROID
     private const string DllName = "native-googlesignin";
+
+    // The instances SignInHelperObject polls once a frame.
+    private static List<GoogleSignInImpl> polledInstances =
+        new List<GoogleSignInImpl>();
 #else
     private const string DllName = "__Internal";
 #endif
@@ -45,9 +49,48 @@ namespace Google.Impl {
                      scopes.ToArray(),
                      scopes.Count,
                      configuration.AccountName);
+#if UNITY_ANDROID
+        // Disabling the cache also deletes a user cached by an earlier run.
+        GoogleSignIn_EnableSessionCache(SelfPtr(),
+                                        configuration.UseSessionCache);
+        GoogleSignIn_EnableTokenRefresh(SelfPtr(),
+                                        configuration.RefreshIdToken);
+#endif
+      }
+#if UNITY_ANDROID
+      polledInstances.Add(this);
+      // Creates the helper object, whose Update() does the polling.
+      SignInHelperObject helper = SignInHelperObject.Instance;
+#endif
+    }
+
+#if UNITY_ANDROID
+    public override void Dispose() {
+      polledInstances.Remove(this);
+      base.Dispose();
+    }
+
+    /// <summary>
+    /// Completes the futures whose results have arrived and starts the token
+    /// refreshes that are due, for every instance.  Called once a frame on the
+    /// game thread.
+    /// </summary>
+    internal static void PollEvents() {
+      for (int i = 0; i < polledInstances.Count; i++) {
+        GoogleSignIn_PollEvents(polledInstances[i].SelfPtr());
       }
     }
 
+    /// <summary>
+    /// Returns the ID token of the most recently signed in or refreshed user,
+    /// or null if there is none.
+    /// </summary>
+    internal string GetRefreshedIdToken() {
+      return OutParamsToString((out_string, out_size) =>
+          GoogleSignIn_GetRefreshedIdToken(SelfPtr(), out_string, out_size));
+    }
+#endif
+
     /// <summary>Enables/Disables verbose logging to help troubleshooting</summary>
     public void EnableDebugLogging(bool flag) {
         GoogleSignIn_EnableDebugLogging(SelfPtr(), flag);
@@ -171,6 +214,119 @@ namespace Google.Impl {
     internal static extern UIntPtr GoogleSignIn_GetUserId(HandleRef self,
       [In, Out] byte[] bytes, UIntPtr len);
 
+#if UNITY_ANDROID
+    /// <summary>
+    /// Mirrors GoogleSignInUserView in google_signin_bridge.h.  The pointers
+    /// refer to native memory owned by the user.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct UserView {
+      public IntPtr DisplayName;
+      public UIntPtr DisplayNameLen;
+      public IntPtr Email;
+      public UIntPtr EmailLen;
+      public IntPtr FamilyName;
+      public UIntPtr FamilyNameLen;
+      public IntPtr GivenName;
+      public UIntPtr GivenNameLen;
+      public IntPtr IdToken;
+      public UIntPtr IdTokenLen;
+      public IntPtr ImageUrl;
+      public UIntPtr ImageUrlLen;
+      public IntPtr ServerAuthCode;
+      public UIntPtr ServerAuthCodeLen;
+      public IntPtr UserId;
+      public UIntPtr UserIdLen;
+    }
+
+    /// <summary>
+    /// Mirrors GoogleSignInResultView in google_signin_bridge.h.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    internal struct ResultView {
+      public int Pending;
+      public int Status;
+      public int HasUser;
+      public UserView User;
+    }
+
+    [DllImport(DllName)]
+    [return: MarshalAs(UnmanagedType.I1)]
+    internal static extern bool GoogleSignIn_GetResultView(HandleRef self,
+      out ResultView view);
+
+    internal static void Prewarm() {
+      GoogleSignIn_Prewarm(GetPlayerActivity());
+    }
+
+    [DllImport(DllName)]
+    static extern void GoogleSignIn_Prewarm(IntPtr activity);
+
+    internal static string ExportTrace() {
+      return OutParamsToString((out_string, out_size) =>
+          GoogleSignIn_ExportTrace(out_string, out_size));
+    }
+
+    [DllImport(DllName)]
+    static extern UIntPtr GoogleSignIn_ExportTrace(
+      [In, Out] byte[] out_string, UIntPtr out_size);
+
+    internal static void EnableRecording(bool enable) {
+      GoogleSignIn_EnableRecording(enable);
+    }
+
+    internal static byte[] ExportRecording() {
+      // The first call takes a snapshot, the second copies it.
+      UIntPtr size = GoogleSignIn_ExportRecording(null, UIntPtr.Zero);
+      byte[] recording = new byte[size.ToUInt32()];
+      if (recording.Length > 0) {
+        GoogleSignIn_ExportRecording(recording, size);
+      }
+      return recording;
+    }
+
+    [DllImport(DllName)]
+    static extern void GoogleSignIn_EnableRecording(
+      [MarshalAs(UnmanagedType.I1)] bool enable);
+
+    [DllImport(DllName)]
+    static extern UIntPtr GoogleSignIn_ExportRecording(
+      [In, Out] byte[] buf, UIntPtr len);
+
+    internal void WarmUp() {
+      GoogleSignIn_WarmUp(SelfPtr());
+    }
+
+    [DllImport(DllName)]
+    [return: MarshalAs(UnmanagedType.I1)]
+    static extern bool GoogleSignIn_WarmUp(HandleRef self);
+
+    [DllImport(DllName)]
+    static extern void GoogleSignIn_EnableSessionCache(HandleRef self,
+      [MarshalAs(UnmanagedType.I1)] bool enable);
+
+    [DllImport(DllName)]
+    static extern void GoogleSignIn_EnableTokenRefresh(HandleRef self,
+      [MarshalAs(UnmanagedType.I1)] bool enable);
+
+    [DllImport(DllName)]
+    static extern void GoogleSignIn_PollEvents(HandleRef self);
+
+    [DllImport(DllName)]
+    static extern UIntPtr GoogleSignIn_GetRefreshedIdToken(HandleRef self,
+      [In, Out] byte[] out_string, UIntPtr out_size);
+
+    internal delegate void CompletionCallback(IntPtr userData);
+
+    [DllImport(DllName)]
+    internal static extern void GoogleSignIn_SetCompletionCallback(
+      HandleRef self, CompletionCallback callback, IntPtr userData,
+      [MarshalAs(UnmanagedType.I1)] bool queued);
+
+    [DllImport(DllName)]
+    internal static extern void GoogleSignIn_DispatchCallbacks();
+#endif
+
     // Gets the Unity player activity.
     // For iOS, this returns Zero.
     private static IntPtr GetPlayerActivity() {
@@ -24,8 +24,43 @@ namespace Google.Impl {
   /// </summary>
   internal class NativeFuture : BaseObject, FutureAPIImpl<GoogleSignInUser> {
 
+#if UNITY_ANDROID
+    // Kept in a static field so the delegate is not collected while the
+    // native code holds on to it.
+    private static readonly GoogleSignInImpl.CompletionCallback
+        completionCallback = OnCompleted;
+
+    // Set by the native completion callback, so Pending does not need to
+    // call into the native code every frame.
+    private volatile bool completed;
+#endif
+
     internal NativeFuture(IntPtr ptr) : base(ptr) {
+#if UNITY_ANDROID
+      // The handle keeps this object alive until the callback frees it.
+      // The callback is queued so it runs on the game thread, from
+      // SignInHelperObject.Update(), rather than on the Java UI thread.
+      GCHandle handle = GCHandle.Alloc(this);
+      GoogleSignInImpl.GoogleSignIn_SetCompletionCallback(SelfPtr(),
+          completionCallback, GCHandle.ToIntPtr(handle), true);
+#endif
+    }
+
+#if UNITY_ANDROID
+    /// <summary>
+    /// Called by GoogleSignIn_DispatchCallbacks() on the game thread,
+    /// exactly once after the future is no longer pending.
+    /// </summary>
+    [AOT.MonoPInvokeCallback(typeof(GoogleSignInImpl.CompletionCallback))]
+    private static void OnCompleted(IntPtr userData) {
+      GCHandle handle = GCHandle.FromIntPtr(userData);
+      NativeFuture future = handle.Target as NativeFuture;
+      handle.Free();
+      if (future != null) {
+        future.completed = true;
+      }
     }
+#endif
 
     public override void Dispose() {
       GoogleSignInImpl.GoogleSignIn_DisposeFuture(SelfPtr());
@@ -34,12 +69,25 @@ namespace Google.Impl {
 
     public bool Pending {
       get {
+#if UNITY_ANDROID
+        return !completed;
+#else
         return GoogleSignInImpl.GoogleSignIn_Pending(SelfPtr());
+#endif
       }
     }
 
     public GoogleSignInUser Result {
       get {
+#if UNITY_ANDROID
+        // Read the whole result with a single native call.
+        GoogleSignInImpl.ResultView view;
+        GoogleSignInImpl.GoogleSignIn_GetResultView(SelfPtr(), out view);
+        if (view.HasUser == 0) {
+          return null;
+        }
+        return UserFromView(ref view.User);
+#else
         IntPtr ptr = GoogleSignInImpl.GoogleSignIn_Result(SelfPtr());
         if (ptr != IntPtr.Zero) {
           GoogleSignInUser user = new GoogleSignInUser();
@@ -83,8 +131,29 @@ namespace Google.Impl {
         } else {
           return null;
         }
+#endif
+      }
+    }
+
+#if UNITY_ANDROID
+    private static GoogleSignInUser UserFromView(
+        ref GoogleSignInImpl.UserView view) {
+      GoogleSignInUser user = new GoogleSignInUser();
+      user.DisplayName = PtrToString(view.DisplayName, view.DisplayNameLen);
+      user.Email = PtrToString(view.Email, view.EmailLen);
+      user.FamilyName = PtrToString(view.FamilyName, view.FamilyNameLen);
+      user.GivenName = PtrToString(view.GivenName, view.GivenNameLen);
+      user.IdToken = PtrToString(view.IdToken, view.IdTokenLen);
+      user.AuthCode = PtrToString(view.ServerAuthCode,
+                                  view.ServerAuthCodeLen);
+      string url = PtrToString(view.ImageUrl, view.ImageUrlLen);
+      if (!string.IsNullOrEmpty(url)) {
+        user.ImageUrl = new System.Uri(url);
       }
+      user.UserId = PtrToString(view.UserId, view.UserIdLen);
+      return user;
     }
+#endif
 
     /// <summary>
     /// Gets the status.
@@ -27,6 +27,9 @@ namespace Google.Impl {
 
     internal static SignInHelperObject Instance {
       get {
+        if (instance != null) {
+          return instance;
+        }
         if (Application.isPlaying) {
           // add an invisible game object to the scene
           GameObject obj = new GameObject("GoogleSignInHelperObject");
@@ -38,5 +41,18 @@ namespace Google.Impl {
         return instance;
       }
     }
+
+#if UNITY_ANDROID
+    /// <summary>
+    /// Completes the native futures whose results have arrived, starting any
+    /// token refresh that is due, then runs their queued completion callbacks.
+    /// Once a frame, on the game thread, before the coroutines waiting on
+    /// them.
+    /// </summary>
+    void Update() {
+      GoogleSignInImpl.PollEvents();
+      GoogleSignInImpl.GoogleSignIn_DispatchCallbacks();
+    }
+#endif
   }
 }
@@ -0,0 +1,211 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "base64url.h"
+#include <stdint.h>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define BASE64URL_SSSE3 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define BASE64URL_NEON 1
+#endif
+
+namespace googlesignin {
+
+// Returns the 6 bit value of c, or -1 if it is not in the alphabet.
+static inline int DecodeChar(unsigned char c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '-') return 62;
+  if (c == '_') return 63;
+  return -1;
+}
+
+// Decodes count (2 to 4) characters into count - 1 bytes.
+static inline bool DecodeQuantum(const unsigned char *src, size_t count,
+                                 unsigned char *dst) {
+  uint32_t bits = 0;
+  for (size_t i = 0; i < count; i++) {
+    int value = DecodeChar(src[i]);
+    if (value < 0) {
+      return false;
+    }
+    bits |= static_cast<uint32_t>(value) << (18 - 6 * i);
+  }
+  dst[0] = static_cast<unsigned char>(bits >> 16);
+  if (count > 2) dst[1] = static_cast<unsigned char>(bits >> 8);
+  if (count > 3) dst[2] = static_cast<unsigned char>(bits);
+  return true;
+}
+
+#if BASE64URL_SSSE3
+// Returns a mask of the lanes of v in [low, low + count).  The bias moves the
+// range to the bottom of the signed byte range so one compare checks both
+// ends.
+static inline __m128i InRange(__m128i v, char low, char count) {
+  __m128i biased =
+      _mm_add_epi8(v, _mm_set1_epi8(static_cast<char>(-128 - low)));
+  return _mm_cmplt_epi8(biased,
+                        _mm_set1_epi8(static_cast<char>(-128 + count)));
+}
+
+// Decodes 16 characters to 12 bytes.  16 bytes are stored, the last 4 are
+// overwritten by the next block or the scalar tail.
+static inline bool DecodeBlock16(const unsigned char *src, unsigned char *dst) {
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+  __m128i upper = InRange(v, 'A', 26);
+  __m128i lower = InRange(v, 'a', 26);
+  __m128i digit = InRange(v, '0', 10);
+  __m128i dash = _mm_cmpeq_epi8(v, _mm_set1_epi8('-'));
+  __m128i underscore = _mm_cmpeq_epi8(v, _mm_set1_epi8('_'));
+  __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                               _mm_or_si128(_mm_or_si128(digit, dash),
+                                            underscore));
+  if (_mm_movemask_epi8(valid) != 0xffff) {
+    return false;
+  }
+
+  __m128i values = _mm_and_si128(upper, _mm_sub_epi8(v, _mm_set1_epi8('A')));
+  values = _mm_or_si128(
+      values, _mm_and_si128(lower, _mm_sub_epi8(v, _mm_set1_epi8('a' - 26))));
+  values = _mm_or_si128(
+      values, _mm_and_si128(digit, _mm_add_epi8(v, _mm_set1_epi8(52 - '0'))));
+  values = _mm_or_si128(values, _mm_and_si128(dash, _mm_set1_epi8(62)));
+  values = _mm_or_si128(values, _mm_and_si128(underscore, _mm_set1_epi8(63)));
+
+  // Merge pairs of 6 bit values into 12 bits, then pairs of those into 24
+  // bits, and pull the 3 bytes of each 32 bit lane out in big endian order.
+  __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+  merged = _mm_shuffle_epi8(
+      merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1,
+                            -1));
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), merged);
+  return true;
+}
+#endif  // BASE64URL_SSSE3
+
+#if BASE64URL_NEON
+static inline uint8x16_t InRange(uint8x16_t v, uint8_t low, uint8_t count) {
+  return vcltq_u8(vsubq_u8(v, vdupq_n_u8(low)), vdupq_n_u8(count));
+}
+
+// Translates 16 characters to their 6 bit values, clearing lanes of valid
+// that are not in the alphabet.
+static inline uint8x16_t Translate(uint8x16_t v, uint8x16_t *valid) {
+  uint8x16_t upper = InRange(v, 'A', 26);
+  uint8x16_t lower = InRange(v, 'a', 26);
+  uint8x16_t digit = InRange(v, '0', 10);
+  uint8x16_t dash = vceqq_u8(v, vdupq_n_u8('-'));
+  uint8x16_t underscore = vceqq_u8(v, vdupq_n_u8('_'));
+  *valid = vandq_u8(*valid, vorrq_u8(vorrq_u8(upper, lower),
+                                     vorrq_u8(vorrq_u8(digit, dash),
+                                              underscore)));
+
+  uint8x16_t values = vandq_u8(upper, vsubq_u8(v, vdupq_n_u8('A')));
+  values =
+      vorrq_u8(values, vandq_u8(lower, vsubq_u8(v, vdupq_n_u8('a' - 26))));
+  values =
+      vorrq_u8(values, vandq_u8(digit, vaddq_u8(v, vdupq_n_u8(52 - '0'))));
+  values = vorrq_u8(values, vandq_u8(dash, vdupq_n_u8(62)));
+  return vorrq_u8(values, vandq_u8(underscore, vdupq_n_u8(63)));
+}
+
+static inline bool AllLanesSet(uint8x16_t mask) {
+#if defined(__aarch64__)
+  return vminvq_u8(mask) == 0xff;
+#else
+  uint8x8_t folded = vpmin_u8(vget_low_u8(mask), vget_high_u8(mask));
+  folded = vpmin_u8(folded, folded);
+  folded = vpmin_u8(folded, folded);
+  folded = vpmin_u8(folded, folded);
+  return vget_lane_u8(folded, 0) == 0xff;
+#endif
+}
+
+// Decodes 64 characters to 48 bytes.  The load de-interleaves the four
+// characters of each quantum into separate registers and the store
+// interleaves the three output bytes.
+static inline bool DecodeBlock64(const unsigned char *src, unsigned char *dst) {
+  uint8x16x4_t in = vld4q_u8(src);
+  uint8x16_t valid = vdupq_n_u8(0xff);
+  uint8x16_t a = Translate(in.val[0], &valid);
+  uint8x16_t b = Translate(in.val[1], &valid);
+  uint8x16_t c = Translate(in.val[2], &valid);
+  uint8x16_t d = Translate(in.val[3], &valid);
+  if (!AllLanesSet(valid)) {
+    return false;
+  }
+  uint8x16x3_t out;
+  out.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+  out.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+  out.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+  vst3q_u8(dst, out);
+  return true;
+}
+#endif  // BASE64URL_NEON
+
+bool Base64UrlDecode(const char *src, size_t length, unsigned char *dst,
+                     size_t *decoded_size) {
+  while (length > 0 && src[length - 1] == '=') {
+    length--;
+  }
+  if (length % 4 == 1) {
+    return false;
+  }
+  const unsigned char *in = reinterpret_cast<const unsigned char *>(src);
+  const unsigned char *in_end = in + length;
+  unsigned char *out = dst;
+
+#if BASE64URL_SSSE3
+  unsigned char *out_end = dst + Base64UrlDecodedSize(length);
+  // Each block stores 16 bytes, so stop while there is room for that.
+  while (in_end - in >= 16 && out_end - out >= 16) {
+    if (!DecodeBlock16(in, out)) {
+      return false;
+    }
+    in += 16;
+    out += 12;
+  }
+#elif BASE64URL_NEON
+  while (in_end - in >= 64) {
+    if (!DecodeBlock64(in, out)) {
+      return false;
+    }
+    in += 64;
+    out += 48;
+  }
+#endif
+
+  while (in_end - in >= 4) {
+    if (!DecodeQuantum(in, 4, out)) {
+      return false;
+    }
+    in += 4;
+    out += 3;
+  }
+  if (in_end - in > 1) {
+    if (!DecodeQuantum(in, in_end - in, out)) {
+      return false;
+    }
+    out += in_end - in - 1;
+  }
+  *decoded_size = out - dst;
+  return true;
+}
+
+}  // namespace googlesignin
@@ -0,0 +1,40 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_BASE64URL_H
+#define GOOGLESIGNIN_BASE64URL_H
+
+#include <stddef.h>
+
+namespace googlesignin {
+
+// Returns the number of bytes decoded from length characters of unpadded
+// base64url.
+inline size_t Base64UrlDecodedSize(size_t length) {
+  return length / 4 * 3 + (length % 4 ? length % 4 - 1 : 0);
+}
+
+// Decodes the URL safe base64 alphabet used by JWTs (RFC 4648 section 5).
+// Trailing '=' padding is accepted but not required.  dst must have room for
+// Base64UrlDecodedSize(length) bytes, the number of bytes written is
+// returned in decoded_size.  Returns false if src is not valid base64url.
+//
+// Blocks of input are decoded with SSSE3 or NEON when the target has them,
+// the rest with a scalar loop.
+bool Base64UrlDecode(const char *src, size_t length, unsigned char *dst,
+                     size_t *decoded_size);
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_BASE64URL_H
@@ -0,0 +1,55 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_CLOCK_H
+#define GOOGLESIGNIN_CLOCK_H
+
+#include <stdint.h>
+#include <chrono>
+
+namespace googlesignin {
+
+// Source of wall clock time, in milliseconds since the epoch so it can be
+// compared with token expiry claims.  Code that schedules work takes a Clock
+// so a fake one can drive it deterministically.
+class Clock {
+ public:
+  virtual ~Clock() {}
+
+  virtual int64_t NowMillis() const = 0;
+
+  // Returns the system clock.  The instance is never freed.
+  static Clock *System();
+
+ private:
+  class SystemClock;
+};
+
+class Clock::SystemClock : public Clock {
+ public:
+  int64_t NowMillis() const override {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+  }
+};
+
+inline Clock *Clock::System() {
+  static SystemClock *clock = new SystemClock();
+  return clock;
+}
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_CLOCK_H
@@ -0,0 +1,144 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_EVENT_RING_H
+#define GOOGLESIGNIN_EVENT_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <memory>
+
+namespace googlesignin {
+
+// Single producer, single consumer ring of events written by the Java
+// class com.google.googlesignin.EventRing and drained by the native code.
+// The memory is owned here and shared with Java as a direct ByteBuffer, so
+// the layout must match EventRing.java.
+//
+// The header holds the write index and the read index on separate cache
+// lines, both are only stored to here.  Java can't order its ByteBuffer
+// writes, so after writing a record it calls Publish() through JNI.  The
+// indexes are free running byte counts, the capacity is a power of two.
+// Records are 8 byte aligned and start with their size and type.
+//
+// Next to the read index is the CLOCK_MONOTONIC time of the last Drain() in
+// nanoseconds, the clock of System.nanoTime().  Java falls back to calling
+// the native code directly once it is too old, so results are not left in a
+// ring that nobody drains.
+class EventRing {
+ public:
+  static const size_t kWriteIndexOffset = 0;
+  static const size_t kReadIndexOffset = 64;
+  static const size_t kDrainTimeOffset = 72;
+  static const size_t kHeaderSize = 128;
+
+  enum RecordType {
+    // Fills the end of the data when the next record does not fit.
+    kRecordPadding = 0,
+    // The result of a sign-in request.
+    kRecordResult = 1,
+  };
+
+  // A record read from the ring.  The payload points into the ring and is
+  // only valid inside the handler passed to Drain().
+  struct Record {
+    int32_t type;
+    int64_t handle;
+    int32_t status;
+    const unsigned char *payload;
+    size_t payload_size;
+  };
+
+  // capacity must be a power of two.
+  explicit EventRing(size_t capacity)
+      : capacity_(capacity),
+        memory_(new unsigned char[kHeaderSize + capacity]) {
+    memset(memory_.get(), 0, kHeaderSize + capacity);
+  }
+
+  void *memory() const { return memory_.get(); }
+  size_t size() const { return kHeaderSize + capacity_; }
+
+  // Makes the records Java wrote before write_index visible to Drain().
+  // Called on the producer thread, after it wrote them.
+  void Publish(uint32_t write_index) {
+    uint32_t *index =
+        reinterpret_cast<uint32_t *>(memory_.get() + kWriteIndexOffset);
+    __atomic_store_n(index, write_index, __ATOMIC_RELEASE);
+  }
+
+  // Calls handler(const Record &) for each record written since the last
+  // call, then releases the space to the producer.  Nothing is allocated.
+  template <typename Handler>
+  void Drain(Handler handler) {
+    uint32_t *write_index =
+        reinterpret_cast<uint32_t *>(memory_.get() + kWriteIndexOffset);
+    uint32_t *read_index =
+        reinterpret_cast<uint32_t *>(memory_.get() + kReadIndexOffset);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    __atomic_store_n(
+        reinterpret_cast<int64_t *>(memory_.get() + kDrainTimeOffset),
+        static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec,
+        __ATOMIC_RELAXED);
+    uint32_t write = __atomic_load_n(write_index, __ATOMIC_ACQUIRE);
+    uint32_t read = *read_index;
+    if (read == write) {
+      return;
+    }
+
+    const unsigned char *data = memory_.get() + kHeaderSize;
+    while (read != write) {
+      const unsigned char *pos = data + (read & (capacity_ - 1));
+      int32_t size;
+      int32_t type;
+      memcpy(&size, pos, sizeof(size));
+      memcpy(&type, pos + 4, sizeof(type));
+      if (size <= 0) {
+        // Corrupt ring, drop everything that is left.
+        read = write;
+        break;
+      }
+      if (type == kRecordResult) {
+        Record record;
+        int32_t payload_size;
+        record.type = type;
+        memcpy(&record.handle, pos + 8, sizeof(record.handle));
+        memcpy(&record.status, pos + 16, sizeof(record.status));
+        memcpy(&payload_size, pos + 20, sizeof(payload_size));
+        record.payload = payload_size >= 0 ? pos + kResultHeaderSize : nullptr;
+        record.payload_size = payload_size >= 0 ? payload_size : 0;
+        handler(record);
+      }
+      read += static_cast<uint32_t>(size);
+    }
+    __atomic_store_n(read_index, read, __ATOMIC_RELEASE);
+  }
+
+ private:
+  // size, type, handle, status and payload length.
+  static const size_t kResultHeaderSize = 24;
+
+  EventRing(const EventRing &copy) = delete;
+  EventRing &operator=(const EventRing &copy) = delete;
+
+  const size_t capacity_;
+  std::unique_ptr<unsigned char[]> memory_;
+};
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_EVENT_RING_H
@@ -15,24 +15,248 @@
 #ifndef GOOGLESIGNIN_FUTURE_H  // NOLINT
 #define GOOGLESIGNIN_FUTURE_H
 
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <mutex>
+#include <vector>
+
 namespace googlesignin {
 
+// Callback invoked when a Future completes.
+typedef void (*FutureCallback)(void* user_data);
+
+namespace internal {
+
+// A completion callback registered on a future.
+struct CompletionCallback {
+  FutureCallback callback;
+  void* user_data;
+  bool queued;
+};
+
+// Callbacks that have completed and are waiting for DispatchCallbacks().
+inline std::mutex& QueuedCallbacksMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+inline std::vector<CompletionCallback>& QueuedCallbacks() {
+  static std::vector<CompletionCallback> callbacks;
+  return callbacks;
+}
+
+inline void RunCompletionCallback(const CompletionCallback& callback) {
+  if (callback.queued) {
+    std::lock_guard<std::mutex> lock(QueuedCallbacksMutex());
+    QueuedCallbacks().push_back(callback);
+  } else {
+    callback.callback(callback.user_data);
+  }
+}
+
+// Runs the queued callbacks on the calling thread.
+inline void DispatchQueuedCallbacks() {
+  std::vector<CompletionCallback> callbacks;
+  {
+    std::lock_guard<std::mutex> lock(QueuedCallbacksMutex());
+    callbacks.swap(QueuedCallbacks());
+  }
+  for (size_t i = 0; i < callbacks.size(); i++) {
+    callbacks[i].callback(callbacks[i].user_data);
+  }
+}
+
+// Delivers the results queued for the calling thread, see SetWaitPump().
+typedef bool (*WaitPump)();
+
+inline std::atomic<WaitPump>& CurrentWaitPump() {
+  static std::atomic<WaitPump> pump(nullptr);
+  return pump;
+}
+
+// How long a waiter that pumps blocks before pumping again, since the
+// results it waits for may only be delivered by its own pump.
+const int kWaitPumpIntervalMs = 5;
+
+// Installs pump, which Wait() and WaitFor() call before blocking.  It returns
+// true if the calling thread is the one results are queued for, after
+// delivering the queued results, false otherwise.
+inline void SetWaitPump(WaitPump pump) {
+  CurrentWaitPump().store(pump, std::memory_order_release);
+}
+
+// Calls the pump, if any, and returns what it returned.
+inline bool RunWaitPump() {
+  WaitPump pump = CurrentWaitPump().load(std::memory_order_acquire);
+  return pump && pump();
+}
+
+// Blocks while *addr == expected, for at most timeout (null is forever).
+// May return early, callers need to re-check the value.
+inline void FutexWait(std::atomic<int>* addr, int expected,
+                      const struct timespec* timeout) {
+  syscall(SYS_futex, reinterpret_cast<int*>(addr), FUTEX_WAIT_PRIVATE,
+          expected, timeout, nullptr, 0);
+}
+
+// Wakes all the threads blocked in FutexWait on addr.
+inline void FutexWakeAll(std::atomic<int>* addr) {
+  syscall(SYS_futex, reinterpret_cast<int*>(addr), FUTEX_WAKE_PRIVATE,
+          INT_MAX, nullptr, nullptr, 0);
+}
+
+}  // namespace internal
+
 // Provides a future promise for an asynchronous result of type <T>
+//
+// The state of the future is a single atomic word, which is either pending
+// or holds the status code of the completed operation.  The result is
+// published before the state with release ordering, so any thread that sees
+// Pending() return false also sees the result.  All the methods can be called
+// from any thread.
 template <class T>
 class Future {
  public:
-  virtual ~Future() {}
+  // pending_status is what Status() returns while the operation is pending.
+  explicit Future(int pending_status)
+      : state_(kPendingState),
+        waiters_(0),
+        pending_status_(pending_status),
+        result_(nullptr) {}
+
   // Returns the Status of the operation.  This is set once Pending is false.
-  virtual int Status() const = 0;
+  int Status() const {
+    int state = state_.load(std::memory_order_acquire);
+    return state == kPendingState ? pending_status_ : state;
+  }
 
   // Returns the Result of the operation if successful.  If it is not
   // successful, the error code should be retrieved using Status().  The result
   // is available once Pending() is false.
-  virtual T* Result() const = 0;
+  T* Result() const {
+    return Pending() ? nullptr : result_.load(std::memory_order_relaxed);
+  }
 
   // Returns true while the promise has not been fulfilled by the operation.
   // Once it is false, the Status and Result fields are populated.
-  virtual bool Pending() const = 0;
+  bool Pending() const {
+    return state_.load(std::memory_order_acquire) == kPendingState;
+  }
+
+  // Blocks the calling thread until the operation completes.  On the thread
+  // that polls for results it keeps delivering them while waiting.
+  void Wait() const {
+    while (Pending()) {
+      if (internal::RunWaitPump()) {
+        struct timespec interval = {0, internal::kWaitPumpIntervalMs * 1000000};
+        BlockWhilePending(&interval);
+      } else {
+        BlockWhilePending(nullptr);
+      }
+    }
+  }
+
+  // Blocks the calling thread until the operation completes or timeout_ms
+  // have passed.  Returns true if the operation completed.
+  bool WaitFor(int timeout_ms) const {
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(timeout_ms);
+    while (Pending()) {
+      std::chrono::nanoseconds remaining =
+          deadline - std::chrono::steady_clock::now();
+      if (remaining.count() <= 0) {
+        return false;
+      }
+      if (internal::RunWaitPump()) {
+        remaining = std::min<std::chrono::nanoseconds>(
+            remaining,
+            std::chrono::milliseconds(internal::kWaitPumpIntervalMs));
+      }
+      struct timespec timeout;
+      timeout.tv_sec = static_cast<time_t>(remaining.count() / 1000000000);
+      timeout.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+      BlockWhilePending(&timeout);
+    }
+    return true;
+  }
+
+  // Registers a callback that is called once, the next time the operation
+  // completes.  If the operation has already completed, it is called right
+  // away.  If queued is false the callback runs on the thread that completes
+  // the operation (the Java UI thread on Android), otherwise it runs on the
+  // next call to GoogleSignIn::DispatchCallbacks() on the caller's thread.
+  void SetCompletionCallback(FutureCallback callback, void* user_data,
+                             bool queued) {
+    internal::CompletionCallback completion = {callback, user_data, queued};
+    {
+      std::lock_guard<std::mutex> lock(callbacks_mutex_);
+      if (Pending()) {
+        callbacks_.push_back(completion);
+        return;
+      }
+    }
+    internal::RunCompletionCallback(completion);
+  }
+
+  // Sets the future back to pending for a new operation.  Callbacks that were
+  // registered for the previous operation and have not been called yet are
+  // dropped, so they can't fire for the new one.
+  void Reset() {
+    {
+      std::lock_guard<std::mutex> lock(callbacks_mutex_);
+      callbacks_.clear();
+    }
+    state_.store(kPendingState, std::memory_order_release);
+    result_.store(nullptr, std::memory_order_relaxed);
+  }
+
+  // Completes the operation, waking any waiting threads and calling the
+  // completion callbacks.
+  void Complete(int status, T* result) {
+    result_.store(result, std::memory_order_relaxed);
+    // Pending is encoded as INT_MIN, which is never a valid status.  This is
+    // sequentially consistent so it can't be reordered with the load of
+    // waiters_ below.
+    state_.store(status, std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) > 0) {
+      internal::FutexWakeAll(&state_);
+    }
+
+    std::vector<internal::CompletionCallback> callbacks;
+    {
+      std::lock_guard<std::mutex> lock(callbacks_mutex_);
+      callbacks.swap(callbacks_);
+    }
+    for (size_t i = 0; i < callbacks.size(); i++) {
+      internal::RunCompletionCallback(callbacks[i]);
+    }
+  }
+
+ private:
+  static const int kPendingState = INT_MIN;
+
+  Future(const Future& copy) = delete;
+  Future& operator=(const Future& copy) = delete;
+
+  void BlockWhilePending(const struct timespec* timeout) const {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    internal::FutexWait(&state_, kPendingState, timeout);
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  mutable std::atomic<int> state_;
+  mutable std::atomic<int> waiters_;
+  const int pending_status_;
+  std::atomic<T*> result_;
+  std::mutex callbacks_mutex_;
+  std::vector<internal::CompletionCallback> callbacks_;
 };
 
 }  // namespace googlesignin
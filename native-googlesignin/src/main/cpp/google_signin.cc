@@ -13,12 +13,25 @@
 //    limitations under the License.
 
 #include "google_signin.h"
-#include <android/log.h>
+#include <string.h>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include "event_ring.h"
+#include "handle_table.h"
 #include "google_signin_user_impl.h"
+#include "id_token.h"
 #include "jni_init.h"
+#include "jni_recorder.h"
+#include "jwks_cache.h"
+#include "log.h"
+#include "refresh_scheduler.h"
+#include "session_cache.h"
+#include "stats.h"
+#include "trace.h"
 
-#define TAG "native-googlesignin"
 #define HELPER_CLASSNAME "com/google/googlesignin/GoogleSignInHelper"
 
 /*
@@ -38,6 +51,7 @@ public static void configure(Activity parentActivity,
                              boolean hideUiPopups,
                              String defaultAccountName,
                              String[] additionalScopes,
+                             long configurationFingerprint,
                              long requestHandle)
 */
 #define CONFIG_METHOD_NAME "configure"
@@ -48,7 +62,31 @@ public static void configure(Activity parentActivity,
   "ZZZZZ"                   \
   "Ljava/lang/String;"      \
   "[Ljava/lang/String;"     \
-  "J)V"
+  "JJ)V"
+
+/*
+public static boolean resubmitConfiguration(Activity parentActivity,
+                                            long configurationFingerprint,
+                                            long requestHandle)
+*/
+#define RESUBMIT_METHOD_NAME "resubmitConfiguration"
+#define RESUBMIT_METHOD_SIG "(Landroid/app/Activity;JJ)Z"
+
+/*
+public static boolean warmUp(Activity parentActivity)
+*/
+#define WARMUP_METHOD_NAME "warmUp"
+#define WARMUP_METHOD_SIG "(Landroid/app/Activity;)Z"
+
+/*
+public static void setEventRing(ByteBuffer buffer)
+*/
+#define SETEVENTRING_METHOD_NAME "setEventRing"
+#define SETEVENTRING_METHOD_SIG "(Ljava/nio/ByteBuffer;)V"
+
+// Size of the data in the event ring, must be a power of two.  This fits a
+// burst of results with ID tokens.
+#define EVENT_RING_CAPACITY (64 * 1024)
 
 /*
 public static void nativeSignIn()
@@ -74,6 +112,12 @@ public static void nativeSignOut()
 #define SIGNOUT_METHOD_NAME "signOut"
 #define SIGNOUT_METHOD_SIG "(Landroid/app/Activity;)V"
 
+/*
+public static native void nativeOnActivityResumed()
+ */
+#define NATIVEONACTIVITYRESUMED_METHOD_NAME "nativeOnActivityResumed"
+#define NATIVEONACTIVITYRESUMED_METHOD_SIG "()V"
+
 /*
 public static void nativeOnResult(long requestHandle, int result,
                                   GoogleSignInAccount acct),
@@ -85,9 +129,88 @@ public static void nativeOnResult(long requestHandle, int result,
   "Lcom/google/android/gms/auth/api/signin/GoogleSignInAccount;" \
   ")V"
 
+/*
+public static void enableTracing(boolean flag)
+*/
+#define ENABLE_TRACING_METHOD_NAME "enableTracing"
+#define ENABLE_TRACING_METHOD_SIG "(Z)V"
+
+/*
+public static native void nativeTraceEvent(int span, int phase, long handle)
+ */
+#define NATIVETRACEEVENT_METHOD_NAME "nativeTraceEvent"
+#define NATIVETRACEEVENT_METHOD_SIG "(IIJ)V"
+
+/*
+static native void nativePublishEvents(int writeIndex)
+ */
+#define NATIVEPUBLISHEVENTS_METHOD_NAME "nativePublishEvents"
+#define NATIVEPUBLISHEVENTS_METHOD_SIG "(I)V"
+
 namespace googlesignin {
 
-class GoogleSignInFuture;
+// The future returned by SignIn() and SignInSilently().
+typedef Future<GoogleSignIn::SignInResult> GoogleSignInFuture;
+
+// Maximum number of requests that can be outstanding at once.  Starting one
+// more cancels the oldest.
+#define MAX_OUTSTANDING_REQUESTS 16
+
+// CommonStatusCodes.SIGN_IN_REQUIRED, returned by a silent sign-in when
+// there is no signed in user.
+#define STATUS_CODE_SIGN_IN_REQUIRED 4
+
+// The futures of all requests, indexed by the handle passed to Java.  Shared
+// by all instances since results arrive through a static native method.
+typedef HandleTable<GoogleSignInFuture, MAX_OUTSTANDING_REQUESTS>
+    RequestTable;
+
+static RequestTable &Requests() {
+  static RequestTable table(
+      static_cast<int>(GoogleSignIn::kStatusCodeUninitialized));
+  return table;
+}
+
+// When and how the sign-in in each slot of Requests() was started, for the
+// stats.  handle is the request the entry is for, 0 if none.
+struct RequestStart {
+  std::atomic<uint64_t> handle;
+  std::atomic<int64_t> started_ms;
+  std::atomic<int> flow;
+};
+
+static RequestStart request_starts[MAX_OUTSTANDING_REQUESTS];
+
+// The result of the request in each slot of Requests(), completed into its
+// future.  The result owns a reference to its user until the slot is
+// acquired again.
+static GoogleSignIn::SignInResult request_results[MAX_OUTSTANDING_REQUESTS];
+
+// The refresh scheduler, if any, that is fed the result of the sign-in in
+// each slot of Requests().  Set when the sign-in starts and taken by
+// CompleteRequest(), so the schedule follows the results on whichever thread
+// completes them, whether or not anything polls.
+static std::shared_ptr<RefreshScheduler>
+    request_schedulers[MAX_OUTSTANDING_REQUESTS];
+
+static GoogleSignIn::SignInResult *SetRequestResult(jlong handle, int status,
+                                                    GoogleSignInUser *user) {
+  GoogleSignIn::SignInResult *result =
+      &request_results[static_cast<uint64_t>(handle) %
+                       MAX_OUTSTANDING_REQUESTS];
+  if (result->User) {
+    result->User->Release();
+  }
+  result->StatusCode = status;
+  result->User = user;
+  return result;
+}
+
+static int64_t SteadyMillis() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
 
 // The implementation of GoogleSignIn.  This implements the JNI interface to
 // call the Java helper class the handles the authentication flow within Java.
@@ -95,8 +218,33 @@ class GoogleSignInFuture;
 class GoogleSignIn::GoogleSignInImpl {
  public:
   jobject activity_;
+  // The future of the last request started, owned by Requests().
   GoogleSignInFuture *current_result_;
+  jlong current_handle_;
+  // True once a sign-in was started with current_handle_.  Until then the
+  // handle was only sent with the configuration and the next sign-in
+  // reuses it.
+  bool current_started_;
   Configuration *current_configuration_;
+  // Fingerprint of current_configuration_, and of the configuration this
+  // instance last sent to Java.  Used to skip re-sending a configuration that
+  // has not changed.  Java keeps only the last configuration of the process,
+  // so it checks the fingerprint again and refuses the resubmit if another
+  // instance has configured since.
+  uint64_t configuration_fingerprint_;
+  uint64_t sent_fingerprint_;
+  // Number of times the configuration was sent in full or skipped.
+  int configure_sent_count_;
+  int configure_skipped_count_;
+  // Schedules token refreshes while enabled.  Replaced atomically, as it is
+  // read by GetRefreshedUser() on any thread.
+  std::shared_ptr<RefreshScheduler> refresh_scheduler_;
+  // Keys for VerifyIdToken(), replaced atomically so verification can run
+  // on other threads while new keys are loaded.
+  std::shared_ptr<const JwksCache> jwks_;
+  // The web_client_id of the configuration, the audience VerifyIdToken()
+  // expects.  Replaced atomically by Configure() for the same reason.
+  std::shared_ptr<const std::string> audience_;
 
   // Constructs the implementation providing the Java activity to use when
   // making calls.
@@ -115,23 +263,138 @@ class GoogleSignIn::GoogleSignInImpl {
   // Get the result of the last sign-in.
   const Future<SignInResult> *GetLastSignInResult();
 
+  void EnableSessionCache(bool enable);
+
+  void EnableTokenRefresh(bool enable, Clock *clock);
+
+  std::shared_ptr<const GoogleSignInUser> GetRefreshedUser() const;
+
+  bool LoadJwks(const char *json, size_t length);
+  bool LoadJwksFile(const char *path);
+  // Installs keys parsed by the above, logging the outcome.
+  bool SetJwks(JwksCache *keys);
+
+  IdTokenStatus VerifyIdToken(const GoogleSignInUser &user) const;
+
   // Signs out.
   void SignOut();
 
   void Disconnect();
 
+  void GetConfigureCounts(int *sent, int *skipped) const;
+
+  bool WarmUp();
+
+  void PollEvents();
+
+  // Resolves the classes and method ids on a background thread.
+  static void Prewarm(jobject activity);
+
   // Native method implementation for the Java class.
   static void NativeOnAuthResult(JNIEnv *env, jobject obj, jlong handle,
                                  jint result, jobject user);
+  static void NativeOnActivityResumed(JNIEnv *env, jclass clazz);
+  static void NativeTraceEvent(JNIEnv *env, jclass clazz, jint span,
+                               jint phase, jlong handle);
+
+  // Called by EventRing.writeResult after writing a record.
+  static void NativePublishEvents(JNIEnv *env, jclass clazz,
+                                  jint write_index);
 
  private:
+  // Completes the requests whose results are in the event ring.
+  static void DrainEvents();
+
+  // The wait pump, see internal::SetWaitPump().  Drains the event ring if
+  // called on the thread that last polled, since a Wait() there would
+  // otherwise block the only thread that completes the results in it.
+  static bool PumpEvents();
+
+  // Completes the request identified by handle.
+  static void CompleteRequest(jlong handle, int status, GoogleSignInUser *user);
+
+  // Acquires a handle for a new request, canceling the oldest outstanding
+  // request if there are too many.  The request's future is reset.
+  static jlong AcquireRequest();
+
+  // Acquires a handle and future for a new request and makes it current.
+  void StartRequest();
+
+  // Cancels the sign-ins still outstanding, so a result arriving after a
+  // sign-out or disconnect is dropped as stale instead of signing the user
+  // back in through the session cache or the token refresh.
+  void CancelRequests();
+
+  // Cancels the sign-ins, then clears the session cache and the token
+  // refresh, for SignOut() and Disconnect().
+  void ForgetUser();
+
+  // Records the start of a sign-in with handle, and its completion, in the
+  // stats.  A completion of a request whose start was not recorded, i.e. no
+  // sign-in was started with it, is not counted.
+  static void RecordSignInStart(jlong handle, SignInStats::Flow flow);
+  static void RecordSignInCompletion(jlong handle, int status);
+
+  // Starts the request for a sign-in, reusing the one started by Configure()
+  // if it is still outstanding.
+  void StartSignInRequest();
+
+  // Starts a silent sign-in in Java as the current request, without looking
+  // at the session cache.
+  void StartSilentSignIn();
+
+  // Has the result of the sign-in with handle fed to scheduler when it
+  // completes.
+  static void ObserveRequest(jlong handle,
+                             const std::shared_ptr<RefreshScheduler> &scheduler);
+
+  // Feeds a completed sign-in's result to scheduler.
+  static void FeedRefreshScheduler(RefreshScheduler *scheduler, int status,
+                                   const GoogleSignInUser *user);
+
+  // Sends the configuration and request handle to Java, only sending the
+  // handle if the configuration has not changed since it was last sent.
+  void SendConfiguration();
   void CallConfigure();
 
+  static uint64_t Fingerprint(const Configuration &configuration);
+
+  // Runs InitializeStatics() until it succeeds once, on whichever thread
+  // gets there first, the others wait for it.  Returns whether the statics
+  // are initialized.
+  static bool EnsureStatics(jobject context);
+
+  // Finds the helper class, registers the natives and looks up the method
+  // ids.  Returns false if any of them is missing, e.g. when the helper
+  // class can't be found from a thread without the app ClassLoader.
+  static bool InitializeStatics(jobject context);
+
   static const JNINativeMethod methods[];
+  static std::mutex statics_mutex_;
+  // Only set once InitializeStatics() succeeded.
+  static std::atomic<bool> statics_initialized_;
 
   static jclass helper_clazz_;
   static jmethodID enable_debug_method_;
   static jmethodID config_method_;
+  static jmethodID resubmit_method_;
+  static jmethodID warmup_method_;
+  static jmethodID set_event_ring_method_;
+  static EventRing *event_ring_;
+  // The thread that last called PollEvents().
+  static std::atomic<std::thread::id> poll_thread_;
+  // Created when first enabled and never freed, since results can be
+  // completed on the Java UI thread at any time.
+  static SessionCache *session_cache_;
+  static std::atomic<bool> session_cache_enabled_;
+  // Counts the sign-outs.  CancelRequests() skips the requests already being
+  // completed, so CompleteRequest() reads the epoch before claiming its
+  // request and, if a sign-out happened since, completes it as canceled.
+  // Guarded by sign_out_mutex_ from checking it to having stored the user in
+  // the session cache and fed the token refresh, so a sign-out clears them
+  // either after or not at all.
+  static std::mutex sign_out_mutex_;
+  static std::atomic<uint64_t> sign_out_epoch_;
   static jmethodID disconnect_method_;
   static jmethodID signin_method_;
   static jmethodID signinsilently_method_;
@@ -145,67 +408,159 @@ const JNINativeMethod GoogleSignIn::GoogleSignInImpl::methods[] = {
     reinterpret_cast<void *>(
         GoogleSignIn::GoogleSignInImpl::NativeOnAuthResult),
   },
+  {
+    NATIVEONACTIVITYRESUMED_METHOD_NAME,
+    NATIVEONACTIVITYRESUMED_METHOD_SIG,
+    reinterpret_cast<void *>(
+        GoogleSignIn::GoogleSignInImpl::NativeOnActivityResumed),
+  },
+  {
+    NATIVETRACEEVENT_METHOD_NAME,
+    NATIVETRACEEVENT_METHOD_SIG,
+    reinterpret_cast<void *>(
+        GoogleSignIn::GoogleSignInImpl::NativeTraceEvent),
+  },
+  {
+    NATIVEPUBLISHEVENTS_METHOD_NAME,
+    NATIVEPUBLISHEVENTS_METHOD_SIG,
+    reinterpret_cast<void *>(
+        GoogleSignIn::GoogleSignInImpl::NativePublishEvents),
+  },
 };
 
+std::mutex GoogleSignIn::GoogleSignInImpl::statics_mutex_;
+std::atomic<bool> GoogleSignIn::GoogleSignInImpl::statics_initialized_(false);
 jclass GoogleSignIn::GoogleSignInImpl::helper_clazz_ = 0;
 jmethodID GoogleSignIn::GoogleSignInImpl::enable_debug_method_ = 0;
 jmethodID GoogleSignIn::GoogleSignInImpl::config_method_ = 0;
+jmethodID GoogleSignIn::GoogleSignInImpl::resubmit_method_ = 0;
+jmethodID GoogleSignIn::GoogleSignInImpl::warmup_method_ = 0;
+jmethodID GoogleSignIn::GoogleSignInImpl::set_event_ring_method_ = 0;
+EventRing *GoogleSignIn::GoogleSignInImpl::event_ring_ = nullptr;
+std::atomic<std::thread::id> GoogleSignIn::GoogleSignInImpl::poll_thread_;
+SessionCache *GoogleSignIn::GoogleSignInImpl::session_cache_ = nullptr;
+std::atomic<bool> GoogleSignIn::GoogleSignInImpl::session_cache_enabled_(
+    false);
+std::mutex GoogleSignIn::GoogleSignInImpl::sign_out_mutex_;
+std::atomic<uint64_t> GoogleSignIn::GoogleSignInImpl::sign_out_epoch_(0);
 jmethodID GoogleSignIn::GoogleSignInImpl::disconnect_method_ = 0;
 jmethodID GoogleSignIn::GoogleSignInImpl::signin_method_ = 0;
 jmethodID GoogleSignIn::GoogleSignInImpl::signinsilently_method_ = 0;
 jmethodID GoogleSignIn::GoogleSignInImpl::signout_method_ = 0;
 
-// Implementation of the SignIn future.
-class GoogleSignInFuture : public Future<GoogleSignIn::SignInResult> {
-  virtual int Status() const {
-    return result_ ? result_->StatusCode
-                   : GoogleSignIn::StatusCode::kStatusCodeUninitialized;
-  }
-  virtual GoogleSignIn::SignInResult *Result() const { return result_; }
-  virtual bool Pending() const {
-    return (!result_) || result_->StatusCode ==
-                             GoogleSignIn::StatusCode::kStatusCodeUninitialized;
-  }
-
- public:
-  GoogleSignInFuture() : result_(nullptr) {}
-  void SetResult(GoogleSignIn::SignInResult *result) { result_ = result; }
-
- private:
-  GoogleSignIn::SignInResult *result_;
-};
-
 // Constructs a new instance.  The static members are initialized if need-be.
 GoogleSignIn::GoogleSignInImpl::GoogleSignInImpl(jobject activity)
-    : current_result_(nullptr), current_configuration_(nullptr) {
+    : current_result_(nullptr),
+      current_handle_(0),
+      current_started_(false),
+      current_configuration_(nullptr),
+      configuration_fingerprint_(0),
+      sent_fingerprint_(0),
+      configure_sent_count_(0),
+      configure_skipped_count_(0) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
   JNIEnv *env = GetJniEnv();
 
   activity_ = env->NewGlobalRef(activity);
 
+  // Waits if Prewarm() is still resolving on its thread, and resolves here
+  // if it didn't manage to.
+  bool initialized = EnsureStatics(activity);
+  assert(initialized);
+  (void)initialized;
+
+  GOOGLESIGNIN_LOG_DEBUG(
+      "Constructed in %lld us",
+      static_cast<long long>(
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count()));
+}
+
+bool GoogleSignIn::GoogleSignInImpl::EnsureStatics(jobject context) {
+  if (statics_initialized_.load(std::memory_order_acquire)) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(statics_mutex_);
+  if (statics_initialized_.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  if (!InitializeStatics(context)) {
+    return false;
+  }
+  statics_initialized_.store(true, std::memory_order_release);
+  return true;
+}
+
+bool GoogleSignIn::GoogleSignInImpl::InitializeStatics(jobject context) {
+  JNIEnv *env = GetJniEnv();
+
+  // Find the java  helper class and initialize it.
+  helper_clazz_ = FindClass(HELPER_CLASSNAME, context);
   if (!helper_clazz_) {
-    // Find the java  helper class and initialize it.
-    helper_clazz_ = FindClass(HELPER_CLASSNAME, activity);
-
-    assert(helper_clazz_);
-
-    if (helper_clazz_) {
-      helper_clazz_ = (jclass)env->NewGlobalRef(helper_clazz_);
-      env->RegisterNatives(helper_clazz_, methods,
-                           sizeof(methods) / sizeof(methods[0]));
-      enable_debug_method_ = env->GetStaticMethodID(helper_clazz_, ENABLE_DEBUG_METHOD_NAME,
-                                              ENABLE_DEBUG_METHOD_SIG);
-      config_method_ = env->GetStaticMethodID(helper_clazz_, CONFIG_METHOD_NAME,
-                                              CONFIG_METHOD_SIG);
-      disconnect_method_ = env->GetStaticMethodID(
-          helper_clazz_, DISCONNECT_METHOD_NAME, DISCONNECT_METHOD_SIG);
-      signin_method_ = env->GetStaticMethodID(helper_clazz_, SIGNIN_METHOD_NAME,
-                                              SIGNIN_METHOD_SIG);
-      signinsilently_method_ = env->GetStaticMethodID(
-          helper_clazz_, SIGNINSILENTLY_METHOD_NAME, SIGNINSILENTLY_METHOD_SIG);
-      signout_method_ = env->GetStaticMethodID(
-          helper_clazz_, SIGNOUT_METHOD_NAME, SIGNOUT_METHOD_SIG);
-    }
+    GOOGLESIGNIN_LOG_WARN("Could not find %s", HELPER_CLASSNAME);
+    return false;
+  }
+
+  if (env->RegisterNatives(helper_clazz_, methods,
+                           sizeof(methods) / sizeof(methods[0])) != JNI_OK) {
+    env->ExceptionClear();
+    GOOGLESIGNIN_LOG_WARN("Could not register the natives of %s",
+                          HELPER_CLASSNAME);
+    return false;
+  }
+  enable_debug_method_ = GetStaticMethod(
+      helper_clazz_, ENABLE_DEBUG_METHOD_NAME, ENABLE_DEBUG_METHOD_SIG);
+  config_method_ =
+      GetStaticMethod(helper_clazz_, CONFIG_METHOD_NAME, CONFIG_METHOD_SIG);
+  resubmit_method_ = GetStaticMethod(helper_clazz_, RESUBMIT_METHOD_NAME,
+                                     RESUBMIT_METHOD_SIG);
+  warmup_method_ =
+      GetStaticMethod(helper_clazz_, WARMUP_METHOD_NAME, WARMUP_METHOD_SIG);
+  set_event_ring_method_ = GetStaticMethod(
+      helper_clazz_, SETEVENTRING_METHOD_NAME, SETEVENTRING_METHOD_SIG);
+  disconnect_method_ = GetStaticMethod(helper_clazz_, DISCONNECT_METHOD_NAME,
+                                       DISCONNECT_METHOD_SIG);
+  signin_method_ =
+      GetStaticMethod(helper_clazz_, SIGNIN_METHOD_NAME, SIGNIN_METHOD_SIG);
+  signinsilently_method_ = GetStaticMethod(
+      helper_clazz_, SIGNINSILENTLY_METHOD_NAME, SIGNINSILENTLY_METHOD_SIG);
+  signout_method_ =
+      GetStaticMethod(helper_clazz_, SIGNOUT_METHOD_NAME, SIGNOUT_METHOD_SIG);
+  if (!enable_debug_method_ || !config_method_ || !resubmit_method_ ||
+      !warmup_method_ || !set_event_ring_method_ || !disconnect_method_ ||
+      !signin_method_ || !signinsilently_method_ || !signout_method_) {
+    GOOGLESIGNIN_LOG_WARN("Could not resolve the methods of %s",
+                          HELPER_CLASSNAME);
+    return false;
   }
+#if defined(GOOGLESIGNIN_TRACE)
+  // The Java side only calls nativeTraceEvent once told to.
+  jmethodID enable_tracing = GetStaticMethod(
+      helper_clazz_, ENABLE_TRACING_METHOD_NAME, ENABLE_TRACING_METHOD_SIG);
+  if (enable_tracing) {
+    env->CallStaticVoidMethod(helper_clazz_, enable_tracing, JNI_TRUE);
+    env->ExceptionClear();
+  }
+#endif
+  return true;
+}
+
+void GoogleSignIn::GoogleSignInImpl::Prewarm(jobject activity) {
+  // The thread keeps its own reference, the caller's may be local.
+  jobject context = GetJniEnv()->NewGlobalRef(activity);
+  std::thread([context]() {
+    // Either can fail, e.g. without a context to find the app classes
+    // with.  They are then resolved by the first instance and the first
+    // result instead.
+    if (!EnsureStatics(context) || !GoogleSignInUserImpl::Initialize(context)) {
+      GOOGLESIGNIN_LOG_WARN("Prewarm failed, resolving on first use");
+    }
+    if (context) {
+      GetJniEnv()->DeleteGlobalRef(context);
+    }
+  }).detach();
 }
 
 GoogleSignIn::GoogleSignInImpl::~GoogleSignInImpl() {
@@ -213,13 +568,17 @@ GoogleSignIn::GoogleSignInImpl::~GoogleSignInImpl() {
 
   env->DeleteGlobalRef(activity_);
   activity_ = nullptr;
-  delete current_result_;
-  current_result_ = nullptr;
+  delete current_configuration_;
 }
 
 void GoogleSignIn::GoogleSignInImpl::EnableDebugLogging(bool flag) {
   JNIEnv *env = GetJniEnv();
 
+  // Checked natively by each log call, the Java side has its own flag.
+  Log::SetLevel(flag ? GOOGLESIGNIN_LOG_LEVEL_DEBUG
+                     : GOOGLESIGNIN_LOG_LEVEL_INFO);
+
+  StatsRecorder::RecordJni(SignInStats::kOpOther, 1, 0);
   env->CallStaticVoidMethod(helper_clazz_, enable_debug_method_, flag);
 
 }
@@ -228,27 +587,113 @@ void GoogleSignIn::GoogleSignInImpl::Configure(
     const Configuration &configuration) {
   delete current_configuration_;
   current_configuration_ = new Configuration(configuration);
+  std::shared_ptr<const std::string> audience(
+      new std::string(configuration.web_client_id));
+  std::atomic_store(&audience_, audience);
+  configuration_fingerprint_ = Fingerprint(configuration);
+
+  // Keep a handle that was only sent with the previous configuration,
+  // acquiring another would leave it outstanding until it is evicted, which
+  // cancels the sign-ins started after it.
+  if (current_started_ || !Requests().Lookup(current_handle_)) {
+    StartRequest();
+  }
+  current_started_ = false;
+  SendConfiguration();
+}
+
+// FNV-1a hash helpers used to fingerprint the configuration.
+static const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+static const uint64_t kFnvPrime = 1099511628211ULL;
 
-  delete current_result_;
-  current_result_ = new GoogleSignInFuture();
+static uint64_t FnvHash(uint64_t hash, const void *data, size_t len) {
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < len; i++) {
+    hash ^= bytes[i];
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+static uint64_t FnvHash(uint64_t hash, bool value) {
+  unsigned char byte = value ? 1 : 0;
+  return FnvHash(hash, &byte, 1);
+}
 
+// Strings are prefixed with their length so adjacent fields can't collide.
+static uint64_t FnvHash(uint64_t hash, const std::string &value) {
+  uint64_t len = value.size();
+  hash = FnvHash(hash, &len, sizeof(len));
+  return FnvHash(hash, value.data(), value.size());
+}
+
+uint64_t GoogleSignIn::GoogleSignInImpl::Fingerprint(
+    const Configuration &configuration) {
+  uint64_t hash = kFnvOffsetBasis;
+  hash = FnvHash(hash, configuration.use_game_signin);
+  hash = FnvHash(hash, configuration.web_client_id);
+  hash = FnvHash(hash, configuration.request_auth_code);
+  hash = FnvHash(hash, configuration.force_token_refresh);
+  hash = FnvHash(hash, configuration.request_email);
+  hash = FnvHash(hash, configuration.request_id_token);
+  hash = FnvHash(hash, configuration.hide_ui_popups);
+  hash = FnvHash(hash, configuration.account_name);
+  uint64_t scope_count = configuration.additional_scopes.size();
+  hash = FnvHash(hash, &scope_count, sizeof(scope_count));
+  for (size_t i = 0; i < configuration.additional_scopes.size(); i++) {
+    hash = FnvHash(hash, configuration.additional_scopes[i]);
+  }
+  // 0 is reserved for "nothing sent yet".
+  return hash ? hash : 1;
+}
+
+void GoogleSignIn::GoogleSignInImpl::SendConfiguration() {
+  if (current_configuration_ &&
+      sent_fingerprint_ == configuration_fingerprint_) {
+    // Java still has this configuration, it only needs the request handle.
+    JNIEnv *env = GetJniEnv();
+    StatsRecorder::RecordJni(SignInStats::kOpConfigure, 1, 0);
+    bool accepted = env->CallStaticBooleanMethod(
+        helper_clazz_, resubmit_method_, activity_,
+        static_cast<jlong>(configuration_fingerprint_), current_handle_);
+    JniRecorder::RecordResubmit(current_handle_, accepted);
+    if (accepted) {
+      configure_skipped_count_++;
+      return;
+    }
+  }
   CallConfigure();
+  configure_sent_count_++;
+  sent_fingerprint_ = current_configuration_ ? configuration_fingerprint_ : 0;
 }
 
 void GoogleSignIn::GoogleSignInImpl::CallConfigure() {
+  GOOGLESIGNIN_TRACE_SCOPE(kTraceConfigure, current_handle_);
   JNIEnv *env = GetJniEnv();
 
   if (!current_configuration_) {
-    __android_log_print(ANDROID_LOG_ERROR, TAG, "configuration is null!?");
+    GOOGLESIGNIN_LOG_ERROR("configuration is null!?");
     return;
   }
+  // The call to configure plus the calls to create and delete the strings.
+  uint32_t jni_calls = 1;
+  uint64_t jni_bytes = 0;
+
   jstring j_web_client_id =
       current_configuration_->web_client_id.empty() ? nullptr
           : env->NewStringUTF(current_configuration_->web_client_id.c_str());
+  if (j_web_client_id) {
+    jni_calls += 2;
+    jni_bytes += current_configuration_->web_client_id.size();
+  }
 
   jstring j_account_name =
       current_configuration_->account_name.empty() ? nullptr
           : env->NewStringUTF(current_configuration_->account_name.c_str());
+  if (j_account_name) {
+    jni_calls += 2;
+    jni_bytes += current_configuration_->account_name.size();
+  }
 
   jobjectArray j_auth_scopes = nullptr;
 
@@ -256,13 +701,16 @@ void GoogleSignIn::GoogleSignInImpl::CallConfigure() {
     jclass string_clazz = FindClass("java/lang/String", activity_);
     j_auth_scopes = env->NewObjectArray(
             current_configuration_->additional_scopes.size(), string_clazz, nullptr);
+    jni_calls += 3;
 
     for (int i = 0; i < current_configuration_->additional_scopes.size(); i++) {
-      env->SetObjectArrayElement(
-          j_auth_scopes, i,
-          env->NewStringUTF(current_configuration_->additional_scopes[i].c_str()));
+      const std::string &scope = current_configuration_->additional_scopes[i];
+      jstring j_scope = env->NewStringUTF(scope.c_str());
+      env->SetObjectArrayElement(j_auth_scopes, i, j_scope);
+      env->DeleteLocalRef(j_scope);
+      jni_calls += 3;
+      jni_bytes += scope.size();
     }
-    env->DeleteLocalRef(string_clazz);
   }
 
   env->CallStaticVoidMethod(
@@ -273,7 +721,8 @@ void GoogleSignIn::GoogleSignInImpl::CallConfigure() {
       current_configuration_->request_email,
       current_configuration_->request_id_token,
       current_configuration_->hide_ui_popups, j_account_name, j_auth_scopes,
-      reinterpret_cast<jlong>(current_result_));
+      static_cast<jlong>(configuration_fingerprint_), current_handle_);
+  JniRecorder::RecordConfigure(current_handle_, *current_configuration_);
 
   if (j_web_client_id) {
     env->DeleteLocalRef(j_web_client_id);
@@ -286,35 +735,62 @@ void GoogleSignIn::GoogleSignInImpl::CallConfigure() {
   if (j_auth_scopes) {
     env->DeleteLocalRef(j_auth_scopes);
   }
+  StatsRecorder::RecordJni(SignInStats::kOpConfigure, jni_calls, jni_bytes);
 }
 
 Future<GoogleSignIn::SignInResult> &GoogleSignIn::GoogleSignInImpl::SignIn() {
   JNIEnv *env = GetJniEnv();
 
-  if (current_result_) {
-    current_result_->SetResult(nullptr);
-  }
+  StartSignInRequest();
+  GOOGLESIGNIN_TRACE_EVENT(kTraceRequest, kTraceAsyncBegin, current_handle_);
+  RecordSignInStart(current_handle_, SignInStats::kFlowInteractive);
+  SendConfiguration();
 
-  CallConfigure();
-
-  env->CallStaticVoidMethod(helper_clazz_, signin_method_, activity_,
-                            (jlong)current_result_);
+  {
+    GOOGLESIGNIN_TRACE_SCOPE(kTraceSignInCall, current_handle_);
+    StatsRecorder::RecordJni(SignInStats::kOpSignIn, 1, 0);
+    env->CallStaticVoidMethod(helper_clazz_, signin_method_, activity_,
+                              current_handle_);
+    JniRecorder::RecordCall(JniRecorder::kRecordSignIn, current_handle_);
+  }
 
   return *current_result_;
 }
 
-Future<GoogleSignIn::SignInResult>
-    &GoogleSignIn::GoogleSignInImpl::SignInSilently() {
+void GoogleSignIn::GoogleSignInImpl::StartSilentSignIn() {
   JNIEnv *env = GetJniEnv();
 
-  if (current_result_) {
-    current_result_->SetResult(nullptr);
-  }
+  StartSignInRequest();
+  GOOGLESIGNIN_TRACE_EVENT(kTraceRequest, kTraceAsyncBegin, current_handle_);
+  RecordSignInStart(current_handle_, SignInStats::kFlowSilent);
+  SendConfiguration();
 
-  CallConfigure();
+  {
+    GOOGLESIGNIN_TRACE_SCOPE(kTraceSignInCall, current_handle_);
+    StatsRecorder::RecordJni(SignInStats::kOpSignIn, 1, 0);
+    env->CallStaticVoidMethod(helper_clazz_, signinsilently_method_,
+                              activity_, current_handle_);
+    JniRecorder::RecordCall(JniRecorder::kRecordSignInSilently,
+                            current_handle_);
+  }
+}
 
-  env->CallStaticVoidMethod(helper_clazz_, signinsilently_method_, activity_,
-                            (jlong)current_result_);
+Future<GoogleSignIn::SignInResult>
+    &GoogleSignIn::GoogleSignInImpl::SignInSilently() {
+  StartSilentSignIn();
+
+  GoogleSignInUser *cached_user =
+      session_cache_enabled_ ? session_cache_->Load() : nullptr;
+  if (cached_user) {
+    // Hand out the cached user right away, the request started above keeps
+    // running and stays the last sign-in result.  Both are counted as silent
+    // sign-ins in the stats.
+    jlong cached_handle = AcquireRequest();
+    RecordSignInStart(cached_handle, SignInStats::kFlowSilent);
+    CompleteRequest(cached_handle, GoogleSignIn::kStatusCodeSuccessCached,
+                    cached_user);
+    return *Requests().Get(cached_handle);
+  }
 
   return *current_result_;
 }
@@ -325,46 +801,418 @@ const Future<GoogleSignIn::SignInResult>
   return current_result_;
 }
 
+void GoogleSignIn::GoogleSignInImpl::EnableSessionCache(bool enable) {
+  // Disabling needs the cache too, to delete the file an earlier run with the
+  // cache enabled may have left.
+  if (!session_cache_) {
+    session_cache_ = SessionCache::CreateInFilesDir(activity_);
+  }
+  if (!enable && session_cache_) {
+    session_cache_enabled_ = false;
+    session_cache_->Clear();
+  }
+  session_cache_enabled_ = enable && session_cache_;
+}
+
+void GoogleSignIn::GoogleSignInImpl::EnableTokenRefresh(bool enable,
+                                                        Clock *clock) {
+  if (!enable) {
+    std::atomic_store(&refresh_scheduler_,
+                      std::shared_ptr<RefreshScheduler>());
+    return;
+  }
+  if (std::atomic_load(&refresh_scheduler_)) {
+    return;
+  }
+  std::shared_ptr<RefreshScheduler> scheduler(new RefreshScheduler(
+      clock ? clock : Clock::System(), RefreshScheduler::Options()));
+  std::atomic_store(&refresh_scheduler_, scheduler);
+  if (!current_result_ || !current_started_) {
+    return;
+  }
+  // Follow the last sign-in, picking up its result if it already finished.
+  // If it completes meanwhile it is fed twice, which schedules the same
+  // refresh.
+  ObserveRequest(current_handle_, scheduler);
+  if (!current_result_->Pending()) {
+    const SignInResult *result = current_result_->Result();
+    FeedRefreshScheduler(scheduler.get(), current_result_->Status(),
+                         result ? result->User : nullptr);
+  }
+}
+
+std::shared_ptr<const GoogleSignInUser>
+    GoogleSignIn::GoogleSignInImpl::GetRefreshedUser() const {
+  std::shared_ptr<RefreshScheduler> scheduler =
+      std::atomic_load(&refresh_scheduler_);
+  return scheduler ? scheduler->user()
+                   : std::shared_ptr<const GoogleSignInUser>();
+}
+
+void GoogleSignIn::GoogleSignInImpl::ObserveRequest(
+    jlong handle, const std::shared_ptr<RefreshScheduler> &scheduler) {
+  std::atomic_store(
+      &request_schedulers[static_cast<uint64_t>(handle) %
+                          MAX_OUTSTANDING_REQUESTS],
+      scheduler);
+}
+
+void GoogleSignIn::GoogleSignInImpl::FeedRefreshScheduler(
+    RefreshScheduler *scheduler, int status, const GoogleSignInUser *user) {
+  if ((status == GoogleSignIn::kStatusCodeSuccess ||
+       status == GoogleSignIn::kStatusCodeSuccessCached) &&
+      user) {
+    scheduler->OnSignedIn(*user);
+  } else {
+    scheduler->OnSignInFailed();
+  }
+}
+
+bool GoogleSignIn::GoogleSignInImpl::LoadJwks(const char *json,
+                                              size_t length) {
+  return SetJwks(JwksCache::Parse(json, length));
+}
+
+bool GoogleSignIn::GoogleSignInImpl::LoadJwksFile(const char *path) {
+  return SetJwks(JwksCache::ParseFile(path));
+}
+
+bool GoogleSignIn::GoogleSignInImpl::SetJwks(JwksCache *keys) {
+  if (!keys) {
+    GOOGLESIGNIN_LOG_WARN(
+        "No usable keys in the JWKS, keeping the old keys");
+    return false;
+  }
+  GOOGLESIGNIN_LOG_INFO("Loaded %d JWKS keys",
+                        static_cast<int>(keys->size()));
+  std::atomic_store(&jwks_, std::shared_ptr<const JwksCache>(keys));
+  return true;
+}
+
+IdTokenStatus GoogleSignIn::GoogleSignInImpl::VerifyIdToken(
+    const GoogleSignInUser &user) const {
+  const char *token = user.GetIdToken();
+  const IdTokenClaims *claims = user.GetIdTokenClaims();
+  if (!token || !claims) {
+    return kIdTokenMalformed;
+  }
+  std::shared_ptr<const JwksCache> keys = std::atomic_load(&jwks_);
+  if (!keys) {
+    return kIdTokenUnknownKey;
+  }
+  std::shared_ptr<const std::string> audience = std::atomic_load(&audience_);
+  return googlesignin::VerifyIdToken(token, strlen(token), *claims, *keys,
+                                     audience ? audience->c_str() : nullptr,
+                                     Clock::System()->NowMillis() / 1000);
+}
+
+void GoogleSignIn::GoogleSignInImpl::GetConfigureCounts(int *sent,
+                                                        int *skipped) const {
+  *sent = configure_sent_count_;
+  *skipped = configure_skipped_count_;
+}
+
+bool GoogleSignIn::GoogleSignInImpl::WarmUp() {
+  if (!current_configuration_) {
+    GOOGLESIGNIN_LOG_WARN("WarmUp() called before Configure()");
+    return false;
+  }
+  JNIEnv *env = GetJniEnv();
+  StatsRecorder::RecordJni(SignInStats::kOpOther, 1, 0);
+  return env->CallStaticBooleanMethod(helper_clazz_, warmup_method_,
+                                      activity_);
+}
+
 // Signs out.
 void GoogleSignIn::GoogleSignInImpl::SignOut() {
   JNIEnv *env = GetJniEnv();
 
-  __android_log_print(ANDROID_LOG_INFO, TAG,
-                      "helper: %x method: %x activity: %x",
-                      (uintptr_t)helper_clazz_, (uintptr_t)signin_method_,
-                      (uintptr_t)activity_);
+  ForgetUser();
 
+  StatsRecorder::RecordJni(SignInStats::kOpOther, 1, 0);
   env->CallStaticVoidMethod(helper_clazz_, signout_method_, activity_);
+  JniRecorder::RecordCall(JniRecorder::kRecordSignOut, 0);
 }
 
 // Signs out.
 void GoogleSignIn::GoogleSignInImpl::Disconnect() {
   JNIEnv *env = GetJniEnv();
 
+  ForgetUser();
+
+  StatsRecorder::RecordJni(SignInStats::kOpOther, 1, 0);
   env->CallStaticVoidMethod(helper_clazz_, disconnect_method_, activity_);
+  JniRecorder::RecordCall(JniRecorder::kRecordDisconnect, 0);
+}
+
+void GoogleSignIn::GoogleSignInImpl::CancelRequests() {
+  uint64_t handles[MAX_OUTSTANDING_REQUESTS];
+  size_t count = Requests().Outstanding(handles);
+  for (size_t i = 0; i < count; i++) {
+    jlong handle = static_cast<jlong>(handles[i]);
+    // The handle sent with the configuration has no sign-in to cancel yet.
+    if (handle == current_handle_ && !current_started_) {
+      continue;
+    }
+    CompleteRequest(handle, GoogleSignIn::kStatusCodeCanceled, nullptr);
+  }
+}
+
+void GoogleSignIn::GoogleSignInImpl::ForgetUser() {
+  // Cancel before bumping the epoch: a request claimed after it was read
+  // must have been claimed after the cancellation, i.e. be a new sign-in.
+  CancelRequests();
+  std::lock_guard<std::mutex> lock(sign_out_mutex_);
+  sign_out_epoch_++;
+  if (session_cache_enabled_) {
+    session_cache_->Clear();
+  }
+  std::shared_ptr<RefreshScheduler> scheduler =
+      std::atomic_load(&refresh_scheduler_);
+  if (scheduler) {
+    scheduler->OnSignedOut();
+  }
+}
+
+jlong GoogleSignIn::GoogleSignInImpl::AcquireRequest() {
+  uint64_t evicted;
+  jlong handle = static_cast<jlong>(Requests().Acquire(&evicted));
+  GoogleSignInFuture *future = Requests().Get(handle);
+
+  if (evicted) {
+    // The evicted request used the same slot, finish it before reusing the
+    // future so anything waiting on it is released.
+    GOOGLESIGNIN_LOG_WARN(
+        "Too many outstanding requests, canceling the oldest");
+    SignInResult *rc =
+        SetRequestResult(handle, GoogleSignIn::kStatusCodeCanceled, nullptr);
+    future->Complete(rc->StatusCode, rc);
+    RecordSignInCompletion(static_cast<jlong>(evicted), rc->StatusCode);
+    // If the evicted sign-in was a token refresh, its scheduler must hear
+    // that it ended or it never starts another one.
+    std::shared_ptr<RefreshScheduler> scheduler = std::atomic_exchange(
+        &request_schedulers[static_cast<uint64_t>(handle) %
+                            MAX_OUTSTANDING_REQUESTS],
+        std::shared_ptr<RefreshScheduler>());
+    if (scheduler) {
+      FeedRefreshScheduler(scheduler.get(), rc->StatusCode, nullptr);
+    }
+  }
+  future->Reset();
+  // The previous result is no longer reachable through the future.
+  SetRequestResult(handle, GoogleSignIn::kStatusCodeUninitialized, nullptr);
+  // Only sign-ins feed the refresh schedule, see StartSignInRequest().
+  ObserveRequest(handle, std::shared_ptr<RefreshScheduler>());
+  return handle;
+}
+
+void GoogleSignIn::GoogleSignInImpl::StartRequest() {
+  current_handle_ = AcquireRequest();
+  current_result_ = Requests().Get(current_handle_);
+}
+
+void GoogleSignIn::GoogleSignInImpl::RecordSignInStart(
+    jlong handle, SignInStats::Flow flow) {
+  StatsRecorder::RecordStart(flow);
+  RequestStart &start =
+      request_starts[static_cast<uint64_t>(handle) % MAX_OUTSTANDING_REQUESTS];
+  start.started_ms.store(SteadyMillis(), std::memory_order_relaxed);
+  start.flow.store(flow, std::memory_order_relaxed);
+  start.handle.store(static_cast<uint64_t>(handle), std::memory_order_release);
+}
+
+void GoogleSignIn::GoogleSignInImpl::RecordSignInCompletion(jlong handle,
+                                                            int status) {
+  RequestStart &start =
+      request_starts[static_cast<uint64_t>(handle) % MAX_OUTSTANDING_REQUESTS];
+  uint64_t expected = static_cast<uint64_t>(handle);
+  if (start.handle.load(std::memory_order_acquire) != expected) {
+    return;
+  }
+  int64_t started_ms = start.started_ms.load(std::memory_order_relaxed);
+  SignInStats::Flow flow =
+      static_cast<SignInStats::Flow>(start.flow.load(std::memory_order_relaxed));
+  // Only count the completion once, a later sign-in reusing the handle
+  // records a new start.
+  if (start.handle.compare_exchange_strong(expected, 0,
+                                           std::memory_order_relaxed)) {
+    int64_t elapsed = SteadyMillis() - started_ms;
+    StatsRecorder::RecordCompletion(
+        flow, status, elapsed > 0 ? static_cast<uint64_t>(elapsed) : 0);
+  }
+}
+
+void GoogleSignIn::GoogleSignInImpl::StartSignInRequest() {
+  if (current_started_ || !Requests().Lookup(current_handle_)) {
+    StartRequest();
+  } else {
+    current_result_->Reset();
+  }
+  current_started_ = true;
+  ObserveRequest(current_handle_, std::atomic_load(&refresh_scheduler_));
+}
+
+void GoogleSignIn::GoogleSignInImpl::CompleteRequest(jlong handle, int status,
+                                                     GoogleSignInUser *user) {
+  uint64_t epoch = sign_out_epoch_.load();
+  GoogleSignInFuture *future = Requests().Claim(static_cast<uint64_t>(handle));
+  if (future) {
+    SignInResult *rc;
+    {
+      std::lock_guard<std::mutex> lock(sign_out_mutex_);
+      if (epoch != sign_out_epoch_.load() &&
+          status != GoogleSignIn::kStatusCodeCanceled) {
+        // Signed out while this result was being delivered.
+        GOOGLESIGNIN_LOG_DEBUG("Canceling a result that raced a sign-out");
+        status = GoogleSignIn::kStatusCodeCanceled;
+        if (user) {
+          user->Release();
+          user = nullptr;
+        }
+      }
+      rc = SetRequestResult(handle, status, user);
+
+      if (session_cache_enabled_) {
+        if (status == GoogleSignIn::kStatusCodeSuccess && user) {
+          session_cache_->Store(*user);
+        } else if (status == STATUS_CODE_SIGN_IN_REQUIRED ||
+                   status == GoogleSignIn::kStatusCodeInvalidAccount) {
+          session_cache_->Clear();
+        }
+      }
+      RecordSignInCompletion(handle, status);
+      std::shared_ptr<RefreshScheduler> scheduler = std::atomic_exchange(
+          &request_schedulers[static_cast<uint64_t>(handle) %
+                              MAX_OUTSTANDING_REQUESTS],
+          std::shared_ptr<RefreshScheduler>());
+      if (scheduler) {
+        FeedRefreshScheduler(scheduler.get(), status, user);
+      }
+    }
+    future->Complete(status, rc);
+    Requests().Release(static_cast<uint64_t>(handle));
+    GOOGLESIGNIN_TRACE_EVENT(kTraceRequest, kTraceAsyncEnd, handle);
+  } else {
+    // The request was canceled or its result was already delivered.
+    if (handle) {
+      GOOGLESIGNIN_LOG_WARN("Ignoring result for stale request handle");
+    }
+    if (user) {
+      user->Release();
+    }
+  }
 }
 
 void GoogleSignIn::GoogleSignInImpl::NativeOnAuthResult(
     JNIEnv *env, jobject obj, jlong handle, jint result, jobject user) {
-  GoogleSignInFuture *future = reinterpret_cast<GoogleSignInFuture *>(handle);
-  if (future) {
-    SignInResult *rc = new GoogleSignIn::SignInResult();
-    rc->StatusCode = result;
-    rc->User = GoogleSignInUserImpl::UserFromAccount(user);
+  GOOGLESIGNIN_TRACE_SCOPE(kTraceResultDecode, handle);
+  // The callback itself, reading the account is counted by UserFromAccount.
+  StatsRecorder::RecordJni(SignInStats::kOpResult, 1, 0);
+  // Skip reading the account for a request that is no longer outstanding.
+  GoogleSignInUser *signed_in =
+      Requests().Lookup(static_cast<uint64_t>(handle))
+          ? GoogleSignInUserImpl::UserFromAccount(user)
+          : nullptr;
+  JniRecorder::RecordResult(handle, result, signed_in);
+  if (result == GoogleSignIn::kStatusCodeSuccess && user && !signed_in) {
+    GOOGLESIGNIN_LOG_ERROR("Could not read the signed in account");
+    result = GoogleSignIn::kStatusCodeInternalError;
+  }
+  CompleteRequest(handle, result, signed_in);
+}
 
-    if (rc->User) {
-      __android_log_print(ANDROID_LOG_INFO, TAG, "User Display Name is  %s",
-                          rc->User->GetDisplayName());
-    }
-    future->SetResult(rc);
+void GoogleSignIn::GoogleSignInImpl::NativeOnActivityResumed(JNIEnv *env,
+                                                             jclass clazz) {
+  RefreshScheduler::NotifyActivityResumed();
+}
+
+void GoogleSignIn::GoogleSignInImpl::NativeTraceEvent(JNIEnv *env,
+                                                      jclass clazz, jint span,
+                                                      jint phase,
+                                                      jlong handle) {
+  if (span >= 0 && span < kTraceSpanCount) {
+    GOOGLESIGNIN_TRACE_EVENT(static_cast<TraceSpan>(span),
+                             static_cast<TracePhase>(phase), handle);
+  }
+}
+
+void GoogleSignIn::GoogleSignInImpl::NativePublishEvents(JNIEnv *env,
+                                                         jclass clazz,
+                                                         jint write_index) {
+  // Java only has the ring once PollEvents() created it and passed it on.
+  if (event_ring_) {
+    event_ring_->Publish(static_cast<uint32_t>(write_index));
   }
 }
 
+void GoogleSignIn::GoogleSignInImpl::PollEvents() {
+  GOOGLESIGNIN_TRACE_SCOPE(kTracePollEvents, 0);
+  if (!event_ring_) {
+    // The first poll creates the ring and hands it to Java, from then on
+    // results are written to it instead of calling NativeOnAuthResult, for
+    // as long as it keeps being drained.
+    JNIEnv *env = GetJniEnv();
+    event_ring_ = new EventRing(EVENT_RING_CAPACITY);
+    jobject buffer = env->NewDirectByteBuffer(event_ring_->memory(),
+                                              event_ring_->size());
+    env->CallStaticVoidMethod(helper_clazz_, set_event_ring_method_, buffer);
+    env->DeleteLocalRef(buffer);
+    StatsRecorder::RecordJni(SignInStats::kOpOther, 3, 0);
+    internal::SetWaitPump(PumpEvents);
+  }
+  poll_thread_.store(std::this_thread::get_id(), std::memory_order_relaxed);
+  DrainEvents();
+
+  std::shared_ptr<RefreshScheduler> scheduler =
+      std::atomic_load(&refresh_scheduler_);
+  if (scheduler && scheduler->Poll()) {
+    GOOGLESIGNIN_LOG_INFO("Refreshing the ID token");
+    // Not SignInSilently(), the session cache would only hand back the
+    // token being refreshed.
+    StartSilentSignIn();
+  }
+}
+
+void GoogleSignIn::GoogleSignInImpl::DrainEvents() {
+  // A Wait() in a completion callback run below must not drain again, the
+  // records it would see are still being handled.
+  static thread_local bool draining = false;
+  if (draining) {
+    return;
+  }
+  draining = true;
+  event_ring_->Drain([](const EventRing::Record &record) {
+    GOOGLESIGNIN_TRACE_SCOPE(kTraceResultDecode, record.handle);
+    // Read from the shared ring, without any JNI calls.
+    StatsRecorder::RecordJni(SignInStats::kOpResult, 0, record.payload_size);
+    GoogleSignInUser *user =
+        record.payload &&
+                Requests().Lookup(static_cast<uint64_t>(record.handle))
+            ? GoogleSignInUserImpl::UserFromPackedAccount(
+                  record.payload, record.payload_size)
+            : nullptr;
+    JniRecorder::RecordResult(record.handle, record.status, user);
+    CompleteRequest(record.handle, record.status, user);
+  });
+  draining = false;
+}
+
+bool GoogleSignIn::GoogleSignInImpl::PumpEvents() {
+  if (poll_thread_.load(std::memory_order_relaxed) !=
+      std::this_thread::get_id()) {
+    return false;
+  }
+  DrainEvents();
+  return true;
+}
+
 // Public class implementation.  These are called by external callers to use the
 // Google Sign-in API.
 GoogleSignIn::GoogleSignIn(jobject activity)
     : impl_(new GoogleSignInImpl(activity)) {}
 
+GoogleSignIn::~GoogleSignIn() { delete impl_; }
+
 void GoogleSignIn::EnableDebugLogging(bool flag) {
   impl_->EnableDebugLogging(flag);
 }
@@ -385,8 +1233,53 @@ const Future<GoogleSignIn::SignInResult> *GoogleSignIn::GetLastSignInResult() {
   return impl_->GetLastSignInResult();
 }
 
+void GoogleSignIn::EnableSessionCache(bool enable) {
+  impl_->EnableSessionCache(enable);
+}
+
+void GoogleSignIn::EnableTokenRefresh(bool enable, Clock *clock) {
+  impl_->EnableTokenRefresh(enable, clock);
+}
+
+std::shared_ptr<const GoogleSignInUser> GoogleSignIn::GetRefreshedUser()
+    const {
+  return impl_->GetRefreshedUser();
+}
+
+bool GoogleSignIn::LoadJwks(const char *json, size_t length) {
+  return impl_->LoadJwks(json, length);
+}
+
+bool GoogleSignIn::LoadJwksFile(const char *path) {
+  return impl_->LoadJwksFile(path);
+}
+
+IdTokenStatus GoogleSignIn::VerifyIdToken(const GoogleSignInUser &user) const {
+  return impl_->VerifyIdToken(user);
+}
+
 void GoogleSignIn::SignOut() { impl_->SignOut(); }
 
 void GoogleSignIn::Disconnect() { impl_->Disconnect(); }
 
+bool GoogleSignIn::WarmUp() { return impl_->WarmUp(); }
+
+SignInStats GoogleSignIn::GetStats() const {
+  SignInStats stats;
+  StatsRecorder::Snapshot(&stats);
+  return stats;
+}
+
+void GoogleSignIn::GetConfigureCounts(int *sent, int *skipped) const {
+  impl_->GetConfigureCounts(sent, skipped);
+}
+
+void GoogleSignIn::PollEvents() { impl_->PollEvents(); }
+
+void GoogleSignIn::Prewarm(jobject activity) {
+  GoogleSignInImpl::Prewarm(activity);
+}
+
+void GoogleSignIn::DispatchCallbacks() { internal::DispatchQueuedCallbacks(); }
+
 }  // namespace googlesignin
@@ -15,19 +15,24 @@
 #ifndef GOOGLESIGNIN_GOOGLESIGNIN_H  // NOLINT
 #define GOOGLESIGNIN_GOOGLESIGNIN_H
 
-#if !defined(__ANDROID__)
+#if !defined(__ANDROID__) && !defined(GOOGLESIGNIN_FAKE_JNI)
 #error "This class is for Android only."
 #endif
 
 #include <jni.h>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "future.h"              // NOLINT
 #include "google_signin_user.h"  // NOLINT
+#include "id_token_verifier.h"   // NOLINT
+#include "stats.h"               // NOLINT
 
 namespace googlesignin {
 
+class Clock;
+
 class GoogleSignIn {
  public:
   /// <summary>StatusCode</summary>
@@ -121,7 +126,10 @@ class GoogleSignIn {
     Configuration &operator=(Configuration &&move) = delete;
   };
 
-  // Holds the result of the sign-in process.
+  // The result of a sign-in.  User is null unless the sign-in succeeded.
+  // The result and its user are valid until the future they were returned
+  // by is reused, which only happens after several newer sign-ins have
+  // started.  Call User->AddRef() to keep the user for longer.
   struct SignInResult {
     GoogleSignInUser *User;
     int StatusCode;
@@ -137,29 +145,120 @@ class GoogleSignIn {
   // add a fragment to the activity which performs the sign-in operation.
   GoogleSignIn(jobject activity);
 
+  // Sign-ins still in progress complete as usual, their futures stay valid.
+  ~GoogleSignIn();
+
+  GoogleSignIn(const GoogleSignIn &copy) = delete;
+  GoogleSignIn &operator=(const GoogleSignIn &copy) = delete;
+
   // Enables verbose logging.
   void EnableDebugLogging(bool flag);
 
   // Sets the configuration for the sign-in.  This must be called before
-  // calling SignIn().  Calling this invalidates the current sign-in result.
+  // calling SignIn().  Futures returned by earlier calls stay valid.
   void Configure(const Configuration &configuration);
 
   // Starts the authentication process.
   Future<SignInResult> &SignIn();
 
-  // Attempts to sign in silently.
+  // Attempts to sign in silently.  If the session cache is enabled and holds
+  // a user, the returned future has already completed with
+  // kStatusCodeSuccessCached and the silent sign-in runs in the background to
+  // revalidate it; its result is available from GetLastSignInResult().
   Future<SignInResult> &SignInSilently();
 
   // Get the result of the last sign-in.
   const Future<SignInResult> *GetLastSignInResult();
 
+  // Enables or disables the session cache, which is off by default.  When
+  // enabled, the last successfully signed in user is kept in a file in the
+  // app's files directory and returned by SignInSilently() on the next cold
+  // start.  The file is written on a background thread.  Signing out,
+  // disconnecting or disabling the cache deletes it, disabling also deletes
+  // a file left by an earlier run.
+  void EnableSessionCache(bool enable);
+
+  // Enables or disables refreshing the ID token before it expires, which is
+  // off by default.  While enabled, PollEvents() starts a silent sign-in a few
+  // minutes, plus some jitter, before the token of the last signed in user
+  // expires, and when the activity resumes with the token close to expiring.
+  // The result of each sign-in updates the schedule as soon as it completes,
+  // on the completing thread, so PollEvents() only has to start the refresh
+  // once it is due.  The schedule is driven by clock, or the system clock if
+  // it is null.
+  void EnableTokenRefresh(bool enable, Clock *clock = nullptr);
+
+  // Returns the user from the most recent successful sign-in or refresh.
+  // The value is replaced atomically, so it can be read from any thread
+  // without waiting for a refresh in progress.  Null unless token refresh is
+  // enabled and a sign-in succeeded.
+  std::shared_ptr<const GoogleSignInUser> GetRefreshedUser() const;
+
+  // Loads the keys used by VerifyIdToken() from a JSON Web Key Set, such as
+  // https://www.googleapis.com/oauth2/v3/certs fetched and stored by the
+  // app.  Replaces any keys loaded before.  Returns false, keeping the
+  // current keys, if the document has no usable RS256 or ES256 keys.
+  bool LoadJwks(const char *json, size_t length);
+
+  // Loads the keys from a JWKS file, see LoadJwks().
+  bool LoadJwksFile(const char *path);
+
+  // Verifies the ID token of user without any network access: its signature
+  // against the loaded keys, its issuer, that its audience is the configured
+  // web_client_id and that it has not expired.  Can be called from any
+  // thread once configured.
+  IdTokenStatus VerifyIdToken(const GoogleSignInUser &user) const;
+
+  // Builds and connects the Google API client for the current configuration
+  // in the background, so a following SignIn() or SignInSilently() only has
+  // to start the sign-in instead of waiting for the connection.  Call it
+  // after Configure(), e.g. when the sign-in button is shown.  Returns false
+  // if there is no configuration to warm up for.
+  bool WarmUp();
+
   // Signs out the local user.  Any server side tokens are still valid.
+  // Sign-ins still in progress complete with kStatusCodeCanceled.
   void SignOut();
 
   // Disconnects this user from the application.  Invalidates all tokens and
-  // consent.
+  // consent.  Sign-ins still in progress complete with kStatusCodeCanceled.
   void Disconnect();
 
+  // Completes the futures whose results have arrived since the last call.
+  // Once this has been called, results are queued by the Java helper and
+  // decoded here, on the polling thread, instead of on the Android UI thread.
+  // The queue is shared by all the instances, so call it from one thread
+  // only, typically once per frame; it completes the results of every
+  // instance.  A Future::Wait() on that thread keeps draining the queue while
+  // it blocks, except in a completion callback run from here.  If no thread
+  // polls for a second, e.g. while the game loop is paused, new results are
+  // completed on the UI thread again; those already queued wait for the next
+  // poll.  This also drives the token refresh, see EnableTokenRefresh().
+  void PollEvents();
+
+  // Returns the sign-in counts by flow and status, the sign-in latency
+  // histograms and the JNI traffic, summed over all the instances since the
+  // process started.  Reading them never blocks the threads recording them,
+  // so this can be called from any thread at any time.
+  SignInStats GetStats() const;
+
+  // Returns how many times the configuration was sent to Java in full, and
+  // how many times sending it again was skipped because it had not changed.
+  void GetConfigureCounts(int *sent, int *skipped) const;
+
+  // Resolves the Java classes and method ids used by the plugin, and
+  // registers its native methods, on a background thread.  Call it as early
+  // as possible, e.g. while the first scene loads, so constructing an
+  // instance doesn't have to.  Each lookup is done once per process whether
+  // or not this is called, an instance constructed while the background
+  // thread is still running waits for it.
+  static void Prewarm(jobject activity);
+
+  // Runs the completion callbacks that were registered as queued and whose
+  // futures have completed.  The callbacks run on the calling thread, this is
+  // typically called once per frame from the game loop.
+  static void DispatchCallbacks();
+
  private:
   class GoogleSignInImpl;
   GoogleSignInImpl *impl_;
@@ -16,10 +16,16 @@
 
 #include "google_signin_bridge.h"
 
-#include <android/log.h>
+#include <string.h>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
 
 #include "google_signin.h"
+#include "id_token.h"
+#include "jni_recorder.h"
+#include "trace.h"
 
 // Wrapper for the GoogleSignIn object when returning it via the extern
 // "C" interface.
@@ -41,11 +47,11 @@ struct GoogleSignInHolder {
   GoogleSignInHolder &operator=(GoogleSignInHolder &&move) = delete;
 };
 
-// Wrapper for the Future result from calling SignIn().
+// Wrapper for the Future result from calling SignIn().  The futures are
+// owned by the plugin's request table and reused by later sign-ins, so each
+// gets one wrapper, see WrapFuture(), kept for the life of the process.
 struct GoogleSignInFuture {
-  std::unique_ptr<
-      googlesignin::Future<googlesignin::GoogleSignIn ::SignInResult>>
-      wrapped_;
+  googlesignin::Future<googlesignin::GoogleSignIn ::SignInResult> *wrapped_;
 
   GoogleSignInFuture() : wrapped_(nullptr) {}
 
@@ -64,33 +70,29 @@ struct GoogleSignInFuture {
   GoogleSignInFuture &operator=(GoogleSignInFuture &&move) = delete;
 };
 
-// Wrapper for the signed in user object.
-struct GoogleSignInUser {
-  googlesignin::GoogleSignInUser *wrapped_;
-
-  GoogleSignInUser() : wrapped_() {}
-
-  GoogleSignInUser(googlesignin::GoogleSignInUser *ref) : wrapped_(ref) {
-    __android_log_print(ANDROID_LOG_INFO, "native-googlesignin",
-                        "In Wrapper display name is  %s",
-                        ref->GetDisplayName());
+// Returns the wrapper of future, creating it the first time.  There are only
+// as many as the request table has slots.
+static GoogleSignInFuture_t WrapFuture(
+    googlesignin::Future<googlesignin::GoogleSignIn ::SignInResult> *future) {
+  static std::mutex wrappers_mutex;
+  static std::map<const void *, GoogleSignInFuture *> *wrappers =
+      new std::map<const void *, GoogleSignInFuture *>();
+  std::lock_guard<std::mutex> lock(wrappers_mutex);
+  GoogleSignInFuture *&wrapper = (*wrappers)[future];
+  if (!wrapper) {
+    wrapper = new GoogleSignInFuture(future);
   }
-
-  ~GoogleSignInUser() = default;
-
-  GoogleSignInUser(GoogleSignInUser const &copy) = delete;
-
-  GoogleSignInUser(GoogleSignInUser &&move) = delete;
-
-  GoogleSignInUser &operator=(GoogleSignInUser const &copy) = delete;
-
-  GoogleSignInUser &operator=(GoogleSignInUser &&move) = delete;
-};
+  return wrapper;
+}
 
 GoogleSignIn_t GoogleSignIn_Create(jobject activity) {
   return new GoogleSignInHolder(new googlesignin::GoogleSignIn(activity));
 }
 
+void GoogleSignIn_Prewarm(jobject activity) {
+  googlesignin::GoogleSignIn::Prewarm(activity);
+}
+
 void GoogleSignIn_Dispose(GoogleSignIn_t self) { delete self; }
 
 void GoogleSignIn_EnableDebugLogging(GoogleSignIn_t self, bool flag) {
@@ -126,12 +128,40 @@ void GoogleSignIn_Configure(GoogleSignIn_t self, bool useGameSignIn,
   self->wrapped_->Configure(configuration);
 }
 
+bool GoogleSignIn_WarmUp(GoogleSignIn_t self) {
+  return self->wrapped_->WarmUp();
+}
+
 GoogleSignInFuture_t GoogleSignIn_SignIn(GoogleSignIn_t self) {
-  return new GoogleSignInFuture(&self->wrapped_->SignIn());
+  return WrapFuture(&self->wrapped_->SignIn());
 }
 
 GoogleSignInFuture_t GoogleSignIn_SignInSilently(GoogleSignIn_t self) {
-  return new GoogleSignInFuture(&self->wrapped_->SignInSilently());
+  return WrapFuture(&self->wrapped_->SignInSilently());
+}
+
+void GoogleSignIn_PollEvents(GoogleSignIn_t self) {
+  self->wrapped_->PollEvents();
+}
+
+void GoogleSignIn_EnableSessionCache(GoogleSignIn_t self, bool enable) {
+  self->wrapped_->EnableSessionCache(enable);
+}
+
+void GoogleSignIn_EnableTokenRefresh(GoogleSignIn_t self, bool enable) {
+  self->wrapped_->EnableTokenRefresh(enable);
+}
+
+bool GoogleSignIn_LoadJwks(GoogleSignIn_t self, const char *buf, size_t len) {
+  return self->wrapped_->LoadJwks(buf, len);
+}
+
+bool GoogleSignIn_LoadJwksFile(GoogleSignIn_t self, const char *path) {
+  return self->wrapped_->LoadJwksFile(path);
+}
+
+int GoogleSignIn_VerifyIdToken(GoogleSignIn_t self, GoogleSignInUser_t user) {
+  return self->wrapped_->VerifyIdToken(*user);
 }
 
 void GoogleSignIn_Signout(GoogleSignIn_t self) { self->wrapped_->SignOut(); }
@@ -144,9 +174,9 @@ bool GoogleSignIn_Pending(GoogleSignInFuture_t self) {
   return self->wrapped_->Pending();
 }
 
-int GoogleSignIn_Status(GoogleSignInFuture_t self) {
-  // Map the Android status code onto the Unity plugin enum.
-  switch (self->wrapped_->Status()) {
+// Maps the Android status code onto the Unity plugin enum.
+static int MapStatusCode(int status) {
+  switch (status) {
     case googlesignin::GoogleSignIn::kStatusCodeApiNotConnected:
       return googlesignin::GoogleSignUnityStatusCode::kUnityStatusCodeApiNotConnected;
     case googlesignin::GoogleSignIn::kStatusCodeCanceled:
@@ -174,10 +204,80 @@ int GoogleSignIn_Status(GoogleSignInFuture_t self) {
   }
 }
 
+static_assert(GOOGLESIGNIN_STATS_FLOWS == googlesignin::SignInStats::kFlowCount,
+              "GoogleSignInStats flows");
+static_assert(GOOGLESIGNIN_STATS_LATENCY_BUCKETS ==
+                  googlesignin::SignInStats::kLatencyBuckets,
+              "GoogleSignInStats latency buckets");
+static_assert(GOOGLESIGNIN_STATS_OPERATIONS ==
+                  googlesignin::SignInStats::kOpCount,
+              "GoogleSignInStats operations");
+
+void GoogleSignIn_GetStats(GoogleSignIn_t self, GoogleSignInStats *stats) {
+  googlesignin::SignInStats totals = self->wrapped_->GetStats();
+  memset(stats, 0, sizeof(*stats));
+  for (int flow = 0; flow < GOOGLESIGNIN_STATS_FLOWS; flow++) {
+    googlesignin::SignInStats::Flow f =
+        static_cast<googlesignin::SignInStats::Flow>(flow);
+    stats->started[flow] = totals.started[flow];
+    // Fold the status codes into the ones returned by GoogleSignIn_Status().
+    for (int bucket = 0; bucket < googlesignin::SignInStats::kStatusBuckets;
+         bucket++) {
+      int status = MapStatusCode(
+          googlesignin::SignInStats::BucketStatus(bucket));
+      stats->completed[flow][status + 1] += totals.completed[flow][bucket];
+    }
+    stats->success_ratio[flow] = totals.SuccessRatio(f);
+    stats->latency_p50_ms[flow] = totals.LatencyPercentileMs(f, 50);
+    stats->latency_p99_ms[flow] = totals.LatencyPercentileMs(f, 99);
+    memcpy(stats->latency_ms[flow], totals.latency_ms[flow],
+           sizeof(stats->latency_ms[flow]));
+  }
+  memcpy(stats->jni_calls, totals.jni_calls, sizeof(stats->jni_calls));
+  memcpy(stats->jni_bytes, totals.jni_bytes, sizeof(stats->jni_bytes));
+}
+
+bool GoogleSignIn_Wait(GoogleSignInFuture_t self, int timeout_ms) {
+  if (timeout_ms < 0) {
+    self->wrapped_->Wait();
+    return true;
+  }
+  return self->wrapped_->WaitFor(timeout_ms);
+}
+
+void GoogleSignIn_SetCompletionCallback(GoogleSignInFuture_t self,
+                                        GoogleSignIn_CompletionCallback callback,
+                                        void *user_data, bool queued) {
+  self->wrapped_->SetCompletionCallback(callback, user_data, queued);
+}
+
+void GoogleSignIn_DispatchCallbacks() {
+  googlesignin::GoogleSignIn::DispatchCallbacks();
+}
+
+int GoogleSignIn_Status(GoogleSignInFuture_t self) {
+  return MapStatusCode(self->wrapped_->Status());
+}
+
 GoogleSignInUser_t GoogleSignIn_Result(GoogleSignInFuture_t self) {
-  return (self->wrapped_->Result() && self->wrapped_->Result()->User)
-             ? new GoogleSignInUser(self->wrapped_->Result()->User)
-             : nullptr;
+  const googlesignin::GoogleSignIn::SignInResult *result =
+      self->wrapped_->Result();
+  if (!result || !result->User) {
+    return nullptr;
+  }
+  // The caller's reference, dropped by GoogleSignIn_ReleaseUser().
+  result->User->AddRef();
+  return result->User;
+}
+
+void GoogleSignIn_DisposeFuture(GoogleSignInFuture_t self) {
+  // The wrapper is shared with the later sign-ins reusing its future.
+}
+
+void GoogleSignIn_ReleaseUser(GoogleSignInUser_t self) {
+  if (self) {
+    self->Release();
+  }
 }
 
 static size_t ReturnCopiedString(const char *src, char *dest, size_t len) {
@@ -188,40 +288,162 @@ static size_t ReturnCopiedString(const char *src, char *dest, size_t len) {
   return src ? strlen(src) + 1 : 0;
 }
 
+size_t GoogleSignIn_GetRefreshedIdToken(GoogleSignIn_t self, char *buf,
+                                        size_t len) {
+  // Holding the reference keeps the token alive while it is copied.
+  std::shared_ptr<const googlesignin::GoogleSignInUser> user =
+      self->wrapped_->GetRefreshedUser();
+  return user ? ReturnCopiedString(user->GetIdToken(), buf, len) : 0;
+}
+
+size_t GoogleSignIn_ExportTrace(char *buf, size_t len) {
+  static std::mutex snapshot_mutex;
+  static std::string *snapshot = new std::string();
+  std::lock_guard<std::mutex> lock(snapshot_mutex);
+  if (!buf || !len) {
+    googlesignin::Trace::ExportChromeJson(snapshot);
+    return snapshot->size() + 1;
+  }
+  if (snapshot->empty()) {
+    googlesignin::Trace::ExportChromeJson(snapshot);
+  }
+  size_t copied = ReturnCopiedString(snapshot->c_str(), buf, len);
+  snapshot->clear();
+  return copied;
+}
+
+void GoogleSignIn_EnableRecording(bool enable) {
+  googlesignin::JniRecorder::Enable(enable);
+}
+
+size_t GoogleSignIn_ExportRecording(uint8_t *buf, size_t len) {
+  static std::mutex snapshot_mutex;
+  static std::string *snapshot = new std::string();
+  std::lock_guard<std::mutex> lock(snapshot_mutex);
+  if (!buf || !len) {
+    googlesignin::JniRecorder::Export(snapshot);
+    return snapshot->size();
+  }
+  if (snapshot->empty()) {
+    googlesignin::JniRecorder::Export(snapshot);
+  }
+  size_t copied = snapshot->size() < len ? snapshot->size() : len;
+  memcpy(buf, snapshot->data(), copied);
+  snapshot->clear();
+  return copied;
+}
+
 size_t GoogleSignIn_GetServerAuthCode(GoogleSignInUser_t self, char *buf,
                                       size_t len) {
-  return ReturnCopiedString(self->wrapped_->GetServerAuthCode(), buf, len);
+  return ReturnCopiedString(self->GetServerAuthCode(), buf, len);
 }
 
 size_t GoogleSignIn_GetDisplayName(GoogleSignInUser_t self, char *buf,
                                    size_t len) {
-  return ReturnCopiedString(self->wrapped_->GetDisplayName(), buf, len);
+  return ReturnCopiedString(self->GetDisplayName(), buf, len);
 }
 
 size_t GoogleSignIn_GetEmail(const GoogleSignInUser_t self, char *buf,
                              size_t len) {
-  return ReturnCopiedString(self->wrapped_->GetEmail(), buf, len);
+  return ReturnCopiedString(self->GetEmail(), buf, len);
 }
 
 size_t GoogleSignIn_GetFamilyName(GoogleSignInUser_t self, char *buf,
                                   size_t len) {
-  return ReturnCopiedString(self->wrapped_->GetFamilyName(), buf, len);
+  return ReturnCopiedString(self->GetFamilyName(), buf, len);
 }
 
 size_t GoogleSignIn_GetGivenName(GoogleSignInUser_t self, char *buf,
                                  size_t len) {
-  return ReturnCopiedString(self->wrapped_->GetGivenName(), buf, len);
+  return ReturnCopiedString(self->GetGivenName(), buf, len);
 }
 
 size_t GoogleSignIn_GetIdToken(GoogleSignInUser_t self, char *buf, size_t len) {
-  return ReturnCopiedString(self->wrapped_->GetIdToken(), buf, len);
+  return ReturnCopiedString(self->GetIdToken(), buf, len);
 }
 
 size_t GoogleSignIn_GetImageUrl(GoogleSignInUser_t self, char *buf,
                                 size_t len) {
-  return ReturnCopiedString(self->wrapped_->GetImageUrl(), buf, len);
+  return ReturnCopiedString(self->GetImageUrl(), buf, len);
 }
 
 size_t GoogleSignIn_GetUserId(GoogleSignInUser_t self, char *buf, size_t len) {
-  return ReturnCopiedString(self->wrapped_->GetUserId(), buf, len);
+  return ReturnCopiedString(self->GetUserId(), buf, len);
+}
+
+// Sets the pointer and length of one field of the view.
+static void SetViewField(const char *src, const char **dest, size_t *len) {
+  *dest = src;
+  *len = src ? strlen(src) : 0;
+}
+
+static void FillUserView(const googlesignin::GoogleSignInUser *user,
+                         GoogleSignInUserView *view) {
+  SetViewField(user->GetDisplayName(), &view->display_name,
+               &view->display_name_len);
+  SetViewField(user->GetEmail(), &view->email, &view->email_len);
+  SetViewField(user->GetFamilyName(), &view->family_name,
+               &view->family_name_len);
+  SetViewField(user->GetGivenName(), &view->given_name,
+               &view->given_name_len);
+  SetViewField(user->GetIdToken(), &view->id_token, &view->id_token_len);
+  SetViewField(user->GetImageUrl(), &view->image_url, &view->image_url_len);
+  SetViewField(user->GetServerAuthCode(), &view->server_auth_code,
+               &view->server_auth_code_len);
+  SetViewField(user->GetUserId(), &view->user_id, &view->user_id_len);
+}
+
+void GoogleSignIn_GetUserView(GoogleSignInUser_t self,
+                              GoogleSignInUserView *view) {
+  FillUserView(self, view);
+}
+
+bool GoogleSignIn_GetIdTokenClaims(GoogleSignInUser_t self,
+                                   GoogleSignInIdTokenClaims *claims) {
+  memset(claims, 0, sizeof(*claims));
+  const googlesignin::IdTokenClaims *decoded = self->GetIdTokenClaims();
+  if (!decoded) {
+    return false;
+  }
+  claims->alg = decoded->alg;
+  claims->alg_len = decoded->alg_len;
+  claims->kid = decoded->kid;
+  claims->kid_len = decoded->kid_len;
+  claims->iss = decoded->iss;
+  claims->iss_len = decoded->iss_len;
+  claims->aud = decoded->aud;
+  claims->aud_len = decoded->aud_len;
+  claims->azp = decoded->azp;
+  claims->azp_len = decoded->azp_len;
+  claims->sub = decoded->sub;
+  claims->sub_len = decoded->sub_len;
+  claims->email = decoded->email;
+  claims->email_len = decoded->email_len;
+  claims->hd = decoded->hd;
+  claims->hd_len = decoded->hd_len;
+  claims->exp = decoded->exp;
+  claims->iat = decoded->iat;
+  claims->email_verified = decoded->email_verified;
+  return true;
+}
+
+int64_t GoogleSignIn_GetIdTokenExpiry(GoogleSignInUser_t self) {
+  const googlesignin::IdTokenClaims *decoded = self->GetIdTokenClaims();
+  return decoded ? decoded->exp : 0;
+}
+
+bool GoogleSignIn_GetResultView(GoogleSignInFuture_t self,
+                                GoogleSignInResultView *view) {
+  memset(view, 0, sizeof(*view));
+  view->pending = self->wrapped_->Pending();
+  view->status = MapStatusCode(self->wrapped_->Status());
+  if (!view->pending) {
+    googlesignin::GoogleSignIn::SignInResult *result =
+        self->wrapped_->Result();
+    if (result && result->User) {
+      view->has_user = 1;
+      FillUserView(result->User, &view->user);
+    }
+  }
+  return view->pending != 0;
 }
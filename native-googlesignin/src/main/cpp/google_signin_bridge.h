@@ -21,6 +21,7 @@
 
 #include <jni.h>
 #include <stddef.h>
+#include <stdint.h>
 
 struct GoogleSignInHolder;
 typedef GoogleSignInHolder* GoogleSignIn_t;
@@ -28,8 +29,108 @@ typedef GoogleSignInHolder* GoogleSignIn_t;
 struct GoogleSignInFuture;
 typedef GoogleSignInFuture* GoogleSignInFuture_t;
 
-struct GoogleSignInUser;
-typedef GoogleSignInUser* GoogleSignInUser_t;
+// A user handle is the reference counted user itself, so the same user is
+// always the same handle.  See GoogleSignIn_Result().
+namespace googlesignin {
+class GoogleSignInUser;
+}  // namespace googlesignin
+typedef const googlesignin::GoogleSignInUser* GoogleSignInUser_t;
+
+// Callback registered with GoogleSignIn_SetCompletionCallback().
+typedef void (*GoogleSignIn_CompletionCallback)(void* user_data);
+
+// All the fields of a GoogleSignInUser, returned by GoogleSignIn_GetUserView()
+// so they can be read with a single call.  The pointers refer to the storage
+// of the user, they are not copied, and are valid as long as the user is.
+// Each value is null terminated; the length does not include the terminator.
+// The layout is blittable so it can be marshalled directly (i.e. to C#).
+struct GoogleSignInUserView {
+  const char* display_name;
+  size_t display_name_len;
+  const char* email;
+  size_t email_len;
+  const char* family_name;
+  size_t family_name_len;
+  const char* given_name;
+  size_t given_name_len;
+  const char* id_token;
+  size_t id_token_len;
+  const char* image_url;
+  size_t image_url_len;
+  const char* server_auth_code;
+  size_t server_auth_code_len;
+  const char* user_id;
+  size_t user_id_len;
+};
+
+// The claims of the user's ID token, returned by
+// GoogleSignIn_GetIdTokenClaims().  The strings follow the same rules as
+// GoogleSignInUserView, a claim that is not in the token is "".  exp and iat
+// are seconds since the epoch, 0 if not in the token.  email_verified is 1 or
+// 0, -1 if not in the token.
+struct GoogleSignInIdTokenClaims {
+  const char* alg;
+  size_t alg_len;
+  const char* kid;
+  size_t kid_len;
+  const char* iss;
+  size_t iss_len;
+  const char* aud;
+  size_t aud_len;
+  const char* azp;
+  size_t azp_len;
+  const char* sub;
+  size_t sub_len;
+  const char* email;
+  size_t email_len;
+  const char* hd;
+  size_t hd_len;
+  int64_t exp;
+  int64_t iat;
+  int email_verified;
+};
+
+// The state of a GoogleSignInFuture, returned by GoogleSignIn_GetResultView().
+// status is the mapped status code as returned by GoogleSignIn_Status().
+// user is only filled in when has_user is non-zero.  Its pointers refer to
+// the user held by the future's request slot, they are not copied.  There
+// are 16 slots, handed out in round robin order by Configure, SignIn,
+// SignInSilently and the token refresh, and when all 16 are outstanding the
+// oldest is evicted to make room.  The pointers are valid until the slot is
+// reused, at which point they may dangle.  Read the view right after
+// getting it on the thread that starts the requests, or keep the user with
+// GoogleSignIn_Result() instead.
+struct GoogleSignInResultView {
+  int pending;
+  int status;
+  int has_user;
+  GoogleSignInUserView user;
+};
+
+// Sizes of the arrays in GoogleSignInStats.
+#define GOOGLESIGNIN_STATS_FLOWS 2
+#define GOOGLESIGNIN_STATS_STATUSES 11
+#define GOOGLESIGNIN_STATS_LATENCY_BUCKETS 96
+#define GOOGLESIGNIN_STATS_OPERATIONS 4
+
+// The sign-in stats returned by GoogleSignIn_GetStats(), see
+// googlesignin::SignInStats.  Arrays by flow are indexed by 0 for SignIn()
+// and 1 for SignInSilently().  Statuses are the codes returned by
+// GoogleSignIn_Status(), at index status + 1.  Latency bucket i counts the
+// sign-ins that took from SignInStats::LatencyBucketLowerBound(i) ms up to
+// the next bucket's bound.  Arrays by operation are indexed by configure,
+// sign-in, result and other.  The layout is blittable.
+struct GoogleSignInStats {
+  uint64_t started[GOOGLESIGNIN_STATS_FLOWS];
+  uint64_t completed[GOOGLESIGNIN_STATS_FLOWS][GOOGLESIGNIN_STATS_STATUSES];
+  double success_ratio[GOOGLESIGNIN_STATS_FLOWS];
+  uint64_t latency_p50_ms[GOOGLESIGNIN_STATS_FLOWS];
+  uint64_t latency_p99_ms[GOOGLESIGNIN_STATS_FLOWS];
+  uint64_t latency_ms[GOOGLESIGNIN_STATS_FLOWS]
+                     [GOOGLESIGNIN_STATS_LATENCY_BUCKETS];
+  uint64_t jni_calls[GOOGLESIGNIN_STATS_OPERATIONS];
+  uint64_t jni_bytes[GOOGLESIGNIN_STATS_OPERATIONS];
+};
 
 namespace googlesignin {
 //Enum of the status codes used in the Unity plugin.  The
@@ -55,6 +156,10 @@ extern "C" {
 // Create a new instance of the GoogleSignIn class.
 GoogleSignIn_t GoogleSignIn_Create(jobject activity);
 
+// Resolves the classes and method ids used by the plugin on a background
+// thread.  See GoogleSignIn::Prewarm().
+void GoogleSignIn_Prewarm(jobject activity);
+
 // Dispose the instance created by GoogleSignIn_Create().
 void GoogleSignIn_Dispose(GoogleSignIn_t self);
 
@@ -69,13 +174,74 @@ void GoogleSignIn_Configure(GoogleSignIn_t self, bool useGameSignIn,
                             const char** additional_scopes, int scopes_count,
                             const char* accountName);
 
+// Connects to Google Play services for the current configuration in the
+// background, so the next sign-in starts sooner.  Returns false if
+// GoogleSignIn_Configure() has not been called.  See GoogleSignIn::WarmUp().
+bool GoogleSignIn_WarmUp(GoogleSignIn_t self);
+
 // Start the sign-in process.  Returns a Future to use to get the result.
+// Futures are reused, like the results they hold, so a later sign-in can
+// return the same one; signing in allocates nothing that has to be freed.
 GoogleSignInFuture_t GoogleSignIn_SignIn(GoogleSignIn_t self);
 
 // Attempts to sign in silently.  This method should be attempted first when
-// when signing in "automatically".
+// when signing in "automatically".  See GoogleSignIn_SignIn() for the
+// Future returned.
 GoogleSignInFuture_t GoogleSignIn_SignInSilently(GoogleSignIn_t self);
 
+// Completes the futures whose results have arrived, for all the instances.
+// Once this is called, results are delivered by calling it, from one thread
+// only and typically once per frame, until it has not been called for a
+// second.  See GoogleSignIn::PollEvents().
+void GoogleSignIn_PollEvents(GoogleSignIn_t self);
+
+// Enables or disables the session cache.  See
+// GoogleSignIn::EnableSessionCache().
+void GoogleSignIn_EnableSessionCache(GoogleSignIn_t self, bool enable);
+
+// Enables or disables refreshing the ID token ahead of its expiry.  The
+// refreshes are started by GoogleSignIn_PollEvents().  See
+// GoogleSignIn::EnableTokenRefresh().
+void GoogleSignIn_EnableTokenRefresh(GoogleSignIn_t self, bool enable);
+
+// Copies the ID token of the most recently refreshed user into buf, which
+// can be done at any time without waiting for a refresh.  Follows the same
+// convention as GoogleSignIn_GetIdToken(), returns 0 if there is no user.
+size_t GoogleSignIn_GetRefreshedIdToken(GoogleSignIn_t self, char* buf,
+                                        size_t len);
+
+// Fills stats with the sign-in counters, latency histograms and JNI traffic
+// of all the instances.  Does not block the threads recording them.  See
+// GoogleSignIn::GetStats().
+void GoogleSignIn_GetStats(GoogleSignIn_t self, GoogleSignInStats* stats);
+
+// Copies the recorded trace events, in the Chrome trace event JSON format,
+// into buf.  Follows the same convention as GoogleSignIn_GetIdToken(): a
+// call with a null buf takes a snapshot of the events and returns the size
+// needed, including the terminator, and the next call copies that snapshot.
+// The trace is empty unless the library was built with GOOGLESIGNIN_TRACE.
+size_t GoogleSignIn_ExportTrace(char* buf, size_t len);
+
+// Starts recording the calls between the native code and Java, discarding
+// the previous recording, or stops recording.  See JniRecorder.
+void GoogleSignIn_EnableRecording(bool enable);
+
+// Copies the recording into buf.  Like GoogleSignIn_ExportTrace(), a call
+// with a null buf takes a snapshot and returns its size, and the next call
+// copies it and returns the number of bytes copied.  The recording is
+// binary, there is no terminator.
+size_t GoogleSignIn_ExportRecording(uint8_t* buf, size_t len);
+
+// Loads the keys used to verify ID tokens from a JWKS document held in buf,
+// or from the file at path.  Returns false if there are no usable keys.
+// See GoogleSignIn::LoadJwks().
+bool GoogleSignIn_LoadJwks(GoogleSignIn_t self, const char* buf, size_t len);
+bool GoogleSignIn_LoadJwksFile(GoogleSignIn_t self, const char* path);
+
+// Verifies the ID token of user offline.  Returns one of the
+// googlesignin::IdTokenStatus values, 0 if the token is valid.
+int GoogleSignIn_VerifyIdToken(GoogleSignIn_t self, GoogleSignInUser_t user);
+
 // Signs out. This affects the local state.
 void GoogleSignIn_Signout(GoogleSignIn_t self);
 
@@ -93,11 +259,42 @@ bool GoogleSignIn_Pending(GoogleSignInFuture_t self);
 // (i.e. C#).
 int GoogleSignIn_Status(GoogleSignInFuture_t self);
 
+// Blocks until the Future completes or timeout_ms have passed.  A negative
+// timeout waits forever.  Returns true if the Future has completed.  Called
+// on the thread that calls GoogleSignIn_PollEvents(), it keeps delivering the
+// results that have arrived while it waits, but not from a completion
+// callback run by GoogleSignIn_PollEvents().
+bool GoogleSignIn_Wait(GoogleSignInFuture_t self, int timeout_ms);
+
+// Registers a callback that is called once, the next time the Future
+// completes.  This removes the need to poll GoogleSignIn_Pending().  If queued
+// is false the callback is called on the thread that completes the operation,
+// otherwise it is called from GoogleSignIn_DispatchCallbacks().
+void GoogleSignIn_SetCompletionCallback(GoogleSignInFuture_t self,
+                                        GoogleSignIn_CompletionCallback callback,
+                                        void* user_data, bool queued);
+
+// Runs the queued completion callbacks on the calling thread.
+void GoogleSignIn_DispatchCallbacks();
+
 // Accesses the Result() method of the Future.  This avoids
 // having to marshal classes and structures between C and other languages
 // (i.e. C#).
+//
+// Returns the signed in user, or null.  Each call returns the same handle
+// for the same user and adds a reference to it, without allocating.  The
+// handle stays valid after the future is reused or disposed, until it is
+// passed to GoogleSignIn_ReleaseUser().
 GoogleSignInUser_t GoogleSignIn_Result(GoogleSignInFuture_t self);
 
+// Called when the caller is done with a Future.  It does nothing: the Future
+// is reused by later sign-ins and never freed.
+void GoogleSignIn_DisposeFuture(GoogleSignInFuture_t self);
+
+// Drops the reference added by GoogleSignIn_Result().  Does nothing if self
+// is null.
+void GoogleSignIn_ReleaseUser(GoogleSignInUser_t self);
+
 // Accesses the AuthCode() method of the GoogleSignInUser.
 // This avoids having to marshal classes and structures between C and other
 // languages (i.e. C#).
@@ -168,5 +365,27 @@ size_t GoogleSignIn_GetIdToken(GoogleSignInUser_t self, char* buf, size_t len);
 size_t GoogleSignIn_GetImageUrl(GoogleSignInUser_t self, char* buf, size_t len);
 
 size_t GoogleSignIn_GetUserId(GoogleSignInUser_t self, char* buf, size_t len);
+
+// Fills view with all the fields of the GoogleSignInUser.  This replaces
+// calling each GoogleSignIn_Get* method twice, and copies nothing.
+void GoogleSignIn_GetUserView(GoogleSignInUser_t self,
+                              GoogleSignInUserView* view);
+
+// Fills claims with the decoded ID token of the user.  The token is decoded
+// on the first call and kept with the user.  Returns false, leaving claims
+// zeroed, if the user has no ID token or it can't be decoded.
+bool GoogleSignIn_GetIdTokenClaims(GoogleSignInUser_t self,
+                                   GoogleSignInIdTokenClaims* claims);
+
+// Returns the expiry (exp claim) of the user's ID token in seconds since the
+// epoch, or 0 if there is none.
+int64_t GoogleSignIn_GetIdTokenExpiry(GoogleSignInUser_t self);
+
+// Fills view with the Pending(), Status() and Result() of the Future in a
+// single call.  Returns the value of view->pending.  Once the Future's
+// request slot is reused the view describes the new request, see
+// GoogleSignInResultView.
+bool GoogleSignIn_GetResultView(GoogleSignInFuture_t self,
+                                GoogleSignInResultView* view);
 }  // extern "C"
 #endif  // GOOGLESIGNIN_GOOGLESIGNINBRIDGE_H
@@ -16,9 +16,15 @@
 
 #include "google_signin_user.h"  // NOLINT
 #include <android/log.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <new>
 
 #include "google_signin_user_impl.h"  // NOLINT
+#include "id_token.h"                 // NOLINT
 #include "jni_init.h"                 // NOLINT
+#include "stats.h"                    // NOLINT
 
 #define GOOGLESIGNINACCOUNT_NAME \
   "com/google/android/gms/auth/api/signin/GoogleSignInAccount"
@@ -59,6 +65,14 @@
 #define TOSTRING_METHOD_NAME "toString"
 #define TOSTRING_METHOD_SIG "()Ljava/lang/String;"
 
+#define HELPER_CLASSNAME "com/google/googlesignin/GoogleSignInHelper"
+
+// static byte[] packAccount(GoogleSignInAccount acct)
+#define PACKACCOUNT_METHOD_NAME "packAccount"
+#define PACKACCOUNT_METHOD_SIG                                   \
+  "(Lcom/google/android/gms/auth/api/signin/GoogleSignInAccount;" \
+  ")[B"
+
 namespace googlesignin {
 
 jmethodID GoogleSignInUserImpl::method_getDisplayName = 0;
@@ -70,137 +84,442 @@ jmethodID GoogleSignInUserImpl::method_getIdToken = 0;
 jmethodID GoogleSignInUserImpl::method_getPhotoUrl = 0;
 jmethodID GoogleSignInUserImpl::method_getServerAuthCode = 0;
 jmethodID GoogleSignInUserImpl::method_uri_toString = 0;
+jclass GoogleSignInUserImpl::helper_class = 0;
+jmethodID GoogleSignInUserImpl::method_packAccount = 0;
 
-void GoogleSignInUserImpl::Initialize(jobject obj) {
-  JNIEnv* env = GetJniEnv();
+// Set once LookUpMethods() succeeded, initialize_mutex serializes the
+// attempts until then.
+static std::mutex initialize_mutex;
+static std::atomic<bool> initialized(false);
 
-  if (!method_getDisplayName) {
-    jclass google_acct_class = FindClass(GOOGLESIGNINACCOUNT_NAME, obj);
+bool GoogleSignInUserImpl::Initialize(jobject obj) {
+  if (initialized.load(std::memory_order_acquire)) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(initialize_mutex);
+  if (initialized.load(std::memory_order_relaxed)) {
+    return true;
+  }
+  if (!LookUpMethods(obj)) {
+    return false;
+  }
+  initialized.store(true, std::memory_order_release);
+  return true;
+}
 
-    method_getDisplayName =
-        env->GetMethodID(google_acct_class, GETDISPLAYNAME_METHOD_NAME,
-                         GETDISPLAYNAME_METHOD_SIG);
+bool GoogleSignInUserImpl::LookUpMethods(jobject obj) {
+  jclass google_acct_class = FindClass(GOOGLESIGNINACCOUNT_NAME, obj);
+  jclass uri_class = FindClass(URI_NAME, obj);
+  if (!google_acct_class || !uri_class) {
+    return false;
+  }
 
-    method_getEmail = env->GetMethodID(google_acct_class, GETEMAIL_METHOD_NAME,
-                                       GETEMAIL_METHOD_SIG);
+  method_getDisplayName = GetMethod(
+      google_acct_class, GETDISPLAYNAME_METHOD_NAME, GETDISPLAYNAME_METHOD_SIG);
+  method_getEmail =
+      GetMethod(google_acct_class, GETEMAIL_METHOD_NAME, GETEMAIL_METHOD_SIG);
+  method_getFamilyName = GetMethod(
+      google_acct_class, GETFAMILYNAME_METHOD_NAME, GETFAMILYNAME_METHOD_SIG);
+  method_getGivenName = GetMethod(
+      google_acct_class, GETGIVENNAME_METHOD_NAME, GETGIVENNAME_METHOD_SIG);
+  method_getId =
+      GetMethod(google_acct_class, GETID_METHOD_NAME, GETID_METHOD_SIG);
+  method_getIdToken = GetMethod(google_acct_class, GETIDTOKEN_METHOD_NAME,
+                                GETIDTOKEN_METHOD_SIG);
+  method_getPhotoUrl = GetMethod(google_acct_class, GETPHOTOURL_METHOD_NAME,
+                                 GETPHOTOURL_METHOD_SIG);
+  method_uri_toString =
+      GetMethod(uri_class, TOSTRING_METHOD_NAME, TOSTRING_METHOD_SIG);
+  method_getServerAuthCode =
+      GetMethod(google_acct_class, GETSERVERAUTHCODE_METHOD_NAME,
+                GETSERVERAUTHCODE_METHOD_SIG);
+  if (!method_getDisplayName || !method_getEmail || !method_getFamilyName ||
+      !method_getGivenName || !method_getId || !method_getIdToken ||
+      !method_getPhotoUrl || !method_uri_toString ||
+      !method_getServerAuthCode) {
+    return false;
+  }
 
-    method_getFamilyName = env->GetMethodID(
-        google_acct_class, GETFAMILYNAME_METHOD_NAME, GETFAMILYNAME_METHOD_SIG);
+  // The packed path is optional, if the helper does not have the method
+  // the fields are read one at a time.
+  helper_class = FindClass(HELPER_CLASSNAME, obj);
+  if (helper_class) {
+    method_packAccount = GetStaticMethod(
+        helper_class, PACKACCOUNT_METHOD_NAME, PACKACCOUNT_METHOD_SIG);
+  }
+  return true;
+}
 
-    method_getGivenName = env->GetMethodID(
-        google_acct_class, GETGIVENNAME_METHOD_NAME, GETGIVENNAME_METHOD_SIG);
+// Marks an ID token that could not be decoded.
+static char invalid_claims_marker;
+static IdTokenClaims* const kInvalidClaims =
+    reinterpret_cast<IdTokenClaims*>(&invalid_claims_marker);
 
-    method_getId = env->GetMethodID(google_acct_class, GETID_METHOD_NAME,
-                                    GETID_METHOD_SIG);
+GoogleSignInUserImpl::GoogleSignInUserImpl(char* buffer, size_t capacity)
+    : buffer_(buffer), capacity_(capacity), claims_(nullptr), refs_(1) {
+  for (int i = 0; i < kFieldCount; i++) {
+    offsets_[i] = 0;
+    lengths_[i] = 0;
+  }
+}
 
-    method_getIdToken = env->GetMethodID(
-        google_acct_class, GETIDTOKEN_METHOD_NAME, GETIDTOKEN_METHOD_SIG);
+GoogleSignInUserImpl::~GoogleSignInUserImpl() {
+  IdTokenClaims* claims = claims_.load(std::memory_order_acquire);
+  if (claims != kInvalidClaims) {
+    delete claims;
+  }
+}
 
-    method_getPhotoUrl = env->GetMethodID(
-        google_acct_class, GETPHOTOURL_METHOD_NAME, GETPHOTOURL_METHOD_SIG);
+const IdTokenClaims* GoogleSignInUserImpl::GetIdTokenClaims() const {
+  IdTokenClaims* claims = claims_.load(std::memory_order_acquire);
+  if (!claims) {
+    IdTokenClaims* decoded = nullptr;
+    if (lengths_[kIdToken]) {
+      decoded = IdTokenClaims::Decode(Get(kIdToken), lengths_[kIdToken]);
+    }
+    if (!decoded) {
+      decoded = kInvalidClaims;
+    }
+    // If another thread got there first, use its copy.
+    if (claims_.compare_exchange_strong(claims, decoded,
+                                        std::memory_order_acq_rel)) {
+      claims = decoded;
+    } else if (decoded != kInvalidClaims) {
+      delete decoded;
+    }
+  }
+  return claims != kInvalidClaims ? claims : nullptr;
+}
 
-    jclass uri_class = FindClass(URI_NAME, obj);
-    method_uri_toString = env->GetMethodID(
-        uri_class, TOSTRING_METHOD_NAME, TOSTRING_METHOD_SIG);
+void GoogleSignInUserImpl::SetFields(const char* const values[kFieldCount],
+                                     const size_t lengths[kFieldCount]) {
+  char* pos = buffer_;
+  for (int i = 0; i < kFieldCount; i++) {
+    size_t len = values[i] ? lengths[i] : 0;
+    if (len) {
+      memcpy(pos, values[i], len);
+    }
+    pos[len] = '\0';
+    offsets_[i] = static_cast<uint32_t>(pos - buffer_);
+    lengths_[i] = static_cast<uint32_t>(len);
+    pos += len + 1;
+  }
+}
 
-    method_getServerAuthCode =
-        env->GetMethodID(google_acct_class, GETSERVERAUTHCODE_METHOD_NAME,
-                         GETSERVERAUTHCODE_METHOD_SIG);
+// Released users waiting to be reused by NewUser(), guarded by
+// user_pool_mutex.
+static std::mutex user_pool_mutex;
+static GoogleSignInUser* user_pool[GoogleSignInUserImpl::kMaxPooledUsers];
+static int user_pool_size = 0;
+
+// The layout of the block made by Allocate(): the user, then its impl, then
+// the field buffer.
+static const size_t kImplOffset =
+    (sizeof(GoogleSignInUser) + alignof(GoogleSignInUserImpl) - 1) &
+    ~(alignof(GoogleSignInUserImpl) - 1);
+static const size_t kBufferOffset = kImplOffset + sizeof(GoogleSignInUserImpl);
+
+size_t GoogleSignInUserImpl::AllocationSize(size_t capacity) {
+  return kBufferOffset + capacity;
+}
+
+GoogleSignInUser* GoogleSignInUserImpl::Allocate(size_t capacity) {
+  char* block = static_cast<char*>(::operator new(AllocationSize(capacity)));
+  GoogleSignInUserImpl* impl = new (block + kImplOffset)
+      GoogleSignInUserImpl(capacity ? block + kBufferOffset : nullptr,
+                           capacity);
+  return new (block) GoogleSignInUser(impl);
+}
+
+void GoogleSignInUserImpl::Free(GoogleSignInUser* user) {
+  user->impl_->~GoogleSignInUserImpl();
+  user->~GoogleSignInUser();
+  ::operator delete(user);
+}
+
+GoogleSignInUser* GoogleSignInUserImpl::NewUser(size_t capacity) {
+  {
+    std::lock_guard<std::mutex> lock(user_pool_mutex);
+    for (int i = user_pool_size - 1; i >= 0; i--) {
+      GoogleSignInUser* user = user_pool[i];
+      if (user->impl_->capacity_ >= capacity) {
+        user_pool[i] = user_pool[--user_pool_size];
+        user->impl_->refs_.store(1, std::memory_order_relaxed);
+        return user;
+      }
+    }
   }
+  return Allocate(capacity);
 }
 
-GoogleSignInUser::GoogleSignInUser() : impl_(new GoogleSignInUserImpl()) {}
-GoogleSignInUser::~GoogleSignInUser() { delete impl_; }
+GoogleSignInUser* GoogleSignInUserImpl::NewUser(
+    const char* const values[kFieldCount], const size_t lengths[kFieldCount]) {
+  size_t size = 0;
+  for (int i = 0; i < kFieldCount; i++) {
+    size += (values[i] ? lengths[i] : 0) + 1;
+  }
+  GoogleSignInUser* user = NewUser(size);
+  user->impl_->SetFields(values, lengths);
+  return user;
+}
+
+void GoogleSignInUserImpl::Recycle(GoogleSignInUser* user) {
+  GoogleSignInUserImpl* impl = user->impl_;
+  // Wipe the tokens before the buffer is reused.
+  if (impl->capacity_) {
+    memset(impl->buffer_, 0, impl->capacity_);
+  }
+  for (int i = 0; i < kFieldCount; i++) {
+    impl->offsets_[i] = 0;
+    impl->lengths_[i] = 0;
+  }
+  IdTokenClaims* claims = impl->claims_.exchange(nullptr);
+  if (claims != kInvalidClaims) {
+    delete claims;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(user_pool_mutex);
+    if (user_pool_size < kMaxPooledUsers) {
+      user_pool[user_pool_size++] = user;
+      return;
+    }
+  }
+  Free(user);
+}
+
+// The impl is destroyed and freed with the user by
+// GoogleSignInUserImpl::Free().
+GoogleSignInUser::~GoogleSignInUser() {}
+
+void GoogleSignInUser::AddRef() const {
+  impl_->refs_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void GoogleSignInUser::Release() const {
+  if (impl_->refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    GoogleSignInUserImpl::Recycle(const_cast<GoogleSignInUser*>(this));
+  }
+}
 
 const char* GoogleSignInUser::GetDisplayName() const {
-  return impl_->display_name.c_str();
+  return impl_->Get(GoogleSignInUserImpl::kDisplayName);
+}
+const char* GoogleSignInUser::GetEmail() const {
+  return impl_->Get(GoogleSignInUserImpl::kEmail);
 }
-const char* GoogleSignInUser::GetEmail() const { return impl_->email.c_str(); }
 const char* GoogleSignInUser::GetFamilyName() const {
-  return impl_->family_name.c_str();
+  return impl_->Get(GoogleSignInUserImpl::kFamilyName);
 }
 const char* GoogleSignInUser::GetGivenName() const {
-  return impl_->given_name.c_str();
+  return impl_->Get(GoogleSignInUserImpl::kGivenName);
 }
 const char* GoogleSignInUser::GetIdToken() const {
-  return impl_->id_token.c_str();
+  return impl_->Get(GoogleSignInUserImpl::kIdToken);
 }
 const char* GoogleSignInUser::GetImageUrl() const {
-  return impl_->image_url.c_str();
+  return impl_->Get(GoogleSignInUserImpl::kImageUrl);
 }
 const char* GoogleSignInUser::GetServerAuthCode() const {
-  return impl_->server_auth_code.c_str();
+  return impl_->Get(GoogleSignInUserImpl::kServerAuthCode);
 }
 const char* GoogleSignInUser::GetUserId() const {
-  return impl_->user_id.c_str();
+  return impl_->Get(GoogleSignInUserImpl::kUserId);
+}
+const IdTokenClaims* GoogleSignInUser::GetIdTokenClaims() const {
+  return impl_->GetIdTokenClaims();
 }
 
-void StringFromJava(jstring j_str, std::string* dest) {
-  if (!j_str) {
-    dest->clear();
-    return;
+// Reads the next length prefixed field from the packed account buffer.
+// Returns false if the buffer is too short.
+static bool ReadPackedField(const unsigned char** pos, const unsigned char* end,
+                            const char** value, size_t* length) {
+  if (end - *pos < 4) {
+    return false;
   }
-  JNIEnv* env = GetJniEnv();
-  const char* buf = env->GetStringUTFChars(j_str, nullptr);
+  const unsigned char* p = *pos;
+  int32_t len = static_cast<int32_t>((static_cast<uint32_t>(p[0]) << 24) |
+                                     (static_cast<uint32_t>(p[1]) << 16) |
+                                     (static_cast<uint32_t>(p[2]) << 8) |
+                                     static_cast<uint32_t>(p[3]));
+  p += 4;
+  if (len < 0) {
+    *value = nullptr;
+    *length = 0;
+  } else if (end - p < len) {
+    return false;
+  } else {
+    *value = reinterpret_cast<const char*>(p);
+    *length = static_cast<size_t>(len);
+    p += len;
+  }
+  *pos = p;
+  return true;
+}
 
-  *dest = buf;
+// Decodes the array returned by GoogleSignInHelper.packAccount() into a new
+// user, or returns null if it is malformed.  The field order must match the
+// Java side.
+static GoogleSignInUser* UnpackAccount(const unsigned char* data,
+                                       size_t size) {
+  const unsigned char* pos = data;
+  const unsigned char* end = data + size;
+  const char* values[GoogleSignInUserImpl::kFieldCount];
+  size_t lengths[GoogleSignInUserImpl::kFieldCount];
+  for (int i = 0; i < GoogleSignInUserImpl::kFieldCount; i++) {
+    if (!ReadPackedField(&pos, end, &values[i], &lengths[i])) {
+      return nullptr;
+    }
+  }
+  if (pos != end) {
+    return nullptr;
+  }
+  return GoogleSignInUserImpl::NewUser(values, lengths);
+}
 
-  __android_log_print(ANDROID_LOG_INFO, "native-googlesignin",
-                      "StringFromJava %s == %s", dest->c_str(), buf);
+GoogleSignInUser* GoogleSignInUserImpl::UserFromPackedAccount(
+    const unsigned char* data, size_t size) {
+  return UnpackAccount(data, size);
+}
 
-  env->ReleaseStringUTFChars(j_str, buf);
+// Appends a field in the form read by ReadPackedField(), a null value is
+// written with a length of -1.
+static void WritePackedField(const char* value, size_t length,
+                             std::vector<unsigned char>* out) {
+  int32_t len = value ? static_cast<int32_t>(length) : -1;
+  uint32_t bits = static_cast<uint32_t>(len);
+  out->push_back(static_cast<unsigned char>(bits >> 24));
+  out->push_back(static_cast<unsigned char>(bits >> 16));
+  out->push_back(static_cast<unsigned char>(bits >> 8));
+  out->push_back(static_cast<unsigned char>(bits));
+  if (value) {
+    out->insert(out->end(), value, value + length);
+  }
 }
 
-GoogleSignInUser* GoogleSignInUserImpl::UserFromAccount(jobject user_account) {
-  if (!user_account) {
+void GoogleSignInUserImpl::PackUser(const GoogleSignInUser& user,
+                                    bool include_server_auth_code,
+                                    std::vector<unsigned char>* out) {
+  const GoogleSignInUserImpl* impl = user.impl_;
+  for (int i = 0; i < kFieldCount; i++) {
+    Field field = static_cast<Field>(i);
+    bool omit = field == kServerAuthCode && !include_server_auth_code;
+    WritePackedField(omit ? nullptr : impl->Get(field), impl->GetLength(field),
+                     out);
+  }
+}
+
+GoogleSignInUser* GoogleSignInUserImpl::ReadPackedAccount(
+    jobject user_account) {
+  if (!method_packAccount) {
     return nullptr;
   }
   JNIEnv* env = GetJniEnv();
-  GoogleSignInUserImpl* user_impl = new GoogleSignInUserImpl();
+  jbyteArray packed = static_cast<jbyteArray>(env->CallStaticObjectMethod(
+      helper_class, method_packAccount, user_account));
+  if (env->ExceptionCheck()) {
+    env->ExceptionClear();
+    packed = nullptr;
+  }
+  if (!packed) {
+    StatsRecorder::RecordJni(SignInStats::kOpResult, 2, 0);
+    return nullptr;
+  }
 
-  if (!GoogleSignInUserImpl::method_getDisplayName) {
-    GoogleSignInUserImpl::Initialize(user_account);
+  jsize size = env->GetArrayLength(packed);
+  void* data = env->GetPrimitiveArrayCritical(packed, nullptr);
+  GoogleSignInUser* user =
+      data ? UnpackAccount(static_cast<unsigned char*>(data),
+                           static_cast<size_t>(size))
+           : nullptr;
+  if (data) {
+    env->ReleasePrimitiveArrayCritical(packed, data, JNI_ABORT);
   }
+  env->DeleteLocalRef(packed);
+  StatsRecorder::RecordJni(SignInStats::kOpResult, 6,
+                           static_cast<uint64_t>(size));
+  return user;
+}
+
+GoogleSignInUser* GoogleSignInUserImpl::ReadAccountFields(
+    jobject user_account) {
+  JNIEnv* env = GetJniEnv();
+  jstring vals[kFieldCount];
 
-  jstring val = static_cast<jstring>(env->CallObjectMethod(
+  vals[kDisplayName] = static_cast<jstring>(env->CallObjectMethod(
       user_account, GoogleSignInUserImpl::method_getDisplayName));
-  StringFromJava(val, &user_impl->display_name);
 
-  val = static_cast<jstring>(env->CallObjectMethod(
+  vals[kEmail] = static_cast<jstring>(env->CallObjectMethod(
       user_account, GoogleSignInUserImpl::method_getEmail));
-  StringFromJava(val, &user_impl->email);
 
-  val = static_cast<jstring>(env->CallObjectMethod(
+  vals[kFamilyName] = static_cast<jstring>(env->CallObjectMethod(
       user_account, GoogleSignInUserImpl::method_getFamilyName));
-  StringFromJava(val, &user_impl->family_name);
 
-  val = static_cast<jstring>(env->CallObjectMethod(
+  vals[kGivenName] = static_cast<jstring>(env->CallObjectMethod(
       user_account, GoogleSignInUserImpl::method_getGivenName));
-  StringFromJava(val, &user_impl->given_name);
 
-  val = static_cast<jstring>(
+  vals[kUserId] = static_cast<jstring>(
       env->CallObjectMethod(user_account, GoogleSignInUserImpl::method_getId));
-  StringFromJava(val, &user_impl->user_id);
 
-  val = static_cast<jstring>(env->CallObjectMethod(
+  vals[kIdToken] = static_cast<jstring>(env->CallObjectMethod(
       user_account, GoogleSignInUserImpl::method_getIdToken));
-  StringFromJava(val, &user_impl->id_token);
+
+  // The getters, plus the calls to read and free each string.
+  uint32_t jni_calls = 8;
+  uint64_t jni_bytes = 0;
 
   jobject uri = env->CallObjectMethod(user_account,
                                       GoogleSignInUserImpl::method_getPhotoUrl);
   if (uri) {
-    val = static_cast<jstring>(
+    jni_calls += 2;
+    vals[kImageUrl] = static_cast<jstring>(
         env->CallObjectMethod(uri, GoogleSignInUserImpl::method_uri_toString));
+    env->DeleteLocalRef(uri);
   } else {
-    val = nullptr;
+    vals[kImageUrl] = nullptr;
   }
-  StringFromJava(val, &user_impl->image_url);
 
-  val = static_cast<jstring>(env->CallObjectMethod(
+  vals[kServerAuthCode] = static_cast<jstring>(env->CallObjectMethod(
       user_account, GoogleSignInUserImpl::method_getServerAuthCode));
-  StringFromJava(val, &user_impl->server_auth_code);
 
-  return new GoogleSignInUser(user_impl);
+  // Hold on to all the characters so they can be copied into the user with
+  // a single allocation.
+  const char* values[kFieldCount];
+  size_t lengths[kFieldCount];
+  for (int i = 0; i < kFieldCount; i++) {
+    values[i] = vals[i] ? env->GetStringUTFChars(vals[i], nullptr) : nullptr;
+    lengths[i] = values[i] ? strlen(values[i]) : 0;
+    jni_calls += vals[i] ? 3 : 0;
+    jni_bytes += lengths[i];
+  }
+
+  GoogleSignInUser* user = NewUser(values, lengths);
+
+  for (int i = 0; i < kFieldCount; i++) {
+    if (vals[i]) {
+      if (values[i]) {
+        env->ReleaseStringUTFChars(vals[i], values[i]);
+      }
+      env->DeleteLocalRef(vals[i]);
+    }
+  }
+  StatsRecorder::RecordJni(SignInStats::kOpResult, jni_calls, jni_bytes);
+  return user;
+}
+
+GoogleSignInUser* GoogleSignInUserImpl::UserFromAccount(jobject user_account) {
+  if (!user_account) {
+    return nullptr;
+  }
+  // Without the method ids the account can't be read.
+  if (!GoogleSignInUserImpl::Initialize(user_account)) {
+    return nullptr;
+  }
+
+  // Read all the fields with a single call, falling back to one call per
+  // field if the packed form is not available.
+  GoogleSignInUser* user = ReadPackedAccount(user_account);
+  return user ? user : ReadAccountFields(user_account);
 }
 
 }  // namespace googlesignin
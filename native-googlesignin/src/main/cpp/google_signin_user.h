@@ -18,11 +18,18 @@
 namespace googlesignin {
 
 class GoogleSignInUserImpl;
+class IdTokenClaims;
 
 // Represents the currently signed in user.
+//
+// Users are reference counted.  A user starts with one reference, owned by
+// whoever created it, e.g. the GoogleSignIn::SignInResult it is returned in.
+// AddRef() keeps the user alive, each call must be matched by a Release().
+// The last Release() recycles the user.  Both can be called from any thread.
 class GoogleSignInUser {
  public:
-  ~GoogleSignInUser();
+  void AddRef() const;
+  void Release() const;
 
   const char* GetDisplayName() const;
   const char* GetEmail() const;
@@ -33,10 +40,17 @@ class GoogleSignInUser {
   const char* GetServerAuthCode() const;
   const char* GetUserId() const;
 
+  // Returns the claims of the ID token, decoded on the first call and kept
+  // for the life of the user.  Returns null if there is no ID token or it
+  // can't be decoded.  See id_token.h.
+  const IdTokenClaims* GetIdTokenClaims() const;
+
  private:
   friend class GoogleSignInUserImpl;
-  GoogleSignInUser();
+  // Users are made by GoogleSignInUserImpl, in one block with their impl,
+  // and freed by Release().
   GoogleSignInUser(GoogleSignInUserImpl* impl) : impl_(impl) {}
+  ~GoogleSignInUser();
   GoogleSignInUserImpl* impl_;
 };
 
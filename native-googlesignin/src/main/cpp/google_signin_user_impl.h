@@ -16,19 +16,41 @@
 #define GOOGLESIGNIN_GOOGLE_SIGNIN_USER_IMPL_H
 
 #include <jni.h>
-#include <string>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include "google_signin_user.h"
 
 namespace googlesignin {
 class GoogleSignInUserImpl {
  public:
-  std::string display_name;
-  std::string email;
-  std::string family_name;
-  std::string given_name;
-  std::string id_token;
-  std::string image_url;
-  std::string user_id;
-  std::string server_auth_code;
+  // The profile fields of the user.  The order matches the packed form
+  // written by GoogleSignInHelper.packAccount().
+  enum Field {
+    kDisplayName,
+    kEmail,
+    kFamilyName,
+    kGivenName,
+    kUserId,
+    kIdToken,
+    kImageUrl,
+    kServerAuthCode,
+    kFieldCount
+  };
+
+  // Returns the null terminated value of the field, or "" if it is not set.
+  const char *Get(Field field) const {
+    return capacity_ ? buffer_ + offsets_[field] : "";
+  }
+
+  // Returns the length of the field, not counting the terminator.
+  size_t GetLength(Field field) const { return lengths_[field]; }
+
+  // Returns the decoded ID token, decoding it on the first call.  Safe to
+  // call from several threads, one decoded copy is kept.
+  const IdTokenClaims *GetIdTokenClaims() const;
+
   static jmethodID method_getDisplayName;
   static jmethodID method_getEmail;
   static jmethodID method_getFamilyName;
@@ -38,9 +60,80 @@ class GoogleSignInUserImpl {
   static jmethodID method_getPhotoUrl;
   static jmethodID method_getServerAuthCode;
   static jmethodID method_uri_toString;
+  static jclass helper_class;
+  static jmethodID method_packAccount;
 
-  static void Initialize(jobject obj);
+  // Looks up the method ids, once per process.  obj is used to find the
+  // app's class loader.  Safe to call from several threads.  Returns false,
+  // leaving the next call to try again, if a class or method is missing.
+  static bool Initialize(jobject obj);
   static GoogleSignInUser *UserFromAccount(jobject user_account);
+  // Creates a user from the array written by GoogleSignInHelper.packAccount(),
+  // without calling into Java.  Returns null if the data is malformed.
+  static GoogleSignInUser *UserFromPackedAccount(const unsigned char *data,
+                                                 size_t size);
+  // Appends the fields of user to out in the same packed form.  The server
+  // auth code is written as null unless include_server_auth_code is true.
+  static void PackUser(const GoogleSignInUser &user,
+                       bool include_server_auth_code,
+                       std::vector<unsigned char> *out);
+
+  // Returns a user with one reference and no fields set, whose buffer holds
+  // at least capacity bytes of fields.  It is recycled from the pool if one
+  // there is large enough, otherwise allocated.
+  static GoogleSignInUser *NewUser(size_t capacity = 0);
+  // Returns a user with one reference holding the fields.  A null value is
+  // stored as "".  A new user is allocated exactly to fit them.
+  static GoogleSignInUser *NewUser(const char *const values[kFieldCount],
+                                   const size_t lengths[kFieldCount]);
+  // The size of the single allocation holding a user, its impl and a field
+  // buffer of capacity bytes.
+  static size_t AllocationSize(size_t capacity);
+  // Called when the last reference to user is released.  Clears it and
+  // keeps it in the pool, or frees it if the pool is full.
+  static void Recycle(GoogleSignInUser *user);
+
+  // Number of released users kept for reuse.  A few cover the results of
+  // the outstanding requests being completed and released in turn.
+  static const int kMaxPooledUsers = 8;
+
+ private:
+  static bool LookUpMethods(jobject obj);
+
+  // Constructed in place by Allocate(), with the field buffer following it.
+  GoogleSignInUserImpl(char *buffer, size_t capacity);
+  ~GoogleSignInUserImpl();
+
+  // Allocates a user, its impl and the field buffer as one block.
+  static GoogleSignInUser *Allocate(size_t capacity);
+  // Destroys and frees a user made by Allocate().
+  static void Free(GoogleSignInUser *user);
+
+  // Copies the fields into the buffer, which must be large enough.
+  void SetFields(const char *const values[kFieldCount],
+                 const size_t lengths[kFieldCount]);
+
+  // Reads all the fields with one call to GoogleSignInHelper.packAccount().
+  // Returns null if the packed form is not available.
+  static GoogleSignInUser *ReadPackedAccount(jobject user_account);
+  // Reads the fields by calling each getter of the account.
+  static GoogleSignInUser *ReadAccountFields(jobject user_account);
+
+  // All the field values, each null terminated, back to back, in the same
+  // allocation as the impl.  It is kept when the user is recycled.
+  char *const buffer_;
+  const size_t capacity_;
+  uint32_t offsets_[kFieldCount];
+  uint32_t lengths_[kFieldCount];
+
+  // The decoded ID token once GetIdTokenClaims() has been called.  A token
+  // that fails to decode is kept as a marker so it is only decoded once.
+  mutable std::atomic<IdTokenClaims *> claims_;
+
+  // References to the user, see GoogleSignInUser.
+  mutable std::atomic<int> refs_;
+
+  friend class GoogleSignInUser;
 };
 }  // namespace googlesignin
 #endif  // GOOGLESIGNIN_GOOGLE_SIGNIN_USER_IMPL_H
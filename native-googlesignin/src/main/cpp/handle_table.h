@@ -0,0 +1,176 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_HANDLE_TABLE_H
+#define GOOGLESIGNIN_HANDLE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+namespace googlesignin {
+
+// Fixed size table mapping 64 bit handles to objects owned by the table.
+// Handles are passed to Java in place of pointers, so a handle that outlives
+// its request is rejected instead of touching memory that was reused.
+//
+// A handle holds the slot index in the low 32 bits and the slot's generation
+// in the high 32 bits.  The generation is bumped each time the slot is
+// acquired, so 0 is never a valid handle.  Each slot holds the handle that
+// currently owns it, 0 when it is free.  Lookups compare that one word, so
+// they are O(1) and never take a lock.
+//
+// A request is completed by claiming its handle, which marks the slot as
+// completing so it is not evicted while the object is in use, and then
+// releasing it.
+template <typename T, size_t kCapacity>
+class HandleTable {
+ public:
+  // Constructs the objects in all the slots, passing args to each.
+  template <typename... Args>
+  explicit HandleTable(const Args &... args) : next_(0) {
+    for (size_t i = 0; i < kCapacity; i++) {
+      values_[i].reset(new T(args...));
+      slots_[i].generation.store(0, std::memory_order_relaxed);
+      slots_[i].handle.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Acquires a slot and returns its new handle.  Free slots are used in
+  // round robin order so an object is reused as late as possible.  If there
+  // are no free slots the oldest outstanding handle is revoked and returned
+  // in evicted so the caller can complete it, otherwise evicted is set to 0.
+  uint64_t Acquire(uint64_t *evicted) {
+    *evicted = 0;
+    for (;;) {
+      size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+      for (size_t i = 0; i < kCapacity; i++) {
+        size_t index = (start + i) % kCapacity;
+        uint64_t expected = 0;
+        if (slots_[index].handle.load(std::memory_order_relaxed) == 0) {
+          uint64_t handle = NextHandle(index);
+          if (slots_[index].handle.compare_exchange_strong(
+                  expected, handle, std::memory_order_acq_rel)) {
+            next_.store(index + 1, std::memory_order_relaxed);
+            return handle;
+          }
+        }
+      }
+
+      // Every slot is in use, evict the one at start unless it is being
+      // completed right now.
+      size_t index = start % kCapacity;
+      uint64_t old = slots_[index].handle.load(std::memory_order_relaxed);
+      if (old && !(old & kCompleting)) {
+        uint64_t handle = NextHandle(index);
+        if (slots_[index].handle.compare_exchange_strong(
+                old, handle, std::memory_order_acq_rel)) {
+          *evicted = old;
+          return handle;
+        }
+      }
+      std::this_thread::yield();
+    }
+  }
+
+  // Returns the object in the handle's slot, whether or not the handle is
+  // current.  Used by the owner of a handle it just acquired.
+  T *Get(uint64_t handle) const {
+    size_t index = static_cast<size_t>(handle & kIndexMask);
+    return index < kCapacity ? values_[index].get() : nullptr;
+  }
+
+  // Returns the object for handle, or nullptr if the handle is stale.
+  T *Lookup(uint64_t handle) const {
+    size_t index = static_cast<size_t>(handle & kIndexMask);
+    if (!handle || index >= kCapacity ||
+        slots_[index].handle.load(std::memory_order_acquire) != handle) {
+      return nullptr;
+    }
+    return values_[index].get();
+  }
+
+  // Copies the outstanding handles, not counting those being completed,
+  // into handles, which has room for kCapacity, and returns their number.
+  // Handles acquired or completed meanwhile may or may not be included.
+  size_t Outstanding(uint64_t *handles) const {
+    size_t count = 0;
+    for (size_t i = 0; i < kCapacity; i++) {
+      uint64_t handle = slots_[i].handle.load(std::memory_order_acquire);
+      if (handle && !(handle & kCompleting)) {
+        handles[count++] = handle;
+      }
+    }
+    return count;
+  }
+
+  // Claims handle for completion and returns its object, or nullptr if the
+  // handle is stale or already claimed.  Release() must be called when the
+  // object has been updated.
+  T *Claim(uint64_t handle) {
+    size_t index = static_cast<size_t>(handle & kIndexMask);
+    if (!handle || index >= kCapacity) {
+      return nullptr;
+    }
+    uint64_t expected = handle;
+    if (!slots_[index].handle.compare_exchange_strong(
+            expected, handle | kCompleting, std::memory_order_acq_rel)) {
+      return nullptr;
+    }
+    return values_[index].get();
+  }
+
+  // Frees the slot of a claimed handle.
+  void Release(uint64_t handle) {
+    size_t index = static_cast<size_t>(handle & kIndexMask);
+    uint64_t expected = handle | kCompleting;
+    slots_[index].handle.compare_exchange_strong(expected, 0,
+                                                 std::memory_order_release);
+  }
+
+ private:
+  // Set in the slot while the handle is claimed.  Slot indexes never reach
+  // this bit.
+  static const uint64_t kCompleting = 0x80000000ULL;
+  static const uint64_t kIndexMask = 0x7fffffffULL;
+
+  struct Slot {
+    std::atomic<uint32_t> generation;
+    std::atomic<uint64_t> handle;
+  };
+
+  uint64_t NextHandle(size_t index) {
+    uint32_t generation =
+        slots_[index].generation.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (!generation) {
+      // Skip 0 when the generation wraps so the handle is never 0.
+      generation =
+          slots_[index].generation.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    return (static_cast<uint64_t>(generation) << 32) | index;
+  }
+
+  Slot slots_[kCapacity];
+  std::unique_ptr<T> values_[kCapacity];
+  std::atomic<size_t> next_;
+
+  HandleTable(const HandleTable &copy) = delete;
+  HandleTable &operator=(const HandleTable &copy) = delete;
+};
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_HANDLE_TABLE_H
@@ -0,0 +1,148 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "id_token.h"
+#include <string.h>
+#include "base64url.h"
+#include "json_scanner.h"
+
+namespace googlesignin {
+
+namespace {
+
+// A string claim found by the scanner, unescaped once scanning is done so
+// the JSON is not modified while it is being read.
+struct StringClaim {
+  const char *name;
+  const char **value;
+  size_t *length;
+  Span span;
+  bool found;
+};
+
+bool DecodeSection(const char *begin, const char *end, char **out,
+                   char **out_end) {
+  size_t size;
+  if (!Base64UrlDecode(begin, end - begin,
+                       reinterpret_cast<unsigned char *>(*out), &size)) {
+    return false;
+  }
+  *out_end = *out + size;
+  return true;
+}
+
+template <size_t kCount>
+bool ScanSection(char *begin, char *end, StringClaim (&claims)[kCount],
+                 IdTokenClaims *numbers) {
+  JsonScanner scanner(begin, end);
+  bool ok = scanner.ScanObject([&](const Span &key, const Span &value,
+                                   bool is_string) {
+    for (size_t i = 0; i < kCount; i++) {
+      if (KeyIs(key, claims[i].name)) {
+        if (is_string) {
+          claims[i].span = value;
+          claims[i].found = true;
+        } else {
+          // An array, such as multiple audiences, uses the first string.
+          claims[i].found = FirstArrayString(value, &claims[i].span);
+        }
+        return;
+      }
+    }
+    if (!numbers) {
+      return;
+    }
+    if (KeyIs(key, "exp")) {
+      ParseInt64(value, &numbers->exp);
+    } else if (KeyIs(key, "iat")) {
+      ParseInt64(value, &numbers->iat);
+    } else if (KeyIs(key, "email_verified")) {
+      // Some issuers send the boolean as a string.
+      size_t len = value.end - value.begin;
+      if (len == 4 && memcmp(value.begin, "true", 4) == 0) {
+        numbers->email_verified = 1;
+      } else if (len == 5 && memcmp(value.begin, "false", 5) == 0) {
+        numbers->email_verified = 0;
+      }
+    }
+  });
+  if (!ok) {
+    return false;
+  }
+  for (size_t i = 0; i < kCount; i++) {
+    if (claims[i].found &&
+        !UnescapeInPlace(claims[i].span, claims[i].value, claims[i].length)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+IdTokenClaims::IdTokenClaims()
+    : alg(""), alg_len(0), kid(""), kid_len(0), iss(""), iss_len(0),
+      aud(""), aud_len(0), azp(""), azp_len(0), sub(""), sub_len(0),
+      email(""), email_len(0), hd(""), hd_len(0), exp(0), iat(0),
+      email_verified(-1) {}
+
+IdTokenClaims *IdTokenClaims::Decode(const char *token, size_t length) {
+  const char *end = token + length;
+  const char *header_end =
+      static_cast<const char *>(memchr(token, '.', length));
+  if (!header_end) {
+    return nullptr;
+  }
+  const char *payload = header_end + 1;
+  const char *payload_end =
+      static_cast<const char *>(memchr(payload, '.', end - payload));
+  if (!payload_end) {
+    return nullptr;
+  }
+
+  std::unique_ptr<IdTokenClaims> claims(new IdTokenClaims());
+  size_t header_size = Base64UrlDecodedSize(header_end - token);
+  claims->buffer_.reset(
+      new char[header_size + Base64UrlDecodedSize(payload_end - payload)]);
+
+  char *header_json = claims->buffer_.get();
+  char *header_json_end;
+  char *payload_json = header_json + header_size;
+  char *payload_json_end;
+  if (!DecodeSection(token, header_end, &header_json, &header_json_end) ||
+      !DecodeSection(payload, payload_end, &payload_json, &payload_json_end)) {
+    return nullptr;
+  }
+
+  IdTokenClaims *c = claims.get();
+  StringClaim header_claims[] = {
+    {"alg", &c->alg, &c->alg_len, Span(), false},
+    {"kid", &c->kid, &c->kid_len, Span(), false},
+  };
+  StringClaim payload_claims[] = {
+    {"iss", &c->iss, &c->iss_len, Span(), false},
+    {"aud", &c->aud, &c->aud_len, Span(), false},
+    {"azp", &c->azp, &c->azp_len, Span(), false},
+    {"sub", &c->sub, &c->sub_len, Span(), false},
+    {"email", &c->email, &c->email_len, Span(), false},
+    {"hd", &c->hd, &c->hd_len, Span(), false},
+  };
+  if (!ScanSection(header_json, header_json_end, header_claims, nullptr) ||
+      !ScanSection(payload_json, payload_json_end, payload_claims, c)) {
+    return nullptr;
+  }
+  return claims.release();
+}
+
+}  // namespace googlesignin
@@ -0,0 +1,75 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_ID_TOKEN_H
+#define GOOGLESIGNIN_ID_TOKEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+namespace googlesignin {
+
+// The claims of an ID token, which is a JWT: three base64url sections,
+// header.payload.signature, the first two holding JSON objects.
+//
+// The string claims are null terminated and point into memory owned by this
+// object, a claim that is not in the token is "".  The signature is not
+// checked here.
+class IdTokenClaims {
+ public:
+  // Decodes the header and payload of token.  Returns null if the token is
+  // not a well formed JWT.
+  static IdTokenClaims *Decode(const char *token, size_t length);
+
+  // Header.
+  const char *alg;
+  size_t alg_len;
+  const char *kid;
+  size_t kid_len;
+
+  // Payload.
+  const char *iss;
+  size_t iss_len;
+  // The first audience if the claim is an array.
+  const char *aud;
+  size_t aud_len;
+  const char *azp;
+  size_t azp_len;
+  const char *sub;
+  size_t sub_len;
+  const char *email;
+  size_t email_len;
+  const char *hd;
+  size_t hd_len;
+  // Seconds since the epoch, 0 if not in the token.
+  int64_t exp;
+  int64_t iat;
+  // 1 or 0, -1 if not in the token.
+  int email_verified;
+
+ private:
+  IdTokenClaims();
+
+  // The decoded header and payload.  The JSON strings are unescaped in
+  // place.
+  std::unique_ptr<char[]> buffer_;
+
+  IdTokenClaims(const IdTokenClaims &copy) = delete;
+  IdTokenClaims &operator=(const IdTokenClaims &copy) = delete;
+};
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_ID_TOKEN_H
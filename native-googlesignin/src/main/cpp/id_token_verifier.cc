@@ -0,0 +1,107 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "id_token_verifier.h"
+#include <string.h>
+#include "base64url.h"
+#include "id_token.h"
+#include "jwks_cache.h"
+#include "sha256.h"
+
+// How far the device clock may be behind the issuer's before an expired
+// token is rejected.
+#define ID_TOKEN_CLOCK_SKEW_SECONDS 60
+
+// Large enough for the signature of a 4096 bit RSA key.
+#define MAX_SIGNATURE_SIZE 512
+
+namespace googlesignin {
+
+namespace {
+
+bool Equals(const char *value, size_t length, const char *expected) {
+  return length == strlen(expected) && memcmp(value, expected, length) == 0;
+}
+
+}  // namespace
+
+IdTokenStatus VerifyIdToken(const char *token, size_t length,
+                            const IdTokenClaims &claims, const JwksCache &keys,
+                            const char *audience, int64_t now_seconds) {
+  // The signature covers header.payload and is the third section.
+  const char *end = token + length;
+  const char *header_end =
+      static_cast<const char *>(memchr(token, '.', length));
+  if (!header_end) {
+    return kIdTokenMalformed;
+  }
+  const char *signed_end = static_cast<const char *>(
+      memchr(header_end + 1, '.', end - header_end - 1));
+  if (!signed_end) {
+    return kIdTokenMalformed;
+  }
+  const char *encoded_signature = signed_end + 1;
+  size_t encoded_length = end - encoded_signature;
+  if (Base64UrlDecodedSize(encoded_length) > MAX_SIGNATURE_SIZE) {
+    return kIdTokenMalformed;
+  }
+  unsigned char signature[MAX_SIGNATURE_SIZE];
+  size_t signature_length;
+  if (!Base64UrlDecode(encoded_signature, encoded_length, signature,
+                       &signature_length)) {
+    return kIdTokenMalformed;
+  }
+
+  JwksCache::Algorithm algorithm;
+  if (Equals(claims.alg, claims.alg_len, "RS256")) {
+    algorithm = JwksCache::kAlgorithmRs256;
+  } else if (Equals(claims.alg, claims.alg_len, "ES256")) {
+    algorithm = JwksCache::kAlgorithmEs256;
+  } else {
+    return kIdTokenUnsupportedAlgorithm;
+  }
+  JwksCache::Key key;
+  if (!keys.Find(claims.kid, claims.kid_len, &key)) {
+    return kIdTokenUnknownKey;
+  }
+  // The key decides the algorithm, a token can't pick a weaker one.
+  if (key.algorithm != algorithm) {
+    return kIdTokenBadSignature;
+  }
+
+  uint8_t digest[Sha256::kDigestSize];
+  Sha256::Hash(token, signed_end - token, digest);
+  bool verified =
+      algorithm == JwksCache::kAlgorithmRs256
+          ? VerifyRs256(*key.rsa, digest, signature, signature_length)
+          : VerifyEs256(*key.p256, digest, signature, signature_length);
+  if (!verified) {
+    return kIdTokenBadSignature;
+  }
+
+  if (!Equals(claims.iss, claims.iss_len, "accounts.google.com") &&
+      !Equals(claims.iss, claims.iss_len, "https://accounts.google.com")) {
+    return kIdTokenWrongIssuer;
+  }
+  if (!audience || !*audience ||
+      !Equals(claims.aud, claims.aud_len, audience)) {
+    return kIdTokenWrongAudience;
+  }
+  if (claims.exp + ID_TOKEN_CLOCK_SKEW_SECONDS <= now_seconds) {
+    return kIdTokenExpired;
+  }
+  return kIdTokenValid;
+}
+
+}  // namespace googlesignin
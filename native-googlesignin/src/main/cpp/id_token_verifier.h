@@ -0,0 +1,53 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_ID_TOKEN_VERIFIER_H
+#define GOOGLESIGNIN_ID_TOKEN_VERIFIER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace googlesignin {
+
+class IdTokenClaims;
+class JwksCache;
+
+// The outcome of verifying an ID token, in the order the checks are made.
+enum IdTokenStatus {
+  kIdTokenValid = 0,
+  // The token is not a well formed JWT.
+  kIdTokenMalformed = 1,
+  // The token is not signed with RS256 or ES256.
+  kIdTokenUnsupportedAlgorithm = 2,
+  // No key with the token's kid is loaded.
+  kIdTokenUnknownKey = 3,
+  kIdTokenBadSignature = 4,
+  // iss is not accounts.google.com.
+  kIdTokenWrongIssuer = 5,
+  // aud is not the expected client id.
+  kIdTokenWrongAudience = 6,
+  kIdTokenExpired = 7,
+};
+
+// Verifies an ID token offline: the signature against keys, the issuer, that
+// the audience is audience and that the token has not expired at
+// now_seconds, allowing for a little clock skew.  claims must be the decoded
+// claims of token.
+IdTokenStatus VerifyIdToken(const char *token, size_t length,
+                            const IdTokenClaims &claims, const JwksCache &keys,
+                            const char *audience, int64_t now_seconds);
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_ID_TOKEN_VERIFIER_H
@@ -15,6 +15,9 @@
 //
 #include <assert.h>
 #include <pthread.h>
+#include <map>
+#include <mutex>
+#include <string>
 #include "jni_init.h"
 
 // static pointer to access the JVM.
@@ -32,6 +35,15 @@ extern "C" jint JNI_OnLoad(JavaVM *vm, void *reserved) {
   return JNI_VERSION_1_6;
 }
 
+/// Called when the library is unloaded, releases the cached global references.
+extern "C" void JNI_OnUnload(JavaVM *vm, void *reserved) {
+  JNIEnv *env;
+  if (vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6) != JNI_OK) {
+    return;
+  }
+  googlesignin::ClearClassCache(env);
+}
+
 namespace googlesignin {
 
 // Static variables used in tracking thread initialization and cleanup.
@@ -54,51 +66,249 @@ void SetupJvmDetachOnThreadDestruction() {
   pthread_key_create(&jni_env_key, DetachJVMThreads);
 }
 
+// Name given to native threads attached by GetJniEnv(), so they are
+// identifiable in stack traces and the debugger thread list.
+#define ATTACHED_THREAD_NAME "googlesignin-native"
+
+// Per-thread cache of the JNIEnv.  This is set the first time a thread calls
+// GetJniEnv(), after that the env is returned without calling into the VM.
+static thread_local JNIEnv *t_jni_env = nullptr;
+
+// Returns the JNIEnv for the current thread, attaching the thread to the VM
+// if needed.  Only threads attached here are detached when they exit, threads
+// that are already attached (e.g. the UI thread) are left alone.
+static JNIEnv *AttachCurrentThread() {
+  JNIEnv *env = nullptr;
+  jint result = g_vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6);
+  if (result == JNI_EDETACHED) {
+    // Set up the thread key and destructor the first time this is called:
+    (void)pthread_once(&pthread_key_initialized,
+                       SetupJvmDetachOnThreadDestruction);
+
+    JavaVMAttachArgs args;
+    args.version = JNI_VERSION_1_6;
+    args.name = ATTACHED_THREAD_NAME;
+    args.group = nullptr;
+    result = g_vm->AttachCurrentThread(&env, &args);
+    if (result == JNI_OK) {
+      pthread_setspecific(jni_env_key, g_vm);
+    }
+  }
+  return result == JNI_OK ? env : nullptr;
+}
+
 // Helper function used to access the jni environment on the current thread.
 JNIEnv *GetJniEnv() {
-  // Set up the thread key and destructor the first time this is called:
-  (void)pthread_once(&pthread_key_initialized,
-                     SetupJvmDetachOnThreadDestruction);
-  pthread_setspecific(jni_env_key, g_vm);
+  JNIEnv *env = t_jni_env;
+  if (!env) {
+    env = AttachCurrentThread();
+    t_jni_env = env;
+  }
+  return env;
+}
 
-  JNIEnv *env;
-  jint result = g_vm->AttachCurrentThread(&env, nullptr);
-  return result == JNI_OK ? env : nullptr;
+// Process wide cache of classes returned by FindClass().  The values are
+// global references, so they are valid on any thread until the library is
+// unloaded.  The app ClassLoader and its loadClass method are kept alongside
+// so the NativeActivity fallback only does the reflection lookups once.
+// class_cache_mutex only guards the cache itself, the JNI calls that fill it
+// are made without holding it.
+static std::mutex class_cache_mutex;
+static std::map<std::string, jclass> class_cache;
+static jobject class_loader = nullptr;
+static jmethodID class_loader_load_class = nullptr;
+
+// Clears the pending exception, if any.  Returns true if there was one.
+static bool CheckAndClearException(JNIEnv *env) {
+  if (env->ExceptionCheck()) {
+    env->ExceptionClear();
+    return true;
+  }
+  return false;
+}
+
+// Returns a local reference to the ClassLoader of context, or null.  For a
+// Context this is Context.getClassLoader(), the app ClassLoader even when
+// the activity itself is a framework class such as NativeActivity.  Any
+// other object (e.g. a GoogleSignInAccount) is an app object, so the loader
+// of its class is used.
+static jobject ResolveClassLoader(JNIEnv *env, jobject context,
+                                  jmethodID *load_class) {
+  jobject loader = nullptr;
+  jclass context_class = env->FindClass("android/content/Context");
+  if (CheckAndClearException(env)) {
+    return nullptr;
+  }
+  if (env->IsInstanceOf(context, context_class)) {
+    jmethodID get_class_loader = env->GetMethodID(
+        context_class, "getClassLoader", "()Ljava/lang/ClassLoader;");
+    if (!CheckAndClearException(env)) {
+      loader = env->CallObjectMethod(context, get_class_loader);
+      if (CheckAndClearException(env)) loader = nullptr;
+    }
+  } else {
+    jclass object_class = env->GetObjectClass(context);
+    jclass class_class = env->FindClass("java/lang/Class");
+    if (!CheckAndClearException(env)) {
+      jmethodID get_class_loader = env->GetMethodID(
+          class_class, "getClassLoader", "()Ljava/lang/ClassLoader;");
+      if (!CheckAndClearException(env)) {
+        loader = env->CallObjectMethod(object_class, get_class_loader);
+        if (CheckAndClearException(env)) loader = nullptr;
+      }
+      env->DeleteLocalRef(class_class);
+    }
+    env->DeleteLocalRef(object_class);
+  }
+  env->DeleteLocalRef(context_class);
+  if (!loader) {
+    return nullptr;
+  }
+
+  jclass class_loader_class = env->FindClass("java/lang/ClassLoader");
+  if (CheckAndClearException(env)) {
+    env->DeleteLocalRef(loader);
+    return nullptr;
+  }
+  *load_class = env->GetMethodID(class_loader_class, "loadClass",
+                                 "(Ljava/lang/String;)Ljava/lang/Class;");
+  env->DeleteLocalRef(class_loader_class);
+  if (CheckAndClearException(env)) {
+    env->DeleteLocalRef(loader);
+    return nullptr;
+  }
+  return loader;
+}
+
+// Returns the app ClassLoader and sets load_class to its loadClass method,
+// resolving them from context the first time.  Returns null if they can't be
+// resolved, in which case nothing is cached and the next call tries again.
+static jobject GetClassLoader(JNIEnv *env, jobject context,
+                              jmethodID *load_class) {
+  {
+    std::lock_guard<std::mutex> lock(class_cache_mutex);
+    if (class_loader) {
+      *load_class = class_loader_load_class;
+      return class_loader;
+    }
+  }
+  if (!context) {
+    return nullptr;
+  }
+  jmethodID resolved_load_class = nullptr;
+  jobject loader = ResolveClassLoader(env, context, &resolved_load_class);
+  if (!loader) {
+    return nullptr;
+  }
+  jobject global_loader = env->NewGlobalRef(loader);
+  env->DeleteLocalRef(loader);
+
+  jobject duplicate = nullptr;
+  jobject result;
+  {
+    std::lock_guard<std::mutex> lock(class_cache_mutex);
+    if (class_loader) {
+      // Another thread resolved it meanwhile.
+      duplicate = global_loader;
+    } else {
+      class_loader = global_loader;
+      class_loader_load_class = resolved_load_class;
+    }
+    result = class_loader;
+    *load_class = class_loader_load_class;
+  }
+  if (duplicate) {
+    env->DeleteGlobalRef(duplicate);
+  }
+  return result;
 }
 
 // Find a class, attempting to load the class if it's not found.
-jclass FindClass(const char *class_name, jobject activity) {
+jclass FindClass(const char *class_name, jobject context) {
+  {
+    std::lock_guard<std::mutex> lock(class_cache_mutex);
+    std::map<std::string, jclass>::const_iterator it =
+        class_cache.find(class_name);
+    if (it != class_cache.end()) {
+      return it->second;
+    }
+  }
+
   JNIEnv *env = GetJniEnv();
   jclass class_object = env->FindClass(class_name);
-  if (env->ExceptionCheck()) {
-    env->ExceptionClear();
+  if (CheckAndClearException(env)) {
     // If the class isn't found it's possible NativeActivity is being used by
     // the application which means the class path is set to only load system
     // classes.  The following falls back to loading the class using the
-    // Activity before retrieving a reference to it.
-    jclass activity_class = env->FindClass("android/app/Activity");
-    jmethodID activity_get_class_loader = env->GetMethodID(
-        activity_class, "getClassLoader", "()Ljava/lang/ClassLoader;");
-
-    jobject class_loader_object =
-        env->CallObjectMethod(activity, activity_get_class_loader);
-
-    jclass class_loader_class = env->FindClass("java/lang/ClassLoader");
-    jmethodID class_loader_load_class =
-        env->GetMethodID(class_loader_class, "loadClass",
-                         "(Ljava/lang/String;)Ljava/lang/Class;");
-    jstring class_name_object = env->NewStringUTF(class_name);
-
-    class_object = static_cast<jclass>(env->CallObjectMethod(
-        class_loader_object, class_loader_load_class, class_name_object));
-
-    if (env->ExceptionCheck()) {
-      env->ExceptionClear();
-      class_object = nullptr;
+    // app ClassLoader before retrieving a reference to it.
+    class_object = nullptr;
+    jmethodID load_class = nullptr;
+    jobject loader = GetClassLoader(env, context, &load_class);
+    if (loader) {
+      // loadClass takes the binary name, i.e. dots rather than slashes.
+      std::string binary_name(class_name);
+      for (size_t i = 0; i < binary_name.size(); i++) {
+        if (binary_name[i] == '/') binary_name[i] = '.';
+      }
+      jstring class_name_object = env->NewStringUTF(binary_name.c_str());
+
+      class_object = static_cast<jclass>(
+          env->CallObjectMethod(loader, load_class, class_name_object));
+
+      if (CheckAndClearException(env)) {
+        class_object = nullptr;
+      }
+      env->DeleteLocalRef(class_name_object);
+    }
+  }
+
+  if (class_object) {
+    jclass local_ref = class_object;
+    class_object = static_cast<jclass>(env->NewGlobalRef(local_ref));
+    env->DeleteLocalRef(local_ref);
+
+    // Another thread may have cached the class meanwhile, keep the first.
+    jclass duplicate = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(class_cache_mutex);
+      std::pair<std::map<std::string, jclass>::iterator, bool> inserted =
+          class_cache.insert(std::make_pair(class_name, class_object));
+      if (!inserted.second) {
+        duplicate = class_object;
+        class_object = inserted.first->second;
+      }
+    }
+    if (duplicate) {
+      env->DeleteGlobalRef(duplicate);
     }
-    env->DeleteLocalRef(class_name_object);
-    env->DeleteLocalRef(class_loader_object);
   }
   return class_object;
 }
+
+jmethodID GetMethod(jclass clazz, const char *name, const char *signature) {
+  JNIEnv *env = GetJniEnv();
+  jmethodID method = env->GetMethodID(clazz, name, signature);
+  return CheckAndClearException(env) ? nullptr : method;
+}
+
+jmethodID GetStaticMethod(jclass clazz, const char *name,
+                          const char *signature) {
+  JNIEnv *env = GetJniEnv();
+  jmethodID method = env->GetStaticMethodID(clazz, name, signature);
+  return CheckAndClearException(env) ? nullptr : method;
+}
+
+void ClearClassCache(JNIEnv *env) {
+  std::lock_guard<std::mutex> lock(class_cache_mutex);
+  for (std::map<std::string, jclass>::iterator it = class_cache.begin();
+       it != class_cache.end(); ++it) {
+    env->DeleteGlobalRef(it->second);
+  }
+  class_cache.clear();
+  if (class_loader) {
+    env->DeleteGlobalRef(class_loader);
+    class_loader = nullptr;
+  }
+  class_loader_load_class = nullptr;
+}
 }  // namespace googlesignin
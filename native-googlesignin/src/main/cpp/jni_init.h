@@ -20,7 +20,25 @@
 namespace googlesignin {
 
 JNIEnv *GetJniEnv();
-jclass FindClass(const char *class_name, jobject activity);
+
+// Finds a class by name, falling back to the app ClassLoader when the system
+// class path does not have it.  The ClassLoader is the one returned by
+// Context.getClassLoader() if context is a Context, otherwise the loader of
+// context's class.  The result is cached and returned as a global reference
+// owned by the cache, callers must not delete it.  Returns null, with no
+// exception pending, if the class can't be found.  Safe to call from any
+// thread.
+jclass FindClass(const char *class_name, jobject context);
+
+// Look up a method of clazz like GetMethodID() and GetStaticMethodID(), but
+// return null with no exception pending if it is missing, so the next JNI
+// call is not made with the NoSuchMethodError still pending.
+jmethodID GetMethod(jclass clazz, const char *name, const char *signature);
+jmethodID GetStaticMethod(jclass clazz, const char *name,
+                          const char *signature);
+
+// Releases all the global references held by the FindClass() cache.
+void ClearClassCache(JNIEnv *env);
 
 }  // namespace googlesignin
 
@@ -0,0 +1,201 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "jni_recorder.h"
+
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <random>
+
+#include "google_signin_user.h"
+#include "sha256.h"
+
+#define RECORDING_MAGIC "GSIR"
+// Bytes of the salt and of each hash written.
+#define SALT_SIZE 16
+#define HASH_SIZE 8
+
+namespace googlesignin {
+
+const uint8_t JniRecorder::kVersion;
+const size_t JniRecorder::kMaxSize;
+std::atomic<bool> JniRecorder::enabled_(false);
+
+namespace {
+
+// The recording, guarded by mutex.  Calls come from the game thread and the
+// UI thread.
+struct Recording {
+  std::mutex mutex;
+  std::string data;
+  uint8_t salt[SALT_SIZE];
+  std::chrono::steady_clock::time_point last;
+  // Set once kMaxSize is reached, no more records are added.
+  bool full;
+};
+
+Recording &GetRecording() {
+  static Recording *recording = new Recording();
+  return *recording;
+}
+
+void AppendVarint(std::string *out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+void AppendString(std::string *out, const std::string &value) {
+  AppendVarint(out, value.size());
+  out->append(value);
+}
+
+void AppendHashed(std::string *out, const uint8_t *salt, const char *value) {
+  size_t length = value ? strlen(value) : 0;
+  AppendVarint(out, length);
+  if (length) {
+    Sha256 sha;
+    sha.Update(salt, SALT_SIZE);
+    sha.Update(value, length);
+    uint8_t digest[Sha256::kDigestSize];
+    sha.Finish(digest);
+    out->append(reinterpret_cast<const char *>(digest), HASH_SIZE);
+  }
+}
+
+// Starts a record of kind, returning the string to append the payload to,
+// or null if the recording is full.  Must be called with the mutex held.
+std::string *BeginRecord(Recording *recording, JniRecorder::Kind kind,
+                         int64_t handle) {
+  if (recording->full) {
+    return nullptr;
+  }
+  if (recording->data.size() >= JniRecorder::kMaxSize) {
+    recording->full = true;
+    return nullptr;
+  }
+  std::chrono::steady_clock::time_point now =
+      std::chrono::steady_clock::now();
+  int64_t delta_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                         now - recording->last)
+                         .count();
+  recording->last = now;
+  std::string *out = &recording->data;
+  out->push_back(static_cast<char>(kind));
+  AppendVarint(out, delta_us > 0 ? static_cast<uint64_t>(delta_us) : 0);
+  AppendVarint(out, static_cast<uint64_t>(handle));
+  return out;
+}
+
+}  // namespace
+
+void JniRecorder::Enable(bool enable) {
+  Recording &recording = GetRecording();
+  std::lock_guard<std::mutex> lock(recording.mutex);
+  if (enable) {
+    recording.data.assign(RECORDING_MAGIC);
+    recording.data.push_back(static_cast<char>(kVersion));
+    std::random_device random;
+    for (int i = 0; i < SALT_SIZE; i++) {
+      recording.salt[i] = static_cast<uint8_t>(random());
+    }
+    recording.last = std::chrono::steady_clock::now();
+    recording.full = false;
+  }
+  enabled_.store(enable, std::memory_order_relaxed);
+}
+
+void JniRecorder::RecordConfigure(int64_t handle,
+                                  const GoogleSignIn::Configuration &config) {
+  if (!enabled()) {
+    return;
+  }
+  Recording &recording = GetRecording();
+  std::lock_guard<std::mutex> lock(recording.mutex);
+  std::string *out = BeginRecord(&recording, kRecordConfigure, handle);
+  if (!out) {
+    return;
+  }
+  AppendVarint(out, (config.use_game_signin ? 1 : 0) |
+                        (config.request_auth_code ? 2 : 0) |
+                        (config.force_token_refresh ? 4 : 0) |
+                        (config.request_email ? 8 : 0) |
+                        (config.request_id_token ? 16 : 0) |
+                        (config.hide_ui_popups ? 32 : 0));
+  AppendString(out, config.web_client_id);
+  AppendHashed(out, recording.salt, config.account_name.c_str());
+  AppendVarint(out, config.additional_scopes.size());
+  for (size_t i = 0; i < config.additional_scopes.size(); i++) {
+    AppendString(out, config.additional_scopes[i]);
+  }
+}
+
+void JniRecorder::RecordResubmit(int64_t handle, bool accepted) {
+  if (!enabled()) {
+    return;
+  }
+  Recording &recording = GetRecording();
+  std::lock_guard<std::mutex> lock(recording.mutex);
+  std::string *out = BeginRecord(&recording, kRecordResubmit, handle);
+  if (out) {
+    out->push_back(accepted ? 1 : 0);
+  }
+}
+
+void JniRecorder::RecordCall(Kind kind, int64_t handle) {
+  if (!enabled()) {
+    return;
+  }
+  Recording &recording = GetRecording();
+  std::lock_guard<std::mutex> lock(recording.mutex);
+  BeginRecord(&recording, kind, handle);
+}
+
+void JniRecorder::RecordResult(int64_t handle, int status,
+                               const GoogleSignInUser *user) {
+  if (!enabled()) {
+    return;
+  }
+  Recording &recording = GetRecording();
+  std::lock_guard<std::mutex> lock(recording.mutex);
+  std::string *out = BeginRecord(&recording, kRecordResult, handle);
+  if (!out) {
+    return;
+  }
+  int64_t value = status;
+  AppendVarint(out, (static_cast<uint64_t>(value) << 1) ^
+                        static_cast<uint64_t>(value >> 63));
+  out->push_back(user ? 1 : 0);
+  if (user) {
+    const char *fields[] = {
+        user->GetDisplayName(), user->GetEmail(),   user->GetFamilyName(),
+        user->GetGivenName(),   user->GetUserId(),  user->GetIdToken(),
+        user->GetImageUrl(),    user->GetServerAuthCode(),
+    };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+      AppendHashed(out, recording.salt, fields[i]);
+    }
+  }
+}
+
+void JniRecorder::Export(std::string *out) {
+  Recording &recording = GetRecording();
+  std::lock_guard<std::mutex> lock(recording.mutex);
+  out->assign(recording.data);
+}
+
+}  // namespace googlesignin
@@ -0,0 +1,97 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_JNI_RECORDER_H
+#define GOOGLESIGNIN_JNI_RECORDER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+#include "google_signin.h"  // NOLINT
+
+namespace googlesignin {
+
+// Records the calls between the native code and GoogleSignInHelper, so the
+// timing of a sign-in seen in the field can be studied and replayed.
+// Recording is off until enabled at runtime, and then costs a lock and a
+// few bytes per call.  Nothing identifying the user is kept: the account
+// name and the account fields are replaced by their length and a hash
+// salted per recording.
+//
+// The recording is a binary stream of the magic "GSIR", a version byte and
+// then one record per call:
+//   kind         1 byte, a Kind
+//   delta_us     varint, microseconds since the previous record, or since
+//                recording was enabled for the first record
+//   handle       varint, the request handle passed with the call, 0 if none
+//   payload      depends on the kind, see Kind
+// Varints are unsigned LEB128, signed values are zigzag encoded first.
+// Strings are a varint length and the bytes.  Hashed strings are a varint
+// length, followed by the first 8 bytes of the salted SHA-256 of the value
+// unless it is empty.
+class JniRecorder {
+ public:
+  static const uint8_t kVersion = 1;
+  // Recording stops once it reaches this size.
+  static const size_t kMaxSize = 256 * 1024;
+
+  enum Kind {
+    // GoogleSignInHelper.configure.  Payload: a varint of the flags
+    // use_game_signin, request_auth_code, force_token_refresh,
+    // request_email, request_id_token and hide_ui_popups from bit 0 up, the
+    // web client id, the hashed account name, a varint scope count and the
+    // scopes.
+    kRecordConfigure = 1,
+    // GoogleSignInHelper.resubmitConfiguration.  Payload: 1 byte, 1 if
+    // Java accepted the handle.
+    kRecordResubmit = 2,
+    // GoogleSignInHelper.signIn, signInSilently, signOut and disconnect.
+    // No payload.
+    kRecordSignIn = 3,
+    kRecordSignInSilently = 4,
+    kRecordSignOut = 5,
+    kRecordDisconnect = 6,
+    // A result from nativeOnResult or the event ring.  Payload: the zigzag
+    // status, 1 byte that is 1 if there is a user and then the hashed
+    // display name, email, family name, given name, user id, ID token,
+    // image URL and server auth code.
+    kRecordResult = 7,
+  };
+
+  // Starts a new recording, discarding the previous one, or stops
+  // recording.
+  static void Enable(bool enable);
+
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Record a call.  They do nothing unless recording is enabled.
+  static void RecordConfigure(int64_t handle,
+                              const GoogleSignIn::Configuration &config);
+  static void RecordResubmit(int64_t handle, bool accepted);
+  static void RecordCall(Kind kind, int64_t handle);
+  static void RecordResult(int64_t handle, int status,
+                           const GoogleSignInUser *user);
+
+  // Replaces out with the recording so far.  Empty if recording was never
+  // enabled.
+  static void Export(std::string *out);
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_JNI_RECORDER_H
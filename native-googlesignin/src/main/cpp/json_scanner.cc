@@ -0,0 +1,163 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "json_scanner.h"
+#include <string.h>
+
+namespace googlesignin {
+
+namespace {
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+bool ReadHex4(const char *p, const char *end, uint32_t *value) {
+  if (end - p < 4) {
+    return false;
+  }
+  *value = 0;
+  for (int i = 0; i < 4; i++) {
+    int digit = HexValue(p[i]);
+    if (digit < 0) {
+      return false;
+    }
+    *value = (*value << 4) | digit;
+  }
+  return true;
+}
+
+char *AppendUtf8(uint32_t code_point, char *out) {
+  if (code_point < 0x80) {
+    *out++ = static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    *out++ = static_cast<char>(0xc0 | (code_point >> 6));
+    *out++ = static_cast<char>(0x80 | (code_point & 0x3f));
+  } else if (code_point < 0x10000) {
+    *out++ = static_cast<char>(0xe0 | (code_point >> 12));
+    *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+    *out++ = static_cast<char>(0x80 | (code_point & 0x3f));
+  } else {
+    *out++ = static_cast<char>(0xf0 | (code_point >> 18));
+    *out++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3f));
+    *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+    *out++ = static_cast<char>(0x80 | (code_point & 0x3f));
+  }
+  return out;
+}
+
+}  // namespace
+
+bool KeyIs(const Span &key, const char *name) {
+  size_t len = strlen(name);
+  return static_cast<size_t>(key.end - key.begin) == len &&
+         memcmp(key.begin, name, len) == 0;
+}
+
+bool UnescapeInPlace(const Span &span, const char **value, size_t *length) {
+  const char *in = span.begin;
+  char *out = span.begin;
+  while (in < span.end) {
+    if (*in != '\\') {
+      *out++ = *in++;
+      continue;
+    }
+    if (++in >= span.end) {
+      return false;
+    }
+    char c = *in++;
+    switch (c) {
+      case '"': *out++ = '"'; break;
+      case '\\': *out++ = '\\'; break;
+      case '/': *out++ = '/'; break;
+      case 'b': *out++ = '\b'; break;
+      case 'f': *out++ = '\f'; break;
+      case 'n': *out++ = '\n'; break;
+      case 'r': *out++ = '\r'; break;
+      case 't': *out++ = '\t'; break;
+      case 'u': {
+        uint32_t code_point;
+        if (!ReadHex4(in, span.end, &code_point)) {
+          return false;
+        }
+        in += 4;
+        uint32_t low;
+        if (code_point >= 0xd800 && code_point < 0xdc00 &&
+            span.end - in >= 6 && in[0] == '\\' && in[1] == 'u' &&
+            ReadHex4(in + 2, span.end, &low) && low >= 0xdc00 &&
+            low < 0xe000) {
+          code_point = 0x10000 + ((code_point - 0xd800) << 10) +
+                       (low - 0xdc00);
+          in += 6;
+        }
+        out = AppendUtf8(code_point, out);
+        break;
+      }
+      default:
+        return false;
+    }
+  }
+  *out = '\0';
+  *value = span.begin;
+  *length = out - span.begin;
+  return true;
+}
+
+bool ParseInt64(const Span &span, int64_t *value) {
+  const char *p = span.begin;
+  bool negative = p < span.end && *p == '-';
+  if (negative) {
+    p++;
+  }
+  if (p >= span.end || *p < '0' || *p > '9') {
+    return false;
+  }
+  int64_t result = 0;
+  while (p < span.end && *p >= '0' && *p <= '9') {
+    if (result > (INT64_MAX - 9) / 10) {
+      return false;
+    }
+    result = result * 10 + (*p++ - '0');
+  }
+  *value = negative ? -result : result;
+  return true;
+}
+
+bool FirstArrayString(const Span &array, Span *first) {
+  char *p = array.begin;
+  if (*p++ != '[') {
+    return false;
+  }
+  while (p < array.end &&
+         (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+    p++;
+  }
+  if (p >= array.end || *p != '"') {
+    return false;
+  }
+  first->begin = ++p;
+  while (p < array.end && *p != '"') {
+    if (*p == '\\') {
+      p++;
+    }
+    p++;
+  }
+  first->end = p;
+  return p < array.end;
+}
+
+}  // namespace googlesignin
@@ -0,0 +1,203 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_JSON_SCANNER_H
+#define GOOGLESIGNIN_JSON_SCANNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace googlesignin {
+
+// A span of a JSON document.  For strings it is the raw contents between the
+// quotes, still escaped.
+struct Span {
+  char *begin;
+  char *end;
+};
+
+// Minimal JSON scanner over a span of a document.  It only understands
+// enough to walk the members of one object or the elements of one array,
+// nested values are returned as raw spans that can be scanned in turn.  It
+// never allocates.
+class JsonScanner {
+ public:
+  JsonScanner(char *begin, char *end) : pos_(begin), end_(end) {}
+
+  // Calls visit(key, value, is_string) for each member of the object.  value
+  // spans the raw JSON of the value, or the contents of a string.  Returns
+  // false if the JSON is malformed.
+  template <typename Visitor>
+  bool ScanObject(Visitor visit) {
+    SkipWhitespace();
+    if (!Consume('{')) {
+      return false;
+    }
+    SkipWhitespace();
+    if (Consume('}')) {
+      return true;
+    }
+    for (;;) {
+      Span key;
+      SkipWhitespace();
+      if (!ScanString(&key)) {
+        return false;
+      }
+      SkipWhitespace();
+      if (!Consume(':')) {
+        return false;
+      }
+      SkipWhitespace();
+      Span value;
+      bool is_string;
+      if (!ScanAnyValue(&value, &is_string)) {
+        return false;
+      }
+      visit(key, value, is_string);
+      SkipWhitespace();
+      if (Consume('}')) {
+        return true;
+      }
+      if (!Consume(',')) {
+        return false;
+      }
+    }
+  }
+
+  // Calls visit(value, is_string) for each element of the array, with value
+  // as for ScanObject().  Returns false if the JSON is malformed.
+  template <typename Visitor>
+  bool ScanArray(Visitor visit) {
+    SkipWhitespace();
+    if (!Consume('[')) {
+      return false;
+    }
+    SkipWhitespace();
+    if (Consume(']')) {
+      return true;
+    }
+    for (;;) {
+      SkipWhitespace();
+      Span value;
+      bool is_string;
+      if (!ScanAnyValue(&value, &is_string)) {
+        return false;
+      }
+      visit(value, is_string);
+      SkipWhitespace();
+      if (Consume(']')) {
+        return true;
+      }
+      if (!Consume(',')) {
+        return false;
+      }
+    }
+  }
+
+ private:
+  void SkipWhitespace() {
+    while (pos_ < end_ &&
+           (*pos_ == ' ' || *pos_ == '\t' || *pos_ == '\n' || *pos_ == '\r')) {
+      pos_++;
+    }
+  }
+
+  bool Consume(char c) {
+    if (pos_ < end_ && *pos_ == c) {
+      pos_++;
+      return true;
+    }
+    return false;
+  }
+
+  bool ScanAnyValue(Span *value, bool *is_string) {
+    *is_string = pos_ < end_ && *pos_ == '"';
+    return *is_string ? ScanString(value) : ScanValue(value);
+  }
+
+  // Scans a string, returning the span between the quotes.
+  bool ScanString(Span *span) {
+    if (!Consume('"')) {
+      return false;
+    }
+    span->begin = pos_;
+    while (pos_ < end_ && *pos_ != '"') {
+      if (*pos_ == '\\') {
+        pos_++;
+      }
+      pos_++;
+    }
+    if (pos_ >= end_) {
+      return false;
+    }
+    span->end = pos_++;
+    return true;
+  }
+
+  // Scans any other value: a number, literal, object or array.  Nested
+  // containers are skipped by tracking the depth.
+  bool ScanValue(Span *span) {
+    span->begin = pos_;
+    int depth = 0;
+    while (pos_ < end_) {
+      char c = *pos_;
+      if (c == '"') {
+        Span ignored;
+        if (!ScanString(&ignored)) {
+          return false;
+        }
+        continue;
+      }
+      if (c == '{' || c == '[') {
+        depth++;
+      } else if (c == '}' || c == ']') {
+        if (depth == 0) {
+          break;
+        }
+        depth--;
+        if (depth == 0) {
+          // The end of a container value.
+          pos_++;
+          break;
+        }
+      } else if (c == ',' && depth == 0) {
+        break;
+      }
+      pos_++;
+    }
+    span->end = pos_;
+    return depth == 0 && span->end > span->begin;
+  }
+
+  char *pos_;
+  char *end_;
+};
+
+// Returns true if the span holds exactly name.
+bool KeyIs(const Span &key, const char *name);
+
+// Unescapes a string span in place and null terminates it.  The result is
+// never longer than the escaped form, so the terminator lands at or before
+// the closing quote.
+bool UnescapeInPlace(const Span &span, const char **value, size_t *length);
+
+// Parses the integer part of a JSON number.
+bool ParseInt64(const Span &span, int64_t *value);
+
+// Finds the first element of an array if it is a string.
+bool FirstArrayString(const Span &array, Span *first);
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_JSON_SCANNER_H
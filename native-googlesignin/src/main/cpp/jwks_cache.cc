@@ -0,0 +1,289 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "jwks_cache.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include "base64url.h"
+#include "json_scanner.h"
+
+// A key set is a few kilobytes, anything much larger is not one.
+#define JWKS_MAX_FILE_SIZE (1024 * 1024)
+
+namespace googlesignin {
+
+namespace {
+
+// Layout of the table: the header, the entries sorted by kid, the keys and
+// then the kid strings.  Offsets are from the start of the table.
+struct TableHeader {
+  uint32_t count;
+  uint32_t reserved;
+};
+
+struct TableEntry {
+  uint32_t kid_offset;
+  uint32_t kid_length;
+  uint32_t algorithm;
+  uint32_t key_offset;
+};
+
+// A key while the table is being built.
+struct ParsedKey {
+  std::string kid;
+  JwksCache::Algorithm algorithm;
+  std::unique_ptr<RsaPublicKey> rsa;
+  std::unique_ptr<P256PublicKey> p256;
+
+  size_t key_size() const {
+    return rsa ? sizeof(RsaPublicKey) : sizeof(P256PublicKey);
+  }
+  const void *key() const {
+    return rsa ? static_cast<const void *>(rsa.get())
+               : static_cast<const void *>(p256.get());
+  }
+};
+
+size_t Align8(size_t offset) { return (offset + 7) & ~static_cast<size_t>(7); }
+
+bool DecodeBase64Url(const Span &span, std::vector<uint8_t> *bytes) {
+  size_t length = span.end - span.begin;
+  bytes->resize(Base64UrlDecodedSize(length));
+  size_t size;
+  if (!Base64UrlDecode(span.begin, length, bytes->data(), &size)) {
+    return false;
+  }
+  bytes->resize(size);
+  return true;
+}
+
+// Prepares the key described by one JWK object.  Returns false if it is not
+// a signing key this cache supports.
+bool ParseKey(const Span &object, ParsedKey *key) {
+  Span kty = {nullptr, nullptr}, kid = kty, alg = kty, use = kty, crv = kty;
+  Span n = kty, e = kty, x = kty, y = kty;
+  JsonScanner scanner(object.begin, object.end);
+  bool ok = scanner.ScanObject([&](const Span &name, const Span &value,
+                                   bool is_string) {
+    if (!is_string) {
+      return;
+    }
+    const struct {
+      const char *name;
+      Span *span;
+    } members[] = {
+      {"kty", &kty}, {"kid", &kid}, {"alg", &alg}, {"use", &use},
+      {"crv", &crv}, {"n", &n},     {"e", &e},     {"x", &x},
+      {"y", &y},
+    };
+    for (size_t i = 0; i < sizeof(members) / sizeof(members[0]); i++) {
+      if (KeyIs(name, members[i].name)) {
+        *members[i].span = value;
+        return;
+      }
+    }
+  });
+  if (!ok || !kid.begin || (use.begin && !KeyIs(use, "sig"))) {
+    return false;
+  }
+
+  std::vector<uint8_t> first, second;
+  if (kty.begin && KeyIs(kty, "RSA")) {
+    if ((alg.begin && !KeyIs(alg, "RS256")) || !n.begin || !e.begin ||
+        !DecodeBase64Url(n, &first) || !DecodeBase64Url(e, &second)) {
+      return false;
+    }
+    key->rsa.reset(new RsaPublicKey());
+    if (!PrepareRsaPublicKey(first.data(), first.size(), second.data(),
+                             second.size(), key->rsa.get())) {
+      return false;
+    }
+    key->algorithm = JwksCache::kAlgorithmRs256;
+  } else if (kty.begin && KeyIs(kty, "EC")) {
+    if ((alg.begin && !KeyIs(alg, "ES256")) || !crv.begin ||
+        !KeyIs(crv, "P-256") || !x.begin || !y.begin ||
+        !DecodeBase64Url(x, &first) || !DecodeBase64Url(y, &second) ||
+        first.size() != 32 || second.size() != 32) {
+      return false;
+    }
+    key->p256.reset(new P256PublicKey());
+    if (!PrepareP256PublicKey(first.data(), second.data(), key->p256.get())) {
+      return false;
+    }
+    key->algorithm = JwksCache::kAlgorithmEs256;
+  } else {
+    return false;
+  }
+
+  const char *kid_value;
+  size_t kid_length;
+  if (!UnescapeInPlace(kid, &kid_value, &kid_length)) {
+    return false;
+  }
+  key->kid.assign(kid_value, kid_length);
+  return true;
+}
+
+const TableEntry *Entries(const void *table) {
+  return reinterpret_cast<const TableEntry *>(
+      static_cast<const char *>(table) + sizeof(TableHeader));
+}
+
+}  // namespace
+
+JwksCache::JwksCache(void *table, size_t table_size)
+    : table_(table), table_size_(table_size) {}
+
+JwksCache::~JwksCache() { munmap(table_, table_size_); }
+
+JwksCache *JwksCache::Parse(const char *json, size_t length) {
+  std::vector<char> copy(json, json + length);
+  return ParseInPlace(copy.data(), copy.size());
+}
+
+JwksCache *JwksCache::ParseFile(const char *path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0 ||
+      info.st_size > JWKS_MAX_FILE_SIZE) {
+    close(fd);
+    return nullptr;
+  }
+  size_t size = static_cast<size_t>(info.st_size);
+  // A private writable mapping lets the strings be unescaped in place
+  // without touching the file.
+  void *mapping =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+  JwksCache *cache = ParseInPlace(static_cast<char *>(mapping), size);
+  munmap(mapping, size);
+  return cache;
+}
+
+JwksCache *JwksCache::ParseInPlace(char *json, size_t length) {
+  std::vector<ParsedKey> keys;
+  JsonScanner scanner(json, json + length);
+  bool ok = scanner.ScanObject([&](const Span &name, const Span &value,
+                                   bool is_string) {
+    if (is_string || !KeyIs(name, "keys")) {
+      return;
+    }
+    JsonScanner array(value.begin, value.end);
+    array.ScanArray([&](const Span &element, bool element_is_string) {
+      if (element_is_string) {
+        return;
+      }
+      ParsedKey key;
+      if (ParseKey(element, &key)) {
+        keys.push_back(std::move(key));
+      }
+    });
+  });
+  if (!ok || keys.empty()) {
+    return nullptr;
+  }
+
+  std::stable_sort(keys.begin(), keys.end(),
+                   [](const ParsedKey &a, const ParsedKey &b) {
+                     return a.kid < b.kid;
+                   });
+  // A kid should be unique, keep the first key if it is not.
+  keys.erase(std::unique(keys.begin(), keys.end(),
+                         [](const ParsedKey &a, const ParsedKey &b) {
+                           return a.kid == b.kid;
+                         }),
+             keys.end());
+
+  size_t size = sizeof(TableHeader) + keys.size() * sizeof(TableEntry);
+  std::vector<size_t> key_offsets;
+  for (size_t i = 0; i < keys.size(); i++) {
+    size = Align8(size);
+    key_offsets.push_back(size);
+    size += keys[i].key_size();
+  }
+  size_t kid_offset = size;
+  for (size_t i = 0; i < keys.size(); i++) {
+    size += keys[i].kid.size();
+  }
+
+  void *table = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (table == MAP_FAILED) {
+    return nullptr;
+  }
+  char *bytes = static_cast<char *>(table);
+  TableHeader header = {static_cast<uint32_t>(keys.size()), 0};
+  memcpy(bytes, &header, sizeof(header));
+  TableEntry *entries = reinterpret_cast<TableEntry *>(bytes + sizeof(header));
+  for (size_t i = 0; i < keys.size(); i++) {
+    const ParsedKey &key = keys[i];
+    entries[i].kid_offset = static_cast<uint32_t>(kid_offset);
+    entries[i].kid_length = static_cast<uint32_t>(key.kid.size());
+    entries[i].algorithm = key.algorithm;
+    entries[i].key_offset = static_cast<uint32_t>(key_offsets[i]);
+    memcpy(bytes + key_offsets[i], key.key(), key.key_size());
+    memcpy(bytes + kid_offset, key.kid.data(), key.kid.size());
+    kid_offset += key.kid.size();
+  }
+  mprotect(table, size, PROT_READ);
+  return new JwksCache(table, size);
+}
+
+bool JwksCache::Find(const char *kid, size_t kid_length, Key *key) const {
+  const char *bytes = static_cast<const char *>(table_);
+  const TableEntry *begin = Entries(table_);
+  const TableEntry *end = begin + size();
+  const TableEntry *entry = std::lower_bound(
+      begin, end, 0, [bytes, kid, kid_length](const TableEntry &entry, int) {
+        size_t common = std::min<size_t>(entry.kid_length, kid_length);
+        int order = memcmp(bytes + entry.kid_offset, kid, common);
+        return order < 0 || (order == 0 && entry.kid_length < kid_length);
+      });
+  if (entry == end || entry->kid_length != kid_length ||
+      memcmp(bytes + entry->kid_offset, kid, kid_length) != 0) {
+    return false;
+  }
+  key->algorithm = static_cast<Algorithm>(entry->algorithm);
+  key->rsa = nullptr;
+  key->p256 = nullptr;
+  if (key->algorithm == kAlgorithmRs256) {
+    key->rsa =
+        reinterpret_cast<const RsaPublicKey *>(bytes + entry->key_offset);
+  } else {
+    key->p256 =
+        reinterpret_cast<const P256PublicKey *>(bytes + entry->key_offset);
+  }
+  return true;
+}
+
+size_t JwksCache::size() const {
+  TableHeader header;
+  memcpy(&header, table_, sizeof(header));
+  return header.count;
+}
+
+}  // namespace googlesignin
@@ -0,0 +1,77 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_JWKS_CACHE_H
+#define GOOGLESIGNIN_JWKS_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "signature.h"
+
+namespace googlesignin {
+
+// The signing keys of a JSON Web Key Set (RFC 7517), such as the one
+// published at https://www.googleapis.com/oauth2/v3/certs, parsed once into
+// a table that is looked up by key id.
+//
+// The table is built in its own memory mapping holding the prepared keys,
+// sorted by kid, which is then made read only.  Lookups don't lock or
+// allocate and the cache can be shared between threads.  Keys other than
+// RS256 and ES256 (P-256) signing keys are skipped.
+class JwksCache {
+ public:
+  enum Algorithm {
+    kAlgorithmRs256 = 1,
+    kAlgorithmEs256 = 2,
+  };
+
+  struct Key {
+    Algorithm algorithm;
+    // Set for kAlgorithmRs256.
+    const RsaPublicKey *rsa;
+    // Set for kAlgorithmEs256.
+    const P256PublicKey *p256;
+  };
+
+  // Parses a JWKS document.  Returns null if it is malformed or has no
+  // usable keys.
+  static JwksCache *Parse(const char *json, size_t length);
+
+  // Parses a JWKS document from a file.
+  static JwksCache *ParseFile(const char *path);
+
+  ~JwksCache();
+
+  // Finds the key with the given kid.  Returns false if there is none.
+  bool Find(const char *kid, size_t kid_length, Key *key) const;
+
+  // Number of keys in the cache.
+  size_t size() const;
+
+ private:
+  JwksCache(void *table, size_t table_size);
+
+  // Parses json, unescaping its strings in place.
+  static JwksCache *ParseInPlace(char *json, size_t length);
+
+  void *table_;
+  size_t table_size_;
+
+  JwksCache(const JwksCache &copy) = delete;
+  JwksCache &operator=(const JwksCache &copy) = delete;
+};
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_JWKS_CACHE_H
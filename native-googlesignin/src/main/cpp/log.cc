@@ -0,0 +1,151 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "log.h"
+
+#include <android/log.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <mutex>
+#include <thread>
+
+#include "future.h"
+
+#define TAG "native-googlesignin"
+
+namespace googlesignin {
+
+const uint32_t Log::kRingSize;
+const uint32_t Log::kMaxMessage;
+std::atomic<int> Log::level_(GOOGLESIGNIN_LOG_LEVEL_INFO);
+
+namespace {
+
+// A bounded multi-producer queue: a slot holding sequence == position is
+// free for the producer claiming position, one holding position + 1 is
+// ready for the writer, which frees it for position + kRingSize.
+struct LogSlot {
+  std::atomic<uint32_t> sequence;
+  int level;
+  char text[Log::kMaxMessage];
+};
+
+struct LogRing {
+  LogRing() : enqueue(0), dequeue(0), dropped(0), wake(0), sleeping(false) {
+    for (uint32_t i = 0; i < Log::kRingSize; i++) {
+      slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  LogSlot slots[Log::kRingSize];
+  std::atomic<uint32_t> enqueue;
+  // Only used by the writer thread.
+  uint32_t dequeue;
+  std::atomic<uint32_t> dropped;
+  // Bumped to wake the writer, which waits on it while sleeping is set.
+  std::atomic<int> wake;
+  std::atomic<bool> sleeping;
+};
+
+LogRing &Ring() {
+  static LogRing *ring = new LogRing();
+  return *ring;
+}
+
+// Writes the ready messages to logcat, returns false if there were none.
+bool DrainRing(LogRing *ring) {
+  bool drained = false;
+  for (;;) {
+    LogSlot &slot = ring->slots[ring->dequeue & (Log::kRingSize - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != ring->dequeue + 1) {
+      break;
+    }
+    __android_log_write(slot.level, TAG, slot.text);
+    slot.sequence.store(ring->dequeue + Log::kRingSize,
+                        std::memory_order_release);
+    ring->dequeue++;
+    drained = true;
+  }
+  uint32_t dropped = ring->dropped.exchange(0, std::memory_order_relaxed);
+  if (dropped) {
+    __android_log_print(ANDROID_LOG_WARN, TAG, "Dropped %u log messages",
+                        dropped);
+  }
+  return drained;
+}
+
+void RunWriter() {
+  LogRing *ring = &Ring();
+  for (;;) {
+    if (DrainRing(ring)) {
+      continue;
+    }
+    // Announce the wait before checking the ring again, so a message
+    // published meanwhile either is seen or wakes the writer.
+    int wake = ring->wake.load(std::memory_order_acquire);
+    ring->sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!DrainRing(ring)) {
+      internal::FutexWait(&ring->wake, wake, nullptr);
+    }
+    ring->sleeping.store(false, std::memory_order_relaxed);
+  }
+}
+
+void StartWriter() {
+  static std::once_flag started;
+  std::call_once(started, []() { std::thread(RunWriter).detach(); });
+}
+
+}  // namespace
+
+void Log::Write(int level, const char *format, ...) {
+  StartWriter();
+  LogRing *ring = &Ring();
+
+  uint32_t position = ring->enqueue.load(std::memory_order_relaxed);
+  LogSlot *slot;
+  for (;;) {
+    slot = &ring->slots[position & (kRingSize - 1)];
+    int32_t distance = static_cast<int32_t>(
+        slot->sequence.load(std::memory_order_acquire) - position);
+    if (distance == 0) {
+      if (ring->enqueue.compare_exchange_weak(position, position + 1,
+                                              std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (distance < 0) {
+      // The writer has not caught up with a full ring.
+      ring->dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      position = ring->enqueue.load(std::memory_order_relaxed);
+    }
+  }
+
+  slot->level = level;
+  va_list args;
+  va_start(args, format);
+  vsnprintf(slot->text, sizeof(slot->text), format, args);
+  va_end(args);
+  slot->sequence.store(position + 1, std::memory_order_release);
+
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (ring->sleeping.load(std::memory_order_relaxed)) {
+    ring->wake.fetch_add(1, std::memory_order_release);
+    internal::FutexWakeAll(&ring->wake);
+  }
+}
+
+}  // namespace googlesignin
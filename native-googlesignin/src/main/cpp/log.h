@@ -0,0 +1,116 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_LOG_H
+#define GOOGLESIGNIN_LOG_H
+
+#include <stdint.h>
+#include <atomic>
+
+// Log levels, with the values of android_LogPriority.
+#define GOOGLESIGNIN_LOG_LEVEL_DEBUG 3
+#define GOOGLESIGNIN_LOG_LEVEL_INFO 4
+#define GOOGLESIGNIN_LOG_LEVEL_WARN 5
+#define GOOGLESIGNIN_LOG_LEVEL_ERROR 6
+
+// Messages below this level are compiled out, format strings and arguments
+// included.  Set with the GOOGLESIGNIN_LOG_LEVEL option in CMakeLists.txt,
+// by default debug messages are only kept in debug builds.
+#if !defined(GOOGLESIGNIN_MIN_LOG_LEVEL)
+#if defined(NDEBUG)
+#define GOOGLESIGNIN_MIN_LOG_LEVEL GOOGLESIGNIN_LOG_LEVEL_INFO
+#else
+#define GOOGLESIGNIN_MIN_LOG_LEVEL GOOGLESIGNIN_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+namespace googlesignin {
+
+// Writes log messages to logcat without blocking the caller.  A message is
+// formatted on the calling thread into a fixed size ring, without locking,
+// and a background thread writes it to logcat.  If the ring is full the
+// message is dropped, and the number dropped is logged once there is room.
+// Use the GOOGLESIGNIN_LOG_* macros rather than calling Write().
+class Log {
+ public:
+  // Messages in the ring, a power of two, and the longest message kept.
+  // Longer ones are truncated.
+  static const uint32_t kRingSize = 64;
+  static const uint32_t kMaxMessage = 240;
+
+  // Sets the lowest level written, GOOGLESIGNIN_LOG_LEVEL_INFO until
+  // changed.  GoogleSignIn::EnableDebugLogging() sets it.
+  static void SetLevel(int level) {
+    level_.store(level, std::memory_order_relaxed);
+  }
+
+  static bool IsEnabled(int level) {
+    return level >= level_.load(std::memory_order_relaxed);
+  }
+
+  static void Write(int level, const char *format, ...)
+      __attribute__((format(printf, 2, 3)));
+
+  // Never defined, only named in the unevaluated operand of a disabled log
+  // macro so its arguments are still checked and count as used.
+  static int Discard(const char *format, ...)
+      __attribute__((format(printf, 1, 2)));
+
+ private:
+  static std::atomic<int> level_;
+};
+
+}  // namespace googlesignin
+
+#define GOOGLESIGNIN_LOG(level, ...)                    \
+  do {                                                  \
+    if (::googlesignin::Log::IsEnabled(level)) {        \
+      ::googlesignin::Log::Write(level, __VA_ARGS__);   \
+    }                                                   \
+  } while (0)
+
+#define GOOGLESIGNIN_LOG_DISABLED(...)                                   \
+  do {                                                                   \
+    static_cast<void>(sizeof(::googlesignin::Log::Discard(__VA_ARGS__))); \
+  } while (0)
+
+#if GOOGLESIGNIN_MIN_LOG_LEVEL <= GOOGLESIGNIN_LOG_LEVEL_DEBUG
+#define GOOGLESIGNIN_LOG_DEBUG(...) \
+  GOOGLESIGNIN_LOG(GOOGLESIGNIN_LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define GOOGLESIGNIN_LOG_DEBUG(...) GOOGLESIGNIN_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if GOOGLESIGNIN_MIN_LOG_LEVEL <= GOOGLESIGNIN_LOG_LEVEL_INFO
+#define GOOGLESIGNIN_LOG_INFO(...) \
+  GOOGLESIGNIN_LOG(GOOGLESIGNIN_LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define GOOGLESIGNIN_LOG_INFO(...) GOOGLESIGNIN_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if GOOGLESIGNIN_MIN_LOG_LEVEL <= GOOGLESIGNIN_LOG_LEVEL_WARN
+#define GOOGLESIGNIN_LOG_WARN(...) \
+  GOOGLESIGNIN_LOG(GOOGLESIGNIN_LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define GOOGLESIGNIN_LOG_WARN(...) GOOGLESIGNIN_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#if GOOGLESIGNIN_MIN_LOG_LEVEL <= GOOGLESIGNIN_LOG_LEVEL_ERROR
+#define GOOGLESIGNIN_LOG_ERROR(...) \
+  GOOGLESIGNIN_LOG(GOOGLESIGNIN_LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define GOOGLESIGNIN_LOG_ERROR(...) GOOGLESIGNIN_LOG_DISABLED(__VA_ARGS__)
+#endif
+
+#endif  // GOOGLESIGNIN_LOG_H
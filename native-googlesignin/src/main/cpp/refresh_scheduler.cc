@@ -0,0 +1,118 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "refresh_scheduler.h"
+#include "google_signin_user.h"
+#include "id_token.h"
+
+// Resolution of the timer wheel.  Refreshes are minutes apart, a second is
+// plenty.
+#define REFRESH_TICK_MS 1000
+
+namespace googlesignin {
+
+std::atomic<int> RefreshScheduler::resume_count_(0);
+
+RefreshScheduler::Options::Options()
+    : lead_ms(5 * 60 * 1000),
+      jitter_ms(2 * 60 * 1000),
+      retry_ms(60 * 1000),
+      seed(std::minstd_rand::default_seed) {}
+
+RefreshScheduler::RefreshScheduler(Clock *clock, const Options &options)
+    : clock_(clock),
+      options_(options),
+      random_(options.seed),
+      wheel_(REFRESH_TICK_MS, clock->NowMillis()),
+      timer_id_(0),
+      expiry_ms_(0),
+      refresh_in_flight_(false),
+      seen_resume_count_(resume_count_.load(std::memory_order_relaxed)) {}
+
+void RefreshScheduler::OnSignedIn(const GoogleSignInUser &user) {
+  // Share the user rather than copy it, the reference keeps it alive once
+  // its request is reused.
+  user.AddRef();
+  std::shared_ptr<const GoogleSignInUser> shared(
+      &user, [](const GoogleSignInUser *released) { released->Release(); });
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::atomic_store(&user_, shared);
+
+  const IdTokenClaims *claims = user.GetIdTokenClaims();
+  expiry_ms_ = claims && claims->exp ? claims->exp * 1000 : 0;
+  refresh_in_flight_ = false;
+  if (expiry_ms_) {
+    int64_t jitter =
+        options_.jitter_ms > 0 ? random_() % options_.jitter_ms : 0;
+    Schedule(expiry_ms_ - options_.lead_ms - jitter);
+  } else {
+    Schedule(0);
+  }
+}
+
+void RefreshScheduler::OnSignInFailed() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  refresh_in_flight_ = false;
+  Schedule(expiry_ms_ ? clock_->NowMillis() + options_.retry_ms : 0);
+}
+
+void RefreshScheduler::OnSignedOut() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::atomic_store(&user_, std::shared_ptr<const GoogleSignInUser>());
+  expiry_ms_ = 0;
+  refresh_in_flight_ = false;
+  Schedule(0);
+}
+
+// Replaces the pending refresh, a deadline of 0 only cancels it.  Called
+// with mutex_ held.
+void RefreshScheduler::Schedule(int64_t deadline_ms) {
+  if (timer_id_) {
+    wheel_.Cancel(timer_id_);
+    timer_id_ = 0;
+  }
+  if (deadline_ms) {
+    timer_id_ = wheel_.Schedule(deadline_ms);
+  }
+}
+
+bool RefreshScheduler::Poll() {
+  int64_t now = clock_->NowMillis();
+  std::lock_guard<std::mutex> lock(mutex_);
+  bool due = false;
+  wheel_.Advance(now, [this, &due](uint64_t id) {
+    if (id == timer_id_) {
+      timer_id_ = 0;
+      due = true;
+    }
+  });
+
+  int resume_count = resume_count_.load(std::memory_order_relaxed);
+  if (resume_count != seen_resume_count_) {
+    seen_resume_count_ = resume_count;
+    // The timer may not have fired while the app was in the background.
+    if (expiry_ms_ && expiry_ms_ - now <= options_.lead_ms) {
+      due = true;
+    }
+  }
+
+  if (!due || refresh_in_flight_) {
+    return false;
+  }
+  refresh_in_flight_ = true;
+  Schedule(0);
+  return true;
+}
+
+}  // namespace googlesignin
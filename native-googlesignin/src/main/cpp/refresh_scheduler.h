@@ -0,0 +1,114 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_REFRESH_SCHEDULER_H
+#define GOOGLESIGNIN_REFRESH_SCHEDULER_H
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include "clock.h"
+#include "google_signin_user.h"
+#include "timer_wheel.h"
+
+namespace googlesignin {
+
+// Decides when to refresh the ID token of the signed in user.  A refresh is
+// due a lead time before the token expires, moved earlier by a random jitter
+// so many clients don't refresh at once, or when the activity resumes and
+// the token is within the lead time of expiring.  A failed refresh is
+// retried after a delay.
+//
+// The scheduler does not sign in itself: the owner feeds it results and
+// calls Poll() regularly, starting a silent sign-in whenever it returns
+// true.  The methods can be called from any thread, results are typically
+// fed from the thread completing the sign-in while Poll() runs on the
+// polling thread.
+class RefreshScheduler {
+ public:
+  struct Options {
+    // How long before expiry the refresh is due.
+    int64_t lead_ms;
+    // Up to this much is added to the lead time at random.
+    int64_t jitter_ms;
+    // Delay before retrying a failed refresh.
+    int64_t retry_ms;
+    // Seeds the jitter, fixed seeds give repeatable schedules.
+    uint32_t seed;
+
+    Options();
+  };
+
+  // clock must outlive the scheduler.
+  RefreshScheduler(Clock *clock, const Options &options);
+
+  // Records a successful sign-in: publishes the user, holding a reference to
+  // it, and schedules the refresh of its ID token.
+  void OnSignedIn(const GoogleSignInUser &user);
+
+  // Records a sign-in that failed, retrying later if the token is known.
+  void OnSignInFailed();
+
+  // Forgets the user and cancels the refresh.
+  void OnSignedOut();
+
+  // Returns true if a refresh should be started now.  It then returns false
+  // until the result is recorded with OnSignedIn() or OnSignInFailed().
+  bool Poll();
+
+  // The most recently signed in user, or null.  Published atomically so it
+  // can be read from any thread without waiting for a refresh.
+  std::shared_ptr<const GoogleSignInUser> user() const {
+    return std::atomic_load(&user_);
+  }
+
+  // Expiry of the current ID token in milliseconds since the epoch, 0 if
+  // unknown.
+  int64_t expiry_ms() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return expiry_ms_;
+  }
+
+  // Called on any thread when the activity resumes.  Every scheduler checks
+  // its token on the next Poll().
+  static void NotifyActivityResumed() {
+    resume_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+ private:
+  void Schedule(int64_t deadline_ms);
+
+  Clock *clock_;
+  Options options_;
+  // Guards the schedule, i.e. everything below but user_.
+  mutable std::mutex mutex_;
+  std::minstd_rand random_;
+  TimerWheel wheel_;
+  uint64_t timer_id_;
+  int64_t expiry_ms_;
+  bool refresh_in_flight_;
+  int seen_resume_count_;
+  std::shared_ptr<const GoogleSignInUser> user_;
+
+  static std::atomic<int> resume_count_;
+
+  RefreshScheduler(const RefreshScheduler &copy) = delete;
+  RefreshScheduler &operator=(const RefreshScheduler &copy) = delete;
+};
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_REFRESH_SCHEDULER_H
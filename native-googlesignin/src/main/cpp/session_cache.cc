@@ -0,0 +1,278 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "session_cache.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#include "google_signin_user_impl.h"
+#include "jni_init.h"
+#include "log.h"
+
+// File getFilesDir()
+#define GETFILESDIR_METHOD_NAME "getFilesDir"
+#define GETFILESDIR_METHOD_SIG "()Ljava/io/File;"
+
+// String getAbsolutePath()
+#define GETABSOLUTEPATH_METHOD_NAME "getAbsolutePath"
+#define GETABSOLUTEPATH_METHOD_SIG "()Ljava/lang/String;"
+
+#define SESSION_CACHE_FILENAME "googlesignin-session.bin"
+
+namespace googlesignin {
+
+// "GSIS" in a little endian file.
+static const uint32_t kMagic = 0x53495347;
+// Bump when the header or the packed account format changes, older files
+// are then ignored.
+static const uint32_t kVersion = 1;
+// A snapshot is a few kilobytes, anything much larger is not one of ours.
+static const size_t kMaxPayloadSize = 64 * 1024;
+
+struct SessionCacheHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t payload_size;
+  uint32_t checksum;
+};
+
+// FNV-1a of the payload.  This only needs to catch torn or corrupt files.
+static uint32_t Checksum(const unsigned char *data, size_t size) {
+  uint32_t hash = 2166136261U;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= data[i];
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+SessionCache::SessionCache(const std::string &path)
+    : path_(path),
+      has_pending_(false),
+      writing_(false),
+      last_write_ok_(true),
+      stopping_(false) {}
+
+SessionCache::~SessionCache() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  changed_.notify_all();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+}
+
+SessionCache *SessionCache::CreateInFilesDir(jobject activity) {
+  JNIEnv *env = GetJniEnv();
+
+  jclass activity_class = env->GetObjectClass(activity);
+  jmethodID get_files_dir = env->GetMethodID(
+      activity_class, GETFILESDIR_METHOD_NAME, GETFILESDIR_METHOD_SIG);
+  jobject files_dir = env->CallObjectMethod(activity, get_files_dir);
+  env->DeleteLocalRef(activity_class);
+  if (env->ExceptionCheck()) {
+    env->ExceptionClear();
+    files_dir = nullptr;
+  }
+  if (!files_dir) {
+    GOOGLESIGNIN_LOG_ERROR("No files directory for the session cache");
+    return nullptr;
+  }
+
+  jclass file_class = env->GetObjectClass(files_dir);
+  jmethodID get_absolute_path =
+      env->GetMethodID(file_class, GETABSOLUTEPATH_METHOD_NAME,
+                       GETABSOLUTEPATH_METHOD_SIG);
+  jstring j_path = static_cast<jstring>(
+      env->CallObjectMethod(files_dir, get_absolute_path));
+  env->DeleteLocalRef(file_class);
+  env->DeleteLocalRef(files_dir);
+  if (env->ExceptionCheck()) {
+    env->ExceptionClear();
+    j_path = nullptr;
+  }
+  if (!j_path) {
+    return nullptr;
+  }
+
+  const char *chars = env->GetStringUTFChars(j_path, nullptr);
+  std::string path = std::string(chars) + "/" SESSION_CACHE_FILENAME;
+  env->ReleaseStringUTFChars(j_path, chars);
+  env->DeleteLocalRef(j_path);
+
+  return new SessionCache(path);
+}
+
+GoogleSignInUser *SessionCache::Load() const {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const std::vector<unsigned char> *latest =
+        has_pending_ ? &pending_ : writing_ ? &writing_payload_ : nullptr;
+    if (latest) {
+      return GoogleSignInUserImpl::UserFromPackedAccount(latest->data(),
+                                                         latest->size());
+    }
+  }
+
+  int fd = open(path_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      info.st_size < static_cast<off_t>(sizeof(SessionCacheHeader)) ||
+      info.st_size >
+          static_cast<off_t>(sizeof(SessionCacheHeader) + kMaxPayloadSize)) {
+    close(fd);
+    return nullptr;
+  }
+  size_t size = static_cast<size_t>(info.st_size);
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+
+  GoogleSignInUser *user = nullptr;
+  const unsigned char *bytes = static_cast<const unsigned char *>(mapping);
+  SessionCacheHeader header;
+  memcpy(&header, bytes, sizeof(header));
+  const unsigned char *payload = bytes + sizeof(header);
+  if (header.magic == kMagic && header.version == kVersion &&
+      header.payload_size == size - sizeof(header) &&
+      header.checksum == Checksum(payload, header.payload_size)) {
+    user = GoogleSignInUserImpl::UserFromPackedAccount(payload,
+                                                       header.payload_size);
+  } else {
+    GOOGLESIGNIN_LOG_WARN("Ignoring invalid session cache %s",
+                          path_.c_str());
+  }
+  munmap(mapping, size);
+  return user;
+}
+
+void SessionCache::Store(const GoogleSignInUser &user) {
+  std::vector<unsigned char> payload;
+  GoogleSignInUserImpl::PackUser(user, false, &payload);
+  if (payload.size() > kMaxPayloadSize) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.swap(payload);
+    has_pending_ = true;
+    if (!writer_.joinable()) {
+      writer_ = std::thread(&SessionCache::RunWriter, this);
+    }
+  }
+  changed_.notify_all();
+}
+
+void SessionCache::RunWriter() {
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait(lock, [this]() { return has_pending_ || stopping_; });
+      if (!has_pending_) {
+        return;
+      }
+    }
+
+    // The snapshot is taken with file_mutex_ held, so a Clear() either drops
+    // it first or waits for it to be written and then removes the file.
+    std::lock_guard<std::mutex> file_lock(file_mutex_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!has_pending_) {
+        continue;
+      }
+      writing_payload_.swap(pending_);
+      has_pending_ = false;
+      writing_ = true;
+    }
+    // Only read while it is written, Load() may read it as well.
+    bool written = WriteFile(writing_payload_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      writing_ = false;
+      last_write_ok_ = written;
+    }
+    changed_.notify_all();
+  }
+}
+
+bool SessionCache::WriteFile(const std::vector<unsigned char> &payload) {
+  SessionCacheHeader header;
+  header.magic = kMagic;
+  header.version = kVersion;
+  header.payload_size = static_cast<uint32_t>(payload.size());
+  header.checksum = Checksum(payload.data(), payload.size());
+  size_t size = sizeof(header) + payload.size();
+
+  std::string temp_path = path_ + ".tmp";
+  int fd = open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+                S_IRUSR | S_IWUSR);
+  if (fd < 0) {
+    GOOGLESIGNIN_LOG_WARN("Can't write session cache %s",
+                          temp_path.c_str());
+    return false;
+  }
+  bool written = false;
+  if (ftruncate(fd, static_cast<off_t>(size)) == 0) {
+    void *mapping =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping != MAP_FAILED) {
+      unsigned char *bytes = static_cast<unsigned char *>(mapping);
+      memcpy(bytes, &header, sizeof(header));
+      memcpy(bytes + sizeof(header), payload.data(), payload.size());
+      written = msync(mapping, size, MS_SYNC) == 0;
+      munmap(mapping, size);
+    }
+  }
+  close(fd);
+
+  if (!written || rename(temp_path.c_str(), path_.c_str()) != 0) {
+    unlink(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+void SessionCache::Clear() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_pending_ = false;
+    pending_.clear();
+  }
+  changed_.notify_all();
+  // Waits for a write that is already running, it is then removed here.
+  std::lock_guard<std::mutex> file_lock(file_mutex_);
+  unlink(path_.c_str());
+}
+
+bool SessionCache::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  changed_.wait(lock, [this]() { return !has_pending_ && !writing_; });
+  return last_write_ok_;
+}
+
+}  // namespace googlesignin
@@ -0,0 +1,102 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_SESSION_CACHE_H
+#define GOOGLESIGNIN_SESSION_CACHE_H
+
+#include <jni.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "google_signin_user.h"
+
+namespace googlesignin {
+
+// Persists the last signed in user to a file so a cold start can return it
+// before the Java sign-in flow has even started.
+//
+// The file is a small header (magic, version, payload size and checksum)
+// followed by the user in the format written by
+// GoogleSignInHelper.packAccount().  It is read and written through a memory
+// mapping, and replaced atomically with a rename so a crash while writing
+// leaves either the old or the new snapshot.  The server auth code is not
+// stored since it can only be exchanged once.
+//
+// Results are stored from the thread that delivers them, usually the Java UI
+// thread, so the file is written on a thread owned by the cache, started by
+// the first Store().  Store() only packs the user.  A snapshot stored while
+// another is being written replaces the one waiting, only the latest is
+// written.
+class SessionCache {
+ public:
+  explicit SessionCache(const std::string &path);
+  // Waits for the pending write.
+  ~SessionCache();
+
+  // Creates a cache in the files directory of the activity.  Returns null if
+  // the directory can't be found.
+  static SessionCache *CreateInFilesDir(jobject activity);
+
+  // Returns the cached user, or null if there is none or the file is not
+  // valid.  A user that is stored but not written yet is returned as well.
+  // The caller owns the user.
+  GoogleSignInUser *Load() const;
+
+  // Replaces the cached user.  The file is written later, on the writer
+  // thread.
+  void Store(const GoogleSignInUser &user);
+
+  // Removes the cached user, dropping a snapshot that is not written yet.
+  // Once this returns no earlier Store() can bring the file back.
+  void Clear();
+
+  // Blocks until the stored snapshots are written.  Returns false if the
+  // last write failed.
+  bool Flush();
+
+ private:
+  void RunWriter();
+  // Writes the file from payload.  Called with file_mutex_ held.
+  bool WriteFile(const std::vector<unsigned char> &payload);
+
+  std::string path_;
+
+  // Guards the fields below it.
+  mutable std::mutex mutex_;
+  std::condition_variable changed_;
+  std::thread writer_;
+  // The snapshot waiting for the writer, if has_pending_.
+  std::vector<unsigned char> pending_;
+  bool has_pending_;
+  // True while the writer is writing writing_payload_, the snapshot it took
+  // from pending_.  The writer only swaps it with mutex_ held.
+  bool writing_;
+  std::vector<unsigned char> writing_payload_;
+  bool last_write_ok_;
+  bool stopping_;
+
+  // Held by the writer from taking a snapshot until it is written, and by
+  // Clear() to remove the file, so a write can't undo a Clear().  Taken
+  // before mutex_ when both are held.
+  std::mutex file_mutex_;
+
+  SessionCache(const SessionCache &copy) = delete;
+  SessionCache &operator=(const SessionCache &copy) = delete;
+};
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_SESSION_CACHE_H
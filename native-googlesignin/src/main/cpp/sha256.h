@@ -0,0 +1,51 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_SHA256_H
+#define GOOGLESIGNIN_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace googlesignin {
+
+// SHA-256 (FIPS 180-4), used to hash the signed part of ID tokens.
+class Sha256 {
+ public:
+  static const size_t kDigestSize = 32;
+
+  Sha256();
+
+  void Update(const void *data, size_t length);
+
+  // Writes the digest of everything passed to Update().  The object can't be
+  // updated afterwards.
+  void Finish(uint8_t digest[kDigestSize]);
+
+  // Hashes data in one call.
+  static void Hash(const void *data, size_t length,
+                   uint8_t digest[kDigestSize]);
+
+ private:
+  void Transform(const uint8_t block[64]);
+
+  uint32_t state_[8];
+  uint64_t length_;
+  uint8_t buffer_[64];
+  size_t buffered_;
+};
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_SHA256_H
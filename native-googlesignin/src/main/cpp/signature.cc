@@ -0,0 +1,546 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "signature.h"
+#include <string.h>
+
+// Smallest RSA modulus accepted, in bytes.
+#define RSA_MIN_MODULUS_BYTES 256
+
+namespace googlesignin {
+
+namespace {
+
+const size_t kMaxLimbs = RsaPublicKey::kMaxLimbs;
+
+// A modulus with the constant needed for Montgomery multiplication.
+struct Modulus {
+  const uint32_t *n;
+  uint32_t n0inv;
+  size_t limbs;
+};
+
+void FromBigEndian(const uint8_t *bytes, size_t length, uint32_t *limbs,
+                   size_t count) {
+  memset(limbs, 0, count * sizeof(uint32_t));
+  for (size_t i = 0; i < length && i < count * 4; i++) {
+    limbs[i / 4] |= static_cast<uint32_t>(bytes[length - 1 - i])
+                    << (8 * (i % 4));
+  }
+}
+
+void ToBigEndian(const uint32_t *limbs, uint8_t *bytes, size_t length) {
+  for (size_t i = 0; i < length; i++) {
+    bytes[length - 1 - i] = static_cast<uint8_t>(limbs[i / 4] >> (8 * (i % 4)));
+  }
+}
+
+int Compare(const uint32_t *a, const uint32_t *b, size_t limbs) {
+  for (size_t i = limbs; i-- > 0;) {
+    if (a[i] != b[i]) {
+      return a[i] < b[i] ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+bool IsZero(const uint32_t *a, size_t limbs) {
+  for (size_t i = 0; i < limbs; i++) {
+    if (a[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// r = a + b, returning the carry.
+uint32_t Add(uint32_t *r, const uint32_t *a, const uint32_t *b,
+             size_t limbs) {
+  uint64_t carry = 0;
+  for (size_t i = 0; i < limbs; i++) {
+    carry += static_cast<uint64_t>(a[i]) + b[i];
+    r[i] = static_cast<uint32_t>(carry);
+    carry >>= 32;
+  }
+  return static_cast<uint32_t>(carry);
+}
+
+// r = a - b, returning the borrow.
+uint32_t Subtract(uint32_t *r, const uint32_t *a, const uint32_t *b,
+                  size_t limbs) {
+  uint32_t borrow = 0;
+  for (size_t i = 0; i < limbs; i++) {
+    uint64_t difference = static_cast<uint64_t>(a[i]) - b[i] - borrow;
+    r[i] = static_cast<uint32_t>(difference);
+    borrow = static_cast<uint32_t>(difference >> 32) & 1;
+  }
+  return borrow;
+}
+
+// Returns -n0^-1 mod 2^32 for odd n0.  Each Newton step doubles the number
+// of correct bits, starting from the 3 that n0 * n0 = 1 mod 8 gives.
+uint32_t NegativeInverse(uint32_t n0) {
+  uint32_t inverse = n0;
+  for (int i = 0; i < 4; i++) {
+    inverse *= 2 - n0 * inverse;
+  }
+  return 0 - inverse;
+}
+
+// r = a * b / R mod m, where R = 2^(32 * limbs), for a and b less than m.
+// r may alias a or b.
+void MontgomeryMultiply(uint32_t *r, const uint32_t *a, const uint32_t *b,
+                        const Modulus &m) {
+  size_t s = m.limbs;
+  uint32_t t[kMaxLimbs + 2];
+  memset(t, 0, (s + 2) * sizeof(uint32_t));
+  for (size_t i = 0; i < s; i++) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < s; j++) {
+      carry += static_cast<uint64_t>(t[j]) +
+               static_cast<uint64_t>(a[j]) * b[i];
+      t[j] = static_cast<uint32_t>(carry);
+      carry >>= 32;
+    }
+    carry += t[s];
+    t[s] = static_cast<uint32_t>(carry);
+    t[s + 1] = static_cast<uint32_t>(carry >> 32);
+
+    // Add a multiple of m that clears the low limb, then shift it out.
+    uint32_t q = t[0] * m.n0inv;
+    carry = (static_cast<uint64_t>(t[0]) +
+             static_cast<uint64_t>(q) * m.n[0]) >> 32;
+    for (size_t j = 1; j < s; j++) {
+      carry += static_cast<uint64_t>(t[j]) +
+               static_cast<uint64_t>(q) * m.n[j];
+      t[j - 1] = static_cast<uint32_t>(carry);
+      carry >>= 32;
+    }
+    carry += t[s];
+    t[s - 1] = static_cast<uint32_t>(carry);
+    t[s] = t[s + 1] + static_cast<uint32_t>(carry >> 32);
+  }
+  if (t[s] || Compare(t, m.n, s) >= 0) {
+    Subtract(t, t, m.n, s);
+  }
+  memcpy(r, t, s * sizeof(uint32_t));
+}
+
+// r = base^exponent mod m, with base and r in Montgomery form.  exponent is
+// not zero.  r may alias base.
+void MontgomeryPower(uint32_t *r, const uint32_t *base,
+                     const uint32_t *exponent, size_t exponent_limbs,
+                     const Modulus &m) {
+  size_t bit = exponent_limbs * 32;
+  while (bit > 0 && !((exponent[(bit - 1) / 32] >> ((bit - 1) % 32)) & 1)) {
+    bit--;
+  }
+  uint32_t power[kMaxLimbs];
+  memcpy(power, base, m.limbs * sizeof(uint32_t));
+  // The top bit is accounted for by starting from base.
+  while (bit-- > 1) {
+    MontgomeryMultiply(power, power, power, m);
+    if ((exponent[(bit - 1) / 32] >> ((bit - 1) % 32)) & 1) {
+      MontgomeryMultiply(power, power, base, m);
+    }
+  }
+  memcpy(r, power, m.limbs * sizeof(uint32_t));
+}
+
+// rr = R^2 mod m, by doubling 1 until it is R^2.  Slow, only done when a key
+// is prepared.
+void ComputeRR(const Modulus &m, uint32_t *rr) {
+  memset(rr, 0, m.limbs * sizeof(uint32_t));
+  rr[0] = 1;
+  for (size_t i = 0; i < 64 * m.limbs; i++) {
+    uint32_t carry = Add(rr, rr, rr, m.limbs);
+    if (carry || Compare(rr, m.n, m.limbs) >= 0) {
+      Subtract(rr, rr, m.n, m.limbs);
+    }
+  }
+}
+
+// The ASN.1 DigestInfo prefix of a SHA-256 digest in a PKCS #1 v1.5
+// signature.
+const uint8_t kSha256DigestInfo[] = {
+  0x30, 0x31, 0x30, 0x0d, 0x06, 0x09, 0x60, 0x86, 0x48, 0x01,
+  0x65, 0x03, 0x04, 0x02, 0x01, 0x05, 0x00, 0x04, 0x20,
+};
+
+// P-256 parameters from FIPS 186-4 D.1.2.3.
+const uint8_t kP256Prime[32] = {
+  0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+const uint8_t kP256Order[32] = {
+  0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xbc, 0xe6, 0xfa, 0xad, 0xa7, 0x17,
+  0x9e, 0x84, 0xf3, 0xb9, 0xca, 0xc2, 0xfc, 0x63, 0x25, 0x51,
+};
+const uint8_t kP256B[32] = {
+  0x5a, 0xc6, 0x35, 0xd8, 0xaa, 0x3a, 0x93, 0xe7, 0xb3, 0xeb, 0xbd,
+  0x55, 0x76, 0x98, 0x86, 0xbc, 0x65, 0x1d, 0x06, 0xb0, 0xcc, 0x53,
+  0xb0, 0xf6, 0x3b, 0xce, 0x3c, 0x3e, 0x27, 0xd2, 0x60, 0x4b,
+};
+const uint8_t kP256Gx[32] = {
+  0x6b, 0x17, 0xd1, 0xf2, 0xe1, 0x2c, 0x42, 0x47, 0xf8, 0xbc, 0xe6,
+  0xe5, 0x63, 0xa4, 0x40, 0xf2, 0x77, 0x03, 0x7d, 0x81, 0x2d, 0xeb,
+  0x33, 0xa0, 0xf4, 0xa1, 0x39, 0x45, 0xd8, 0x98, 0xc2, 0x96,
+};
+const uint8_t kP256Gy[32] = {
+  0x4f, 0xe3, 0x42, 0xe2, 0xfe, 0x1a, 0x7f, 0x9b, 0x8e, 0xe7, 0xeb,
+  0x4a, 0x7c, 0x0f, 0x9e, 0x16, 0x2b, 0xce, 0x33, 0x57, 0x6b, 0x31,
+  0x5e, 0xce, 0xcb, 0xb6, 0x40, 0x68, 0x37, 0xbf, 0x51, 0xf5,
+};
+
+// The curve constants converted to limbs, with field elements in Montgomery
+// form.
+struct P256Curve {
+  uint32_t p[8];
+  uint32_t p_rr[8];
+  uint32_t p_minus_2[8];
+  uint32_t n[8];
+  uint32_t n_rr[8];
+  uint32_t n_minus_2[8];
+  Modulus field;
+  Modulus order;
+  uint32_t one[8];
+  uint32_t b[8];
+  uint32_t gx[8];
+  uint32_t gy[8];
+
+  P256Curve() {
+    FromBigEndian(kP256Prime, 32, p, 8);
+    field.n = p;
+    field.n0inv = NegativeInverse(p[0]);
+    field.limbs = 8;
+    ComputeRR(field, p_rr);
+    // The low limbs of p and n are large enough that this doesn't borrow.
+    memcpy(p_minus_2, p, sizeof(p));
+    p_minus_2[0] -= 2;
+
+    FromBigEndian(kP256Order, 32, n, 8);
+    order.n = n;
+    order.n0inv = NegativeInverse(n[0]);
+    order.limbs = 8;
+    ComputeRR(order, n_rr);
+    memcpy(n_minus_2, n, sizeof(n));
+    n_minus_2[0] -= 2;
+
+    uint32_t unit[8] = {1};
+    MontgomeryMultiply(one, unit, p_rr, field);
+    FromBigEndian(kP256B, 32, b, 8);
+    MontgomeryMultiply(b, b, p_rr, field);
+    FromBigEndian(kP256Gx, 32, gx, 8);
+    MontgomeryMultiply(gx, gx, p_rr, field);
+    FromBigEndian(kP256Gy, 32, gy, 8);
+    MontgomeryMultiply(gy, gy, p_rr, field);
+  }
+
+  P256Curve(const P256Curve &copy) = delete;
+  P256Curve &operator=(const P256Curve &copy) = delete;
+};
+
+const P256Curve &Curve() {
+  static const P256Curve curve;
+  return curve;
+}
+
+void FieldMultiply(uint32_t *r, const uint32_t *a, const uint32_t *b) {
+  MontgomeryMultiply(r, a, b, Curve().field);
+}
+
+void FieldAdd(uint32_t *r, const uint32_t *a, const uint32_t *b) {
+  if (Add(r, a, b, 8) || Compare(r, Curve().p, 8) >= 0) {
+    Subtract(r, r, Curve().p, 8);
+  }
+}
+
+void FieldSubtract(uint32_t *r, const uint32_t *a, const uint32_t *b) {
+  if (Subtract(r, a, b, 8)) {
+    Add(r, r, Curve().p, 8);
+  }
+}
+
+// A point in Jacobian coordinates, (x / z^2, y / z^3).  z = 0 is the point
+// at infinity.
+struct JacobianPoint {
+  uint32_t x[8];
+  uint32_t y[8];
+  uint32_t z[8];
+};
+
+void SetAffine(JacobianPoint *point, const uint32_t *x, const uint32_t *y) {
+  memcpy(point->x, x, sizeof(point->x));
+  memcpy(point->y, y, sizeof(point->y));
+  memcpy(point->z, Curve().one, sizeof(point->z));
+}
+
+void SetInfinity(JacobianPoint *point) {
+  memcpy(point->x, Curve().one, sizeof(point->x));
+  memcpy(point->y, Curve().one, sizeof(point->y));
+  memset(point->z, 0, sizeof(point->z));
+}
+
+bool IsInfinity(const JacobianPoint &point) { return IsZero(point.z, 8); }
+
+// r = 2a, using the a = -3 doubling formula (dbl-2001-b).  r may alias a.
+void Double(JacobianPoint *r, const JacobianPoint &a) {
+  uint32_t delta[8], gamma[8], beta[8], alpha[8], t1[8], t2[8];
+  FieldMultiply(delta, a.z, a.z);
+  FieldMultiply(gamma, a.y, a.y);
+  FieldMultiply(beta, a.x, gamma);
+  FieldSubtract(t1, a.x, delta);
+  FieldAdd(t2, a.x, delta);
+  FieldMultiply(t1, t1, t2);
+  FieldAdd(alpha, t1, t1);
+  FieldAdd(alpha, alpha, t1);
+
+  // z3 = (y + z)^2 - gamma - delta, computed before y is overwritten.
+  FieldAdd(t1, a.y, a.z);
+  FieldMultiply(t1, t1, t1);
+  FieldSubtract(t1, t1, gamma);
+  FieldSubtract(r->z, t1, delta);
+
+  // x3 = alpha^2 - 8 beta
+  FieldAdd(beta, beta, beta);
+  FieldAdd(beta, beta, beta);
+  FieldMultiply(t1, alpha, alpha);
+  FieldSubtract(t1, t1, beta);
+  FieldSubtract(r->x, t1, beta);
+
+  // y3 = alpha (4 beta - x3) - 8 gamma^2
+  FieldSubtract(t1, beta, r->x);
+  FieldMultiply(t1, alpha, t1);
+  FieldMultiply(t2, gamma, gamma);
+  FieldAdd(t2, t2, t2);
+  FieldAdd(t2, t2, t2);
+  FieldAdd(t2, t2, t2);
+  FieldSubtract(r->y, t1, t2);
+}
+
+// r = a + b (add-1998-cmo-2), handling the point at infinity and a = b.
+// r may alias a or b.
+void AddPoints(JacobianPoint *r, const JacobianPoint &a,
+               const JacobianPoint &b) {
+  if (IsInfinity(a)) {
+    *r = b;
+    return;
+  }
+  if (IsInfinity(b)) {
+    *r = a;
+    return;
+  }
+  uint32_t z1z1[8], z2z2[8], u1[8], u2[8], s1[8], s2[8], h[8], rr[8];
+  FieldMultiply(z1z1, a.z, a.z);
+  FieldMultiply(z2z2, b.z, b.z);
+  FieldMultiply(u1, a.x, z2z2);
+  FieldMultiply(u2, b.x, z1z1);
+  FieldMultiply(s1, a.y, b.z);
+  FieldMultiply(s1, s1, z2z2);
+  FieldMultiply(s2, b.y, a.z);
+  FieldMultiply(s2, s2, z1z1);
+  FieldSubtract(h, u2, u1);
+  FieldSubtract(rr, s2, s1);
+  if (IsZero(h, 8)) {
+    if (IsZero(rr, 8)) {
+      Double(r, a);
+    } else {
+      SetInfinity(r);
+    }
+    return;
+  }
+
+  uint32_t hh[8], hhh[8], v[8], t[8];
+  FieldMultiply(hh, h, h);
+  FieldMultiply(hhh, h, hh);
+  FieldMultiply(v, u1, hh);
+  // z3 = z1 z2 h
+  FieldMultiply(t, a.z, b.z);
+  FieldMultiply(r->z, t, h);
+  // x3 = rr^2 - hhh - 2v
+  FieldMultiply(t, rr, rr);
+  FieldSubtract(t, t, hhh);
+  FieldSubtract(t, t, v);
+  FieldSubtract(r->x, t, v);
+  // y3 = rr (v - x3) - s1 hhh
+  FieldSubtract(t, v, r->x);
+  FieldMultiply(t, rr, t);
+  FieldMultiply(s1, s1, hhh);
+  FieldSubtract(r->y, t, s1);
+}
+
+bool Bit(const uint32_t *scalar, size_t bit) {
+  return (scalar[bit / 32] >> (bit % 32)) & 1;
+}
+
+}  // namespace
+
+bool PrepareRsaPublicKey(const uint8_t *modulus, size_t modulus_length,
+                         const uint8_t *exponent, size_t exponent_length,
+                         RsaPublicKey *key) {
+  while (modulus_length && !*modulus) {
+    modulus++;
+    modulus_length--;
+  }
+  while (exponent_length && !*exponent) {
+    exponent++;
+    exponent_length--;
+  }
+  if (modulus_length < RSA_MIN_MODULUS_BYTES ||
+      modulus_length > kMaxLimbs * 4 || !(modulus[modulus_length - 1] & 1) ||
+      exponent_length == 0 || exponent_length > 4) {
+    return false;
+  }
+  memset(key, 0, sizeof(*key));
+  key->exponent = 0;
+  for (size_t i = 0; i < exponent_length; i++) {
+    key->exponent = (key->exponent << 8) | exponent[i];
+  }
+  if (key->exponent < 3 || !(key->exponent & 1)) {
+    return false;
+  }
+  key->modulus_bytes = static_cast<uint32_t>(modulus_length);
+  key->limbs = static_cast<uint32_t>((modulus_length + 3) / 4);
+  FromBigEndian(modulus, modulus_length, key->modulus, key->limbs);
+  key->n0inv = NegativeInverse(key->modulus[0]);
+  Modulus m = {key->modulus, key->n0inv, key->limbs};
+  ComputeRR(m, key->rr);
+  return true;
+}
+
+bool PrepareP256PublicKey(const uint8_t x[32], const uint8_t y[32],
+                          P256PublicKey *key) {
+  const P256Curve &curve = Curve();
+  uint32_t px[8], py[8];
+  FromBigEndian(x, 32, px, 8);
+  FromBigEndian(y, 32, py, 8);
+  if (Compare(px, curve.p, 8) >= 0 || Compare(py, curve.p, 8) >= 0) {
+    return false;
+  }
+  FieldMultiply(px, px, curve.p_rr);
+  FieldMultiply(py, py, curve.p_rr);
+
+  // y^2 = x^3 - 3x + b
+  uint32_t left[8], right[8], t[8];
+  FieldMultiply(left, py, py);
+  FieldMultiply(right, px, px);
+  FieldMultiply(right, right, px);
+  FieldAdd(t, px, px);
+  FieldAdd(t, t, px);
+  FieldSubtract(right, right, t);
+  FieldAdd(right, right, curve.b);
+  if (Compare(left, right, 8) != 0) {
+    return false;
+  }
+  memcpy(key->x, px, sizeof(key->x));
+  memcpy(key->y, py, sizeof(key->y));
+  return true;
+}
+
+bool VerifyRs256(const RsaPublicKey &key, const uint8_t digest[32],
+                 const uint8_t *signature, size_t signature_length) {
+  if (signature_length != key.modulus_bytes) {
+    return false;
+  }
+  Modulus m = {key.modulus, key.n0inv, key.limbs};
+  uint32_t value[kMaxLimbs];
+  FromBigEndian(signature, signature_length, value, key.limbs);
+  if (Compare(value, key.modulus, key.limbs) >= 0) {
+    return false;
+  }
+  MontgomeryMultiply(value, value, key.rr, m);
+  MontgomeryPower(value, value, &key.exponent, 1, m);
+  uint32_t unit[kMaxLimbs] = {1};
+  MontgomeryMultiply(value, value, unit, m);
+
+  // 00 01 ff .. ff 00 DigestInfo digest
+  uint8_t encoded[kMaxLimbs * 4] = {0};
+  size_t length = key.modulus_bytes;
+  ToBigEndian(value, encoded, length);
+  size_t padding = length - 3 - sizeof(kSha256DigestInfo) - 32;
+  if (encoded[0] != 0x00 || encoded[1] != 0x01) {
+    return false;
+  }
+  for (size_t i = 0; i < padding; i++) {
+    if (encoded[2 + i] != 0xff) {
+      return false;
+    }
+  }
+  const uint8_t *p = encoded + 2 + padding;
+  return p[0] == 0x00 &&
+         memcmp(p + 1, kSha256DigestInfo, sizeof(kSha256DigestInfo)) == 0 &&
+         memcmp(p + 1 + sizeof(kSha256DigestInfo), digest, 32) == 0;
+}
+
+bool VerifyEs256(const P256PublicKey &key, const uint8_t digest[32],
+                 const uint8_t *signature, size_t signature_length) {
+  if (signature_length != 64) {
+    return false;
+  }
+  const P256Curve &curve = Curve();
+  uint32_t r[8], s[8], e[8];
+  FromBigEndian(signature, 32, r, 8);
+  FromBigEndian(signature + 32, 32, s, 8);
+  if (IsZero(r, 8) || IsZero(s, 8) || Compare(r, curve.n, 8) >= 0 ||
+      Compare(s, curve.n, 8) >= 0) {
+    return false;
+  }
+  // The digest is as long as the order, it only needs reducing.
+  FromBigEndian(digest, 32, e, 8);
+  if (Compare(e, curve.n, 8) >= 0) {
+    Subtract(e, e, curve.n, 8);
+  }
+
+  // w = s^-1 mod n in Montgomery form, so multiplying a plain number by it
+  // gives a plain product.
+  uint32_t w[8], u1[8], u2[8];
+  MontgomeryMultiply(w, s, curve.n_rr, curve.order);
+  MontgomeryPower(w, w, curve.n_minus_2, 8, curve.order);
+  MontgomeryMultiply(u1, e, w, curve.order);
+  MontgomeryMultiply(u2, r, w, curve.order);
+
+  // u1 G + u2 Q with one pass over the bits of both scalars.
+  JacobianPoint table[3];
+  SetAffine(&table[0], curve.gx, curve.gy);
+  SetAffine(&table[1], key.x, key.y);
+  AddPoints(&table[2], table[0], table[1]);
+  JacobianPoint sum;
+  SetInfinity(&sum);
+  for (size_t bit = 256; bit-- > 0;) {
+    Double(&sum, sum);
+    int index = Bit(u1, bit) | (Bit(u2, bit) << 1);
+    if (index) {
+      AddPoints(&sum, sum, table[index - 1]);
+    }
+  }
+  if (IsInfinity(sum)) {
+    return false;
+  }
+
+  // x = X / Z^2, out of Montgomery form and reduced mod n.
+  uint32_t z_inverse[8], x[8];
+  MontgomeryPower(z_inverse, sum.z, curve.p_minus_2, 8, curve.field);
+  FieldMultiply(z_inverse, z_inverse, z_inverse);
+  FieldMultiply(x, sum.x, z_inverse);
+  uint32_t unit[8] = {1};
+  FieldMultiply(x, x, unit);
+  if (Compare(x, curve.n, 8) >= 0) {
+    Subtract(x, x, curve.n, 8);
+  }
+  return Compare(x, r, 8) == 0;
+}
+
+}  // namespace googlesignin
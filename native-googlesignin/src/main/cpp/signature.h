@@ -0,0 +1,75 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_SIGNATURE_H
+#define GOOGLESIGNIN_SIGNATURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace googlesignin {
+
+// Verification of the two JWT signature algorithms used for ID tokens,
+// RS256 (RSASSA-PKCS1-v1_5 with SHA-256) and ES256 (ECDSA on P-256 with
+// SHA-256).  Only public keys and public data are involved, so the code
+// favors simplicity over constant time.
+//
+// Keys are prepared once, which does the expensive precomputation, and are
+// plain structs so they can live in a memory mapped key table.  Numbers are
+// kept as little endian arrays of 32-bit limbs.
+
+// An RSA public key of 2048 to 4096 bits.
+struct RsaPublicKey {
+  static const size_t kMaxLimbs = 128;
+
+  uint32_t limbs;
+  uint32_t exponent;
+  // -modulus^-1 mod 2^32, for Montgomery multiplication.
+  uint32_t n0inv;
+  uint32_t modulus_bytes;
+  uint32_t modulus[kMaxLimbs];
+  // R^2 mod modulus, where R = 2^(32 * limbs).
+  uint32_t rr[kMaxLimbs];
+};
+
+// A P-256 public key, with the coordinates in Montgomery form.
+struct P256PublicKey {
+  uint32_t x[8];
+  uint32_t y[8];
+};
+
+// Prepares an RSA key from the big endian modulus and exponent.  Returns
+// false if the modulus is out of range or even, or the exponent doesn't fit
+// in 32 bits.
+bool PrepareRsaPublicKey(const uint8_t *modulus, size_t modulus_length,
+                         const uint8_t *exponent, size_t exponent_length,
+                         RsaPublicKey *key);
+
+// Prepares a P-256 key from the big endian affine coordinates.  Returns
+// false if the point is not on the curve.
+bool PrepareP256PublicKey(const uint8_t x[32], const uint8_t y[32],
+                          P256PublicKey *key);
+
+// Verifies an RS256 signature of a SHA-256 digest.
+bool VerifyRs256(const RsaPublicKey &key, const uint8_t digest[32],
+                 const uint8_t *signature, size_t signature_length);
+
+// Verifies an ES256 signature of a SHA-256 digest.  The signature is r || s
+// as 32 byte big endian numbers, the JWS encoding rather than DER.
+bool VerifyEs256(const P256PublicKey &key, const uint8_t digest[32],
+                 const uint8_t *signature, size_t signature_length);
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_SIGNATURE_H
@@ -0,0 +1,181 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "stats.h"
+
+#include <string.h>
+#include <atomic>
+
+// GoogleSignIn::kStatusCodeSuccessCached, kStatusCodeSuccess and
+// kStatusCodeError.
+#define STATUS_CODE_SUCCESS_CACHED -1
+#define STATUS_CODE_SUCCESS 0
+#define STATUS_CODE_ERROR 13
+
+// Number of shards.  Threads are spread over them round robin, only a few
+// threads ever record.
+#define STATS_SHARDS 8
+
+namespace googlesignin {
+
+const int SignInStats::kStatusBuckets;
+const int SignInStats::kStatusBucketOther;
+const int SignInStats::kLatencyBuckets;
+
+uint64_t SignInStats::Completed(Flow flow) const {
+  uint64_t total = 0;
+  for (int i = 0; i < kStatusBuckets; i++) {
+    total += completed[flow][i];
+  }
+  return total;
+}
+
+uint64_t SignInStats::Succeeded(Flow flow) const {
+  return completed[flow][StatusBucket(STATUS_CODE_SUCCESS)] +
+         completed[flow][StatusBucket(STATUS_CODE_SUCCESS_CACHED)];
+}
+
+double SignInStats::SuccessRatio(Flow flow) const {
+  uint64_t total = Completed(flow);
+  return total ? static_cast<double>(Succeeded(flow)) / total : 0;
+}
+
+uint64_t SignInStats::LatencyPercentileMs(Flow flow,
+                                          double percentile) const {
+  uint64_t total = 0;
+  for (int i = 0; i < kLatencyBuckets; i++) {
+    total += latency_ms[flow][i];
+  }
+  if (!total) {
+    return 0;
+  }
+  // The rank of the percentile, at least the first value.
+  uint64_t rank = static_cast<uint64_t>(percentile / 100 * total + 0.5);
+  rank = rank ? (rank < total ? rank : total) : 1;
+  uint64_t seen = 0;
+  for (int i = 0; i < kLatencyBuckets; i++) {
+    seen += latency_ms[flow][i];
+    if (seen >= rank) {
+      return i + 1 < kLatencyBuckets ? LatencyBucketLowerBound(i + 1) - 1
+                                     : LatencyBucketLowerBound(i);
+    }
+  }
+  return LatencyBucketLowerBound(kLatencyBuckets - 1);
+}
+
+int SignInStats::StatusBucket(int status) {
+  return status >= -1 && status < kStatusBucketOther - 1 ? status + 1
+                                                         : kStatusBucketOther;
+}
+
+int SignInStats::BucketStatus(int bucket) {
+  return bucket >= 0 && bucket < kStatusBucketOther ? bucket - 1
+                                                    : STATUS_CODE_ERROR;
+}
+
+// Values below 4 have a bucket each.  Above that, a value with its highest
+// set bit at position e is in bucket 4 * (e - 1) plus the next two bits.
+int SignInStats::LatencyBucket(uint64_t latency_ms) {
+  if (latency_ms < 4) {
+    return static_cast<int>(latency_ms);
+  }
+  int exponent = 63 - __builtin_clzll(latency_ms);
+  int bucket = 4 * (exponent - 1) +
+               static_cast<int>((latency_ms >> (exponent - 2)) & 3);
+  return bucket < kLatencyBuckets ? bucket : kLatencyBuckets - 1;
+}
+
+uint64_t SignInStats::LatencyBucketLowerBound(int bucket) {
+  if (bucket < 4) {
+    return static_cast<uint64_t>(bucket);
+  }
+  int exponent = bucket / 4 + 1;
+  return static_cast<uint64_t>(4 + bucket % 4) << (exponent - 2);
+}
+
+namespace {
+
+// The counters of one shard.  Aligned so shards never share a cache line.
+struct alignas(64) StatsShard {
+  std::atomic<uint64_t> started[SignInStats::kFlowCount];
+  std::atomic<uint64_t> completed[SignInStats::kFlowCount]
+                                 [SignInStats::kStatusBuckets];
+  std::atomic<uint64_t> latency_ms[SignInStats::kFlowCount]
+                                  [SignInStats::kLatencyBuckets];
+  std::atomic<uint64_t> jni_calls[SignInStats::kOpCount];
+  std::atomic<uint64_t> jni_bytes[SignInStats::kOpCount];
+};
+
+// Zero initialized, being static.
+StatsShard shards[STATS_SHARDS];
+
+StatsShard &ThreadShard() {
+  static std::atomic<uint32_t> next_shard(0);
+  static thread_local StatsShard *shard =
+      &shards[next_shard.fetch_add(1, std::memory_order_relaxed) %
+              STATS_SHARDS];
+  return *shard;
+}
+
+// Only the totals matter, so relaxed ordering is enough.
+inline void Add(std::atomic<uint64_t> *counter, uint64_t value) {
+  counter->fetch_add(value, std::memory_order_relaxed);
+}
+
+inline void Sum(const std::atomic<uint64_t> *counters, size_t count,
+                uint64_t *totals) {
+  for (size_t i = 0; i < count; i++) {
+    totals[i] += counters[i].load(std::memory_order_relaxed);
+  }
+}
+
+}  // namespace
+
+void StatsRecorder::RecordStart(SignInStats::Flow flow) {
+  Add(&ThreadShard().started[flow], 1);
+}
+
+void StatsRecorder::RecordCompletion(SignInStats::Flow flow, int status,
+                                     uint64_t latency_ms) {
+  StatsShard &shard = ThreadShard();
+  Add(&shard.completed[flow][SignInStats::StatusBucket(status)], 1);
+  Add(&shard.latency_ms[flow][SignInStats::LatencyBucket(latency_ms)], 1);
+}
+
+void StatsRecorder::RecordJni(SignInStats::Operation operation,
+                              uint32_t calls, uint64_t bytes) {
+  StatsShard &shard = ThreadShard();
+  Add(&shard.jni_calls[operation], calls);
+  if (bytes) {
+    Add(&shard.jni_bytes[operation], bytes);
+  }
+}
+
+void StatsRecorder::Snapshot(SignInStats *stats) {
+  memset(stats, 0, sizeof(*stats));
+  for (int i = 0; i < STATS_SHARDS; i++) {
+    const StatsShard &shard = shards[i];
+    Sum(shard.started, SignInStats::kFlowCount, stats->started);
+    for (int flow = 0; flow < SignInStats::kFlowCount; flow++) {
+      Sum(shard.completed[flow], SignInStats::kStatusBuckets,
+          stats->completed[flow]);
+      Sum(shard.latency_ms[flow], SignInStats::kLatencyBuckets,
+          stats->latency_ms[flow]);
+    }
+    Sum(shard.jni_calls, SignInStats::kOpCount, stats->jni_calls);
+    Sum(shard.jni_bytes, SignInStats::kOpCount, stats->jni_bytes);
+  }
+}
+
+}  // namespace googlesignin
@@ -0,0 +1,103 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_STATS_H
+#define GOOGLESIGNIN_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace googlesignin {
+
+// Counters of the sign-in requests and of the traffic over JNI, summed over
+// all the instances in the process since it started.  Returned by
+// GoogleSignIn::GetStats().
+struct SignInStats {
+  // How a sign-in was started.
+  enum Flow {
+    kFlowInteractive,  // SignIn()
+    kFlowSilent,       // SignInSilently(), including token refreshes.
+    kFlowCount
+  };
+
+  // The operations that call into Java or receive data from it.
+  enum Operation {
+    kOpConfigure,  // Sending the configuration or its request handle.
+    kOpSignIn,     // Starting a sign-in.
+    kOpResult,     // Receiving a result, through JNI or the event ring.
+    kOpOther,      // Sign-out, disconnect, warm-up and setup.
+    kOpCount
+  };
+
+  // Status codes -1 to 29 are counted in bucket status + 1, all the others
+  // in kStatusBucketOther.
+  static const int kStatusBuckets = 32;
+  static const int kStatusBucketOther = kStatusBuckets - 1;
+
+  // Latencies are counted in log-linear buckets: 4 per power of two, so each
+  // bucket is within 25% of the value, up to about 4.6 hours.
+  static const int kLatencyBuckets = 96;
+
+  // Sign-ins started, by flow.
+  uint64_t started[kFlowCount];
+  // Sign-ins completed, by flow and StatusBucket() of their status.
+  uint64_t completed[kFlowCount][kStatusBuckets];
+  // Time from starting a sign-in to its completion in milliseconds, by flow
+  // and LatencyBucket().
+  uint64_t latency_ms[kFlowCount][kLatencyBuckets];
+  // JNI calls made and bytes marshalled in either direction, by operation.
+  uint64_t jni_calls[kOpCount];
+  uint64_t jni_bytes[kOpCount];
+
+  // Returns the number of sign-ins completed by flow.
+  uint64_t Completed(Flow flow) const;
+  // Returns the number of sign-ins of flow that completed successfully,
+  // from the cache or not.
+  uint64_t Succeeded(Flow flow) const;
+  // Returns Succeeded() / Completed(), or 0 if none completed.
+  double SuccessRatio(Flow flow) const;
+  // Returns an upper bound of the given percentile, 0 to 100, of the
+  // latencies of flow.  0 if none completed.
+  uint64_t LatencyPercentileMs(Flow flow, double percentile) const;
+
+  // Maps a status code to its bucket in completed, and back.  The status of
+  // kStatusBucketOther is GoogleSignIn::kStatusCodeError.
+  static int StatusBucket(int status);
+  static int BucketStatus(int bucket);
+
+  // Maps a latency to its bucket in latency_ms, and returns the smallest
+  // latency counted in a bucket.
+  static int LatencyBucket(uint64_t latency_ms);
+  static uint64_t LatencyBucketLowerBound(int bucket);
+};
+
+// Records SignInStats.  Each thread adds to one of a few shards, each on its
+// own cache lines, so the threads recording (the UI thread and the game
+// thread) do not contend, and Snapshot() sums the shards without blocking
+// them.  All the methods can be called from any thread.
+class StatsRecorder {
+ public:
+  static void RecordStart(SignInStats::Flow flow);
+  static void RecordCompletion(SignInStats::Flow flow, int status,
+                               uint64_t latency_ms);
+  static void RecordJni(SignInStats::Operation operation, uint32_t calls,
+                        uint64_t bytes);
+
+  // Fills stats with the current totals.
+  static void Snapshot(SignInStats *stats);
+};
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_STATS_H
@@ -0,0 +1,123 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_TIMER_WHEEL_H
+#define GOOGLESIGNIN_TIMER_WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace googlesignin {
+
+// Hashed timer wheel.  Time is split into ticks and each timer is kept in
+// the slot of the tick it expires in, modulo the number of slots, so
+// scheduling only touches one slot and advancing only visits the slots of the
+// ticks that passed.  Timers further out than one turn of the wheel stay in
+// their slot until their deadline is reached.
+//
+// Time is whatever the caller passes in, typically Clock::NowMillis().  Not
+// thread safe.
+class TimerWheel {
+ public:
+  static const size_t kSlotCount = 256;
+
+  TimerWheel(int64_t tick_ms, int64_t now_ms)
+      : tick_ms_(tick_ms), current_tick_(now_ms / tick_ms), next_id_(1) {}
+
+  // Schedules a timer and returns its id, which is never 0.  A deadline in
+  // the past fires on the next call to Advance().
+  uint64_t Schedule(int64_t deadline_ms) {
+    int64_t tick = deadline_ms / tick_ms_;
+    if (tick < current_tick_) {
+      tick = current_tick_;
+    }
+    Timer timer = {next_id_++, deadline_ms};
+    SlotFor(tick).push_back(timer);
+    return timer.id;
+  }
+
+  // Cancels a timer.  Returns false if it already fired or was canceled.
+  bool Cancel(uint64_t id) {
+    for (size_t i = 0; i < kSlotCount; i++) {
+      std::vector<Timer> &slot = slots_[i];
+      for (size_t j = 0; j < slot.size(); j++) {
+        if (slot[j].id == id) {
+          slot[j] = slot.back();
+          slot.pop_back();
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  // Fires the timers whose deadline is at or before now_ms, calling
+  // fire(id) for each.  fire may schedule or cancel timers.
+  template <typename Fire>
+  void Advance(int64_t now_ms, Fire fire) {
+    std::vector<uint64_t> expired;
+    int64_t target = now_ms / tick_ms_;
+    if (target - current_tick_ >= static_cast<int64_t>(kSlotCount)) {
+      // More than a full turn passed, every slot has to be looked at.
+      for (size_t i = 0; i < kSlotCount; i++) {
+        TakeExpired(&slots_[i], now_ms, &expired);
+      }
+    } else {
+      for (int64_t tick = current_tick_; tick <= target; tick++) {
+        TakeExpired(&SlotFor(tick), now_ms, &expired);
+      }
+    }
+    // The current tick is visited again next time, it may hold timers
+    // later in the tick.
+    if (target > current_tick_) {
+      current_tick_ = target;
+    }
+    for (size_t i = 0; i < expired.size(); i++) {
+      fire(expired[i]);
+    }
+  }
+
+ private:
+  struct Timer {
+    uint64_t id;
+    int64_t deadline_ms;
+  };
+
+  std::vector<Timer> &SlotFor(int64_t tick) {
+    return slots_[static_cast<uint64_t>(tick) % kSlotCount];
+  }
+
+  static void TakeExpired(std::vector<Timer> *slot, int64_t now_ms,
+                          std::vector<uint64_t> *expired) {
+    for (size_t i = 0; i < slot->size();) {
+      if ((*slot)[i].deadline_ms <= now_ms) {
+        expired->push_back((*slot)[i].id);
+        (*slot)[i] = slot->back();
+        slot->pop_back();
+      } else {
+        i++;
+      }
+    }
+  }
+
+  std::vector<Timer> slots_[kSlotCount];
+  int64_t tick_ms_;
+  int64_t current_tick_;
+  uint64_t next_id_;
+};
+
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_TIMER_WHEEL_H
@@ -0,0 +1,166 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "trace.h"
+
+#if defined(GOOGLESIGNIN_TRACE)
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#endif
+
+namespace googlesignin {
+
+static const char *const kSpanNames[kTraceSpanCount] = {
+    "Request",      "Configure",      "SignInCall",   "FragmentAttach",
+    "BuildClient",  "AccountUi",      "SilentSignIn", "ActivityResult",
+    "ResultQueued", "ResultDecode",   "PollEvents",
+};
+
+const char *Trace::SpanName(TraceSpan span) {
+  return span >= 0 && span < kTraceSpanCount ? kSpanNames[span] : "Unknown";
+}
+
+#if defined(GOOGLESIGNIN_TRACE)
+
+namespace {
+
+// One event.  The fields are atomics so the exporter can read them while
+// the owning thread overwrites them, sequence tells it whether it did.  It
+// is odd while the slot is being written and 2 * (index + 1) once event
+// number index has been written.
+struct TraceSlot {
+  std::atomic<uint32_t> sequence;
+  std::atomic<uint64_t> time_ns;
+  std::atomic<int64_t> request;
+  // span | phase << 16
+  std::atomic<uint32_t> kind;
+};
+
+// The events of one thread.  Only that thread writes to it.  Rings are
+// never freed, there is one per thread that ever recorded an event.
+struct TraceRing {
+  explicit TraceRing(int32_t thread_id)
+      : tid(thread_id), count(0), next(nullptr) {
+    for (uint32_t i = 0; i < Trace::kRingSize; i++) {
+      slots[i].sequence.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  const int32_t tid;
+  // Number of events written so far.
+  std::atomic<uint32_t> count;
+  TraceRing *next;
+  TraceSlot slots[Trace::kRingSize];
+};
+
+std::atomic<TraceRing *> trace_rings(nullptr);
+
+uint64_t MonotonicNanos() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+TraceRing *ThreadRing() {
+  static thread_local TraceRing *ring = nullptr;
+  if (!ring) {
+    ring = new TraceRing(static_cast<int32_t>(syscall(__NR_gettid)));
+    TraceRing *head = trace_rings.load(std::memory_order_relaxed);
+    do {
+      ring->next = head;
+    } while (!trace_rings.compare_exchange_weak(head, ring,
+                                                std::memory_order_release,
+                                                std::memory_order_relaxed));
+  }
+  return ring;
+}
+
+}  // namespace
+
+void Trace::Record(TraceSpan span, TracePhase phase, int64_t request) {
+  TraceRing *ring = ThreadRing();
+  uint32_t index = ring->count.load(std::memory_order_relaxed);
+  TraceSlot &slot = ring->slots[index & (kRingSize - 1)];
+  slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.time_ns.store(MonotonicNanos(), std::memory_order_relaxed);
+  slot.request.store(request, std::memory_order_relaxed);
+  slot.kind.store(static_cast<uint32_t>(span) |
+                      static_cast<uint32_t>(phase) << 16,
+                  std::memory_order_relaxed);
+  slot.sequence.store(2 * (index + 1), std::memory_order_release);
+  ring->count.store(index + 1, std::memory_order_release);
+}
+
+void Trace::ExportChromeJson(std::string *out) {
+  out->assign("{\"traceEvents\":[");
+  bool first = true;
+  int pid = static_cast<int>(getpid());
+  char event[256];
+  for (TraceRing *ring = trace_rings.load(std::memory_order_acquire); ring;
+       ring = ring->next) {
+    uint32_t count = ring->count.load(std::memory_order_acquire);
+    uint32_t index = count > kRingSize ? count - kRingSize : 0;
+    for (; index != count; index++) {
+      const TraceSlot &slot = ring->slots[index & (kRingSize - 1)];
+      uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+      uint64_t time_ns = slot.time_ns.load(std::memory_order_relaxed);
+      int64_t request = slot.request.load(std::memory_order_relaxed);
+      uint32_t kind = slot.kind.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (sequence != 2 * (index + 1) ||
+          slot.sequence.load(std::memory_order_relaxed) != sequence) {
+        // Overwritten by the thread since count was read.
+        continue;
+      }
+
+      TraceSpan span = static_cast<TraceSpan>(kind & 0xffff);
+      char phase = static_cast<char>(kind >> 16);
+      // Async events are matched by id, instant ones are thread scoped.
+      char extra[32] = "";
+      if (phase == kTraceAsyncBegin || phase == kTraceAsyncEnd) {
+        snprintf(extra, sizeof(extra), ",\"id\":\"0x%llx\"",
+                 static_cast<unsigned long long>(request));
+      } else if (phase == kTraceInstant) {
+        snprintf(extra, sizeof(extra), ",\"s\":\"t\"");
+      }
+      snprintf(event, sizeof(event),
+               "%s{\"name\":\"%s\",\"cat\":\"signin\",\"ph\":\"%c\","
+               "\"ts\":%llu.%03u,\"pid\":%d,\"tid\":%d%s,"
+               "\"args\":{\"request\":%lld}}",
+               first ? "" : ",", SpanName(span), phase,
+               static_cast<unsigned long long>(time_ns / 1000),
+               static_cast<unsigned>(time_ns % 1000), pid, ring->tid,
+               extra, static_cast<long long>(request));
+      out->append(event);
+      first = false;
+    }
+  }
+  out->append("],\"displayTimeUnit\":\"ms\"}");
+}
+
+#else  // !defined(GOOGLESIGNIN_TRACE)
+
+void Trace::Record(TraceSpan span, TracePhase phase, int64_t request) {}
+
+void Trace::ExportChromeJson(std::string *out) {
+  out->assign("{\"traceEvents\":[]}");
+}
+
+#endif  // defined(GOOGLESIGNIN_TRACE)
+
+}  // namespace googlesignin
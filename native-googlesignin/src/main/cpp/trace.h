@@ -0,0 +1,125 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_TRACE_H
+#define GOOGLESIGNIN_TRACE_H
+
+#include <stdint.h>
+#include <string>
+
+// Tracing is compiled in only when GOOGLESIGNIN_TRACE is defined, see the
+// GOOGLESIGNIN_TRACE option in CMakeLists.txt.  Otherwise the macros below
+// expand to nothing and the export returns an empty trace.
+
+namespace googlesignin {
+
+// The traced stages of a sign-in.  The values are shared with the TRACE_
+// constants in GoogleSignInHelper.java, keep them in sync.
+enum TraceSpan {
+  // From SignIn() or SignInSilently() until the result is delivered.
+  kTraceRequest = 0,
+  // Marshalling the configuration and calling GoogleSignInHelper.configure.
+  kTraceConfigure = 1,
+  // The JNI call to GoogleSignInHelper.signIn or signInSilently.
+  kTraceSignInCall = 2,
+  // A request waiting for the fragment to be attached and resumed.
+  kTraceFragmentAttach = 3,
+  // Building the GoogleApiClient and starting its connection.
+  kTraceBuildClient = 4,
+  // The account picker and consent UI, until onActivityResult.
+  kTraceAccountUi = 5,
+  // A silent sign-in, including waiting for the client to connect.
+  kTraceSilentSignIn = 6,
+  // Handling the account UI result in onActivityResult.
+  kTraceActivityResult = 7,
+  // The Java helper passing a result to the native code.
+  kTraceResultQueued = 8,
+  // Reading the account and completing the future.
+  kTraceResultDecode = 9,
+  // One call of PollEvents().
+  kTracePollEvents = 10,
+  kTraceSpanCount
+};
+
+// Phases of an event, with the values used by the Chrome trace event format.
+// Begin and end events nest on their thread, async ones are matched by the
+// request and may begin and end on different threads.
+enum TracePhase {
+  kTraceBegin = 'B',
+  kTraceEnd = 'E',
+  kTraceAsyncBegin = 'b',
+  kTraceAsyncEnd = 'e',
+  kTraceInstant = 'i',
+};
+
+// Records timestamped trace events.  Each thread writes to its own fixed
+// size ring without locking, the oldest events of a thread are overwritten
+// once its ring is full.  The events can be exported from any thread while
+// they are being recorded.
+class Trace {
+ public:
+  // Events kept per thread, a power of two.
+  static const uint32_t kRingSize = 1024;
+
+  // Records an event for span.  request is the handle of the sign-in request
+  // the event belongs to, or 0.
+  static void Record(TraceSpan span, TracePhase phase, int64_t request);
+
+  // Replaces out with the recorded events in the Chrome trace event JSON
+  // format, which chrome://tracing and Perfetto load.
+  static void ExportChromeJson(std::string *out);
+
+  // Returns the name of span, as it appears in the trace.
+  static const char *SpanName(TraceSpan span);
+};
+
+// Records the begin event of span when constructed and its end event when
+// destroyed.
+class TraceScope {
+ public:
+  TraceScope(TraceSpan span, int64_t request)
+      : span_(span), request_(request) {
+    Trace::Record(span_, kTraceBegin, request_);
+  }
+  ~TraceScope() { Trace::Record(span_, kTraceEnd, request_); }
+
+ private:
+  TraceScope(const TraceScope &copy) = delete;
+  TraceScope &operator=(const TraceScope &copy) = delete;
+
+  TraceSpan span_;
+  int64_t request_;
+};
+
+}  // namespace googlesignin
+
+#if defined(GOOGLESIGNIN_TRACE)
+#define GOOGLESIGNIN_TRACE_CONCAT_(a, b) a##b
+#define GOOGLESIGNIN_TRACE_CONCAT(a, b) GOOGLESIGNIN_TRACE_CONCAT_(a, b)
+// Traces the rest of the enclosing block as span.
+#define GOOGLESIGNIN_TRACE_SCOPE(span, request)   \
+  ::googlesignin::TraceScope GOOGLESIGNIN_TRACE_CONCAT( \
+      trace_scope_, __LINE__)(span, request)
+#define GOOGLESIGNIN_TRACE_EVENT(span, phase, request) \
+  ::googlesignin::Trace::Record(span, phase, request)
+#else
+#define GOOGLESIGNIN_TRACE_SCOPE(span, request) \
+  do {                                          \
+  } while (0)
+#define GOOGLESIGNIN_TRACE_EVENT(span, phase, request) \
+  do {                                                 \
+  } while (0)
+#endif
+
+#endif  // GOOGLESIGNIN_TRACE_H
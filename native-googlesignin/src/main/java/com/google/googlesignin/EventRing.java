@@ -0,0 +1,117 @@
+/*
+ * Copyright 2017 Google Inc. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+package com.google.googlesignin;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * Ring buffer of events shared with the native code. The memory is a direct ByteBuffer allocated
+ * by the native code. Java is the only producer and the native code, draining the ring from the
+ * game loop, is the only consumer. The layout must match event_ring.h.
+ *
+ * <p>The first HEADER_SIZE bytes hold the write index and the read index (written by the native
+ * code) on separate cache lines. ByteBuffer stores have no ordering, so Java publishes the write
+ * index through GoogleSignInHelper.nativePublishEvents, which stores it with release semantics
+ * after the record. The indexes are free running byte counts, the offset into the data is the
+ * index modulo the capacity, which is a power of two. Each record is 8 byte aligned and starts with
+ * its size and type; a record that does not fit at the end of the data is preceded by a padding
+ * record filling the rest of it.
+ *
+ * <p>Next to the read index the native code stores when it last drained the ring, in the clock of
+ * System.nanoTime(). Once that is more than STALE_NANOS ago, writeResult refuses the record so the
+ * result is passed by calling the native code instead of waiting in a ring nobody drains.
+ */
+class EventRing {
+  // The write index is at offset 0, it is only written by the native code.
+  private static final int READ_INDEX_OFFSET = 64;
+  private static final int DRAIN_TIME_OFFSET = 72;
+  private static final int HEADER_SIZE = 128;
+
+  private static final int RECORD_PADDING = 0;
+  private static final int RECORD_RESULT = 1;
+
+  // size, type, handle, status, payload length.
+  private static final int RESULT_HEADER_SIZE = 24;
+
+  // How long the native code may go without draining before results stop being written to the
+  // ring, e.g. because the game loop is paused or the instance that polled was disposed.
+  private static final long STALE_NANOS = 1000000000L;
+
+  private final ByteBuffer buffer;
+  private final int capacity;
+  // Java is the only writer, so it keeps its own copy of the write index.
+  private int writeIndex;
+
+  EventRing(ByteBuffer buffer) {
+    this.buffer = buffer.order(ByteOrder.nativeOrder());
+    this.capacity = buffer.capacity() - HEADER_SIZE;
+  }
+
+  /**
+   * Writes a result record.
+   *
+   * @param handle Identifies the request.
+   * @param status Authentication result.
+   * @param account The account packed by GoogleSignInHelper.packAccount, or null.
+   * @return false if there is not enough room in the ring or the native code stopped draining it.
+   */
+  synchronized boolean writeResult(long handle, int status, byte[] account) {
+    if (System.nanoTime() - buffer.getLong(DRAIN_TIME_OFFSET) > STALE_NANOS) {
+      return false;
+    }
+    int payloadLength = account != null ? account.length : 0;
+    int size = align(RESULT_HEADER_SIZE + payloadLength);
+    if (size > capacity) {
+      return false;
+    }
+
+    // A stale read index only under-reports the free space.  The record is written only once the
+    // check below has passed, so it can't overwrite space the native code is still reading.
+    int readIndex = buffer.getInt(READ_INDEX_OFFSET);
+    int offset = writeIndex & (capacity - 1);
+    int tail = capacity - offset;
+    int needed = tail < size ? tail + size : size;
+    if (capacity - (writeIndex - readIndex) < needed) {
+      return false;
+    }
+
+    if (tail < size) {
+      buffer.putInt(HEADER_SIZE + offset, tail);
+      buffer.putInt(HEADER_SIZE + offset + 4, RECORD_PADDING);
+      offset = 0;
+    }
+
+    int pos = HEADER_SIZE + offset;
+    buffer.putInt(pos, size);
+    buffer.putInt(pos + 4, RECORD_RESULT);
+    buffer.putLong(pos + 8, handle);
+    buffer.putInt(pos + 16, status);
+    buffer.putInt(pos + 20, account != null ? account.length : -1);
+    if (account != null) {
+      buffer.position(pos + RESULT_HEADER_SIZE);
+      buffer.put(account);
+    }
+
+    writeIndex += needed;
+    GoogleSignInHelper.nativePublishEvents(writeIndex);
+    return true;
+  }
+
+  private static int align(int size) {
+    return (size + 7) & ~7;
+  }
+}
@@ -20,6 +20,7 @@ import android.app.Fragment;
 import android.app.FragmentTransaction;
 import android.content.Intent;
 import android.os.Bundle;
+import android.os.SystemClock;
 import android.support.annotation.NonNull;
 import android.support.annotation.Nullable;
 import android.view.View;
@@ -37,79 +38,89 @@ import com.google.android.gms.common.api.Scope;
 import java.lang.reflect.Field;
 import java.lang.reflect.InvocationTargetException;
 import java.lang.reflect.Method;
+import java.util.Iterator;
+import java.util.LinkedHashMap;
 import java.util.Locale;
+import java.util.Map;
+import java.util.concurrent.atomic.AtomicBoolean;
 
 /**
  * Activity fragment with no UI added to the parent activity in order to manage the accessing of the
  * player's email address and tokens.
  */
-public class GoogleSignInFragment extends Fragment implements
-        GoogleApiClient.ConnectionCallbacks,
-        GoogleApiClient.OnConnectionFailedListener {
+public class GoogleSignInFragment extends Fragment {
 
   // Tag uniquely identifying this fragment.
   public static final String FRAGMENT_TAG = "signin.SignInFragment";
   private static final int RC_SIGNIN = 9009;
 
   /**
-   * Handle the Google API Client connection being connected.
-   *
-   * @param connectionHint - is not used.
+   * Connection callbacks of one cached client. Every client keeps connecting or failing on its own,
+   * so events of a client other than mGoogleApiClient, e.g. an idle one or one a warm-up replaced,
+   * are ignored instead of being taken for the connection the current sign-in waits for.
    */
-  @Override
-  public void onConnected(@Nullable Bundle connectionHint) {
-    GoogleSignInHelper.logDebug("onConnected!");
-    if (mGoogleApiClient.hasConnectedApi(Auth.GOOGLE_SIGN_IN_API)) {
-      GoogleSignInHelper.logDebug("has connected auth!");
-      Auth.GoogleSignInApi.silentSignIn(mGoogleApiClient)
-          .setResultCallback(
-              new ResultCallback<GoogleSignInResult>() {
-                @Override
-                public void onResult(@NonNull GoogleSignInResult googleSignInResult) {
-                  if (googleSignInResult.isSuccess()) {
-                    GoogleSignInHelper.nativeOnResult(
-                        request.getHandle(),
-                        googleSignInResult.getStatus().getStatusCode(),
-                        googleSignInResult.getSignInAccount());
-                    setState(State.READY);
-                  } else {
-                    GoogleSignInHelper.logError(
-                        "Error with " + "silentSignIn: " + googleSignInResult.getStatus());
-                    GoogleSignInHelper.nativeOnResult(
-                        request.getHandle(),
-                        googleSignInResult.getStatus().getStatusCode(),
-                        googleSignInResult.getSignInAccount());
-                    setState(State.READY);
-                  }
-                }
-              });
-    } else {
-      Intent signInIntent = Auth.GoogleSignInApi.getSignInIntent(mGoogleApiClient);
-      startActivityForResult(signInIntent, RC_SIGNIN);
+  private final class ClientCallbacks
+      implements GoogleApiClient.ConnectionCallbacks, GoogleApiClient.OnConnectionFailedListener {
+    // Set once the client is built, before it connects.
+    private GoogleApiClient client;
+
+    @Override
+    public void onConnected(@Nullable Bundle connectionHint) {
+      if (client != mGoogleApiClient) {
+        GoogleSignInHelper.logDebug("Ignoring the connection of an idle client");
+        return;
+      }
+      GoogleSignInFragment.this.onConnected();
     }
-  }
 
-  @Override
-  public void onConnectionSuspended(int cause) {
-    GoogleSignInHelper.logDebug("onConnectionSuspended() called: " + cause);
+    @Override
+    public void onConnectionSuspended(int cause) {
+      GoogleSignInHelper.logDebug("onConnectionSuspended() called: " + cause);
+    }
+
+    @Override
+    public void onConnectionFailed(@NonNull ConnectionResult connectionResult) {
+      if (client != mGoogleApiClient) {
+        GoogleSignInHelper.logDebug(
+            "Ignoring the failed connection of an idle client: " + connectionResult.getErrorCode());
+        return;
+      }
+      GoogleSignInFragment.this.onConnectionFailed(connectionResult);
+    }
   }
 
+  /**
+   * Handle the Google API Client connection being connected. Starts the sign-in that processRequest
+   * left waiting for the connection; connections made by warmUp() have nothing to start.
+   */
+  private void onConnected() {
+    GoogleSignInHelper.logDebug("onConnected!");
+    if (getState() != State.BUSY || !awaitingConnection.getAndSet(false)) {
+      GoogleSignInHelper.logDebug("Client is warmed up");
+      return;
+    }
+    signIn(awaitingSilent);
+  }
 
-  @Override
-  public void onConnectionFailed(@NonNull ConnectionResult connectionResult) {
+  private void onConnectionFailed(ConnectionResult connectionResult) {
     // Handle errors during connection, such as Play Store not installed.
     GoogleSignInHelper.logError("Connection failed: " +
             connectionResult.getErrorCode());
+    if (getState() != State.BUSY || !awaitingConnection.getAndSet(false)) {
+      // A warm-up connection, the sign-in retries connecting when it is requested.
+      return;
+    }
     // if there is a resolution, just start the sign-in intent, which handles
     // the resolution logic.
     if (connectionResult.hasResolution()) {
       Intent signInIntent = Auth.GoogleSignInApi.getSignInIntent(mGoogleApiClient);
-      startActivityForResult(signInIntent, RC_SIGNIN);
+      startSignInActivity(signInIntent);
     } else {
-      GoogleSignInHelper.nativeOnResult(
+      GoogleSignInHelper.onResult(
               request.getHandle(),
               connectionResult.getErrorCode(),
               null);
+      setState(State.READY);
     }
   }
 
@@ -117,6 +128,7 @@ public class GoogleSignInFragment extends Fragment implements
 
     if (mGoogleApiClient != null) {
       mGoogleApiClient.disconnect();
+      evictIdleClients();
     }
   }
 
@@ -142,6 +154,45 @@ public class GoogleSignInFragment extends Fragment implements
 
   private GoogleApiClient mGoogleApiClient;
 
+  // The request whose options mGoogleApiClient was built with.
+  private TokenRequest clientRequest;
+
+  // Most clients kept in clientCache.  Apps rarely switch between more than a couple of
+  // configurations, e.g. with and without the games config.
+  private static final int MAX_CACHED_CLIENTS = 2;
+
+  // Clients built so far, keyed by TokenRequest.getOptionsKey() and in least recently used order.
+  // The least recently used client is disconnected when there are too many.
+  private final LinkedHashMap<String, GoogleApiClient> clientCache =
+      new LinkedHashMap<String, GoogleApiClient>(MAX_CACHED_CLIENTS + 1, 0.75f, true) {
+        @Override
+        protected boolean removeEldestEntry(Map.Entry<String, GoogleApiClient> eldest) {
+          if (size() <= MAX_CACHED_CLIENTS) {
+            return false;
+          }
+          GoogleSignInHelper.logDebug("Evicting least recently used client");
+          eldest.getValue().disconnect();
+          return true;
+        }
+      };
+
+  // The Games API and the extension hiding its popups, looked up with reflection on first use.
+  private static Api<? extends Api.ApiOptions.NotRequiredOptions> gamesApi;
+  private static GoogleSignInOptionsExtension gamesExtension;
+
+  // Request to warm up the client for once the fragment is attached.
+  private TokenRequest pendingWarmUp;
+
+  // Set while the current sign-in waits in processRequest for mGoogleApiClient to connect, and
+  // cleared by whichever of processRequest and onConnected starts it, so it starts exactly once.
+  private final AtomicBoolean awaitingConnection = new AtomicBoolean();
+
+  // Whether the sign-in waiting for the connection is silent.
+  private volatile boolean awaitingSilent;
+
+  // When the current sign-in was requested, to log how long dispatching it took.
+  private long signInRequestedAt;
+
   // TODO: make config async.
   private static GoogleSignInFragment theFragment;
 
@@ -194,6 +245,8 @@ public class GoogleSignInFragment extends Fragment implements
     clearRequest(true);
     if (mGoogleApiClient != null) {
       Auth.GoogleSignInApi.signOut(mGoogleApiClient);
+      // The other cached clients may still hold the signed out account.
+      evictIdleClients();
     }
   }
 
@@ -204,6 +257,7 @@ public class GoogleSignInFragment extends Fragment implements
    * @return true if the sign-in flow was started.
    */
   public boolean startSignIn() {
+    signInRequestedAt = SystemClock.elapsedRealtime();
     if (request == null) {
       GoogleSignInHelper.logError("Request not configured! Failing authenticate");
       return false;
@@ -238,6 +292,43 @@ public class GoogleSignInFragment extends Fragment implements
     return true;
   }
 
+  /**
+   * Builds and connects the API client for the options of the request ahead of a sign-in, so the
+   * sign-in only has to dispatch the intent. If the fragment is not attached yet, this is done once
+   * it is resumed. Nothing is done if a request is already in progress or the client was built with
+   * the same options.
+   *
+   * @param request - the request holding the options to build the client for.
+   */
+  public synchronized void warmUp(TokenRequest request) {
+    State current = getState();
+    if (current == State.BUSY || current == State.PENDING || current == State.PENDING_SILENT) {
+      GoogleSignInHelper.logDebug("Request in progress, not warming up");
+      return;
+    }
+    if (getActivity() == null || !isResumed()) {
+      GoogleSignInHelper.logDebug("Fragment not resumed yet, warming up later");
+      pendingWarmUp = request;
+      return;
+    }
+    pendingWarmUp = null;
+    if (mGoogleApiClient != null && request.hasSameOptions(clientRequest)) {
+      GoogleSignInHelper.logDebug("Client already warm");
+      return;
+    }
+    GoogleSignInHelper.trace(
+        GoogleSignInHelper.TRACE_BUILD_CLIENT, GoogleSignInHelper.TRACE_BEGIN, request.getHandle());
+    try {
+      buildClient(request);
+    } catch (Throwable throwable) {
+      // The sign-in will report the problem when it builds the client.
+      GoogleSignInHelper.logError("Warm up failed: " + throwable.getMessage());
+    } finally {
+      GoogleSignInHelper.trace(
+          GoogleSignInHelper.TRACE_BUILD_CLIENT, GoogleSignInHelper.TRACE_END, request.getHandle());
+    }
+  }
+
   /**
    * Indicates that the token request has been set and it is ready to be processed. The processing
    * can start once the fragment is attached to the activity and initialized.
@@ -246,9 +337,25 @@ public class GoogleSignInFragment extends Fragment implements
    */
   private void processWhenReady(boolean silent) {
     GoogleSignInHelper.logInfo("Fragment not initialized yet, " + "waiting to authenticate");
+    GoogleSignInHelper.trace(
+        GoogleSignInHelper.TRACE_FRAGMENT_ATTACH,
+        GoogleSignInHelper.TRACE_ASYNC_BEGIN,
+        requestHandle());
     setState(silent ? State.PENDING_SILENT : State.PENDING);
   }
 
+  /** Returns the handle of the current request, or 0 if there is none. */
+  private synchronized long requestHandle() {
+    return request != null ? request.getHandle() : 0;
+  }
+
+  /** Starts the account picker and consent UI, whose result is passed to onActivityResult. */
+  private void startSignInActivity(Intent signInIntent) {
+    GoogleSignInHelper.trace(
+        GoogleSignInHelper.TRACE_ACCOUNT_UI, GoogleSignInHelper.TRACE_ASYNC_BEGIN, requestHandle());
+    startActivityForResult(signInIntent, RC_SIGNIN);
+  }
+
   /**
    * Processes the token requests that are queued up. First checking that the google api client is
    * connected.
@@ -271,11 +378,11 @@ public class GoogleSignInFragment extends Fragment implements
                           GoogleSignInHelper.logDebug(
                                   String.format(
                                           Locale.getDefault(),
-                                          "Calling nativeOnResult: handle: %s, status: %d acct: %s",
+                                          "Calling onResult: handle: %s, status: %d acct: %s",
                                           tokenResult.getHandle(),
                                           tokenResult.getStatus().getStatusCode(),
                                           tokenResult.getAccount()));
-                          GoogleSignInHelper.nativeOnResult(
+                          GoogleSignInHelper.onResult(
                                   tokenResult.getHandle(),
                                   tokenResult.getStatus().getStatusCode(),
                                   tokenResult.getAccount());
@@ -283,44 +390,47 @@ public class GoogleSignInFragment extends Fragment implements
                         }
                       });
 
-      // Build the GoogleAPIClient
-      buildClient(request);
-
-      GoogleSignInHelper.logDebug(
-              " Has connected == " + mGoogleApiClient.hasConnectedApi(Auth.GOOGLE_SIGN_IN_API));
-      if (!mGoogleApiClient.hasConnectedApi(Auth.GOOGLE_SIGN_IN_API)) {
-
-        if (!silent) {
-          Intent signInIntent = Auth.GoogleSignInApi.getSignInIntent(mGoogleApiClient);
-          startActivityForResult(signInIntent, RC_SIGNIN);
-        } else {
-          Auth.GoogleSignInApi.silentSignIn(mGoogleApiClient)
-                  .setResultCallback(
-                          new ResultCallback<GoogleSignInResult>() {
-                            @Override
-                            public void onResult(@NonNull GoogleSignInResult googleSignInResult) {
-                              if (googleSignInResult.isSuccess()) {
-                                GoogleSignInHelper.nativeOnResult(
-                                        request.getHandle(),
-                                        googleSignInResult.getStatus().getStatusCode(),
-                                        googleSignInResult.getSignInAccount());
-                                setState(State.READY);
-                              } else {
-                                GoogleSignInHelper.logError(
-                                        "Error with " + "silentSignIn: " + googleSignInResult.getStatus());
-                                GoogleSignInHelper.nativeOnResult(
-                                        request.getHandle(),
-                                        googleSignInResult.getStatus().getStatusCode(),
-                                        googleSignInResult.getSignInAccount());
-                                setState(State.READY);
-                              }
-                            }
-                          });
+      // Build the GoogleAPIClient, unless one with the same options was built already.
+      if (mGoogleApiClient != null && request.hasSameOptions(clientRequest)) {
+        GoogleSignInHelper.logDebug("Reusing the warmed up client");
+        if (!mGoogleApiClient.isConnected() && !mGoogleApiClient.isConnecting()) {
+          mGoogleApiClient.connect(GoogleApiClient.SIGN_IN_MODE_OPTIONAL);
+        }
+      } else {
+        GoogleSignInHelper.trace(
+            GoogleSignInHelper.TRACE_BUILD_CLIENT,
+            GoogleSignInHelper.TRACE_BEGIN,
+            request.getHandle());
+        try {
+          buildClient(request);
+        } finally {
+          GoogleSignInHelper.trace(
+              GoogleSignInHelper.TRACE_BUILD_CLIENT,
+              GoogleSignInHelper.TRACE_END,
+              request.getHandle());
         }
       }
+
+      // A client that is connected already, e.g. by warmUp(), has no onConnected() to come, so the
+      // sign-in is started here.  Otherwise onConnected() starts it, unless the connection
+      // completes in between and both get here.
+      awaitingSilent = silent;
+      awaitingConnection.set(true);
+      GoogleSignInHelper.logDebug(" Is connected == " + mGoogleApiClient.isConnected());
+      if (mGoogleApiClient.isConnected() && awaitingConnection.getAndSet(false)) {
+        signIn(silent);
+      }
     } catch (Throwable throwable) {
       GoogleSignInHelper.logError("Exception caught! " + throwable.getMessage());
-      request.setResult(CommonStatusCodes.INTERNAL_ERROR, null);
+      // Completing the request may have cleared it already.
+      TokenRequest failed = request;
+      if (failed != null) {
+        failed.setResult(
+            throwable instanceof InvalidOptionsException
+                ? CommonStatusCodes.DEVELOPER_ERROR
+                : CommonStatusCodes.INTERNAL_ERROR,
+            null);
+      }
       return;
     }
 
@@ -328,11 +438,67 @@ public class GoogleSignInFragment extends Fragment implements
   }
 
   /**
-   * Builds the Google API Client based on the configuration in the request.
+   * Starts the sign-in of the current request on the connected mGoogleApiClient.
    *
-   * @param request - the request for a token.
+   * @param silent - true to sign in without showing any UI.
+   */
+  private void signIn(boolean silent) {
+    if (!silent) {
+      Intent signInIntent = Auth.GoogleSignInApi.getSignInIntent(mGoogleApiClient);
+      GoogleSignInHelper.logDebug(
+          "Dispatching the sign-in intent "
+              + (SystemClock.elapsedRealtime() - signInRequestedAt)
+              + "ms after the request");
+      startSignInActivity(signInIntent);
+      return;
+    }
+    GoogleSignInHelper.trace(
+        GoogleSignInHelper.TRACE_SILENT_SIGN_IN,
+        GoogleSignInHelper.TRACE_ASYNC_BEGIN,
+        request.getHandle());
+    Auth.GoogleSignInApi.silentSignIn(mGoogleApiClient)
+        .setResultCallback(
+            new ResultCallback<GoogleSignInResult>() {
+              @Override
+              public void onResult(@NonNull GoogleSignInResult googleSignInResult) {
+                GoogleSignInHelper.trace(
+                    GoogleSignInHelper.TRACE_SILENT_SIGN_IN,
+                    GoogleSignInHelper.TRACE_ASYNC_END,
+                    request.getHandle());
+                if (!googleSignInResult.isSuccess()) {
+                  GoogleSignInHelper.logError(
+                      "Error with " + "silentSignIn: " + googleSignInResult.getStatus());
+                }
+                GoogleSignInHelper.onResult(
+                    request.getHandle(),
+                    googleSignInResult.getStatus().getStatusCode(),
+                    googleSignInResult.getSignInAccount());
+                setState(State.READY);
+              }
+            });
+  }
+
+  /**
+   * Makes mGoogleApiClient a client for the options of the request and connects it. A client built
+   * earlier with the same options is reused from the cache. The request itself is not completed,
+   * errors are thrown for the caller to report.
+   *
+   * @param request - the request holding the options.
+   * @throws InvalidOptionsException if the options can't be used.
    */
   private void buildClient(TokenRequest request) {
+    String key = request.getOptionsKey();
+    GoogleApiClient cached = clientCache.get(key);
+    if (cached != null) {
+      GoogleSignInHelper.logDebug("Using cached client");
+      mGoogleApiClient = cached;
+      clientRequest = request;
+      if (!cached.isConnected() && !cached.isConnecting()) {
+        cached.connect(GoogleApiClient.SIGN_IN_MODE_OPTIONAL);
+      }
+      return;
+    }
+
     GoogleSignInOptions.Builder builder;
 
     if (request.getUseGamesConfig()) {
@@ -352,9 +518,7 @@ public class GoogleSignInFragment extends Fragment implements
                 + request.getWebClientId());
         builder.requestServerAuthCode(request.getWebClientId(), request.getForceRefresh());
       } else {
-        GoogleSignInHelper.logError("Web client ID is needed for Auth Code");
-        request.setResult(CommonStatusCodes.DEVELOPER_ERROR, null);
-        throw new IllegalStateException("Web client ID is needed for Auth Code");
+        throw new InvalidOptionsException("Web client ID is needed for Auth Code");
       }
     }
 
@@ -369,9 +533,7 @@ public class GoogleSignInFragment extends Fragment implements
 
         builder.requestIdToken(request.getWebClientId());
       } else {
-        GoogleSignInHelper.logError("Web client ID is needed for ID Token");
-        request.setResult(CommonStatusCodes.DEVELOPER_ERROR, null);
-        throw new IllegalStateException("Web client ID is needed for Auth Code");
+        throw new InvalidOptionsException("Web client ID is needed for ID Token");
       }
     }
     if (request.getScopes() != null) {
@@ -398,17 +560,19 @@ public class GoogleSignInFragment extends Fragment implements
 
     GoogleSignInOptions options = builder.build();
 
+    ClientCallbacks callbacks = new ClientCallbacks();
     GoogleApiClient.Builder clientBuilder =
-        new GoogleApiClient.Builder(getActivity()).addApi(Auth.GOOGLE_SIGN_IN_API, options);
+        new GoogleApiClient.Builder(getActivity())
+            .addApi(Auth.GOOGLE_SIGN_IN_API, options)
+            .addConnectionCallbacks(callbacks)
+            .addOnConnectionFailedListener(callbacks);
     if (request.getUseGamesConfig()) {
       GoogleSignInHelper.logDebug("Adding games API");
 
       try {
         clientBuilder.addApi(getGamesAPI());
       } catch (Exception e) {
-        GoogleSignInHelper.logError("Exception getting Games API: " + e.getMessage());
-        request.setResult(CommonStatusCodes.DEVELOPER_ERROR, null);
-        return;
+        throw new InvalidOptionsException("Games API is not available: " + e.getMessage());
       }
     }
     if (request.getHidePopups()) {
@@ -418,14 +582,33 @@ public class GoogleSignInFragment extends Fragment implements
       clientBuilder.setViewForPopups(invisible);
     }
     mGoogleApiClient = clientBuilder.build();
+    callbacks.client = mGoogleApiClient;
+    clientRequest = request;
+    clientCache.put(key, mGoogleApiClient);
     mGoogleApiClient.connect(GoogleApiClient.SIGN_IN_MODE_OPTIONAL);
   }
 
-  private Api<? extends Api.ApiOptions.NotRequiredOptions> getGamesAPI() {
+  /** Disconnects and forgets the cached clients other than mGoogleApiClient. */
+  private void evictIdleClients() {
+    Iterator<GoogleApiClient> clients = clientCache.values().iterator();
+    while (clients.hasNext()) {
+      GoogleApiClient client = clients.next();
+      if (client != mGoogleApiClient) {
+        client.disconnect();
+        clients.remove();
+      }
+    }
+  }
+
+  private static synchronized Api<? extends Api.ApiOptions.NotRequiredOptions> getGamesAPI() {
+    if (gamesApi != null) {
+      return gamesApi;
+    }
     try {
       Class<?> gamesClass = Class.forName("com" + ".google.android.gms.games.Games");
       Field apiField = gamesClass.getField("API");
-      return (Api<? extends Api.ApiOptions.NotRequiredOptions>) apiField.get(null);
+      gamesApi = (Api<? extends Api.ApiOptions.NotRequiredOptions>) apiField.get(null);
+      return gamesApi;
     } catch (ClassNotFoundException e) {
       throw new IllegalArgumentException("Games API requested, but " + "can't load Games class", e);
     } catch (NoSuchFieldException e) {
@@ -439,15 +622,18 @@ public class GoogleSignInFragment extends Fragment implements
 
   /**
    * Builds the games extension to hide popups using Reflection. This avoids the hard dependency on
-   * Games.
+   * Games. The extension is immutable, so it is built once per process.
    *
    * @return the extension, or throws InvalidArgumentException if games is requested, but not found.
    */
-  private GoogleSignInOptionsExtension getGamesExtension() {
+  private static synchronized GoogleSignInOptionsExtension getGamesExtension() {
+    if (gamesExtension != null) {
+      return gamesExtension;
+    }
     try {
       Class<?> gamesClass = Class.forName("com" + ".google.android.gms.games.Games$GamesOptions");
 
-      Method builderMethod = gamesClass.getMethod("builder()");
+      Method builderMethod = gamesClass.getMethod("builder");
 
       Object builder = builderMethod.invoke(null);
 
@@ -456,7 +642,8 @@ public class GoogleSignInFragment extends Fragment implements
       setter.invoke(builder, false);
 
       Method buildMethod = builder.getClass().getMethod("build");
-      return (GoogleSignInOptionsExtension) buildMethod.invoke(builder);
+      gamesExtension = (GoogleSignInOptionsExtension) buildMethod.invoke(builder);
+      return gamesExtension;
 
     } catch (ClassNotFoundException e) {
       throw new IllegalArgumentException(
@@ -498,14 +685,27 @@ public class GoogleSignInFragment extends Fragment implements
     super.onResume();
     if (getState() == State.PENDING) {
       GoogleSignInHelper.logDebug("State is pending, calling processRequest(false)");
+      GoogleSignInHelper.trace(
+          GoogleSignInHelper.TRACE_FRAGMENT_ATTACH,
+          GoogleSignInHelper.TRACE_ASYNC_END,
+          requestHandle());
       processRequest(false);
     } else if (getState() == State.PENDING_SILENT) {
       GoogleSignInHelper.logDebug("State is pending_silent, calling processRequest(true)");
+      GoogleSignInHelper.trace(
+          GoogleSignInHelper.TRACE_FRAGMENT_ATTACH,
+          GoogleSignInHelper.TRACE_ASYNC_END,
+          requestHandle());
       processRequest(true);
     } else {
       GoogleSignInHelper.logDebug("State is now ready");
       setState(State.READY);
+      TokenRequest warmUpRequest = pendingWarmUp;
+      if (warmUpRequest != null) {
+        warmUp(warmUpRequest);
+      }
     }
+    GoogleSignInHelper.onActivityResumed();
   }
 
   /**
@@ -523,6 +723,11 @@ public class GoogleSignInFragment extends Fragment implements
   public void onActivityResult(int requestCode, int resultCode, Intent data) {
     GoogleSignInHelper.logDebug("onActivityResult: " + requestCode + " " + resultCode);
     if (requestCode == RC_SIGNIN) {
+      long handle = requestHandle();
+      GoogleSignInHelper.trace(
+          GoogleSignInHelper.TRACE_ACCOUNT_UI, GoogleSignInHelper.TRACE_ASYNC_END, handle);
+      GoogleSignInHelper.trace(
+          GoogleSignInHelper.TRACE_ACTIVITY_RESULT, GoogleSignInHelper.TRACE_BEGIN, handle);
       GoogleSignInResult result = Auth.GoogleSignInApi.getSignInResultFromIntent(data);
       TokenRequest request = this.request;
       if (request != null) {
@@ -538,6 +743,8 @@ public class GoogleSignInFragment extends Fragment implements
       } else {
         GoogleSignInHelper.logError("Pending request is null, can't " + "return result!");
       }
+      GoogleSignInHelper.trace(
+          GoogleSignInHelper.TRACE_ACTIVITY_RESULT, GoogleSignInHelper.TRACE_END, handle);
       return;
     }
     super.onActivityResult(requestCode, resultCode, data);
@@ -551,4 +758,11 @@ public class GoogleSignInFragment extends Fragment implements
     request = null;
     setState(getActivity() != null ? State.READY : State.NEW);
   }
+
+  /** Thrown by buildClient when the options of a request can't be used, a DEVELOPER_ERROR. */
+  private static final class InvalidOptionsException extends IllegalStateException {
+    InvalidOptionsException(String message) {
+      super(message);
+    }
+  }
 }
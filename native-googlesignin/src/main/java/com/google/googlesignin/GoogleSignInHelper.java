@@ -16,9 +16,12 @@
 package com.google.googlesignin;
 
 import android.app.Activity;
+import android.net.Uri;
 import android.util.Log;
 import com.google.android.gms.auth.api.signin.GoogleSignInAccount;
 import com.google.android.gms.common.api.CommonStatusCodes;
+import java.nio.ByteBuffer;
+import java.nio.charset.Charset;
 
 /**
  * Helper class used by the native C++ code to interact with Google Sign-in API. The general flow is
@@ -29,6 +32,35 @@ public class GoogleSignInHelper {
   // Set to true to get more debug logging.
   public static boolean loggingEnabled = false;
   private static final String TAG = "SignInFragment";
+  private static final Charset UTF8 = Charset.forName("UTF-8");
+
+  // The last valid request passed to configure, used by resubmitConfiguration, and the fingerprint
+  // the native code computed for its configuration.  They are process wide while each native
+  // GoogleSignIn instance has its own configuration, so a resubmit is only accepted for the
+  // fingerprint that was last configured.  Both are guarded by the class lock.
+  private static TokenRequest lastRequest;
+  private static long lastFingerprint;
+
+  // Ring used to pass results to the native code, if the native code is polling for them.
+  private static volatile EventRing eventRing;
+
+  // Traced stages of a sign-in, must match TraceSpan in trace.h.
+  static final int TRACE_FRAGMENT_ATTACH = 3;
+  static final int TRACE_BUILD_CLIENT = 4;
+  static final int TRACE_ACCOUNT_UI = 5;
+  static final int TRACE_SILENT_SIGN_IN = 6;
+  static final int TRACE_ACTIVITY_RESULT = 7;
+  static final int TRACE_RESULT_QUEUED = 8;
+
+  // Trace event phases, must match TracePhase in trace.h.
+  static final int TRACE_BEGIN = 'B';
+  static final int TRACE_END = 'E';
+  static final int TRACE_ASYNC_BEGIN = 'b';
+  static final int TRACE_ASYNC_END = 'e';
+  static final int TRACE_INSTANT = 'i';
+
+  // Set by the native code when it is built with tracing.
+  private static volatile boolean tracingEnabled = false;
 
   /**
    * Enables verbose logging
@@ -53,6 +85,8 @@ public class GoogleSignInHelper {
    *     This only has affect if useGamesConfig is true.
    * @param defaultAccountName - the account name to attempt to default to when signing in.
    * @param additionalScopes - additional API scopes to request when authenticating.
+   * @param configurationFingerprint - hash of the configuration computed by the native code, passed
+   *     back to resubmitConfiguration.
    * @param requestHandle - the handle to this request, created by the native C++ code, this is used
    *     to correlate the response with the request.
    */
@@ -67,6 +101,7 @@ public class GoogleSignInHelper {
       boolean hideUiPopups,
       String defaultAccountName,
       String[] additionalScopes,
+      long configurationFingerprint,
       long requestHandle) {
     logDebug("TokenFragment.configure called");
     TokenRequest request =
@@ -85,12 +120,83 @@ public class GoogleSignInHelper {
     GoogleSignInFragment fragment = GoogleSignInFragment.getInstance(parentActivity);
 
     if (request.isValid()) {
+      setLastRequest(request, configurationFingerprint);
       if (!fragment.submitRequest(request)) {
         logError("There is already a pending" + " authentication token request!");
       }
     } else {
-      nativeOnResult(requestHandle, CommonStatusCodes.DEVELOPER_ERROR, null);
+      setLastRequest(null, 0);
+      onResult(requestHandle, CommonStatusCodes.DEVELOPER_ERROR, null);
+    }
+  }
+
+  private static synchronized void setLastRequest(TokenRequest request, long fingerprint) {
+    lastRequest = request;
+    lastFingerprint = fingerprint;
+  }
+
+  private static synchronized TokenRequest getLastRequest() {
+    return lastRequest;
+  }
+
+  /**
+   * Returns the last request with a new handle, or null if the last configuration is not the one
+   * with configurationFingerprint.
+   */
+  private static synchronized TokenRequest renewLastRequest(
+      long configurationFingerprint, long requestHandle) {
+    if (lastRequest == null || lastFingerprint != configurationFingerprint) {
+      return null;
     }
+    lastRequest = lastRequest.withHandle(requestHandle);
+    return lastRequest;
+  }
+
+  /**
+   * Submits a new request using the configuration from the last call to configure. This lets the
+   * native code skip marshalling the configuration again when it has not changed.
+   *
+   * @param parentActivity - the parent activity.
+   * @param configurationFingerprint - the fingerprint passed to configure for the configuration.
+   * @param requestHandle - the handle to this request, created by the native C++ code.
+   * @return true if the request was submitted, false if the last configuration is not the one with
+   *     this fingerprint, e.g. another instance configured since, and configure must be called.
+   */
+  public static boolean resubmitConfiguration(
+      Activity parentActivity, long configurationFingerprint, long requestHandle) {
+    TokenRequest request = renewLastRequest(configurationFingerprint, requestHandle);
+    if (request == null) {
+      return false;
+    }
+    logDebug("TokenFragment.resubmitConfiguration called");
+    GoogleSignInFragment fragment = GoogleSignInFragment.getInstance(parentActivity);
+    if (!fragment.submitRequest(request)) {
+      logError("There is already a pending" + " authentication token request!");
+    }
+    return true;
+  }
+
+  /**
+   * Builds and connects the API client for the configuration from the last call to configure, so a
+   * later sign-in only has to dispatch the intent. The work is done on the UI thread.
+   *
+   * @param parentActivity - the parent activity.
+   * @return true if the warm up was posted, false if there is no configuration to warm up for.
+   */
+  public static boolean warmUp(final Activity parentActivity) {
+    final TokenRequest request = getLastRequest();
+    if (request == null) {
+      return false;
+    }
+    logDebug("TokenFragment.warmUp called");
+    parentActivity.runOnUiThread(
+        new Runnable() {
+          @Override
+          public void run() {
+            GoogleSignInFragment.getInstance(parentActivity).warmUp(request);
+          }
+        });
+    return true;
   }
 
   public static void signIn(Activity activity, long requestHandle) {
@@ -98,7 +204,7 @@ public class GoogleSignInHelper {
     GoogleSignInFragment fragment = GoogleSignInFragment.getInstance(activity);
 
     if (!fragment.startSignIn()) {
-      nativeOnResult(requestHandle, CommonStatusCodes.DEVELOPER_ERROR, null);
+      onResult(requestHandle, CommonStatusCodes.DEVELOPER_ERROR, null);
     }
   }
 
@@ -107,7 +213,7 @@ public class GoogleSignInHelper {
     GoogleSignInFragment fragment = GoogleSignInFragment.getInstance(activity);
 
     if (!fragment.startSignInSilently()) {
-      nativeOnResult(requestHandle, CommonStatusCodes.DEVELOPER_ERROR, null);
+      onResult(requestHandle, CommonStatusCodes.DEVELOPER_ERROR, null);
     }
   }
 
@@ -121,6 +227,24 @@ public class GoogleSignInHelper {
     fragment.disconnect();
   }
 
+  /** Enables recording trace events, called by the native code when it is built with tracing. */
+  public static void enableTracing(boolean flag) {
+    tracingEnabled = flag;
+  }
+
+  /**
+   * Records a trace event in the native trace recorder, if tracing is enabled.
+   *
+   * @param span - one of the TRACE_ stage constants.
+   * @param phase - one of the TRACE_ phase constants.
+   * @param handle - the handle of the request the event belongs to.
+   */
+  static void trace(int span, int phase, long handle) {
+    if (tracingEnabled) {
+      nativeTraceEvent(span, phase, handle);
+    }
+  }
+
   public static void logInfo(String msg) {
     if (loggingEnabled) {
       Log.i(TAG, msg);
@@ -137,6 +261,90 @@ public class GoogleSignInHelper {
     }
   }
 
+  /**
+   * Packs the fields of the account into a single array so the native code can read all of them with
+   * one JNI call instead of one call per getter. Each field is written as a big-endian int length
+   * followed by that many UTF-8 bytes, a length of -1 means the value is null. The field order is
+   * display name, email, family name, given name, id, id token, photo url, server auth code.
+   *
+   * @param acct The account to pack.
+   * @return the packed fields, or null if acct is null.
+   */
+  public static byte[] packAccount(GoogleSignInAccount acct) {
+    if (acct == null) {
+      return null;
+    }
+    Uri photoUrl = acct.getPhotoUrl();
+    byte[][] fields = {
+      getUtf8Bytes(acct.getDisplayName()),
+      getUtf8Bytes(acct.getEmail()),
+      getUtf8Bytes(acct.getFamilyName()),
+      getUtf8Bytes(acct.getGivenName()),
+      getUtf8Bytes(acct.getId()),
+      getUtf8Bytes(acct.getIdToken()),
+      getUtf8Bytes(photoUrl != null ? photoUrl.toString() : null),
+      getUtf8Bytes(acct.getServerAuthCode())
+    };
+
+    int size = 0;
+    for (byte[] field : fields) {
+      size += 4 + (field != null ? field.length : 0);
+    }
+    ByteBuffer packed = ByteBuffer.allocate(size);
+    for (byte[] field : fields) {
+      if (field != null) {
+        packed.putInt(field.length);
+        packed.put(field);
+      } else {
+        packed.putInt(-1);
+      }
+    }
+    return packed.array();
+  }
+
+  private static byte[] getUtf8Bytes(String value) {
+    return value != null ? value.getBytes(UTF8) : null;
+  }
+
+  /**
+   * Sets the ring buffer used to pass results to the native code. This is called by the native code
+   * the first time it polls for events. Until then results are passed by calling nativeOnResult.
+   *
+   * @param buffer - the direct buffer shared with the native code, or null to stop using it.
+   */
+  public static void setEventRing(ByteBuffer buffer) {
+    eventRing = buffer != null ? new EventRing(buffer) : null;
+  }
+
+  /**
+   * Passes the authentication result to the native code. If the native code is polling, and drained
+   * the event ring recently, the result is written to the ring and decoded on the polling thread,
+   * otherwise nativeOnResult is called directly.
+   *
+   * @param handle Identifies the request.
+   * @param result Authentication result.
+   * @param acct The account that is signed in, if successful.
+   */
+  public static void onResult(long handle, int result, GoogleSignInAccount acct) {
+    trace(TRACE_RESULT_QUEUED, TRACE_INSTANT, handle);
+    EventRing ring = eventRing;
+    if (ring == null || !ring.writeResult(handle, result, packAccount(acct))) {
+      nativeOnResult(handle, result, acct);
+    }
+  }
+
+  /**
+   * Tells the native code that the activity resumed, so it can refresh an ID token that is about to
+   * expire.
+   */
+  public static void onActivityResumed() {
+    try {
+      nativeOnActivityResumed();
+    } catch (UnsatisfiedLinkError e) {
+      logDebug("Native resume callback is not registered");
+    }
+  }
+
   /**
    * Native callback for the authentication result.
    *
@@ -145,4 +353,23 @@ public class GoogleSignInHelper {
    * @param acct The account that is signed in, if successful.
    */
   public static native void nativeOnResult(long handle, int result, GoogleSignInAccount acct);
+
+  /** Native callback for the activity being resumed. */
+  public static native void nativeOnActivityResumed();
+
+  /**
+   * Native callback recording a trace event.
+   *
+   * @param span Identifies the traced stage.
+   * @param phase The phase of the event.
+   * @param handle Identifies the request.
+   */
+  public static native void nativeTraceEvent(int span, int phase, long handle);
+
+  /**
+   * Native callback publishing the records written to the event ring up to writeIndex.
+   *
+   * @param writeIndex The new write index of the ring.
+   */
+  static native void nativePublishEvents(int writeIndex);
 }
@@ -17,6 +17,7 @@ package com.google.googlesignin;
 
 import com.google.android.gms.auth.api.signin.GoogleSignInAccount;
 import com.google.android.gms.common.api.PendingResult;
+import java.util.Arrays;
 import java.util.Locale;
 
 /** Helper class containing the request for information. */
@@ -32,6 +33,8 @@ public class TokenRequest {
   private String accountName;
   private String[] scopes;
   private long handle;
+  // Canonical form of the options, built by getOptionsKey() when first needed.
+  private String optionsKey;
 
   /**
    * Constructs a token request.
@@ -79,6 +82,78 @@ public class TokenRequest {
     }
   }
 
+  /**
+   * Returns a new request with the same configuration as this one, but a new handle and pending
+   * response.
+   *
+   * @param requestHandle - the handle of the new request.
+   * @return the new request.
+   */
+  public TokenRequest withHandle(long requestHandle) {
+    return new TokenRequest(
+        useGamesConfig,
+        webClientId,
+        doAuthCode,
+        forceRefresh,
+        doEmail,
+        doIdToken,
+        hidePopups,
+        accountName,
+        scopes,
+        requestHandle);
+  }
+
+  /**
+   * Returns true if other builds the same sign-in options and API client as this request, that is
+   * only the handles differ.
+   *
+   * @param other - the request to compare with, may be null.
+   * @return true if the options are the same.
+   */
+  public boolean hasSameOptions(TokenRequest other) {
+    return other != null && getOptionsKey().equals(other.getOptionsKey());
+  }
+
+  /**
+   * Returns a canonical string of the options that go into the sign-in options and API client,
+   * every option except the handle. Requests with equal keys can share a client. The scopes are
+   * sorted, so their order does not matter.
+   *
+   * @return the key.
+   */
+  public synchronized String getOptionsKey() {
+    if (optionsKey == null) {
+      StringBuilder key = new StringBuilder();
+      key.append(useGamesConfig ? 'g' : '-')
+          .append(doAuthCode ? 'a' : '-')
+          .append(forceRefresh ? 'f' : '-')
+          .append(doEmail ? 'e' : '-')
+          .append(doIdToken ? 'i' : '-')
+          .append(hidePopups ? 'h' : '-');
+      appendKeyString(key, getWebClientId());
+      appendKeyString(key, accountName);
+      if (scopes != null) {
+        String[] sorted = scopes.clone();
+        Arrays.sort(sorted);
+        for (String scope : sorted) {
+          appendKeyString(key, scope);
+        }
+      }
+      optionsKey = key.toString();
+    }
+    return optionsKey;
+  }
+
+  // Strings are prefixed with their length so adjacent values can't run together.  Null is
+  // written as -1 to tell it apart from "".
+  private static void appendKeyString(StringBuilder key, String value) {
+    if (value == null) {
+      key.append("|-1:");
+    } else {
+      key.append('|').append(value.length()).append(':').append(value);
+    }
+  }
+
   /**
    * Returns the pending response object for this request.
    *
@@ -0,0 +1,194 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "google_signin_bridge.h"
+#include "plugin_test.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+// The number of request slots, MAX_OUTSTANDING_REQUESTS in google_signin.cc.
+const int kRequestSlots = 16;
+
+class BridgeTest : public PluginTest {
+ protected:
+  // Signs in with account and waits for the result.
+  GoogleSignInFuture_t SignIn(const FakeAccount &account) {
+    helper_.RespondWith(account, 0);
+    GoogleSignInFuture_t future = GoogleSignIn_SignIn(plugin_);
+    EXPECT_TRUE(GoogleSignIn_Wait(future, 10000));
+    return future;
+  }
+
+  static FakeAccount AccountWithEmail(const std::string &email) {
+    FakeAccount account = FakeAccount::Default();
+    account.email = email;
+    return account;
+  }
+};
+
+TEST_F(BridgeTest, ResultViewMatchesStatusAndUser) {
+  GoogleSignInFuture_t future = SignIn(FakeAccount::Default());
+  GoogleSignInResultView view;
+  EXPECT_FALSE(GoogleSignIn_GetResultView(future, &view));
+  EXPECT_EQ(0, view.pending);
+  EXPECT_EQ(GoogleSignIn_Status(future), view.status);
+  ASSERT_EQ(1, view.has_user);
+  EXPECT_EQ(FakeAccount::Default().email,
+            std::string(view.user.email, view.user.email_len));
+}
+
+// The view points into the request slot of the future, which is reused
+// once every other slot has been handed out.
+TEST_F(BridgeTest, ResultViewIsValidUntilTheSlotIsReused) {
+  GoogleSignInFuture_t first = SignIn(AccountWithEmail("first@example.com"));
+  GoogleSignInResultView view;
+  GoogleSignIn_GetResultView(first, &view);
+  ASSERT_EQ(1, view.has_user);
+  const char *email = view.user.email;
+  GoogleSignInUser_t user = GoogleSignIn_Result(first);
+
+  for (int i = 1; i < kRequestSlots; i++) {
+    SignIn(AccountWithEmail("other@example.com"));
+  }
+  EXPECT_STREQ("first@example.com", email);
+  GoogleSignIn_GetResultView(first, &view);
+  EXPECT_EQ("first@example.com",
+            std::string(view.user.email, view.user.email_len));
+
+  // The next request takes the slot over.
+  SignIn(AccountWithEmail("reused@example.com"));
+  GoogleSignIn_GetResultView(first, &view);
+  EXPECT_EQ("reused@example.com",
+            std::string(view.user.email, view.user.email_len));
+
+  // A user handle is kept alive by its own reference.
+  char buf[64];
+  GoogleSignIn_GetEmail(user, buf, sizeof(buf));
+  EXPECT_STREQ("first@example.com", buf);
+  GoogleSignIn_ReleaseUser(user);
+}
+
+// Java keeps one configuration for the whole process, so an instance must
+// not resubmit it after another instance has sent its own.
+TEST_F(BridgeTest, ResubmitIsRefusedAfterAnotherInstanceConfigures) {
+  std::mutex mutex;
+  std::vector<std::string> client_ids;
+  helper_.SetResponder([&](const FakeRequest &request, bool silent) {
+    std::lock_guard<std::mutex> lock(mutex);
+    client_ids.push_back(request.web_client_id);
+    FakeResponse response = {kFakeSuccess, nullptr, 0};
+    return response;
+  });
+  const char kOtherClientId[] = "other.apps.googleusercontent.com";
+  GoogleSignIn_t other = GoogleSignIn_Create(helper_.activity());
+  GoogleSignIn_Configure(other, false, kOtherClientId, false, false, true,
+                         true, false, nullptr, 0, nullptr);
+
+  FakeSignInHelper::Counters before = helper_.counters();
+  EXPECT_TRUE(GoogleSignIn_Wait(GoogleSignIn_SignIn(plugin_), 10000));
+  EXPECT_TRUE(GoogleSignIn_Wait(GoogleSignIn_SignIn(other), 10000));
+  EXPECT_TRUE(GoogleSignIn_Wait(GoogleSignIn_SignIn(plugin_), 10000));
+  // Unchanged configurations are still only resubmitted.
+  EXPECT_TRUE(GoogleSignIn_Wait(GoogleSignIn_SignIn(plugin_), 10000));
+  FakeSignInHelper::Counters after = helper_.counters();
+
+  std::vector<std::string> expected = {kWebClientId, kOtherClientId,
+                                       kWebClientId, kWebClientId};
+  EXPECT_EQ(expected, client_ids);
+  // Each of the first three signs in with the configuration the other
+  // instance replaced, so it is sent again after Java refuses the resubmit.
+  EXPECT_EQ(3u, after.configure - before.configure);
+  EXPECT_EQ(4u, after.resubmit - before.resubmit);
+
+  helper_.WaitIdle();
+  GoogleSignIn_Dispose(other);
+}
+
+// Once polled, results come through the event ring: the fake Java threads
+// write them and publish the write index through nativePublishEvents, and
+// PollEvents() drains them on this thread.  Enough results are written to
+// wrap around the ring several times.
+TEST_F(BridgeTest, ResultsAreDrainedFromTheEventRing) {
+  const int kSignIns = 300;
+  GoogleSignIn_PollEvents(plugin_);
+  FakeAccount account = FakeAccount::Default();
+  for (int i = 0; i < kSignIns; i++) {
+    account.email = "user" + std::to_string(i) + "@example.com";
+    helper_.RespondWith(account, i % 4 == 0 ? 100 : 0);
+    GoogleSignInFuture_t future = GoogleSignIn_SignIn(plugin_);
+    while (GoogleSignIn_Pending(future)) {
+      GoogleSignIn_PollEvents(plugin_);
+      std::this_thread::yield();
+    }
+    ASSERT_EQ(0, GoogleSignIn_Status(future)) << "sign-in " << i;
+    GoogleSignInResultView view;
+    GoogleSignIn_GetResultView(future, &view);
+    ASSERT_EQ(1, view.has_user);
+    EXPECT_EQ(account.email,
+              std::string(view.user.email, view.user.email_len));
+  }
+  EXPECT_EQ(static_cast<uint64_t>(kSignIns),
+            helper_.counters().results_in_ring);
+}
+
+// A Wait() on the polling thread drains the ring itself, instead of blocking
+// the only thread that would.  The result of an instance that never polls is
+// completed through the ring as well.
+TEST_F(BridgeTest, WaitOnThePollingThreadDrainsTheEventRing) {
+  GoogleSignIn_t other = GoogleSignIn_Create(helper_.activity());
+  GoogleSignIn_Configure(other, false, kWebClientId, false, false, true, true,
+                         false, nullptr, 0, nullptr);
+  GoogleSignIn_PollEvents(plugin_);
+  helper_.RespondWith(FakeAccount::Default(), 1000);
+
+  EXPECT_TRUE(GoogleSignIn_Wait(GoogleSignIn_SignIn(plugin_), 10000));
+  EXPECT_TRUE(GoogleSignIn_Wait(GoogleSignIn_SignIn(other), 10000));
+  EXPECT_TRUE(GoogleSignIn_Wait(GoogleSignIn_SignIn(plugin_), -1));
+  EXPECT_EQ(3u, helper_.counters().results_in_ring);
+  EXPECT_EQ(0u, helper_.counters().results_by_call);
+
+  helper_.WaitIdle();
+  GoogleSignIn_Dispose(other);
+}
+
+// Once the ring has not been drained for a second, results are passed by
+// calling nativeOnResult again, so waiting on another thread completes.
+TEST_F(BridgeTest, ResultsAreCalledBackOnceTheEventRingIsNotDrained) {
+  GoogleSignIn_PollEvents(plugin_);
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+  GoogleSignInFuture_t future = GoogleSignIn_SignIn(plugin_);
+  bool completed = false;
+  std::thread waiter(
+      [future, &completed] { completed = GoogleSignIn_Wait(future, 10000); });
+  waiter.join();
+  EXPECT_TRUE(completed);
+  EXPECT_EQ(0u, helper_.counters().results_in_ring);
+  EXPECT_EQ(1u, helper_.counters().results_by_call);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
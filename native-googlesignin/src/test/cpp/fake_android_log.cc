@@ -0,0 +1,54 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// The NDK log functions for the host build.  Messages are dropped unless
+// GOOGLESIGNIN_TEST_LOG is set in the environment, then they go to stderr.
+
+#include <android/log.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace {
+
+bool LogEnabled() {
+  static const bool enabled = getenv("GOOGLESIGNIN_TEST_LOG") != nullptr;
+  return enabled;
+}
+
+char PriorityLetter(int prio) {
+  static const char kLetters[] = "??VDIWEFS";
+  return prio >= 0 && prio <= ANDROID_LOG_SILENT ? kLetters[prio] : '?';
+}
+
+}  // namespace
+
+extern "C" {
+
+int __android_log_write(int prio, const char *tag, const char *text) {
+  if (!LogEnabled()) return 0;
+  return fprintf(stderr, "%c/%s: %s\n", PriorityLetter(prio), tag, text);
+}
+
+int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+  if (!LogEnabled()) return 0;
+  char text[1024];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(text, sizeof(text), fmt, args);
+  va_end(args);
+  return __android_log_write(prio, tag, text);
+}
+
+}  // extern "C"
@@ -0,0 +1,1072 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "fake_jvm.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+namespace googlesignin {
+namespace test {
+
+namespace {
+
+const uint32_t kRefMagic = 0x6a726566;  // "jref"
+
+enum RefKind { kLocalRef, kGlobalRef };
+
+struct FakeEnv;
+
+// What a jobject points to.
+struct FakeRef {
+  uint32_t magic;
+  RefKind kind;
+  FakeObject *object;
+  // The env a local reference belongs to.
+  FakeEnv *owner;
+};
+
+// The JNIEnv of an attached thread.  env must be the first member, the
+// JNIEnv pointer handed out is a pointer to it.
+struct FakeEnv {
+  JNIEnv env;
+  bool java_thread;
+  FakeObject *exception;
+  // Local references, null once deleted, and where each frame starts.
+  std::vector<FakeRef *> locals;
+  std::vector<size_t> frames;
+  size_t live_locals;
+};
+
+thread_local FakeEnv *t_env = nullptr;
+
+struct FakeMethod {
+  FakeClass *clazz;
+  std::string name;
+  std::string sig;
+  bool is_static;
+  FakeMethodHandler handler;
+  // The type character of each parameter, and of the return value.
+  std::string params;
+  char ret;
+};
+
+void Abort(const char *format, ...) __attribute__((format(printf, 1, 2)))
+    __attribute__((noreturn));
+
+void Abort(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  fputs("fake JNI: ", stderr);
+  vfprintf(stderr, format, args);
+  fputs("\n", stderr);
+  va_end(args);
+  abort();
+}
+
+// Parses "(IJLjava/lang/String;[B)V" into "IJL[" and 'V'.
+void ParseSignature(const std::string &sig, std::string *params, char *ret) {
+  size_t i = 1;
+  while (i < sig.size() && sig[i] != ')') {
+    char type = sig[i];
+    while (sig[i] == '[') i++;
+    if (sig[i] == 'L') {
+      i = sig.find(';', i);
+    }
+    params->push_back(type);
+    i++;
+  }
+  *ret = sig[i + 1];
+}
+
+FakeEnv *CheckEnv(JNIEnv *env, const char *function) {
+  FakeEnv *fake = reinterpret_cast<FakeEnv *>(env);
+  if (fake != t_env) {
+    Abort("%s called with the JNIEnv of another thread", function);
+  }
+  return fake;
+}
+
+// Checks there is no exception pending, as CheckJNI does for every function
+// except the exception and reference deleting ones.
+FakeEnv *CheckCall(JNIEnv *env, const char *function) {
+  FakeEnv *fake = CheckEnv(env, function);
+  if (fake->exception) {
+    Abort("%s called with an exception pending", function);
+  }
+  return fake;
+}
+
+FakeRef *CheckRef(FakeEnv *env, jobject ref, const char *function) {
+  FakeRef *fake = reinterpret_cast<FakeRef *>(ref);
+  if (fake->magic != kRefMagic) {
+    Abort("%s called with a deleted reference", function);
+  }
+  if (fake->kind == kLocalRef && fake->owner != env) {
+    Abort("%s called with a local reference of another thread", function);
+  }
+  return fake;
+}
+
+FakeObject *CheckObject(FakeEnv *env, jobject ref, const char *function) {
+  return ref ? CheckRef(env, ref, function)->object : nullptr;
+}
+
+}  // namespace
+
+class FakeClass {
+ public:
+  std::string name;
+  FakeClass *super;
+  bool app_class;
+  // The java/lang/Class object, never freed.
+  FakeObject *class_object;
+  std::map<std::pair<std::string, std::string>, std::unique_ptr<FakeMethod>>
+      methods;
+  std::map<std::pair<std::string, std::string>, std::unique_ptr<FakeMethod>>
+      static_methods;
+  std::map<std::pair<std::string, std::string>, void *> natives;
+
+  bool IsA(const FakeClass *other) const {
+    for (const FakeClass *c = this; c; c = c->super) {
+      if (c == other) return true;
+    }
+    return false;
+  }
+};
+
+const std::string &FakeCall::String(int i) const {
+  static const std::string empty;
+  FakeObject *object = Object(i);
+  return object ? object->string : empty;
+}
+
+jvalue FakeVoid() {
+  jvalue value;
+  value.j = 0;
+  return value;
+}
+
+jvalue FakeBoolean(bool value) {
+  jvalue result = FakeVoid();
+  result.z = value ? JNI_TRUE : JNI_FALSE;
+  return result;
+}
+
+jvalue FakeInt(jint value) {
+  jvalue result = FakeVoid();
+  result.i = value;
+  return result;
+}
+
+jvalue FakeObjectValue(FakeObject *object) {
+  jvalue result = FakeVoid();
+  result.l = reinterpret_cast<jobject>(object);
+  return result;
+}
+
+uint64_t FakeJniCounts::Total() const {
+  uint64_t total = 0;
+  for (int i = 0; i < kFakeJniFunctionCount; i++) {
+    total += calls[i];
+  }
+  return total;
+}
+
+FakeJniCounts FakeJniCounts::operator-(const FakeJniCounts &base) const {
+  FakeJniCounts difference;
+  for (int i = 0; i < kFakeJniFunctionCount; i++) {
+    difference.calls[i] = calls[i] - base.calls[i];
+  }
+  return difference;
+}
+
+const char *FakeJniCounts::Name(FakeJniFunction function) {
+  static const char *const kNames[kFakeJniFunctionCount] = {
+      "FindClass",
+      "ThrowNew",
+      "ExceptionCheck",
+      "ExceptionClear",
+      "NewGlobalRef",
+      "DeleteGlobalRef",
+      "DeleteLocalRef",
+      "IsInstanceOf",
+      "GetObjectClass",
+      "GetMethodID",
+      "CallObjectMethod",
+      "CallBooleanMethod",
+      "CallVoidMethod",
+      "GetStaticMethodID",
+      "CallStaticObjectMethod",
+      "CallStaticBooleanMethod",
+      "CallStaticVoidMethod",
+      "NewStringUTF",
+      "GetStringUTFChars",
+      "ReleaseStringUTFChars",
+      "GetArrayLength",
+      "NewObjectArray",
+      "GetObjectArrayElement",
+      "SetObjectArrayElement",
+      "NewByteArray",
+      "SetByteArrayRegion",
+      "RegisterNatives",
+      "GetPrimitiveArrayCritical",
+      "ReleasePrimitiveArrayCritical",
+      "NewDirectByteBuffer",
+      "GetDirectBufferAddress",
+      "GetDirectBufferCapacity",
+      "AttachCurrentThread",
+      "DetachCurrentThread",
+      "GetEnv",
+  };
+  return kNames[function];
+}
+
+// The entries of the JNINativeInterface and JNIInvokeInterface tables.
+struct FakeJniFunctions {
+  static FakeJvm &Jvm() { return FakeJvm::Get(); }
+
+  static jclass FindClass(JNIEnv *env, const char *name) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniFindClass);
+    FakeEnv *fake = CheckCall(env, "FindClass");
+    FakeClass *clazz = jvm.FindLoadedClass(name);
+    // Native threads use the system class path, which has no app classes.
+    if (!clazz || (clazz->app_class && !fake->java_thread)) {
+      jvm.Throw(env, "java/lang/NoClassDefFoundError");
+      return nullptr;
+    }
+    return static_cast<jclass>(jvm.NewLocalRef(env, clazz->class_object));
+  }
+
+  static jint ThrowNew(JNIEnv *env, jclass clazz, const char *message) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniThrowNew);
+    FakeEnv *fake = CheckCall(env, "ThrowNew");
+    FakeObject *class_object = CheckObject(fake, clazz, "ThrowNew");
+    fake->exception = jvm.NewObject(class_object->class_value);
+    jvm.Retain(fake->exception);
+    return JNI_OK;
+  }
+
+  static jboolean ExceptionCheck(JNIEnv *env) {
+    Jvm().Count(kJniExceptionCheck);
+    return CheckEnv(env, "ExceptionCheck")->exception ? JNI_TRUE : JNI_FALSE;
+  }
+
+  static void ExceptionClear(JNIEnv *env) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniExceptionClear);
+    FakeEnv *fake = CheckEnv(env, "ExceptionClear");
+    if (fake->exception) {
+      jvm.Release(fake->exception);
+      fake->exception = nullptr;
+    }
+  }
+
+  static jobject NewGlobalRef(JNIEnv *env, jobject obj) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniNewGlobalRef);
+    FakeEnv *fake = CheckCall(env, "NewGlobalRef");
+    FakeObject *object = CheckObject(fake, obj, "NewGlobalRef");
+    return object ? jvm.NewGlobalRef(object) : nullptr;
+  }
+
+  static void DeleteGlobalRef(JNIEnv *env, jobject obj) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniDeleteGlobalRef);
+    FakeEnv *fake = CheckEnv(env, "DeleteGlobalRef");
+    if (!obj) return;
+    FakeRef *ref = CheckRef(fake, obj, "DeleteGlobalRef");
+    if (ref->kind != kGlobalRef) {
+      Abort("DeleteGlobalRef called with a local reference");
+    }
+    {
+      std::lock_guard<std::mutex> lock(jvm.mutex_);
+      jvm.global_refs_.erase(obj);
+    }
+    jvm.Release(ref->object);
+    ref->magic = 0;
+    delete ref;
+  }
+
+  static void DeleteLocalRef(JNIEnv *env, jobject obj) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniDeleteLocalRef);
+    FakeEnv *fake = CheckEnv(env, "DeleteLocalRef");
+    if (!obj) return;
+    FakeRef *ref = CheckRef(fake, obj, "DeleteLocalRef");
+    if (ref->kind != kLocalRef) {
+      Abort("DeleteLocalRef called with a global reference");
+    }
+    for (size_t i = fake->locals.size(); i > 0; i--) {
+      if (fake->locals[i - 1] == ref) {
+        fake->locals[i - 1] = nullptr;
+        break;
+      }
+    }
+    while (!fake->locals.empty() && !fake->locals.back() &&
+           fake->locals.size() > fake->frames.back()) {
+      fake->locals.pop_back();
+    }
+    fake->live_locals--;
+    jvm.Release(ref->object);
+    ref->magic = 0;
+    delete ref;
+  }
+
+  static jboolean IsInstanceOf(JNIEnv *env, jobject obj, jclass clazz) {
+    Jvm().Count(kJniIsInstanceOf);
+    FakeEnv *fake = CheckCall(env, "IsInstanceOf");
+    FakeObject *object = CheckObject(fake, obj, "IsInstanceOf");
+    FakeObject *class_object = CheckObject(fake, clazz, "IsInstanceOf");
+    return !object || object->clazz->IsA(class_object->class_value);
+  }
+
+  static jclass GetObjectClass(JNIEnv *env, jobject obj) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniGetObjectClass);
+    FakeEnv *fake = CheckCall(env, "GetObjectClass");
+    FakeObject *object = CheckObject(fake, obj, "GetObjectClass");
+    if (!object) Abort("GetObjectClass called with null");
+    return static_cast<jclass>(
+        jvm.NewLocalRef(env, object->clazz->class_object));
+  }
+
+  static FakeMethod *LookupMethod(FakeClass *clazz, const char *name,
+                                  const char *sig, bool is_static) {
+    FakeJvm &jvm = Jvm();
+    std::lock_guard<std::mutex> lock(jvm.mutex_);
+    std::pair<std::string, std::string> key(name, sig);
+    for (FakeClass *c = clazz; c; c = c->super) {
+      auto &methods = is_static ? c->static_methods : c->methods;
+      auto it = methods.find(key);
+      if (it != methods.end()) {
+        return it->second.get();
+      }
+    }
+    return nullptr;
+  }
+
+  static jmethodID GetMethod(JNIEnv *env, jclass clazz, const char *name,
+                             const char *sig, bool is_static,
+                             const char *function) {
+    FakeEnv *fake = CheckCall(env, function);
+    FakeObject *class_object = CheckObject(fake, clazz, function);
+    if (!class_object) Abort("%s called with a null class", function);
+    FakeMethod *method =
+        LookupMethod(class_object->class_value, name, sig, is_static);
+    if (!method) {
+      Jvm().Throw(env, "java/lang/NoSuchMethodError");
+    }
+    return reinterpret_cast<jmethodID>(method);
+  }
+
+  static jmethodID GetMethodID(JNIEnv *env, jclass clazz, const char *name,
+                               const char *sig) {
+    Jvm().Count(kJniGetMethodID);
+    return GetMethod(env, clazz, name, sig, false, "GetMethodID");
+  }
+
+  static jmethodID GetStaticMethodID(JNIEnv *env, jclass clazz,
+                                     const char *name, const char *sig) {
+    Jvm().Count(kJniGetStaticMethodID);
+    return GetMethod(env, clazz, name, sig, true, "GetStaticMethodID");
+  }
+
+  // Calls method with the arguments in args, decoded by its signature.
+  static jvalue Invoke(JNIEnv *env, jobject obj, jmethodID method_id,
+                       va_list args, bool is_static, char ret,
+                       const char *function) {
+    FakeEnv *fake = CheckCall(env, function);
+    FakeMethod *method = reinterpret_cast<FakeMethod *>(method_id);
+    if (!method) Abort("%s called with a null method id", function);
+    if (method->is_static != is_static) {
+      Abort("%s called with the wrong kind of method id %s", function,
+            method->name.c_str());
+    }
+    bool returns_object = method->ret == 'L' || method->ret == '[';
+    if ((ret == 'L') != returns_object || (ret != 'L' && ret != method->ret)) {
+      Abort("%s called for %s%s", function, method->name.c_str(),
+            method->sig.c_str());
+    }
+    FakeObject *self = CheckObject(fake, obj, function);
+    if (!self) Abort("%s called with null", function);
+    if (!is_static && self->clazz != method->clazz) {
+      // Virtual dispatch to an override.
+      FakeMethod *override = LookupMethod(
+          self->clazz, method->name.c_str(), method->sig.c_str(), false);
+      if (override) method = override;
+    }
+
+    std::vector<jvalue> values(method->params.size());
+    for (size_t i = 0; i < method->params.size(); i++) {
+      values[i] = FakeVoid();
+      switch (method->params[i]) {
+        case 'Z':
+          values[i].z = static_cast<jboolean>(va_arg(args, int));
+          break;
+        case 'B':
+        case 'C':
+        case 'S':
+        case 'I':
+          values[i].i = va_arg(args, jint);
+          break;
+        case 'J':
+          values[i].j = va_arg(args, jlong);
+          break;
+        case 'F':
+        case 'D':
+          values[i].d = va_arg(args, double);
+          break;
+        default:
+          values[i].l = reinterpret_cast<jobject>(
+              CheckObject(fake, va_arg(args, jobject), function));
+          break;
+      }
+    }
+
+    FakeCall call = {env, is_static ? nullptr : self, values.data()};
+    jvalue result = method->handler(call);
+    if (fake->exception) {
+      return FakeVoid();
+    }
+    if (returns_object) {
+      FakeObject *object = reinterpret_cast<FakeObject *>(result.l);
+      result.l = object ? Jvm().NewLocalRef(env, object) : nullptr;
+    }
+    return result;
+  }
+
+  static jobject CallObjectMethodV(JNIEnv *env, jobject obj,
+                                   jmethodID method, va_list args) {
+    Jvm().Count(kJniCallObjectMethod);
+    return Invoke(env, obj, method, args, false, 'L', "CallObjectMethod").l;
+  }
+
+  static jboolean CallBooleanMethodV(JNIEnv *env, jobject obj,
+                                     jmethodID method, va_list args) {
+    Jvm().Count(kJniCallBooleanMethod);
+    return Invoke(env, obj, method, args, false, 'Z', "CallBooleanMethod").z;
+  }
+
+  static void CallVoidMethodV(JNIEnv *env, jobject obj, jmethodID method,
+                              va_list args) {
+    Jvm().Count(kJniCallVoidMethod);
+    Invoke(env, obj, method, args, false, 'V', "CallVoidMethod");
+  }
+
+  static jobject CallStaticObjectMethodV(JNIEnv *env, jclass clazz,
+                                         jmethodID method, va_list args) {
+    Jvm().Count(kJniCallStaticObjectMethod);
+    return Invoke(env, clazz, method, args, true, 'L',
+                  "CallStaticObjectMethod")
+        .l;
+  }
+
+  static jboolean CallStaticBooleanMethodV(JNIEnv *env, jclass clazz,
+                                           jmethodID method, va_list args) {
+    Jvm().Count(kJniCallStaticBooleanMethod);
+    return Invoke(env, clazz, method, args, true, 'Z',
+                  "CallStaticBooleanMethod")
+        .z;
+  }
+
+  static void CallStaticVoidMethodV(JNIEnv *env, jclass clazz,
+                                    jmethodID method, va_list args) {
+    Jvm().Count(kJniCallStaticVoidMethod);
+    Invoke(env, clazz, method, args, true, 'V', "CallStaticVoidMethod");
+  }
+
+  static jstring NewStringUTF(JNIEnv *env, const char *bytes) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniNewStringUTF);
+    CheckCall(env, "NewStringUTF");
+    if (!bytes) return nullptr;
+    return static_cast<jstring>(jvm.NewLocalRef(env, jvm.NewString(bytes)));
+  }
+
+  static const char *GetStringUTFChars(JNIEnv *env, jstring string,
+                                       jboolean *is_copy) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniGetStringUTFChars);
+    FakeEnv *fake = CheckCall(env, "GetStringUTFChars");
+    FakeObject *object = CheckObject(fake, string, "GetStringUTFChars");
+    if (!object) Abort("GetStringUTFChars called with null");
+    if (is_copy) *is_copy = JNI_FALSE;
+    jvm.pinned_.fetch_add(1);
+    return object->string.c_str();
+  }
+
+  static void ReleaseStringUTFChars(JNIEnv *env, jstring string,
+                                    const char *utf) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniReleaseStringUTFChars);
+    FakeEnv *fake = CheckEnv(env, "ReleaseStringUTFChars");
+    FakeObject *object = CheckObject(fake, string, "ReleaseStringUTFChars");
+    if (!object || utf != object->string.c_str()) {
+      Abort("ReleaseStringUTFChars called with the wrong string");
+    }
+    jvm.pinned_.fetch_sub(1);
+  }
+
+  static FakeObject *CheckArray(FakeEnv *env, jobject array,
+                                const char *function) {
+    FakeObject *object = CheckObject(env, array, function);
+    if (!object || object->clazz->name[0] != '[') {
+      Abort("%s called without an array", function);
+    }
+    return object;
+  }
+
+  static jsize GetArrayLength(JNIEnv *env, jarray array) {
+    Jvm().Count(kJniGetArrayLength);
+    FakeEnv *fake = CheckCall(env, "GetArrayLength");
+    FakeObject *object = CheckArray(fake, array, "GetArrayLength");
+    return static_cast<jsize>(object->clazz->name == "[B"
+                                  ? object->bytes.size()
+                                  : object->elements.size());
+  }
+
+  static jobjectArray NewObjectArray(JNIEnv *env, jsize length,
+                                     jclass element_class,
+                                     jobject initial_element) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniNewObjectArray);
+    FakeEnv *fake = CheckCall(env, "NewObjectArray");
+    FakeObject *class_object =
+        CheckObject(fake, element_class, "NewObjectArray");
+    if (!class_object) Abort("NewObjectArray called with a null class");
+    FakeObject *initial = CheckObject(fake, initial_element, "NewObjectArray");
+    FakeClass *element = class_object->class_value;
+    std::string name = "[L" + element->name + ";";
+    FakeClass *array_class = jvm.FindLoadedClass(name.c_str());
+    if (!array_class) {
+      array_class = jvm.DefineClass(name.c_str(), "java/lang/Object",
+                                    element->app_class);
+    }
+    FakeObject *array = jvm.NewObject(array_class);
+    array->elements.assign(length, initial);
+    for (jsize i = 0; initial && i < length; i++) {
+      jvm.Retain(initial);
+    }
+    return static_cast<jobjectArray>(jvm.NewLocalRef(env, array));
+  }
+
+  static FakeObject *CheckIndex(JNIEnv *env, FakeObject *array, jsize index) {
+    if (index < 0 || static_cast<size_t>(index) >= array->elements.size()) {
+      Jvm().Throw(env, "java/lang/ArrayIndexOutOfBoundsException");
+      return nullptr;
+    }
+    return array;
+  }
+
+  static jobject GetObjectArrayElement(JNIEnv *env, jobjectArray array,
+                                       jsize index) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniGetObjectArrayElement);
+    FakeEnv *fake = CheckCall(env, "GetObjectArrayElement");
+    FakeObject *object = CheckArray(fake, array, "GetObjectArrayElement");
+    if (!CheckIndex(env, object, index)) return nullptr;
+    FakeObject *element = object->elements[index];
+    return element ? jvm.NewLocalRef(env, element) : nullptr;
+  }
+
+  static void SetObjectArrayElement(JNIEnv *env, jobjectArray array,
+                                    jsize index, jobject value) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniSetObjectArrayElement);
+    FakeEnv *fake = CheckCall(env, "SetObjectArrayElement");
+    FakeObject *object = CheckArray(fake, array, "SetObjectArrayElement");
+    FakeObject *element = CheckObject(fake, value, "SetObjectArrayElement");
+    if (!CheckIndex(env, object, index)) return;
+    if (element) jvm.Retain(element);
+    if (object->elements[index]) jvm.Release(object->elements[index]);
+    object->elements[index] = element;
+  }
+
+  static jbyteArray NewByteArray(JNIEnv *env, jsize length) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniNewByteArray);
+    CheckCall(env, "NewByteArray");
+    std::vector<uint8_t> zeros(length);
+    return static_cast<jbyteArray>(
+        jvm.NewLocalRef(env, jvm.NewByteArray(zeros.data(), zeros.size())));
+  }
+
+  static void SetByteArrayRegion(JNIEnv *env, jbyteArray array, jsize start,
+                                 jsize len, const jbyte *buf) {
+    Jvm().Count(kJniSetByteArrayRegion);
+    FakeEnv *fake = CheckCall(env, "SetByteArrayRegion");
+    FakeObject *object = CheckArray(fake, array, "SetByteArrayRegion");
+    if (start < 0 || len < 0 ||
+        static_cast<size_t>(start) + len > object->bytes.size()) {
+      Jvm().Throw(env, "java/lang/ArrayIndexOutOfBoundsException");
+      return;
+    }
+    memcpy(object->bytes.data() + start, buf, len);
+  }
+
+  static jint RegisterNatives(JNIEnv *env, jclass clazz,
+                              const JNINativeMethod *methods, jint count) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniRegisterNatives);
+    FakeEnv *fake = CheckCall(env, "RegisterNatives");
+    FakeObject *class_object = CheckObject(fake, clazz, "RegisterNatives");
+    if (!class_object) Abort("RegisterNatives called with a null class");
+    FakeClass *fake_class = class_object->class_value;
+    {
+      std::lock_guard<std::mutex> lock(jvm.mutex_);
+      bool declared = true;
+      for (jint i = 0; declared && i < count; i++) {
+        declared = fake_class->natives.count(std::make_pair(
+            std::string(methods[i].name), std::string(methods[i].signature)));
+      }
+      for (jint i = 0; declared && i < count; i++) {
+        fake_class->natives[std::make_pair(
+            std::string(methods[i].name), std::string(methods[i].signature))] =
+            methods[i].fnPtr;
+      }
+      if (declared) {
+        return JNI_OK;
+      }
+    }
+    jvm.Throw(env, "java/lang/NoSuchMethodError");
+    return JNI_ERR;
+  }
+
+  static void *GetPrimitiveArrayCritical(JNIEnv *env, jarray array,
+                                         jboolean *is_copy) {
+    static uint8_t empty;
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniGetPrimitiveArrayCritical);
+    FakeEnv *fake = CheckCall(env, "GetPrimitiveArrayCritical");
+    FakeObject *object = CheckArray(fake, array, "GetPrimitiveArrayCritical");
+    if (is_copy) *is_copy = JNI_FALSE;
+    jvm.pinned_.fetch_add(1);
+    return object->bytes.empty() ? &empty : object->bytes.data();
+  }
+
+  static void ReleasePrimitiveArrayCritical(JNIEnv *env, jarray array,
+                                            void *carray, jint mode) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniReleasePrimitiveArrayCritical);
+    FakeEnv *fake = CheckEnv(env, "ReleasePrimitiveArrayCritical");
+    CheckArray(fake, array, "ReleasePrimitiveArrayCritical");
+    jvm.pinned_.fetch_sub(1);
+  }
+
+  static jobject NewDirectByteBuffer(JNIEnv *env, void *address,
+                                     jlong capacity) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniNewDirectByteBuffer);
+    CheckCall(env, "NewDirectByteBuffer");
+    FakeObject *buffer =
+        jvm.NewObject(jvm.FindLoadedClass("java/nio/DirectByteBuffer"));
+    buffer->address = address;
+    buffer->capacity = capacity;
+    return jvm.NewLocalRef(env, buffer);
+  }
+
+  static void *GetDirectBufferAddress(JNIEnv *env, jobject buffer) {
+    Jvm().Count(kJniGetDirectBufferAddress);
+    FakeEnv *fake = CheckCall(env, "GetDirectBufferAddress");
+    FakeObject *object = CheckObject(fake, buffer, "GetDirectBufferAddress");
+    return object ? object->address : nullptr;
+  }
+
+  static jlong GetDirectBufferCapacity(JNIEnv *env, jobject buffer) {
+    Jvm().Count(kJniGetDirectBufferCapacity);
+    FakeEnv *fake = CheckCall(env, "GetDirectBufferCapacity");
+    FakeObject *object = CheckObject(fake, buffer, "GetDirectBufferCapacity");
+    return object ? object->capacity : -1;
+  }
+
+  static const JNINativeInterface kNativeInterface;
+
+  static JNIEnv *Attach(bool java_thread) {
+    if (!t_env) {
+      FakeEnv *env = new FakeEnv();
+      env->env.functions = &kNativeInterface;
+      env->java_thread = java_thread;
+      env->exception = nullptr;
+      env->frames.push_back(0);
+      env->live_locals = 0;
+      t_env = env;
+    }
+    return &t_env->env;
+  }
+
+  static jint AttachCurrentThread(JavaVM *vm, JNIEnv **env, void *args) {
+    Jvm().Count(kJniAttachCurrentThread);
+    *env = Attach(false);
+    return JNI_OK;
+  }
+
+  static jint DetachCurrentThread(JavaVM *vm) {
+    FakeJvm &jvm = Jvm();
+    jvm.Count(kJniDetachCurrentThread);
+    FakeEnv *env = t_env;
+    if (!env) {
+      return JNI_ERR;
+    }
+    while (!env->frames.empty()) {
+      jvm.PopLocalFrame(&env->env);
+    }
+    if (env->exception) {
+      jvm.Release(env->exception);
+    }
+    t_env = nullptr;
+    delete env;
+    return JNI_OK;
+  }
+
+  static jint GetEnv(JavaVM *vm, void **env, jint version) {
+    Jvm().Count(kJniGetEnv);
+    if (!t_env) {
+      *env = nullptr;
+      return JNI_EDETACHED;
+    }
+    *env = &t_env->env;
+    return JNI_OK;
+  }
+
+  static const JNIInvokeInterface kInvokeInterface;
+};
+
+const JNINativeInterface FakeJniFunctions::kNativeInterface = {
+    FakeJniFunctions::FindClass,
+    FakeJniFunctions::ThrowNew,
+    FakeJniFunctions::ExceptionCheck,
+    FakeJniFunctions::ExceptionClear,
+    FakeJniFunctions::NewGlobalRef,
+    FakeJniFunctions::DeleteGlobalRef,
+    FakeJniFunctions::DeleteLocalRef,
+    FakeJniFunctions::IsInstanceOf,
+    FakeJniFunctions::GetObjectClass,
+    FakeJniFunctions::GetMethodID,
+    FakeJniFunctions::CallObjectMethodV,
+    FakeJniFunctions::CallBooleanMethodV,
+    FakeJniFunctions::CallVoidMethodV,
+    FakeJniFunctions::GetStaticMethodID,
+    FakeJniFunctions::CallStaticObjectMethodV,
+    FakeJniFunctions::CallStaticBooleanMethodV,
+    FakeJniFunctions::CallStaticVoidMethodV,
+    FakeJniFunctions::NewStringUTF,
+    FakeJniFunctions::GetStringUTFChars,
+    FakeJniFunctions::ReleaseStringUTFChars,
+    FakeJniFunctions::GetArrayLength,
+    FakeJniFunctions::NewObjectArray,
+    FakeJniFunctions::GetObjectArrayElement,
+    FakeJniFunctions::SetObjectArrayElement,
+    FakeJniFunctions::NewByteArray,
+    FakeJniFunctions::SetByteArrayRegion,
+    FakeJniFunctions::RegisterNatives,
+    FakeJniFunctions::GetPrimitiveArrayCritical,
+    FakeJniFunctions::ReleasePrimitiveArrayCritical,
+    FakeJniFunctions::NewDirectByteBuffer,
+    FakeJniFunctions::GetDirectBufferAddress,
+    FakeJniFunctions::GetDirectBufferCapacity,
+};
+
+const JNIInvokeInterface FakeJniFunctions::kInvokeInterface = {
+    FakeJniFunctions::AttachCurrentThread,
+    FakeJniFunctions::DetachCurrentThread,
+    FakeJniFunctions::GetEnv,
+};
+
+FakeJvm &FakeJvm::Get() {
+  // Never destroyed, the plugin's statics hold references until exit.
+  static FakeJvm *jvm = new FakeJvm();
+  return *jvm;
+}
+
+FakeJvm::FakeJvm() : live_objects_(0), pinned_(0), transition_ns_(0) {
+  vm_.functions = &FakeJniFunctions::kInvokeInterface;
+  for (int i = 0; i < kFakeJniFunctionCount; i++) {
+    counts_[i].store(0);
+  }
+
+  // java/lang/Class objects are instances of java/lang/Class, which has to
+  // exist before the first class is defined.
+  FakeClass *object_class = new FakeClass();
+  object_class->name = "java/lang/Object";
+  object_class->super = nullptr;
+  object_class->app_class = false;
+  FakeClass *class_class = new FakeClass();
+  class_class->name = "java/lang/Class";
+  class_class->super = object_class;
+  class_class->app_class = false;
+  classes_[object_class->name] = object_class;
+  classes_[class_class->name] = class_class;
+  for (FakeClass *clazz : {object_class, class_class}) {
+    clazz->class_object = NewObject(class_class);
+    clazz->class_object->class_value = clazz;
+    Retain(clazz->class_object);
+  }
+
+  DefineClass("java/lang/String", "java/lang/Object", false);
+  DefineClass("[B", "java/lang/Object", false);
+  DefineClass("java/nio/ByteBuffer", "java/lang/Object", false);
+  DefineClass("java/nio/DirectByteBuffer", "java/nio/ByteBuffer", false);
+  DefineClass("java/lang/Throwable", "java/lang/Object", false);
+  for (const char *name :
+       {"java/lang/ClassNotFoundException", "java/lang/NoClassDefFoundError",
+        "java/lang/NoSuchMethodError",
+        "java/lang/ArrayIndexOutOfBoundsException",
+        "java/lang/RuntimeException"}) {
+    DefineClass(name, "java/lang/Throwable", false);
+  }
+
+  FakeClass *loader_class =
+      DefineClass("java/lang/ClassLoader", "java/lang/Object", false);
+  boot_class_loader_ = NewObject(
+      DefineClass("java/lang/BootClassLoader", "java/lang/ClassLoader", false));
+  Retain(boot_class_loader_);
+  app_class_loader_ = NewObject(DefineClass(
+      "dalvik/system/PathClassLoader", "java/lang/ClassLoader", false));
+  Retain(app_class_loader_);
+
+  // As on Android, classes on the boot class path report the boot class
+  // loader rather than null.
+  DefineMethod(class_class, "getClassLoader", "()Ljava/lang/ClassLoader;",
+               [this](const FakeCall &call) {
+                 return FakeObjectValue(call.self->class_value->app_class
+                                            ? app_class_loader_
+                                            : boot_class_loader_);
+               });
+  DefineMethod(
+      loader_class, "loadClass", "(Ljava/lang/String;)Ljava/lang/Class;",
+      [this](const FakeCall &call) {
+        std::string name = call.String(0);
+        for (size_t i = 0; i < name.size(); i++) {
+          if (name[i] == '.') name[i] = '/';
+        }
+        FakeClass *clazz = FindLoadedClass(name.c_str());
+        if (!clazz ||
+            (clazz->app_class && call.self != app_class_loader_)) {
+          Throw(call.env, "java/lang/ClassNotFoundException");
+          return FakeVoid();
+        }
+        return FakeObjectValue(clazz->class_object);
+      });
+}
+
+void FakeJvm::Spin(int64_t ns) {
+  std::chrono::steady_clock::time_point end =
+      std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+  while (std::chrono::steady_clock::now() < end) {
+  }
+}
+
+JNIEnv *FakeJvm::AttachJavaThread() { return FakeJniFunctions::Attach(true); }
+
+void FakeJvm::DetachCurrentThread() {
+  FakeJniFunctions::DetachCurrentThread(&vm_);
+}
+
+JNIEnv *FakeJvm::CurrentEnv() { return t_env ? &t_env->env : nullptr; }
+
+FakeClass *FakeJvm::DefineClass(const char *name, const char *super_name,
+                                bool app_class) {
+  FakeClass *super = super_name ? FindLoadedClass(super_name) : nullptr;
+  if (super_name && !super) {
+    Abort("DefineClass %s before its super class %s", name, super_name);
+  }
+  FakeClass *clazz = new FakeClass();
+  clazz->name = name;
+  clazz->super = super;
+  clazz->app_class = app_class;
+  clazz->class_object = NewObject(FindLoadedClass("java/lang/Class"));
+  clazz->class_object->class_value = clazz;
+  Retain(clazz->class_object);
+  std::lock_guard<std::mutex> lock(mutex_);
+  classes_[name] = clazz;
+  return clazz;
+}
+
+FakeClass *FakeJvm::FindLoadedClass(const char *name) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::map<std::string, FakeClass *>::const_iterator it = classes_.find(name);
+  return it != classes_.end() ? it->second : nullptr;
+}
+
+FakeObject *FakeJvm::ClassObject(FakeClass *clazz) {
+  return clazz->class_object;
+}
+
+static void AddMethod(FakeClass *clazz, const char *name, const char *sig,
+                      bool is_static, FakeMethodHandler handler,
+                      std::mutex *mutex) {
+  std::unique_ptr<FakeMethod> method(new FakeMethod());
+  method->clazz = clazz;
+  method->name = name;
+  method->sig = sig;
+  method->is_static = is_static;
+  method->handler = handler;
+  ParseSignature(method->sig, &method->params, &method->ret);
+  std::lock_guard<std::mutex> lock(*mutex);
+  (is_static ? clazz->static_methods : clazz->methods)[std::make_pair(
+      method->name, method->sig)] = std::move(method);
+}
+
+void FakeJvm::DefineMethod(FakeClass *clazz, const char *name,
+                           const char *sig, FakeMethodHandler handler) {
+  AddMethod(clazz, name, sig, false, handler, &mutex_);
+}
+
+void FakeJvm::DefineStaticMethod(FakeClass *clazz, const char *name,
+                                 const char *sig, FakeMethodHandler handler) {
+  AddMethod(clazz, name, sig, true, handler, &mutex_);
+}
+
+void FakeJvm::DeclareNative(FakeClass *clazz, const char *name,
+                            const char *sig) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  clazz->natives[std::make_pair(std::string(name), std::string(sig))] =
+      nullptr;
+}
+
+void *FakeJvm::FindNative(FakeClass *clazz, const char *name,
+                          const char *sig) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = clazz->natives.find(std::make_pair(std::string(name),
+                                               std::string(sig)));
+  return it != clazz->natives.end() ? it->second : nullptr;
+}
+
+FakeObject *FakeJvm::NewObject(FakeClass *clazz) {
+  FakeObject *object = new FakeObject();
+  object->clazz = clazz;
+  object->refs.store(0, std::memory_order_relaxed);
+  object->address = nullptr;
+  object->capacity = 0;
+  object->class_value = nullptr;
+  live_objects_.fetch_add(1, std::memory_order_relaxed);
+  return object;
+}
+
+FakeObject *FakeJvm::NewString(const std::string &value) {
+  FakeObject *object = NewObject(FindLoadedClass("java/lang/String"));
+  object->string = value;
+  return object;
+}
+
+FakeObject *FakeJvm::NewByteArray(const uint8_t *data, size_t size) {
+  FakeObject *object = NewObject(FindLoadedClass("[B"));
+  object->bytes.assign(data, data + size);
+  return object;
+}
+
+void FakeJvm::Retain(FakeObject *object) {
+  object->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FakeJvm::Release(FakeObject *object) {
+  if (object->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    for (FakeObject *element : object->elements) {
+      if (element) Release(element);
+    }
+    delete object;
+    live_objects_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+jobject FakeJvm::NewLocalRef(JNIEnv *env, FakeObject *object) {
+  FakeEnv *fake = CheckEnv(env, "NewLocalRef");
+  FakeRef *ref = new FakeRef();
+  ref->magic = kRefMagic;
+  ref->kind = kLocalRef;
+  ref->object = object;
+  ref->owner = fake;
+  Retain(object);
+  fake->locals.push_back(ref);
+  fake->live_locals++;
+  return reinterpret_cast<jobject>(ref);
+}
+
+jobject FakeJvm::NewGlobalRef(FakeObject *object) {
+  FakeRef *ref = new FakeRef();
+  ref->magic = kRefMagic;
+  ref->kind = kGlobalRef;
+  ref->object = object;
+  ref->owner = nullptr;
+  Retain(object);
+  jobject global = reinterpret_cast<jobject>(ref);
+  std::lock_guard<std::mutex> lock(mutex_);
+  global_refs_.insert(global);
+  return global;
+}
+
+FakeObject *FakeJvm::Resolve(jobject ref) {
+  if (!ref) return nullptr;
+  FakeRef *fake = reinterpret_cast<FakeRef *>(ref);
+  if (fake->magic != kRefMagic) {
+    Abort("Resolve called with a deleted reference");
+  }
+  return fake->object;
+}
+
+void FakeJvm::PushLocalFrame(JNIEnv *env) {
+  FakeEnv *fake = CheckEnv(env, "PushLocalFrame");
+  fake->frames.push_back(fake->locals.size());
+}
+
+void FakeJvm::PopLocalFrame(JNIEnv *env) {
+  FakeEnv *fake = CheckEnv(env, "PopLocalFrame");
+  size_t start = fake->frames.back();
+  fake->frames.pop_back();
+  while (fake->locals.size() > start) {
+    FakeRef *ref = fake->locals.back();
+    fake->locals.pop_back();
+    if (ref) {
+      fake->live_locals--;
+      Release(ref->object);
+      ref->magic = 0;
+      delete ref;
+    }
+  }
+}
+
+void FakeJvm::Throw(JNIEnv *env, const char *class_name) {
+  FakeEnv *fake = CheckEnv(env, "Throw");
+  FakeClass *clazz = FindLoadedClass(class_name);
+  if (!clazz) Abort("Throw of undefined class %s", class_name);
+  if (fake->exception) {
+    Release(fake->exception);
+  }
+  fake->exception = NewObject(clazz);
+  Retain(fake->exception);
+}
+
+FakeJniCounts FakeJvm::counts() const {
+  FakeJniCounts counts;
+  for (int i = 0; i < kFakeJniFunctionCount; i++) {
+    counts.calls[i] = counts_[i].load(std::memory_order_relaxed);
+  }
+  return counts;
+}
+
+size_t FakeJvm::global_refs() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return global_refs_.size();
+}
+
+size_t FakeJvm::local_refs() const { return t_env ? t_env->live_locals : 0; }
+
+}  // namespace test
+}  // namespace googlesignin
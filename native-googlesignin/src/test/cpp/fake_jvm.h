@@ -0,0 +1,266 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_TEST_FAKE_JVM_H
+#define GOOGLESIGNIN_TEST_FAKE_JVM_H
+
+#include <jni.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace googlesignin {
+namespace test {
+
+class FakeClass;
+class FakeJvm;
+
+// An object in the fake VM.  Objects are reference counted by the JNI
+// references to them and by the objects holding them, and freed when the
+// last one goes.
+struct FakeObject {
+  FakeClass *clazz;
+  std::atomic<int> refs;
+  // java/lang/String.
+  std::string string;
+  // Object arrays hold a reference to each element.
+  std::vector<FakeObject *> elements;
+  // Byte arrays.
+  std::vector<uint8_t> bytes;
+  // Direct byte buffers.
+  void *address;
+  jlong capacity;
+  // The class of a java/lang/Class object.
+  FakeClass *class_value;
+  // Anything else the fake Java code keeps with the object.
+  std::shared_ptr<void> data;
+};
+
+// The arguments of a call from the native code into a fake Java method.
+// Object arguments are passed as FakeObject pointers.
+struct FakeCall {
+  JNIEnv *env;
+  // The object the method is called on, null for a static method.
+  FakeObject *self;
+  const jvalue *args;
+
+  FakeObject *Object(int i) const {
+    return reinterpret_cast<FakeObject *>(args[i].l);
+  }
+  // The value of a String argument, "" if it is null.
+  const std::string &String(int i) const;
+  bool Boolean(int i) const { return args[i].z != 0; }
+  jint Int(int i) const { return args[i].i; }
+  jlong Long(int i) const { return args[i].j; }
+};
+
+// Implements a fake Java method.  An object is returned as a FakeObject
+// pointer in jvalue::l, and is given to the caller as a new local reference.
+typedef std::function<jvalue(const FakeCall &call)> FakeMethodHandler;
+
+// Return values for FakeMethodHandler.
+jvalue FakeVoid();
+jvalue FakeBoolean(bool value);
+jvalue FakeInt(jint value);
+jvalue FakeObjectValue(FakeObject *object);
+
+// The JNI functions, counted by FakeJvm::count().
+enum FakeJniFunction {
+  kJniFindClass,
+  kJniThrowNew,
+  kJniExceptionCheck,
+  kJniExceptionClear,
+  kJniNewGlobalRef,
+  kJniDeleteGlobalRef,
+  kJniDeleteLocalRef,
+  kJniIsInstanceOf,
+  kJniGetObjectClass,
+  kJniGetMethodID,
+  kJniCallObjectMethod,
+  kJniCallBooleanMethod,
+  kJniCallVoidMethod,
+  kJniGetStaticMethodID,
+  kJniCallStaticObjectMethod,
+  kJniCallStaticBooleanMethod,
+  kJniCallStaticVoidMethod,
+  kJniNewStringUTF,
+  kJniGetStringUTFChars,
+  kJniReleaseStringUTFChars,
+  kJniGetArrayLength,
+  kJniNewObjectArray,
+  kJniGetObjectArrayElement,
+  kJniSetObjectArrayElement,
+  kJniNewByteArray,
+  kJniSetByteArrayRegion,
+  kJniRegisterNatives,
+  kJniGetPrimitiveArrayCritical,
+  kJniReleasePrimitiveArrayCritical,
+  kJniNewDirectByteBuffer,
+  kJniGetDirectBufferAddress,
+  kJniGetDirectBufferCapacity,
+  kJniAttachCurrentThread,
+  kJniDetachCurrentThread,
+  kJniGetEnv,
+  kFakeJniFunctionCount
+};
+
+// A snapshot of the JNI call counters.
+struct FakeJniCounts {
+  uint64_t calls[kFakeJniFunctionCount];
+
+  // All the calls, or those made since base was taken.
+  uint64_t Total() const;
+  FakeJniCounts operator-(const FakeJniCounts &base) const;
+  static const char *Name(FakeJniFunction function);
+};
+
+// A Java VM with just enough of the JNI to run the plugin off device.
+// Classes and methods are defined by the test, their implementations are
+// C++ callbacks.  It checks the JNI rules a device with CheckJNI would,
+// aborting with a message on a stale or wrong-thread reference, a null
+// method id, or a call other than ExceptionCheck/ExceptionClear/Delete*Ref
+// while an exception is pending.
+//
+// Threads attached with JavaVM::AttachCurrentThread() are native threads:
+// env->FindClass() only sees classes on the boot class path, like on
+// Android.  Threads attached with AttachJavaThread() stand in for Java
+// threads and also see the app classes.
+//
+// There is one VM per process, see Get().
+class FakeJvm {
+ public:
+  static FakeJvm &Get();
+
+  JavaVM *vm() { return &vm_; }
+
+  // Attaches the calling thread as a Java thread, e.g. the UI thread.
+  // Returns its env.  Detach it with DetachCurrentThread().
+  JNIEnv *AttachJavaThread();
+  void DetachCurrentThread();
+  // The env of the calling thread, or null if it is not attached.
+  static JNIEnv *CurrentEnv();
+
+  // Defines a class, loaded by the app ClassLoader if app_class is set,
+  // otherwise on the boot class path.  super_name is null for
+  // java/lang/Object only.
+  FakeClass *DefineClass(const char *name, const char *super_name,
+                         bool app_class);
+  FakeClass *FindLoadedClass(const char *name);
+  // The java/lang/Class object of a class.
+  static FakeObject *ClassObject(FakeClass *clazz);
+
+  void DefineMethod(FakeClass *clazz, const char *name, const char *sig,
+                    FakeMethodHandler handler);
+  void DefineStaticMethod(FakeClass *clazz, const char *name,
+                          const char *sig, FakeMethodHandler handler);
+  // Declares a static native method, which RegisterNatives() must match.
+  void DeclareNative(FakeClass *clazz, const char *name, const char *sig);
+
+  // The native registered for a method by RegisterNatives(), or null.
+  void *FindNative(FakeClass *clazz, const char *name, const char *sig);
+
+  // Creates objects with no references, to be returned from a handler or
+  // held with Retain().
+  FakeObject *NewObject(FakeClass *clazz);
+  FakeObject *NewString(const std::string &value);
+  FakeObject *NewByteArray(const uint8_t *data, size_t size);
+
+  // References held by fake Java code, e.g. a static field.
+  void Retain(FakeObject *object);
+  void Release(FakeObject *object);
+
+  // Local and global references to objects, for fake Java code calling a
+  // native method.
+  jobject NewLocalRef(JNIEnv *env, FakeObject *object);
+  jobject NewGlobalRef(FakeObject *object);
+  static FakeObject *Resolve(jobject ref);
+
+  // Pushes and pops a frame of local references, as the VM does around a
+  // call to a native method.  Popping deletes the references left in it.
+  void PushLocalFrame(JNIEnv *env);
+  void PopLocalFrame(JNIEnv *env);
+
+  // Makes an exception of the class pending on env.
+  void Throw(JNIEnv *env, const char *class_name);
+
+  // The app and boot ClassLoaders.
+  FakeObject *app_class_loader() const { return app_class_loader_; }
+  FakeObject *boot_class_loader() const { return boot_class_loader_; }
+
+  // Makes every JNI call busy-wait for ns nanoseconds, to approximate the
+  // cost of crossing into the VM on a device when timing a path.  The cost
+  // is the same for every function, 0 by default.
+  void SetTransitionCost(int64_t ns) { transition_ns_.store(ns); }
+
+  FakeJniCounts counts() const;
+  // Objects alive, global references, local references of the calling
+  // thread, and strings and arrays not released yet.
+  size_t live_objects() const { return live_objects_.load(); }
+  size_t global_refs() const;
+  size_t local_refs() const;
+  size_t pinned() const { return pinned_.load(); }
+
+ private:
+  friend struct FakeJniFunctions;
+
+  FakeJvm();
+
+  void Count(FakeJniFunction function) {
+    counts_[function].fetch_add(1, std::memory_order_relaxed);
+    int64_t ns = transition_ns_.load(std::memory_order_relaxed);
+    if (ns) Spin(ns);
+  }
+  static void Spin(int64_t ns);
+
+  JavaVM vm_;
+  FakeObject *app_class_loader_;
+  FakeObject *boot_class_loader_;
+
+  mutable std::mutex mutex_;
+  std::map<std::string, FakeClass *> classes_;
+  std::unordered_set<jobject> global_refs_;
+
+  std::atomic<uint64_t> counts_[kFakeJniFunctionCount];
+  std::atomic<size_t> live_objects_;
+  std::atomic<size_t> pinned_;
+  std::atomic<int64_t> transition_ns_;
+
+  FakeJvm(const FakeJvm &copy) = delete;
+  FakeJvm &operator=(const FakeJvm &copy) = delete;
+};
+
+// Attaches the calling thread as a Java thread for the life of the object.
+class ScopedJavaThread {
+ public:
+  ScopedJavaThread() : env_(FakeJvm::Get().AttachJavaThread()) {}
+  ~ScopedJavaThread() { FakeJvm::Get().DetachCurrentThread(); }
+
+  JNIEnv *env() const { return env_; }
+
+ private:
+  JNIEnv *env_;
+};
+
+}  // namespace test
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_TEST_FAKE_JVM_H
@@ -0,0 +1,628 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "fake_sign_in_helper.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <queue>
+
+#include "token_fixtures.h"
+
+extern "C" jint JNI_OnLoad(JavaVM *vm, void *reserved);
+
+#define HELPER_CLASSNAME "com/google/googlesignin/GoogleSignInHelper"
+#define ACCOUNT_CLASSNAME \
+  "com/google/android/gms/auth/api/signin/GoogleSignInAccount"
+#define ACCOUNT_SIG "Lcom/google/android/gms/auth/api/signin/GoogleSignInAccount;"
+#define STRING_GETTER_SIG "()Ljava/lang/String;"
+
+namespace googlesignin {
+namespace test {
+
+namespace {
+
+// EventRing.STALE_NANOS.
+const int64_t kRingStaleNanos = 1000000000;
+
+// The layout of the ring, see EventRing.java and event_ring.h.
+const size_t kReadIndexOffset = 64;
+const size_t kDrainTimeOffset = 72;
+const size_t kHeaderSize = 128;
+const int32_t kRecordPadding = 0;
+const int32_t kRecordResult = 1;
+const size_t kResultHeaderSize = 24;
+
+int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+std::shared_ptr<const FakeAccount> AccountData(FakeObject *account) {
+  return std::static_pointer_cast<const FakeAccount>(account->data);
+}
+
+// Returns value as a String, or null if it is empty.
+jvalue StringOrNull(FakeJvm &jvm, const std::string &value) {
+  return FakeObjectValue(value.empty() ? nullptr : jvm.NewString(value));
+}
+
+void WritePackedField(const std::string &value,
+                      std::vector<unsigned char> *out) {
+  uint32_t len = value.empty() ? 0xffffffffU : value.size();
+  out->push_back(static_cast<unsigned char>(len >> 24));
+  out->push_back(static_cast<unsigned char>(len >> 16));
+  out->push_back(static_cast<unsigned char>(len >> 8));
+  out->push_back(static_cast<unsigned char>(len));
+  out->insert(out->end(), value.begin(), value.end());
+}
+
+}  // namespace
+
+FakeAccount FakeAccount::Default() {
+  FakeAccount account;
+  account.display_name = "Jane Doe";
+  account.email = "jane.doe@example.com";
+  account.family_name = "Doe";
+  account.given_name = "Jane";
+  account.id = "110169484474386276334";
+  account.id_token = MakeIdToken(
+      "1234567890-abcdefghijklmnopqrstuvwxyz012345.apps.googleusercontent.com",
+      std::chrono::duration_cast<std::chrono::seconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+              .count() +
+          3600);
+  account.photo_url =
+      "https://lh3.googleusercontent.com/a/default-user=s96-c";
+  account.server_auth_code = "4/0AX4XfWh-abcdefghijklmnopqrstuvwxyz0123456789";
+  return account;
+}
+
+// A result waiting to be delivered.
+struct FakeSignInHelper::Delivery {
+  int64_t due_us;
+  uint64_t sequence;
+  jlong handle;
+  int status;
+  std::shared_ptr<const FakeAccount> account;
+
+  bool operator<(const Delivery &other) const {
+    // Earliest first out of the priority queue.
+    return due_us != other.due_us ? due_us > other.due_us
+                                   : sequence > other.sequence;
+  }
+};
+
+// Runs the deliveries when they are due on a pool of Java threads.
+class FakeSignInHelper::Looper {
+ public:
+  Looper(FakeSignInHelper *helper, int threads)
+      : helper_(helper), sequence_(0), pending_(0), stopping_(false) {
+    for (int i = 0; i < threads; i++) {
+      threads_.emplace_back([this]() { Run(); });
+    }
+  }
+
+  ~Looper() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void Post(jlong handle, int status,
+            std::shared_ptr<const FakeAccount> account, int64_t delay_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Delivery delivery = {NowMicros() + delay_us, sequence_++, handle, status,
+                         account};
+    queue_.push(delivery);
+    pending_++;
+    wake_.notify_one();
+  }
+
+  void WaitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_.wait(lock, [this]() { return pending_ == 0; });
+  }
+
+ private:
+  void Run() {
+    ScopedJavaThread java_thread;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      if (queue_.empty()) {
+        if (stopping_) return;
+        wake_.wait(lock);
+        continue;
+      }
+      int64_t wait_us = queue_.top().due_us - NowMicros();
+      if (wait_us > 0) {
+        wake_.wait_for(lock, std::chrono::microseconds(wait_us));
+        continue;
+      }
+      Delivery delivery = queue_.top();
+      queue_.pop();
+      lock.unlock();
+      helper_->DeliverResult(delivery.handle, delivery.status,
+                             delivery.account.get());
+      lock.lock();
+      if (--pending_ == 0) {
+        idle_.notify_all();
+      }
+    }
+  }
+
+  FakeSignInHelper *helper_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::priority_queue<Delivery> queue_;
+  uint64_t sequence_;
+  size_t pending_;
+  bool stopping_;
+  std::vector<std::thread> threads_;
+};
+
+FakeSignInHelper &FakeSignInHelper::Get() {
+  // Never destroyed, like the VM.
+  static FakeSignInHelper *helper = new FakeSignInHelper();
+  return *helper;
+}
+
+FakeSignInHelper::FakeSignInHelper()
+    : jvm_(FakeJvm::Get()),
+      activity_(nullptr),
+      last_fingerprint_(0),
+      responder_(DefaultResponder()),
+      ring_(nullptr),
+      ring_capacity_(0),
+      ring_write_index_(0),
+      ring_reset_ns_(0),
+      configure_(0),
+      resubmit_(0),
+      sign_in_(0),
+      sign_in_silently_(0),
+      sign_out_(0),
+      disconnect_(0),
+      warm_up_(0),
+      pack_account_(0),
+      results_in_ring_(0),
+      results_by_call_(0) {
+  char dir[] = "/tmp/googlesignin-test-XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    abort();
+  }
+  files_dir_ = dir;
+  DefineClasses();
+  looper_.reset(new Looper(this, 1));
+  Load();
+}
+
+FakeSignInHelper::Responder FakeSignInHelper::DefaultResponder() {
+  std::shared_ptr<const FakeAccount> account(
+      new FakeAccount(FakeAccount::Default()));
+  return [account](const FakeRequest &request, bool silent) {
+    FakeResponse response = {kFakeSuccess, account, 0};
+    return response;
+  };
+}
+
+void FakeSignInHelper::DefineClasses() {
+  FakeJvm &jvm = jvm_;
+
+  // The platform.
+  FakeClass *context_class =
+      jvm.DefineClass("android/content/Context", "java/lang/Object", false);
+  jvm.DefineClass("android/app/Activity", "android/content/Context", false);
+  FakeClass *native_activity_class = jvm.DefineClass(
+      "android/app/NativeActivity", "android/app/Activity", false);
+  file_class_ = jvm.DefineClass("java/io/File", "java/lang/Object", false);
+  uri_class_ = jvm.DefineClass("android/net/Uri", "java/lang/Object", false);
+
+  jvm.DefineMethod(context_class, "getClassLoader",
+                   "()Ljava/lang/ClassLoader;", [&jvm](const FakeCall &call) {
+                     return FakeObjectValue(jvm.app_class_loader());
+                   });
+  jvm.DefineMethod(context_class, "getFilesDir", "()Ljava/io/File;",
+                   [this](const FakeCall &call) {
+                     FakeObject *file = jvm_.NewObject(file_class_);
+                     file->string = files_dir_;
+                     return FakeObjectValue(file);
+                   });
+  jvm.DefineMethod(file_class_, "getAbsolutePath", STRING_GETTER_SIG,
+                   [&jvm](const FakeCall &call) {
+                     return FakeObjectValue(jvm.NewString(call.self->string));
+                   });
+  jvm.DefineMethod(uri_class_, "toString", STRING_GETTER_SIG,
+                   [&jvm](const FakeCall &call) {
+                     return FakeObjectValue(jvm.NewString(call.self->string));
+                   });
+
+  // Google Play services.
+  account_class_ =
+      jvm.DefineClass(ACCOUNT_CLASSNAME, "java/lang/Object", true);
+  struct Getter {
+    const char *name;
+    std::string FakeAccount::*field;
+  };
+  static const Getter kGetters[] = {
+      {"getDisplayName", &FakeAccount::display_name},
+      {"getEmail", &FakeAccount::email},
+      {"getFamilyName", &FakeAccount::family_name},
+      {"getGivenName", &FakeAccount::given_name},
+      {"getId", &FakeAccount::id},
+      {"getIdToken", &FakeAccount::id_token},
+      {"getServerAuthCode", &FakeAccount::server_auth_code},
+  };
+  for (const Getter &getter : kGetters) {
+    std::string FakeAccount::*field = getter.field;
+    jvm.DefineMethod(account_class_, getter.name, STRING_GETTER_SIG,
+                     [&jvm, field](const FakeCall &call) {
+                       return StringOrNull(jvm,
+                                           (*AccountData(call.self)).*field);
+                     });
+  }
+  jvm.DefineMethod(account_class_, "getPhotoUrl", "()Landroid/net/Uri;",
+                   [this](const FakeCall &call) {
+                     const std::string &url =
+                         AccountData(call.self)->photo_url;
+                     if (url.empty()) return FakeObjectValue(nullptr);
+                     FakeObject *uri = jvm_.NewObject(uri_class_);
+                     uri->string = url;
+                     return FakeObjectValue(uri);
+                   });
+
+  // GoogleSignInHelper.
+  helper_class_ = jvm.DefineClass(HELPER_CLASSNAME, "java/lang/Object", true);
+  jvm.DeclareNative(helper_class_, "nativeOnResult", "(JI" ACCOUNT_SIG ")V");
+  jvm.DeclareNative(helper_class_, "nativeOnActivityResumed", "()V");
+  jvm.DeclareNative(helper_class_, "nativeTraceEvent", "(IIJ)V");
+  jvm.DeclareNative(helper_class_, "nativePublishEvents", "(I)V");
+
+  jvm.DefineStaticMethod(helper_class_, "enableDebugLogging", "(Z)V",
+                         [](const FakeCall &call) { return FakeVoid(); });
+  jvm.DefineStaticMethod(helper_class_, "enableTracing", "(Z)V",
+                         [](const FakeCall &call) { return FakeVoid(); });
+  jvm.DefineStaticMethod(
+      helper_class_, "configure",
+      "(Landroid/app/Activity;ZLjava/lang/String;ZZZZZLjava/lang/String;"
+      "[Ljava/lang/String;JJ)V",
+      [this](const FakeCall &call) {
+        Configure(call);
+        return FakeVoid();
+      });
+  jvm.DefineStaticMethod(
+      helper_class_, "resubmitConfiguration", "(Landroid/app/Activity;JJ)Z",
+      [this](const FakeCall &call) {
+        return FakeBoolean(Resubmit(call.Long(1), call.Long(2)));
+      });
+  jvm.DefineStaticMethod(helper_class_, "warmUp", "(Landroid/app/Activity;)Z",
+                         [this](const FakeCall &call) {
+                           warm_up_++;
+                           std::lock_guard<std::mutex> lock(mutex_);
+                           return FakeBoolean(last_request_ != nullptr);
+                         });
+  jvm.DefineStaticMethod(helper_class_, "setEventRing",
+                         "(Ljava/nio/ByteBuffer;)V",
+                         [this](const FakeCall &call) {
+                           FakeObject *buffer = call.Object(0);
+                           std::lock_guard<std::mutex> lock(ring_mutex_);
+                           ring_ = buffer ? static_cast<unsigned char *>(
+                                                buffer->address)
+                                          : nullptr;
+                           ring_capacity_ =
+                               buffer ? buffer->capacity - kHeaderSize : 0;
+                           ring_write_index_ = 0;
+                           return FakeVoid();
+                         });
+  jvm.DefineStaticMethod(helper_class_, "signIn", "(Landroid/app/Activity;J)V",
+                         [this](const FakeCall &call) {
+                           sign_in_++;
+                           StartSignIn(call.env, call.Long(1), false);
+                           return FakeVoid();
+                         });
+  jvm.DefineStaticMethod(helper_class_, "signInSilently",
+                         "(Landroid/app/Activity;J)V",
+                         [this](const FakeCall &call) {
+                           sign_in_silently_++;
+                           StartSignIn(call.env, call.Long(1), true);
+                           return FakeVoid();
+                         });
+  jvm.DefineStaticMethod(helper_class_, "signOut", "(Landroid/app/Activity;)V",
+                         [this](const FakeCall &call) {
+                           sign_out_++;
+                           return FakeVoid();
+                         });
+  jvm.DefineStaticMethod(helper_class_, "disconnect",
+                         "(Landroid/app/Activity;)V",
+                         [this](const FakeCall &call) {
+                           disconnect_++;
+                           return FakeVoid();
+                         });
+  jvm.DefineStaticMethod(
+      helper_class_, "packAccount", "(" ACCOUNT_SIG ")[B",
+      [this](const FakeCall &call) {
+        pack_account_++;
+        FakeObject *account = call.Object(0);
+        if (!account) return FakeObjectValue(nullptr);
+        std::vector<unsigned char> packed;
+        Pack(*AccountData(account), &packed);
+        return FakeObjectValue(
+            jvm_.NewByteArray(packed.data(), packed.size()));
+      });
+
+  FakeObject *activity = jvm.NewObject(native_activity_class);
+  activity_ = jvm.NewGlobalRef(activity);
+}
+
+void FakeSignInHelper::Load() {
+  // The VM loads the library on a Java thread.
+  std::thread([this]() {
+    ScopedJavaThread java_thread;
+    if (JNI_OnLoad(jvm_.vm(), nullptr) != JNI_VERSION_1_6) {
+      fprintf(stderr, "JNI_OnLoad failed\n");
+      abort();
+    }
+  }).join();
+}
+
+void FakeSignInHelper::Configure(const FakeCall &call) {
+  configure_++;
+  std::unique_ptr<FakeRequest> request(new FakeRequest());
+  request->use_games_config = call.Boolean(1);
+  request->web_client_id = call.String(2);
+  request->request_auth_code = call.Boolean(3);
+  request->force_refresh_token = call.Boolean(4);
+  request->request_email = call.Boolean(5);
+  request->request_id_token = call.Boolean(6);
+  request->hide_ui_popups = call.Boolean(7);
+  request->account_name = call.String(8);
+  FakeObject *scopes = call.Object(9);
+  if (scopes) {
+    for (FakeObject *scope : scopes->elements) {
+      request->scopes.push_back(scope ? scope->string : std::string());
+    }
+  }
+  jlong fingerprint = call.Long(10);
+  request->handle = call.Long(11);
+
+  // TokenRequest.isValid().
+  bool valid = !request->web_client_id.empty() ||
+               (!request->request_auth_code && !request->request_id_token);
+  jlong handle = request->handle;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (valid) {
+      submitted_.reset(new FakeRequest(*request));
+      last_request_ = std::move(request);
+      last_fingerprint_ = fingerprint;
+    } else {
+      last_request_.reset();
+      last_fingerprint_ = 0;
+    }
+  }
+  if (!valid) {
+    DeliverResult(handle, kFakeDeveloperError, nullptr);
+  }
+}
+
+bool FakeSignInHelper::Resubmit(jlong fingerprint, jlong handle) {
+  resubmit_++;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!last_request_ || last_fingerprint_ != fingerprint) {
+    return false;
+  }
+  last_request_->handle = handle;
+  submitted_.reset(new FakeRequest(*last_request_));
+  return true;
+}
+
+void FakeSignInHelper::StartSignIn(JNIEnv *env, jlong handle, bool silent) {
+  std::unique_ptr<FakeRequest> request;
+  Responder responder;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (submitted_) {
+      request.reset(new FakeRequest(*submitted_));
+    }
+    responder = responder_;
+  }
+  if (!request) {
+    DeliverResult(handle, kFakeDeveloperError, nullptr);
+    return;
+  }
+  FakeResponse response = responder(*request, silent);
+  if (response.delay_us < 0) {
+    return;
+  }
+  looper_->Post(request->handle, response.status, response.account,
+                response.delay_us);
+}
+
+void FakeSignInHelper::DeliverResult(jlong handle, int status,
+                                     const FakeAccount *account) {
+  std::vector<unsigned char> packed;
+  if (account) {
+    Pack(*account, &packed);
+  }
+  if (WriteRing(handle, status, account ? &packed : nullptr)) {
+    results_in_ring_++;
+    return;
+  }
+  results_by_call_++;
+
+  typedef void (*NativeOnResult)(JNIEnv *, jclass, jlong, jint, jobject);
+  NativeOnResult native = reinterpret_cast<NativeOnResult>(jvm_.FindNative(
+      helper_class_, "nativeOnResult", "(JI" ACCOUNT_SIG ")V"));
+  if (!native) {
+    fprintf(stderr, "nativeOnResult is not registered\n");
+    abort();
+  }
+  JNIEnv *env = FakeJvm::CurrentEnv();
+  jvm_.PushLocalFrame(env);
+  jobject j_account = account ? NewAccount(env, *account) : nullptr;
+  jclass clazz = static_cast<jclass>(
+      jvm_.NewLocalRef(env, jvm_.ClassObject(helper_class_)));
+  native(env, clazz, handle, status, j_account);
+  jvm_.PopLocalFrame(env);
+}
+
+bool FakeSignInHelper::WriteRing(jlong handle, int status,
+                                 const std::vector<unsigned char> *account) {
+  // EventRing.writeResult(), which is synchronized.
+  std::lock_guard<std::mutex> lock(ring_mutex_);
+  if (!ring_) {
+    return false;
+  }
+  // System.nanoTime() is CLOCK_MONOTONIC, like steady_clock.
+  int64_t drained = __atomic_load_n(
+      reinterpret_cast<int64_t *>(ring_ + kDrainTimeOffset), __ATOMIC_RELAXED);
+  if (NowMicros() * 1000 - drained > kRingStaleNanos ||
+      drained <= ring_reset_ns_) {
+    return false;
+  }
+  size_t payload = account ? account->size() : 0;
+  size_t size = (kResultHeaderSize + payload + 7) & ~static_cast<size_t>(7);
+  if (size > ring_capacity_) {
+    return false;
+  }
+  // Relaxed, like ByteBuffer.getInt().
+  uint32_t read = __atomic_load_n(
+      reinterpret_cast<uint32_t *>(ring_ + kReadIndexOffset),
+      __ATOMIC_RELAXED);
+  uint32_t write = ring_write_index_;
+  uint32_t offset = write & (ring_capacity_ - 1);
+  uint32_t tail = ring_capacity_ - offset;
+  uint32_t needed = tail < size ? tail + size : size;
+  if (ring_capacity_ - (write - read) < needed) {
+    return false;
+  }
+
+  unsigned char *data = ring_ + kHeaderSize;
+  if (tail < size) {
+    int32_t padding[2] = {static_cast<int32_t>(tail), kRecordPadding};
+    memcpy(data + offset, padding, sizeof(padding));
+    offset = 0;
+  }
+  unsigned char *pos = data + offset;
+  int32_t header[2] = {static_cast<int32_t>(size), kRecordResult};
+  int64_t record_handle = handle;
+  int32_t record_status = status;
+  int32_t length = account ? static_cast<int32_t>(account->size()) : -1;
+  memcpy(pos, header, sizeof(header));
+  memcpy(pos + 8, &record_handle, sizeof(record_handle));
+  memcpy(pos + 16, &record_status, sizeof(record_status));
+  memcpy(pos + 20, &length, sizeof(length));
+  if (account) {
+    memcpy(pos + kResultHeaderSize, account->data(), account->size());
+  }
+  ring_write_index_ = write + needed;
+
+  typedef void (*NativePublishEvents)(JNIEnv *, jclass, jint);
+  NativePublishEvents publish = reinterpret_cast<NativePublishEvents>(
+      jvm_.FindNative(helper_class_, "nativePublishEvents", "(I)V"));
+  if (!publish) {
+    fprintf(stderr, "nativePublishEvents is not registered\n");
+    abort();
+  }
+  JNIEnv *env = FakeJvm::CurrentEnv();
+  jvm_.PushLocalFrame(env);
+  jclass clazz = static_cast<jclass>(
+      jvm_.NewLocalRef(env, jvm_.ClassObject(helper_class_)));
+  publish(env, clazz, static_cast<jint>(ring_write_index_));
+  jvm_.PopLocalFrame(env);
+  return true;
+}
+
+void FakeSignInHelper::Pack(const FakeAccount &account,
+                            std::vector<unsigned char> *out) {
+  WritePackedField(account.display_name, out);
+  WritePackedField(account.email, out);
+  WritePackedField(account.family_name, out);
+  WritePackedField(account.given_name, out);
+  WritePackedField(account.id, out);
+  WritePackedField(account.id_token, out);
+  WritePackedField(account.photo_url, out);
+  WritePackedField(account.server_auth_code, out);
+}
+
+jobject FakeSignInHelper::NewAccount(JNIEnv *env, const FakeAccount &account) {
+  FakeObject *object = jvm_.NewObject(account_class_);
+  object->data = std::make_shared<FakeAccount>(account);
+  return jvm_.NewLocalRef(env, object);
+}
+
+void FakeSignInHelper::SetResponder(Responder responder) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  responder_ = responder;
+}
+
+void FakeSignInHelper::RespondWith(const FakeAccount &account,
+                                   int64_t delay_us) {
+  std::shared_ptr<const FakeAccount> shared(new FakeAccount(account));
+  SetResponder([shared, delay_us](const FakeRequest &request, bool silent) {
+    FakeResponse response = {kFakeSuccess, shared, delay_us};
+    return response;
+  });
+}
+
+void FakeSignInHelper::SetDeliveryThreads(int count) {
+  looper_->WaitIdle();
+  looper_.reset(new Looper(this, count));
+}
+
+void FakeSignInHelper::WaitIdle() { looper_->WaitIdle(); }
+
+void FakeSignInHelper::Reset() {
+  WaitIdle();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    last_request_.reset();
+    last_fingerprint_ = 0;
+    submitted_.reset();
+    responder_ = DefaultResponder();
+  }
+  {
+    // The native code keeps the ring, so Java keeps it too, but as if
+    // nothing had drained it for a while.  It is used again once polled.
+    std::lock_guard<std::mutex> lock(ring_mutex_);
+    ring_reset_ns_ = NowMicros() * 1000;
+  }
+  for (std::atomic<uint64_t> *counter :
+       {&configure_, &resubmit_, &sign_in_, &sign_in_silently_, &sign_out_,
+        &disconnect_, &warm_up_, &pack_account_, &results_in_ring_,
+        &results_by_call_}) {
+    counter->store(0);
+  }
+}
+
+FakeSignInHelper::Counters FakeSignInHelper::counters() const {
+  Counters counters = {configure_.load(),       resubmit_.load(),
+                       sign_in_.load(),         sign_in_silently_.load(),
+                       sign_out_.load(),        disconnect_.load(),
+                       warm_up_.load(),         pack_account_.load(),
+                       results_in_ring_.load(), results_by_call_.load()};
+  return counters;
+}
+
+}  // namespace test
+}  // namespace googlesignin
@@ -0,0 +1,211 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_TEST_FAKE_SIGN_IN_HELPER_H
+#define GOOGLESIGNIN_TEST_FAKE_SIGN_IN_HELPER_H
+
+#include <jni.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fake_jvm.h"
+
+namespace googlesignin {
+namespace test {
+
+// CommonStatusCodes used by the fake.
+enum FakeStatus {
+  kFakeSuccess = 0,
+  kFakeSignInRequired = 4,
+  kFakeInvalidAccount = 5,
+  kFakeNetworkError = 7,
+  kFakeInternalError = 8,
+  kFakeDeveloperError = 10,
+  kFakeError = 13,
+  kFakeInterrupted = 14,
+  kFakeTimeout = 15,
+  kFakeCanceled = 16,
+};
+
+// The account returned by a fake sign-in.  An empty field is null in Java.
+struct FakeAccount {
+  std::string display_name;
+  std::string email;
+  std::string family_name;
+  std::string given_name;
+  std::string id;
+  std::string id_token;
+  std::string photo_url;
+  std::string server_auth_code;
+
+  // An account with every field set and an ID token of the usual size.
+  static FakeAccount Default();
+};
+
+// A request submitted to the fake by configure() or resubmitConfiguration().
+struct FakeRequest {
+  jlong handle;
+  bool use_games_config;
+  std::string web_client_id;
+  bool request_auth_code;
+  bool force_refresh_token;
+  bool request_email;
+  bool request_id_token;
+  bool hide_ui_popups;
+  std::string account_name;
+  std::vector<std::string> scopes;
+};
+
+// How the fake answers a sign-in.
+struct FakeResponse {
+  int status;
+  // The signed in account, null if there is none.
+  std::shared_ptr<const FakeAccount> account;
+  // How long after the sign-in was started the result is delivered.  A
+  // negative delay withholds it, the test delivers it with DeliverResult().
+  int64_t delay_us;
+};
+
+// Stands in for GoogleSignInHelper.java, GoogleSignInAccount and the
+// activity, on top of FakeJvm.  Sign-ins are answered by a scriptable
+// responder.  Results are delivered on a pool of fake Java threads after the
+// delay the responder picks, through the event ring once the native code
+// has set it up and while it keeps draining it, and through nativeOnResult
+// otherwise, like GoogleSignInHelper.onResult().
+//
+// Get() also loads the plugin, i.e. calls JNI_OnLoad, so there is one per
+// process.
+class FakeSignInHelper {
+ public:
+  typedef std::function<FakeResponse(const FakeRequest &request, bool silent)>
+      Responder;
+
+  // Calls to the fake Java methods.
+  struct Counters {
+    uint64_t configure;
+    uint64_t resubmit;
+    uint64_t sign_in;
+    uint64_t sign_in_silently;
+    uint64_t sign_out;
+    uint64_t disconnect;
+    uint64_t warm_up;
+    uint64_t pack_account;
+    uint64_t results_in_ring;
+    uint64_t results_by_call;
+  };
+
+  static FakeSignInHelper &Get();
+
+  // A global reference to the activity, a NativeActivity so the app classes
+  // are only found through its ClassLoader.
+  jobject activity() const { return activity_; }
+  // Returned by the activity's getFilesDir().
+  const std::string &files_dir() const { return files_dir_; }
+
+  // Replaces the responder.  The default answers with kFakeSuccess and
+  // FakeAccount::Default() right away.
+  void SetResponder(Responder responder);
+  static Responder DefaultResponder();
+  // Sets a responder answering every sign-in with kFakeSuccess and a copy of
+  // account after delay_us.
+  void RespondWith(const FakeAccount &account, int64_t delay_us);
+
+  // Sets the number of threads results are delivered on, 1 by default.
+  // Results due at the same time can be delivered in any order.
+  void SetDeliveryThreads(int count);
+
+  // Waits for the scheduled results to be delivered, then forgets the
+  // last request, the counters and the responder.  The event ring is kept
+  // but only used again once it is drained.
+  void Reset();
+  // Waits for the scheduled results to be delivered.
+  void WaitIdle();
+
+  // Delivers a result as GoogleSignInHelper.onResult() does.  Must be
+  // called on an attached thread.
+  void DeliverResult(jlong handle, int status, const FakeAccount *account);
+
+  // Creates a GoogleSignInAccount, returning a local reference on env.
+  jobject NewAccount(JNIEnv *env, const FakeAccount &account);
+
+  // Packs account as GoogleSignInHelper.packAccount() does.
+  static void Pack(const FakeAccount &account,
+                   std::vector<unsigned char> *out);
+
+  Counters counters() const;
+
+ private:
+  struct Delivery;
+  class Looper;
+
+  FakeSignInHelper();
+
+  void DefineClasses();
+  void Load();
+
+  // The bodies of the fake Java methods.
+  void Configure(const FakeCall &call);
+  bool Resubmit(jlong fingerprint, jlong handle);
+  void StartSignIn(JNIEnv *env, jlong handle, bool silent);
+  bool WriteRing(jlong handle, int status,
+                 const std::vector<unsigned char> *account);
+
+  FakeJvm &jvm_;
+  FakeClass *helper_class_;
+  FakeClass *account_class_;
+  FakeClass *uri_class_;
+  FakeClass *file_class_;
+  jobject activity_;
+  std::string files_dir_;
+
+  // The Java statics, guarded by mutex_.
+  mutable std::mutex mutex_;
+  std::unique_ptr<FakeRequest> last_request_;
+  jlong last_fingerprint_;
+  // The request the fragment signs in with, as set by submitRequest().
+  std::unique_ptr<FakeRequest> submitted_;
+  Responder responder_;
+  unsigned char *ring_;
+  size_t ring_capacity_;
+  // EventRing.writeIndex.
+  uint32_t ring_write_index_;
+  // When Reset() was last called, the ring is only used if drained since.
+  int64_t ring_reset_ns_;
+  std::mutex ring_mutex_;
+
+  std::atomic<uint64_t> configure_;
+  std::atomic<uint64_t> resubmit_;
+  std::atomic<uint64_t> sign_in_;
+  std::atomic<uint64_t> sign_in_silently_;
+  std::atomic<uint64_t> sign_out_;
+  std::atomic<uint64_t> disconnect_;
+  std::atomic<uint64_t> warm_up_;
+  std::atomic<uint64_t> pack_account_;
+  std::atomic<uint64_t> results_in_ring_;
+  std::atomic<uint64_t> results_by_call_;
+
+  std::unique_ptr<Looper> looper_;
+};
+
+}  // namespace test
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_TEST_FAKE_SIGN_IN_HELPER_H
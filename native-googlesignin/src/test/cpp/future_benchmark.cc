@@ -0,0 +1,159 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// Benchmarks of Future: the time from Complete() on one thread to a thread
+// blocked in Wait() or WaitFor() running again, and the cost of Complete()
+// and of polling Pending().  The wake latency is dominated by the scheduler,
+// so the percentiles matter more than the mean.
+
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "future.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const int kPendingStatus = -100;
+
+// How long the signalling thread lets the waiter block before completing, so
+// the waiter is asleep in the kernel rather than still checking Pending().
+const std::chrono::microseconds kBlockTime(200);
+
+// The wake benchmarks run a fixed number of signals, so the percentiles are
+// over the same sample count whatever --benchmark_min_time is.
+const int kWakeSamples = 1000;
+
+void ReportPercentiles(benchmark::State &state, std::vector<double> *samples) {
+  if (samples->empty()) return;
+  std::sort(samples->begin(), samples->end());
+  state.counters["p50_us"] = (*samples)[samples->size() / 2];
+  state.counters["p99_us"] = (*samples)[samples->size() * 99 / 100];
+  state.counters["max_us"] = samples->back();
+}
+
+// Signal-to-wake: a waiter blocks on a fresh future, the benchmark thread
+// completes it and the time until the waiter returns from the wait is
+// recorded.  Arg 0 waits with Wait(), otherwise with WaitFor(arg ms).
+void BM_SignalToWake(benchmark::State &state) {
+  const int timeout_ms = static_cast<int>(state.range(0));
+  std::vector<double> samples;
+  for (auto _ : state) {
+    Future<int> future(kPendingStatus);
+    std::atomic<bool> waiting(false);
+    Clock::time_point woke;
+    std::thread waiter([&]() {
+      waiting.store(true, std::memory_order_release);
+      if (timeout_ms == 0) {
+        future.Wait();
+      } else {
+        while (!future.WaitFor(timeout_ms)) {
+        }
+      }
+      woke = Clock::now();
+    });
+    while (!waiting.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(kBlockTime);
+
+    Clock::time_point signalled = Clock::now();
+    future.Complete(0, nullptr);
+    waiter.join();
+
+    double latency =
+        std::chrono::duration<double>(woke - signalled).count();
+    state.SetIterationTime(latency);
+    samples.push_back(latency * 1e6);
+  }
+  ReportPercentiles(state, &samples);
+}
+BENCHMARK(BM_SignalToWake)
+    ->Arg(0)
+    ->Arg(1000)
+    ->Iterations(kWakeSamples)
+    ->UseManualTime();
+
+// The same with several waiters on one future, reporting the time until the
+// last of them is running.
+void BM_SignalToWakeAll(benchmark::State &state) {
+  const int waiter_count = static_cast<int>(state.range(0));
+  std::vector<double> samples;
+  for (auto _ : state) {
+    Future<int> future(kPendingStatus);
+    std::atomic<int> waiting(0);
+    std::vector<Clock::time_point> woke(waiter_count);
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < waiter_count; i++) {
+      waiters.emplace_back([&, i]() {
+        waiting.fetch_add(1, std::memory_order_release);
+        future.Wait();
+        woke[i] = Clock::now();
+      });
+    }
+    while (waiting.load(std::memory_order_acquire) < waiter_count) {
+      std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(kBlockTime);
+
+    Clock::time_point signalled = Clock::now();
+    future.Complete(0, nullptr);
+    for (size_t i = 0; i < waiters.size(); i++) waiters[i].join();
+
+    double latency = std::chrono::duration<double>(
+                         *std::max_element(woke.begin(), woke.end()) -
+                         signalled)
+                         .count();
+    state.SetIterationTime(latency);
+    samples.push_back(latency * 1e6);
+  }
+  ReportPercentiles(state, &samples);
+}
+BENCHMARK(BM_SignalToWakeAll)
+    ->Arg(2)
+    ->Arg(8)
+    ->Iterations(kWakeSamples)
+    ->UseManualTime();
+
+// Complete() with nobody waiting, which skips the futex wake.
+void BM_CompleteWithoutWaiters(benchmark::State &state) {
+  Future<int> future(kPendingStatus);
+  for (auto _ : state) {
+    future.Reset();
+    future.Complete(0, nullptr);
+  }
+}
+BENCHMARK(BM_CompleteWithoutWaiters);
+
+// What a game loop polling the future each frame pays.
+void BM_Pending(benchmark::State &state) {
+  Future<int> future(kPendingStatus);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(future.Pending());
+  }
+}
+BENCHMARK(BM_Pending);
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
+
+BENCHMARK_MAIN();
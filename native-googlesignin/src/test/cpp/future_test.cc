@@ -0,0 +1,224 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "future.h"
+#include "google_signin_bridge.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+struct CallbackRecord {
+  int calls = 0;
+  std::thread::id thread;
+};
+
+void RecordCallback(void *user_data) {
+  CallbackRecord *record = static_cast<CallbackRecord *>(user_data);
+  record->calls++;
+  record->thread = std::this_thread::get_id();
+}
+
+const int kPendingStatus = -100;
+
+TEST(FutureTest, InlineCallbackRunsOnCompletingThread) {
+  Future<int> future(kPendingStatus);
+  CallbackRecord record;
+  future.SetCompletionCallback(RecordCallback, &record, false);
+  std::thread::id completing;
+  std::thread([&]() {
+    completing = std::this_thread::get_id();
+    future.Complete(0, nullptr);
+  }).join();
+  EXPECT_EQ(1, record.calls);
+  EXPECT_EQ(completing, record.thread);
+}
+
+TEST(FutureTest, QueuedCallbackRunsOnDispatchingThread) {
+  Future<int> future(kPendingStatus);
+  CallbackRecord record;
+  future.SetCompletionCallback(RecordCallback, &record, true);
+  std::thread([&]() { future.Complete(0, nullptr); }).join();
+  EXPECT_EQ(0, record.calls);
+  GoogleSignIn_DispatchCallbacks();
+  EXPECT_EQ(1, record.calls);
+  EXPECT_EQ(std::this_thread::get_id(), record.thread);
+  GoogleSignIn_DispatchCallbacks();
+  EXPECT_EQ(1, record.calls);
+}
+
+TEST(FutureTest, CallbackOnCompletedFutureRunsRightAway) {
+  Future<int> future(kPendingStatus);
+  future.Complete(0, nullptr);
+  CallbackRecord record;
+  future.SetCompletionCallback(RecordCallback, &record, false);
+  EXPECT_EQ(1, record.calls);
+}
+
+TEST(FutureTest, CallbackRunsOnce) {
+  Future<int> future(kPendingStatus);
+  CallbackRecord record;
+  future.SetCompletionCallback(RecordCallback, &record, false);
+  future.Complete(0, nullptr);
+  future.Reset();
+  future.Complete(0, nullptr);
+  EXPECT_EQ(1, record.calls);
+}
+
+// A future reused for another operation must not call back the code that
+// waited on the previous one.
+TEST(FutureTest, ResetDropsCallbacksOfThePreviousOperation) {
+  Future<int> future(kPendingStatus);
+  CallbackRecord stale;
+  future.SetCompletionCallback(RecordCallback, &stale, false);
+  CallbackRecord stale_queued;
+  future.SetCompletionCallback(RecordCallback, &stale_queued, true);
+  future.Reset();
+
+  CallbackRecord current;
+  future.SetCompletionCallback(RecordCallback, &current, false);
+  future.Complete(0, nullptr);
+  GoogleSignIn_DispatchCallbacks();
+  EXPECT_EQ(0, stale.calls);
+  EXPECT_EQ(0, stale_queued.calls);
+  EXPECT_EQ(1, current.calls);
+}
+
+TEST(FutureTest, ResetMakesFuturePendingWithNoResult) {
+  Future<int> future(kPendingStatus);
+  int result = 7;
+  future.Complete(3, &result);
+  EXPECT_FALSE(future.Pending());
+  EXPECT_EQ(3, future.Status());
+  EXPECT_EQ(&result, future.Result());
+  future.Reset();
+  EXPECT_TRUE(future.Pending());
+  EXPECT_EQ(kPendingStatus, future.Status());
+  EXPECT_EQ(nullptr, future.Result());
+}
+
+TEST(FutureTest, WaitForTimesOutWhilePending) {
+  Future<int> future(kPendingStatus);
+  EXPECT_FALSE(future.WaitFor(10));
+  EXPECT_TRUE(future.Pending());
+  future.Complete(0, nullptr);
+  EXPECT_TRUE(future.WaitFor(0));
+}
+
+// The stress tests are meant to be run under -DGOOGLESIGNIN_SANITIZE=thread
+// as well, where a missing happens-before edge is reported as a race on the
+// plain fields of the result.
+struct Payload {
+  int round;
+  std::vector<int> values;
+};
+
+const int kStressRounds = 200;
+const int kStressWaiters = 4;
+
+TEST(FutureStressTest, WaitersSeeTheResultPublishedBeforeComplete) {
+  for (int round = 0; round < kStressRounds; round++) {
+    Future<Payload> future(kPendingStatus);
+    Payload payload;
+    std::atomic<int> mismatches(0);
+    std::vector<std::thread> waiters;
+    for (int i = 0; i < kStressWaiters; i++) {
+      waiters.emplace_back([&future, &mismatches, round, i]() {
+        // Half block in Wait(), half poll with short timeouts.
+        if (i % 2 == 0) {
+          future.Wait();
+        } else {
+          while (!future.WaitFor(1)) {
+          }
+        }
+        // The payload is read before Status(), so only the ordering of
+        // Wait() and Result() makes it visible.
+        const Payload *result = future.Result();
+        if (!result || result->round != round || result->values.size() != 3 ||
+            result->values[2] != round || future.Status() != round) {
+          mismatches++;
+        }
+      });
+    }
+    std::thread completer([&future, &payload, round]() {
+      payload.round = round;
+      payload.values.assign(3, round);
+      future.Complete(round, &payload);
+    });
+    completer.join();
+    for (size_t i = 0; i < waiters.size(); i++) waiters[i].join();
+    EXPECT_EQ(0, mismatches.load()) << "round " << round;
+  }
+}
+
+void CountCallback(void *user_data) {
+  static_cast<std::atomic<int> *>(user_data)->fetch_add(1);
+}
+
+TEST(FutureStressTest, CallbacksRacingCompletionRunExactlyOnce) {
+  const int kCallbacksPerThread = 50;
+  for (int round = 0; round < kStressRounds; round++) {
+    Future<int> future(kPendingStatus);
+    std::atomic<int> calls(0);
+    std::vector<std::thread> registrars;
+    for (int i = 0; i < kStressWaiters; i++) {
+      registrars.emplace_back([&future, &calls]() {
+        for (int n = 0; n < kCallbacksPerThread; n++) {
+          future.SetCompletionCallback(CountCallback, &calls, false);
+        }
+      });
+    }
+    std::thread completer([&future]() { future.Complete(0, nullptr); });
+    completer.join();
+    for (size_t i = 0; i < registrars.size(); i++) registrars[i].join();
+    EXPECT_EQ(kStressWaiters * kCallbacksPerThread, calls.load())
+        << "round " << round;
+  }
+}
+
+TEST(FutureStressTest, QueuedCallbacksFromManyThreadsAreAllDispatched) {
+  const int kFutures = 64;
+  std::atomic<int> calls(0);
+  std::vector<std::unique_ptr<Future<int>>> futures;
+  for (int i = 0; i < kFutures; i++) {
+    futures.emplace_back(new Future<int>(kPendingStatus));
+    futures.back()->SetCompletionCallback(CountCallback, &calls, true);
+  }
+  std::vector<std::thread> completers;
+  for (int t = 0; t < kStressWaiters; t++) {
+    completers.emplace_back([&futures, t]() {
+      for (int i = t; i < kFutures; i += kStressWaiters) {
+        futures[i]->Complete(0, nullptr);
+      }
+    });
+  }
+  // Dispatch while the completions are still arriving.
+  while (calls.load() < kFutures) {
+    GoogleSignIn_DispatchCallbacks();
+    std::this_thread::yield();
+  }
+  for (size_t i = 0; i < completers.size(); i++) completers[i].join();
+  GoogleSignIn_DispatchCallbacks();
+  EXPECT_EQ(kFutures, calls.load());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
@@ -0,0 +1,182 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+
+// Throughput of reading the claims of ID tokens, over a corpus shaped like
+// the tokens apps actually receive, see MakeIdTokenCorpus(), and of
+// verifying tokens signed with the test keys of token_fixtures.h.  The label
+// says which base64url decoder the build uses; the default x86-64 host
+// build has no SSSE3, configure with -DCMAKE_CXX_FLAGS=-mssse3 to measure
+// the vector path.
+
+#include <benchmark/benchmark.h>
+#include <string.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base64url.h"
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "google_signin_bridge.h"
+#include "google_signin_user.h"
+#include "google_signin_user_impl.h"
+#include "id_token.h"
+#include "id_token_verifier.h"
+#include "jwks_cache.h"
+#include "token_fixtures.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+const size_t kCorpusSize = 1024;
+
+const std::vector<std::string> &Corpus() {
+  static const std::vector<std::string> corpus =
+      MakeIdTokenCorpus(kCorpusSize, 20170901);
+  return corpus;
+}
+
+const char *DecoderName() {
+#if defined(__SSSE3__)
+  return "ssse3";
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  return "neon";
+#else
+  return "scalar";
+#endif
+}
+
+// Decodes the payload section of each token in turn, which is the bulk of
+// what Decode() runs the base64url decoder over.
+void BM_Base64UrlDecodePayload(benchmark::State &state) {
+  struct Section {
+    const char *data;
+    size_t length;
+  };
+  std::vector<Section> payloads;
+  size_t max_length = 0;
+  for (const std::string &token : Corpus()) {
+    size_t begin = token.find('.') + 1;
+    size_t end = token.find('.', begin);
+    payloads.push_back({token.data() + begin, end - begin});
+    if (end - begin > max_length) max_length = end - begin;
+  }
+  std::unique_ptr<unsigned char[]> decoded(
+      new unsigned char[Base64UrlDecodedSize(max_length)]);
+
+  size_t i = 0;
+  int64_t bytes = 0;
+  for (auto _ : state) {
+    const Section &payload = payloads[i++ % payloads.size()];
+    size_t size = 0;
+    bool ok = Base64UrlDecode(payload.data, payload.length, decoded.get(),
+                              &size);
+    benchmark::DoNotOptimize(ok);
+    benchmark::ClobberMemory();
+    bytes += payload.length;
+  }
+  state.SetBytesProcessed(bytes);
+  state.SetLabel(DecoderName());
+}
+BENCHMARK(BM_Base64UrlDecodePayload);
+
+// Decodes whole tokens: both base64url sections, the JSON scan and the
+// unescaping of the claims.
+void BM_DecodeIdTokenClaims(benchmark::State &state) {
+  const std::vector<std::string> &corpus = Corpus();
+  size_t i = 0;
+  int64_t bytes = 0;
+  for (auto _ : state) {
+    const std::string &token = corpus[i++ % corpus.size()];
+    std::unique_ptr<IdTokenClaims> claims(
+        IdTokenClaims::Decode(token.data(), token.size()));
+    if (!claims) {
+      state.SkipWithError("a corpus token did not decode");
+      break;
+    }
+    benchmark::DoNotOptimize(claims->exp);
+    bytes += token.size();
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(bytes);
+  state.SetLabel(DecoderName());
+}
+BENCHMARK(BM_DecodeIdTokenClaims);
+
+// Reading the claims and the expiry through the bridge, as the C# side
+// does, from users whose tokens have been decoded once already.
+void BM_BridgeGetIdTokenClaims(benchmark::State &state) {
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  JNIEnv *env = FakeJvm::CurrentEnv();
+  const std::vector<std::string> &corpus = Corpus();
+  std::vector<GoogleSignInUser *> users;
+  for (size_t i = 0; i < 64; i++) {
+    FakeAccount account = FakeAccount::Default();
+    account.id_token = corpus[i];
+    jobject object = helper.NewAccount(env, account);
+    GoogleSignInUserImpl::Initialize(object);
+    users.push_back(GoogleSignInUserImpl::UserFromAccount(object));
+    env->DeleteLocalRef(object);
+    users.back()->GetIdTokenClaims();
+  }
+
+  size_t i = 0;
+  for (auto _ : state) {
+    GoogleSignInUser *user = users[i++ % users.size()];
+    GoogleSignInIdTokenClaims claims;
+    bool ok = GoogleSignIn_GetIdTokenClaims(user, &claims);
+    benchmark::DoNotOptimize(ok);
+    benchmark::DoNotOptimize(GoogleSignIn_GetIdTokenExpiry(user));
+  }
+  state.SetItemsProcessed(state.iterations());
+  for (GoogleSignInUser *user : users) user->Release();
+}
+BENCHMARK(BM_BridgeGetIdTokenClaims);
+
+// Verifications per second of a token whose claims are already decoded, as
+// VerifyIdToken() does with the claims cached on the user: the SHA-256 of
+// the signed part, the RSA or ECDSA verification and the claim checks.
+void BM_VerifyIdToken(benchmark::State &state, const char *token) {
+  std::unique_ptr<JwksCache> keys(JwksCache::Parse(kTestJwks,
+                                                   strlen(kTestJwks)));
+  size_t length = strlen(token);
+  std::unique_ptr<IdTokenClaims> claims(IdTokenClaims::Decode(token, length));
+  for (auto _ : state) {
+    IdTokenStatus status =
+        VerifyIdToken(token, length, *claims, *keys, kTestAudience,
+                      1700000000);
+    if (status != kIdTokenValid) {
+      state.SkipWithError("the token did not verify");
+      break;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK_CAPTURE(BM_VerifyIdToken, rs256, kRs256IdToken);
+BENCHMARK_CAPTURE(BM_VerifyIdToken, es256, kEs256IdToken);
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
+
+int main(int argc, char **argv) {
+  // The users are read from fake accounts on this thread.
+  googlesignin::test::ScopedJavaThread java_thread;
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,196 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// Verification of ID tokens signed with the test keys in token_fixtures.h,
+// directly and through the plugin.
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "fake_sign_in_helper.h"
+#include "google_signin_bridge.h"
+#include "id_token.h"
+#include "id_token_verifier.h"
+#include "jwks_cache.h"
+#include "token_fixtures.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+// Well after the tokens were issued and before they expire, but for
+// kExpiredIdToken.
+const int64_t kNowSeconds = 1700000000;
+
+// The same claims as kRs256IdToken, with the given header.
+std::string WithHeader(const std::string &header) {
+  std::string token(kRs256IdToken);
+  return Base64UrlEncode(header.data(), header.size()) +
+         token.substr(token.find('.'));
+}
+
+class IdTokenVerifierTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    keys_.reset(JwksCache::Parse(kTestJwks, strlen(kTestJwks)));
+    ASSERT_NE(nullptr, keys_);
+    ASSERT_EQ(2u, keys_->size());
+  }
+
+  IdTokenStatus Verify(const std::string &token,
+                       int64_t now_seconds = kNowSeconds,
+                       const char *audience = kTestAudience) {
+    std::unique_ptr<IdTokenClaims> claims(
+        IdTokenClaims::Decode(token.data(), token.size()));
+    if (!claims) return kIdTokenMalformed;
+    return VerifyIdToken(token.data(), token.size(), *claims, *keys_,
+                         audience, now_seconds);
+  }
+
+  std::unique_ptr<JwksCache> keys_;
+};
+
+TEST_F(IdTokenVerifierTest, AcceptsTokensSignedWithEitherKey) {
+  EXPECT_EQ(kIdTokenValid, Verify(kRs256IdToken));
+  EXPECT_EQ(kIdTokenValid, Verify(kEs256IdToken));
+}
+
+TEST_F(IdTokenVerifierTest, RejectsAnAlteredToken) {
+  std::string token(kRs256IdToken);
+  size_t signature = token.rfind('.') + 1;
+  std::string bad_signature = token;
+  bad_signature[signature + 10] = bad_signature[signature + 10] == 'A' ? 'B'
+                                                                       : 'A';
+  EXPECT_EQ(kIdTokenBadSignature, Verify(bad_signature));
+
+  // The payload of another token under this token's signature.
+  std::string other(kWrongAudienceIdToken);
+  std::string swapped = token.substr(0, token.find('.')) +
+                        other.substr(other.find('.'), other.rfind('.') -
+                                                          other.find('.')) +
+                        token.substr(token.rfind('.'));
+  EXPECT_EQ(kIdTokenBadSignature, Verify(swapped));
+
+  std::string es256(kEs256IdToken);
+  es256[es256.rfind('.') + 5] ^= 1;
+  EXPECT_EQ(kIdTokenBadSignature, Verify(es256));
+}
+
+TEST_F(IdTokenVerifierTest, ChecksTheHeaderAgainstTheKeys) {
+  EXPECT_EQ(kIdTokenUnknownKey,
+            Verify(WithHeader(
+                "{\"alg\":\"RS256\",\"kid\":\"retired\",\"typ\":\"JWT\"}")));
+  EXPECT_EQ(kIdTokenUnsupportedAlgorithm,
+            Verify(WithHeader("{\"alg\":\"HS256\",\"kid\":\"test-rsa-2048\","
+                              "\"typ\":\"JWT\"}")));
+  // The key decides the algorithm, not the token.
+  EXPECT_EQ(kIdTokenBadSignature,
+            Verify(WithHeader("{\"alg\":\"ES256\",\"kid\":\"test-rsa-2048\","
+                              "\"typ\":\"JWT\"}")));
+  EXPECT_EQ(kIdTokenMalformed, Verify("not.a-token"));
+}
+
+TEST_F(IdTokenVerifierTest, ChecksTheClaims) {
+  EXPECT_EQ(kIdTokenWrongIssuer, Verify(kWrongIssuerIdToken));
+  EXPECT_EQ(kIdTokenWrongAudience, Verify(kWrongAudienceIdToken));
+  EXPECT_EQ(kIdTokenWrongAudience, Verify(kRs256IdToken, kNowSeconds, ""));
+  EXPECT_EQ(kIdTokenWrongAudience,
+            Verify(kRs256IdToken, kNowSeconds, nullptr));
+  EXPECT_EQ(kIdTokenExpired, Verify(kExpiredIdToken));
+}
+
+TEST_F(IdTokenVerifierTest, AllowsAMinuteOfClockSkew) {
+  const int64_t expiry = 1500000000;
+  EXPECT_EQ(kIdTokenValid, Verify(kExpiredIdToken, expiry + 59));
+  EXPECT_EQ(kIdTokenExpired, Verify(kExpiredIdToken, expiry + 60));
+}
+
+// Through the plugin, which checks against the configured web client id.
+class PluginVerifyTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    helper_.Reset();
+    FakeAccount account = FakeAccount::Default();
+    account.id_token = kRs256IdToken;
+    helper_.RespondWith(account, 0);
+    plugin_ = GoogleSignIn_Create(helper_.activity());
+    Configure(plugin_, kTestAudience);
+    GoogleSignInFuture_t future = GoogleSignIn_SignIn(plugin_);
+    ASSERT_TRUE(GoogleSignIn_Wait(future, 10000));
+    user_ = GoogleSignIn_Result(future);
+    ASSERT_NE(nullptr, user_);
+  }
+  void TearDown() override {
+    GoogleSignIn_ReleaseUser(user_);
+    helper_.WaitIdle();
+    GoogleSignIn_Dispose(plugin_);
+  }
+
+  static void Configure(GoogleSignIn_t plugin, const char *web_client_id) {
+    GoogleSignIn_Configure(plugin, false, web_client_id, false, false, true,
+                           true, false, nullptr, 0, nullptr);
+  }
+
+  FakeSignInHelper &helper_ = FakeSignInHelper::Get();
+  GoogleSignIn_t plugin_;
+  GoogleSignInUser_t user_ = nullptr;
+};
+
+TEST_F(PluginVerifyTest, VerifiesAgainstTheLoadedKeysAndConfiguration) {
+  EXPECT_EQ(kIdTokenUnknownKey, GoogleSignIn_VerifyIdToken(plugin_, user_));
+  ASSERT_TRUE(GoogleSignIn_LoadJwks(plugin_, kTestJwks, strlen(kTestJwks)));
+  EXPECT_EQ(kIdTokenValid, GoogleSignIn_VerifyIdToken(plugin_, user_));
+
+  Configure(plugin_, "other.apps.googleusercontent.com");
+  EXPECT_EQ(kIdTokenWrongAudience,
+            GoogleSignIn_VerifyIdToken(plugin_, user_));
+}
+
+// Verifying on another thread while the configuration changes sees either
+// audience, never a configuration being replaced.
+TEST_F(PluginVerifyTest, VerifiesWhileReconfiguring) {
+  ASSERT_TRUE(GoogleSignIn_LoadJwks(plugin_, kTestJwks, strlen(kTestJwks)));
+  std::atomic<bool> done(false);
+  std::atomic<int> valid(0);
+  std::atomic<int> wrong_audience(0);
+  std::thread verifier([this, &done, &valid, &wrong_audience] {
+    while (!done.load()) {
+      int status = GoogleSignIn_VerifyIdToken(plugin_, user_);
+      if (status == kIdTokenValid) {
+        valid++;
+      } else {
+        EXPECT_EQ(kIdTokenWrongAudience, status);
+        wrong_audience++;
+      }
+      std::this_thread::yield();
+    }
+  });
+  for (int i = 0; i < 200; i++) {
+    Configure(plugin_, i % 2 ? kTestAudience
+                             : "other.apps.googleusercontent.com");
+    std::this_thread::yield();
+  }
+  Configure(plugin_, kTestAudience);
+  done = true;
+  verifier.join();
+  EXPECT_GT(valid + wrong_audience, 0);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
@@ -0,0 +1,75 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// Benchmarks of FindClass() with and without its cache, counting the JNI
+// calls each lookup makes.  This binary never creates the plugin, so the
+// cache can be cleared between iterations.
+
+#include <benchmark/benchmark.h>
+#include <future>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "jni_init.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+// Looks up class_name state.iterations() times on a native thread, as the
+// callbacks of a NativeActivity app do, clearing the cache before each
+// lookup unless cached is set.
+void BM_FindClass(benchmark::State &state, const char *class_name,
+                  bool cached) {
+  jobject activity = FakeSignInHelper::Get().activity();
+  std::async(std::launch::async, [&]() {
+    JNIEnv *env = GetJniEnv();
+    ClearClassCache(env);
+    FindClass(class_name, activity);
+    FakeJniCounts before = FakeJvm::Get().counts();
+    for (auto _ : state) {
+      if (!cached) {
+        state.PauseTiming();
+        ClearClassCache(env);
+        state.ResumeTiming();
+      }
+      benchmark::DoNotOptimize(FindClass(class_name, activity));
+    }
+    FakeJniCounts calls = FakeJvm::Get().counts() - before;
+    // Clearing the cache deletes the references the lookups made.
+    uint64_t total = calls.Total() - calls.calls[kJniDeleteGlobalRef];
+    state.counters["jni_calls"] = benchmark::Counter(
+        static_cast<double>(total), benchmark::Counter::kAvgIterations);
+    ClearClassCache(env);
+  }).get();
+}
+BENCHMARK_CAPTURE(BM_FindClass, system_cached, "java/lang/String", true);
+BENCHMARK_CAPTURE(BM_FindClass, system_uncached, "java/lang/String", false);
+BENCHMARK_CAPTURE(BM_FindClass, app_cached,
+                  "com/google/googlesignin/GoogleSignInHelper", true);
+BENCHMARK_CAPTURE(BM_FindClass, app_uncached,
+                  "com/google/googlesignin/GoogleSignInHelper", false);
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
+
+int main(int argc, char **argv) {
+  googlesignin::test::ScopedJavaThread ui_thread;
+  googlesignin::test::FakeSignInHelper::Get();
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,610 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "jni_replayer.h"
+
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "token_fixtures.h"
+
+#define RECORDING_MAGIC "GSIR"
+#define RECORDING_MAGIC_SIZE 4
+// Bytes of each hash in the recording.
+#define HASH_SIZE 8
+// The hashed fields of a result.
+#define RESULT_FIELDS 8
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Used when the recording starts with a sign-in instead of a configuration.
+const char kReplayWebClientId[] =
+    "1234567890-abcdefghijklmnopqrstuvwxyz012345.apps.googleusercontent.com";
+
+const char *const kPhaseNames[] = {
+    "configure", "sign_in_call", "result", "round_trip", "sign_out", "lag",
+};
+static_assert(sizeof(kPhaseNames) / sizeof(kPhaseNames[0]) == kPhaseCount,
+              "a name for every phase");
+
+int64_t NanosBetween(Clock::time_point start, Clock::time_point end) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+      .count();
+}
+
+// Reads the fields of a recording, see jni_recorder.h.
+class Reader {
+ public:
+  explicit Reader(const std::string &data) : data_(data), offset_(0) {}
+
+  bool done() const { return offset_ == data_.size(); }
+
+  bool Byte(uint8_t *value) {
+    if (offset_ >= data_.size()) {
+      return false;
+    }
+    *value = static_cast<uint8_t>(data_[offset_++]);
+    return true;
+  }
+
+  bool Varint(uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte;
+      if (!Byte(&byte)) {
+        return false;
+      }
+      *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool Size(size_t *value) {
+    uint64_t varint;
+    if (!Varint(&varint) || varint > data_.size()) {
+      return false;
+    }
+    *value = static_cast<size_t>(varint);
+    return true;
+  }
+
+  bool String(std::string *value) {
+    size_t length;
+    if (!Size(&length) || data_.size() - offset_ < length) {
+      return false;
+    }
+    value->assign(data_, offset_, length);
+    offset_ += length;
+    return true;
+  }
+
+  // Reads a hashed string, keeping only its length.
+  bool Hashed(size_t *length) {
+    if (!Size(length)) {
+      return false;
+    }
+    if (!*length) {
+      return true;
+    }
+    if (data_.size() - offset_ < HASH_SIZE) {
+      return false;
+    }
+    offset_ += HASH_SIZE;
+    return true;
+  }
+
+ private:
+  const std::string &data_;
+  size_t offset_;
+};
+
+bool ParseConfiguration(Reader *reader, ReplayEvent *event) {
+  std::shared_ptr<GoogleSignIn::Configuration> configuration(
+      new GoogleSignIn::Configuration());
+  uint64_t flags;
+  size_t account_name_length;
+  size_t scope_count;
+  if (!reader->Varint(&flags) ||
+      !reader->String(&configuration->web_client_id) ||
+      !reader->Hashed(&account_name_length) || !reader->Size(&scope_count)) {
+    return false;
+  }
+  configuration->use_game_signin = (flags & 1) != 0;
+  configuration->request_auth_code = (flags & 2) != 0;
+  configuration->force_token_refresh = (flags & 4) != 0;
+  configuration->request_email = (flags & 8) != 0;
+  configuration->request_id_token = (flags & 16) != 0;
+  configuration->hide_ui_popups = (flags & 32) != 0;
+  configuration->account_name.assign(account_name_length, 'a');
+  for (size_t i = 0; i < scope_count; i++) {
+    std::string scope;
+    if (!reader->String(&scope)) {
+      return false;
+    }
+    configuration->additional_scopes.push_back(scope);
+  }
+  event->configuration = configuration;
+  return true;
+}
+
+bool ParseResult(Reader *reader, ReplayEvent *event) {
+  uint64_t zigzag;
+  uint8_t has_user;
+  if (!reader->Varint(&zigzag) || !reader->Byte(&has_user)) {
+    return false;
+  }
+  event->status = static_cast<int>(static_cast<int64_t>(zigzag >> 1) ^
+                                   -static_cast<int64_t>(zigzag & 1));
+  event->has_user = has_user != 0;
+  if (event->has_user) {
+    for (int i = 0; i < RESULT_FIELDS; i++) {
+      if (!reader->Hashed(&event->field_lengths[i])) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// An account with fields of the lengths recorded in a result.  The ID token
+// is a well formed one for audience, padded to its recorded length.
+std::shared_ptr<const FakeAccount> MakeAccount(const ReplayEvent &event,
+                                               const std::string &audience,
+                                               int64_t exp) {
+  const size_t *lengths = event.field_lengths;
+  std::shared_ptr<FakeAccount> account(new FakeAccount());
+  account->display_name.assign(lengths[0], 'd');
+  account->email.assign(lengths[1], 'e');
+  account->family_name.assign(lengths[2], 'f');
+  account->given_name.assign(lengths[3], 'g');
+  account->id.assign(lengths[4], '1');
+  if (lengths[5]) {
+    account->id_token = MakeIdToken(audience, exp);
+    if (account->id_token.size() < lengths[5]) {
+      // More signature, which is not checked.
+      account->id_token.append(lengths[5] - account->id_token.size(), 'A');
+    }
+  }
+  account->photo_url.assign(lengths[6], 'p');
+  account->server_auth_code.assign(lengths[7], 's');
+  return account;
+}
+
+void DefaultConfiguration(GoogleSignIn::Configuration *configuration) {
+  configuration->use_game_signin = false;
+  configuration->web_client_id = kReplayWebClientId;
+  configuration->request_auth_code = false;
+  configuration->force_token_refresh = false;
+  configuration->request_email = true;
+  configuration->request_id_token = true;
+  configuration->hide_ui_popups = false;
+}
+
+// A fake Java UI thread, running the tasks handed to it one at a time.
+class UiThread {
+ public:
+  UiThread() : task_(nullptr), stop_(false), thread_(&UiThread::Loop, this) {}
+  ~UiThread() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+  }
+
+  // Runs task on the thread, returning once it has run.
+  void Run(const std::function<void()> &task) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    task_ = &task;
+    changed_.notify_all();
+    changed_.wait(lock, [this] { return task_ == nullptr; });
+  }
+
+ private:
+  void Loop() {
+    ScopedJavaThread java;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      changed_.wait(lock, [this] { return task_ || stop_; });
+      if (task_) {
+        (*task_)();
+        task_ = nullptr;
+        changed_.notify_all();
+      } else {
+        return;
+      }
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  const std::function<void()> *task_;
+  bool stop_;
+  std::thread thread_;
+};
+
+// A sign-in made by the replay.  The completion time is taken by a callback
+// on the delivering thread.
+struct ReplayedSignIn {
+  Clock::time_point started;
+  std::atomic<int64_t> round_trip_ns;
+
+  static void OnComplete(void *user_data) {
+    ReplayedSignIn *sign_in = static_cast<ReplayedSignIn *>(user_data);
+    sign_in->round_trip_ns.store(NanosBetween(sign_in->started, Clock::now()));
+  }
+};
+
+// A sign-in waiting for its recorded result.
+struct PendingSignIn {
+  int64_t handle;
+  ReplayedSignIn *sign_in;
+};
+
+void CountReplayedCalls(const FakeSignInHelper::Counters &before,
+                        const FakeSignInHelper::Counters &after,
+                        ReplayReport *report) {
+  uint64_t *calls = report->replayed_calls;
+  calls[JniRecorder::kRecordConfigure] += after.configure - before.configure;
+  calls[JniRecorder::kRecordResubmit] += after.resubmit - before.resubmit;
+  calls[JniRecorder::kRecordSignIn] += after.sign_in - before.sign_in;
+  calls[JniRecorder::kRecordSignInSilently] +=
+      after.sign_in_silently - before.sign_in_silently;
+  calls[JniRecorder::kRecordSignOut] += after.sign_out - before.sign_out;
+  calls[JniRecorder::kRecordDisconnect] += after.disconnect - before.disconnect;
+  calls[JniRecorder::kRecordResult] +=
+      (after.results_by_call - before.results_by_call) +
+      (after.results_in_ring - before.results_in_ring);
+}
+
+}  // namespace
+
+ReplayReport::ReplayReport()
+    : unmatched_results(0),
+      unanswered(0),
+      incomplete(0),
+      wall_us(0),
+      recorded_us(0) {
+  memset(recorded_calls, 0, sizeof(recorded_calls));
+  memset(replayed_calls, 0, sizeof(replayed_calls));
+}
+
+bool ParseRecording(const std::string &data, std::vector<ReplayEvent> *events,
+                    std::string *error) {
+  events->clear();
+  if (data.size() < RECORDING_MAGIC_SIZE + 1 ||
+      data.compare(0, RECORDING_MAGIC_SIZE, RECORDING_MAGIC) != 0) {
+    *error = "not a recording";
+    return false;
+  }
+  if (static_cast<uint8_t>(data[RECORDING_MAGIC_SIZE]) !=
+      JniRecorder::kVersion) {
+    *error = "unknown version " +
+             std::to_string(static_cast<uint8_t>(data[RECORDING_MAGIC_SIZE]));
+    return false;
+  }
+  std::string body = data.substr(RECORDING_MAGIC_SIZE + 1);
+  Reader reader(body);
+  int64_t time_us = 0;
+  while (!reader.done()) {
+    ReplayEvent event = ReplayEvent();
+    uint8_t kind;
+    uint64_t delta_us;
+    uint64_t handle;
+    if (!reader.Byte(&kind) || !reader.Varint(&delta_us) ||
+        !reader.Varint(&handle)) {
+      *error = "record " + std::to_string(events->size()) + " is cut short";
+      return false;
+    }
+    time_us += static_cast<int64_t>(delta_us);
+    event.kind = static_cast<JniRecorder::Kind>(kind);
+    event.time_us = time_us;
+    event.handle = static_cast<int64_t>(handle);
+    bool parsed = true;
+    switch (event.kind) {
+      case JniRecorder::kRecordConfigure:
+        parsed = ParseConfiguration(&reader, &event);
+        break;
+      case JniRecorder::kRecordResubmit: {
+        uint8_t accepted = 0;
+        parsed = reader.Byte(&accepted);
+        event.accepted = accepted != 0;
+        break;
+      }
+      case JniRecorder::kRecordSignIn:
+      case JniRecorder::kRecordSignInSilently:
+      case JniRecorder::kRecordSignOut:
+      case JniRecorder::kRecordDisconnect:
+        break;
+      case JniRecorder::kRecordResult:
+        parsed = ParseResult(&reader, &event);
+        break;
+      default:
+        *error = "record " + std::to_string(events->size()) +
+                 " has unknown kind " + std::to_string(kind);
+        return false;
+    }
+    if (!parsed) {
+      *error = "record " + std::to_string(events->size()) + " is cut short";
+      return false;
+    }
+    events->push_back(event);
+  }
+  return true;
+}
+
+std::vector<size_t> ReplayOrder(const std::vector<ReplayEvent> &events) {
+  std::vector<size_t> order;
+  // By handle, the sign-ins waiting for a result and the early results.
+  std::set<int64_t> outstanding;
+  std::map<int64_t, size_t> early;
+  for (size_t i = 0; i < events.size(); i++) {
+    const ReplayEvent &event = events[i];
+    if (event.kind == JniRecorder::kRecordResult &&
+        !outstanding.erase(event.handle) &&
+        early.insert(std::make_pair(event.handle, i)).second) {
+      continue;
+    }
+    order.push_back(i);
+    if (event.kind == JniRecorder::kRecordSignIn ||
+        event.kind == JniRecorder::kRecordSignInSilently) {
+      std::map<int64_t, size_t>::iterator result = early.find(event.handle);
+      if (result != early.end()) {
+        order.push_back(result->second);
+        early.erase(result);
+      } else {
+        outstanding.insert(event.handle);
+      }
+    }
+  }
+  // Results no sign-in was found for, replayed last.
+  for (std::map<int64_t, size_t>::iterator it = early.begin();
+       it != early.end(); ++it) {
+    order.push_back(it->second);
+  }
+  return order;
+}
+
+const char *ReplayPhaseName(ReplayPhase phase) { return kPhaseNames[phase]; }
+
+void Replay(const std::vector<ReplayEvent> &events,
+            const ReplayOptions &options, ReplayReport *report) {
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  if (events.empty()) {
+    return;
+  }
+
+  // The accounts of the results, made up front so their cost is not
+  // replayed.  Their tokens are for the web client id configured when the
+  // result arrived and valid for a day.
+  int64_t exp = std::chrono::duration_cast<std::chrono::seconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count() +
+                86400;
+  std::string audience = kReplayWebClientId;
+  std::vector<std::shared_ptr<const FakeAccount>> accounts(events.size());
+  for (size_t i = 0; i < events.size(); i++) {
+    const ReplayEvent &event = events[i];
+    if (event.kind == JniRecorder::kRecordConfigure) {
+      audience = event.configuration->web_client_id;
+    } else if (event.kind == JniRecorder::kRecordResult && event.has_user) {
+      accounts[i] = MakeAccount(event, audience, exp);
+    }
+    if (event.kind <= JniRecorder::kRecordResult) {
+      report->recorded_calls[event.kind] +=
+          static_cast<uint64_t>(options.repeat);
+    }
+  }
+  report->recorded_us = events.back().time_us - events.front().time_us;
+
+  // Java answers each sign-in with nothing, the replay delivers the
+  // recorded result.
+  std::shared_ptr<std::atomic<int64_t>> java_handle(
+      new std::atomic<int64_t>(0));
+  helper.SetResponder([java_handle](const FakeRequest &request, bool silent) {
+    java_handle->store(request.handle);
+    FakeResponse response = {kFakeSuccess, nullptr, -1};
+    return response;
+  });
+
+  std::vector<size_t> order = ReplayOrder(events);
+  UiThread ui_thread;
+  GoogleSignIn plugin(helper.activity());
+  bool configured = false;
+  Clock::time_point replay_start = Clock::now();
+  for (int pass = 0; pass < options.repeat; pass++) {
+    FakeSignInHelper::Counters before = helper.counters();
+    std::vector<std::unique_ptr<ReplayedSignIn>> sign_ins;
+    // By recorded handle.
+    std::map<int64_t, PendingSignIn> pending;
+    std::vector<ReplayedSignIn *> answered;
+    Clock::time_point pass_start = Clock::now();
+    for (size_t position = 0; position < order.size(); position++) {
+      size_t i = order[position];
+      const ReplayEvent &event = events[i];
+      if (!options.max_speed) {
+        Clock::time_point due =
+            pass_start +
+            std::chrono::microseconds(event.time_us - events.front().time_us);
+        std::this_thread::sleep_until(due);
+        report->samples_ns[kPhaseLag].push_back(
+            NanosBetween(due, Clock::now()));
+      }
+      Clock::time_point start = Clock::now();
+      switch (event.kind) {
+        case JniRecorder::kRecordConfigure:
+          plugin.Configure(*event.configuration);
+          report->samples_ns[kPhaseConfigure].push_back(
+              NanosBetween(start, Clock::now()));
+          configured = true;
+          break;
+        case JniRecorder::kRecordSignIn:
+        case JniRecorder::kRecordSignInSilently: {
+          if (!configured) {
+            GoogleSignIn::Configuration configuration;
+            DefaultConfiguration(&configuration);
+            plugin.Configure(configuration);
+            configured = true;
+          }
+          sign_ins.emplace_back(new ReplayedSignIn());
+          ReplayedSignIn *sign_in = sign_ins.back().get();
+          sign_in->round_trip_ns.store(-1);
+          java_handle->store(0);
+          sign_in->started = Clock::now();
+          Future<GoogleSignIn::SignInResult> &future =
+              event.kind == JniRecorder::kRecordSignIn
+                  ? plugin.SignIn()
+                  : plugin.SignInSilently();
+          report->samples_ns[kPhaseSignInCall].push_back(
+              NanosBetween(sign_in->started, Clock::now()));
+          future.SetCompletionCallback(ReplayedSignIn::OnComplete, sign_in,
+                                       false);
+          if (java_handle->load()) {
+            PendingSignIn entry = {java_handle->load(), sign_in};
+            pending[event.handle] = entry;
+          }
+          break;
+        }
+        case JniRecorder::kRecordSignOut:
+        case JniRecorder::kRecordDisconnect:
+          if (event.kind == JniRecorder::kRecordSignOut) {
+            plugin.SignOut();
+          } else {
+            plugin.Disconnect();
+          }
+          report->samples_ns[kPhaseSignOut].push_back(
+              NanosBetween(start, Clock::now()));
+          break;
+        case JniRecorder::kRecordResult: {
+          std::map<int64_t, PendingSignIn>::iterator it =
+              pending.find(event.handle);
+          if (it == pending.end()) {
+            report->unmatched_results++;
+            break;
+          }
+          PendingSignIn entry = it->second;
+          pending.erase(it);
+          const FakeAccount *account = accounts[i].get();
+          std::function<void()> deliver = [&helper, &event, &entry, account,
+                                           report]() {
+            Clock::time_point delivered = Clock::now();
+            helper.DeliverResult(entry.handle, event.status, account);
+            report->samples_ns[kPhaseResult].push_back(
+                NanosBetween(delivered, Clock::now()));
+          };
+          ui_thread.Run(deliver);
+          answered.push_back(entry.sign_in);
+          break;
+        }
+        default:
+          // Resubmits are made by the plugin as it needs them.
+          break;
+      }
+    }
+    CountReplayedCalls(before, helper.counters(), report);
+
+    // Completion callbacks run on the delivering thread before
+    // DeliverResult() returns.
+    for (size_t i = 0; i < answered.size(); i++) {
+      int64_t round_trip_ns = answered[i]->round_trip_ns.load();
+      if (round_trip_ns < 0) {
+        report->incomplete++;
+      } else {
+        report->samples_ns[kPhaseRoundTrip].push_back(round_trip_ns);
+      }
+    }
+    // Cancel what the recording never answered, so the request slots are
+    // free for the next pass.
+    if (!pending.empty()) {
+      report->unanswered += pending.size();
+      plugin.SignOut();
+    }
+  }
+  report->wall_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        Clock::now() - replay_start)
+                        .count() /
+                    options.repeat;
+  helper.Reset();
+}
+
+void RecordSampleSession(int sign_ins, int64_t max_delay_us, uint32_t seed,
+                         std::string *out) {
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  helper.Reset();
+  std::shared_ptr<std::mt19937> random(new std::mt19937(seed));
+  std::shared_ptr<const FakeAccount> account(
+      new FakeAccount(FakeAccount::Default()));
+  // Only called on this thread, from SignIn() and SignInSilently().
+  helper.SetResponder([random, account, max_delay_us](
+                          const FakeRequest &request, bool silent) {
+    std::uniform_int_distribution<int64_t> delay(0, max_delay_us);
+    FakeResponse response = {kFakeSuccess, account, delay(*random)};
+    switch ((*random)() % 8) {
+      case 0:
+        response.status = kFakeNetworkError;
+        response.account.reset();
+        break;
+      case 1:
+        response.status = silent ? kFakeSignInRequired : kFakeCanceled;
+        response.account.reset();
+        break;
+    }
+    return response;
+  });
+
+  GoogleSignIn plugin(helper.activity());
+  GoogleSignIn::Configuration configuration;
+  DefaultConfiguration(&configuration);
+  GoogleSignIn::Configuration with_auth_code(configuration);
+  with_auth_code.request_auth_code = true;
+
+  JniRecorder::Enable(true);
+  plugin.Configure(configuration);
+  for (int i = 0; i < sign_ins; i++) {
+    if (i == sign_ins / 2) {
+      plugin.Configure(with_auth_code);
+    }
+    Future<GoogleSignIn::SignInResult> &future =
+        i % 2 ? plugin.SignInSilently() : plugin.SignIn();
+    future.Wait();
+    if (i % 10 == 9) {
+      plugin.SignOut();
+    }
+  }
+  helper.WaitIdle();
+  JniRecorder::Export(out);
+  JniRecorder::Enable(false);
+  helper.Reset();
+}
+
+}  // namespace test
+}  // namespace googlesignin
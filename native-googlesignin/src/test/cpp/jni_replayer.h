@@ -0,0 +1,129 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_TEST_JNI_REPLAYER_H
+#define GOOGLESIGNIN_TEST_JNI_REPLAYER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "google_signin.h"
+#include "jni_recorder.h"
+
+namespace googlesignin {
+namespace test {
+
+// A record of a recording made by JniRecorder, see jni_recorder.h.  Hashed
+// strings only keep their length.
+struct ReplayEvent {
+  JniRecorder::Kind kind;
+  // Microseconds since recording was enabled.
+  int64_t time_us;
+  int64_t handle;
+
+  // kRecordConfigure.  The account name is made up, of the recorded length.
+  std::shared_ptr<const GoogleSignIn::Configuration> configuration;
+  // kRecordResubmit.
+  bool accepted;
+  // kRecordResult.  The lengths of the display name, email, family name,
+  // given name, user id, ID token, image URL and server auth code, in the
+  // order they are recorded.
+  int status;
+  bool has_user;
+  size_t field_lengths[8];
+};
+
+// Parses a recording into events.  Returns false and sets error if it is
+// not a recording of a version this understands, or is cut short.
+bool ParseRecording(const std::string &data, std::vector<ReplayEvent> *events,
+                    std::string *error);
+
+// Returns the indexes of events in the order they are replayed.  A sign-in
+// call is recorded once the Java call returns, so a result delivered
+// straight away can be recorded before the call it answers.  Such a result
+// is moved right after its call.
+std::vector<size_t> ReplayOrder(const std::vector<ReplayEvent> &events);
+
+// The timed phases of a replay.
+enum ReplayPhase {
+  // GoogleSignIn::Configure().
+  kPhaseConfigure,
+  // SignIn() or SignInSilently(), including sending a changed
+  // configuration to Java.
+  kPhaseSignInCall,
+  // nativeOnResult: reading the account and completing the future.
+  kPhaseResult,
+  // From the sign-in call until its future completed.  At recorded speed
+  // this includes the time Play services took.
+  kPhaseRoundTrip,
+  // SignOut() or Disconnect().
+  kPhaseSignOut,
+  // How late each record was replayed, at recorded speed.
+  kPhaseLag,
+  kPhaseCount
+};
+
+// Returns the name of phase, as it appears in reports.
+const char *ReplayPhaseName(ReplayPhase phase);
+
+struct ReplayOptions {
+  // Replays the records back to back instead of at their recorded times.
+  bool max_speed;
+  // Times to replay the recording.
+  int repeat;
+};
+
+struct ReplayReport {
+  // Samples of each phase, in nanoseconds.
+  std::vector<int64_t> samples_ns[kPhaseCount];
+  // The Java calls in the recording, and those the plugin made replaying
+  // it, by kind.  They differ if the plugin resubmits or sends the
+  // configuration differently than the recorded one did.
+  uint64_t recorded_calls[JniRecorder::kRecordResult + 1];
+  uint64_t replayed_calls[JniRecorder::kRecordResult + 1];
+  // Results for requests the replay did not make, not delivered.
+  uint64_t unmatched_results;
+  // Sign-ins without a result in the recording, canceled at the end.
+  uint64_t unanswered;
+  // Sign-ins whose result was delivered but whose future did not complete.
+  uint64_t incomplete;
+  // How long the replay took, and the recording lasted, once.
+  int64_t wall_us;
+  int64_t recorded_us;
+
+  ReplayReport();
+};
+
+// Replays events through a GoogleSignIn on the fake helper: the game side
+// calls on the calling thread, at their recorded times unless
+// options.max_speed is set, and the results on a fake Java UI thread, in
+// the recorded order.  Each result is delivered for the request the replay
+// made in place of the recorded one, with an account whose fields have the
+// recorded lengths.  Replaces the helper's responder.
+void Replay(const std::vector<ReplayEvent> &events,
+            const ReplayOptions &options, ReplayReport *report);
+
+// Records a session of sign_ins sign-ins on the fake helper, interactive
+// and silent in turn, with a reconfiguration, sign-outs and failures among
+// them, into *out.  Results take up to max_delay_us.
+void RecordSampleSession(int sign_ins, int64_t max_delay_us, uint32_t seed,
+                         std::string *out);
+
+}  // namespace test
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_TEST_JNI_REPLAYER_H
@@ -0,0 +1,199 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "jni_replayer.h"
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fake_sign_in_helper.h"
+#include "jni_recorder.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+// The kind and status of each record in replay order, which a replay
+// reproduces.
+std::vector<std::pair<int, int>> Outline(
+    const std::vector<ReplayEvent> &events) {
+  std::vector<std::pair<int, int>> outline;
+  std::vector<size_t> order = ReplayOrder(events);
+  for (size_t i = 0; i < order.size(); i++) {
+    const ReplayEvent &event = events[order[i]];
+    outline.push_back(std::make_pair(
+        static_cast<int>(event.kind),
+        event.kind == JniRecorder::kRecordResult ? event.status : 0));
+  }
+  return outline;
+}
+
+ReplayEvent Event(JniRecorder::Kind kind, int64_t handle) {
+  ReplayEvent event = ReplayEvent();
+  event.kind = kind;
+  event.handle = handle;
+  return event;
+}
+
+class JniReplayerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FakeSignInHelper::Get().Reset();
+    RecordSampleSession(20, 500, 7, &recording_);
+    std::string error;
+    ASSERT_TRUE(ParseRecording(recording_, &events_, &error)) << error;
+  }
+
+  size_t Count(JniRecorder::Kind kind) {
+    size_t count = 0;
+    for (size_t i = 0; i < events_.size(); i++) {
+      if (events_[i].kind == kind) count++;
+    }
+    return count;
+  }
+
+  std::string recording_;
+  std::vector<ReplayEvent> events_;
+};
+
+TEST_F(JniReplayerTest, ParsesARecordedSession) {
+  EXPECT_EQ(10u, Count(JniRecorder::kRecordSignIn));
+  EXPECT_EQ(10u, Count(JniRecorder::kRecordSignInSilently));
+  EXPECT_EQ(20u, Count(JniRecorder::kRecordResult));
+  EXPECT_EQ(2u, Count(JniRecorder::kRecordSignOut));
+  // The first sign-in and the one after the reconfiguration.
+  EXPECT_LE(2u, Count(JniRecorder::kRecordConfigure));
+  bool auth_code = false;
+  for (size_t i = 0; i < events_.size(); i++) {
+    if (i) {
+      EXPECT_LE(events_[i - 1].time_us, events_[i].time_us);
+    }
+    const ReplayEvent &event = events_[i];
+    if (event.kind == JniRecorder::kRecordConfigure) {
+      auth_code = auth_code || event.configuration->request_auth_code;
+    }
+    if (event.kind == JniRecorder::kRecordResult && event.has_user) {
+      FakeAccount account = FakeAccount::Default();
+      EXPECT_EQ(account.email.size(), event.field_lengths[1]);
+      EXPECT_EQ(account.id_token.size(), event.field_lengths[5]);
+    }
+  }
+  EXPECT_TRUE(auth_code);
+}
+
+TEST_F(JniReplayerTest, RejectsWhatIsNotARecording) {
+  std::vector<ReplayEvent> events;
+  std::string error;
+  EXPECT_FALSE(ParseRecording("", &events, &error));
+  EXPECT_FALSE(ParseRecording("GSIX\x01", &events, &error));
+  std::string version = recording_;
+  version[4] = 2;
+  EXPECT_FALSE(ParseRecording(version, &events, &error));
+  EXPECT_EQ("unknown version 2", error);
+  // Cut anywhere inside the last record.
+  for (size_t cut = 1; cut < 8; cut++) {
+    std::string cut_short = recording_.substr(0, recording_.size() - cut);
+    if (ParseRecording(cut_short, &events, &error)) {
+      // The cut fell on a record boundary.
+      EXPECT_LT(events.size(), events_.size());
+    }
+  }
+  std::string unknown = recording_;
+  unknown.push_back(42);
+  EXPECT_FALSE(ParseRecording(unknown, &events, &error));
+}
+
+TEST(ReplayOrderTest, ResultsAreReplayedAfterTheirCall) {
+  std::vector<ReplayEvent> events;
+  events.push_back(Event(JniRecorder::kRecordResult, 1));
+  events.push_back(Event(JniRecorder::kRecordSignIn, 1));
+  events.push_back(Event(JniRecorder::kRecordSignInSilently, 2));
+  events.push_back(Event(JniRecorder::kRecordResult, 3));
+  events.push_back(Event(JniRecorder::kRecordSignOut, 0));
+  events.push_back(Event(JniRecorder::kRecordResult, 2));
+  events.push_back(Event(JniRecorder::kRecordSignIn, 3));
+  // A result without a call stays last.
+  events.push_back(Event(JniRecorder::kRecordResult, 4));
+  std::vector<size_t> expected = {1, 0, 2, 4, 5, 6, 3, 7};
+  EXPECT_EQ(expected, ReplayOrder(events));
+}
+
+// Recording the replay gives back the same calls and results.
+TEST_F(JniReplayerTest, ReplayReproducesTheRecording) {
+  ReplayOptions options = {true, 1};
+  ReplayReport report;
+  JniRecorder::Enable(true);
+  Replay(events_, options, &report);
+  std::string replayed;
+  JniRecorder::Export(&replayed);
+  JniRecorder::Enable(false);
+
+  std::vector<ReplayEvent> events;
+  std::string error;
+  ASSERT_TRUE(ParseRecording(replayed, &events, &error)) << error;
+  EXPECT_EQ(Outline(events_), Outline(events));
+  for (int kind = JniRecorder::kRecordConfigure;
+       kind <= JniRecorder::kRecordResult; kind++) {
+    EXPECT_EQ(report.recorded_calls[kind], report.replayed_calls[kind])
+        << "kind " << kind;
+  }
+  EXPECT_EQ(0u, report.unmatched_results);
+  EXPECT_EQ(0u, report.unanswered);
+  EXPECT_EQ(0u, report.incomplete);
+  EXPECT_EQ(20u, report.samples_ns[kPhaseSignInCall].size());
+  EXPECT_EQ(20u, report.samples_ns[kPhaseResult].size());
+  EXPECT_EQ(20u, report.samples_ns[kPhaseRoundTrip].size());
+  EXPECT_TRUE(report.samples_ns[kPhaseLag].empty());
+}
+
+TEST_F(JniReplayerTest, RecordedSpeedKeepsTheSchedule) {
+  ReplayOptions options = {false, 2};
+  ReplayReport report;
+  Replay(events_, options, &report);
+  EXPECT_GE(report.wall_us, report.recorded_us);
+  EXPECT_EQ(2 * events_.size(), report.samples_ns[kPhaseLag].size());
+  EXPECT_EQ(40u, report.samples_ns[kPhaseRoundTrip].size());
+  EXPECT_EQ(0u, report.incomplete);
+}
+
+// Results for sign-ins the replay did not make are dropped, sign-ins the
+// recording never answered are canceled.
+TEST_F(JniReplayerTest, UnmatchedRecordsAreCounted) {
+  size_t first_sign_in = events_.size();
+  size_t last_result = events_.size();
+  for (size_t i = 0; i < events_.size(); i++) {
+    JniRecorder::Kind kind = events_[i].kind;
+    if (kind == JniRecorder::kRecordSignIn && first_sign_in == events_.size()) {
+      first_sign_in = i;
+    }
+    if (kind == JniRecorder::kRecordResult) last_result = i;
+  }
+  std::vector<ReplayEvent> events;
+  for (size_t i = 0; i < events_.size(); i++) {
+    if (i != first_sign_in && i != last_result) events.push_back(events_[i]);
+  }
+  ReplayOptions options = {true, 1};
+  ReplayReport report;
+  Replay(events, options, &report);
+  EXPECT_EQ(1u, report.unmatched_results);
+  EXPECT_EQ(1u, report.unanswered);
+  EXPECT_EQ(0u, report.incomplete);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
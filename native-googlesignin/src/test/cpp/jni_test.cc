@@ -0,0 +1,195 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "jni_init.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+#define HELPER_CLASSNAME "com/google/googlesignin/GoogleSignInHelper"
+
+class JniTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ClearClassCache(GetJniEnv()); }
+  void TearDown() override { ClearClassCache(GetJniEnv()); }
+
+  // Runs fn on a new native thread, i.e. one attached by GetJniEnv() rather
+  // than by the VM, which only sees the boot class path.
+  template <typename Fn>
+  static auto OnNativeThread(Fn fn) -> decltype(fn()) {
+    return std::async(std::launch::async, fn).get();
+  }
+
+  FakeSignInHelper &helper_ = FakeSignInHelper::Get();
+  FakeJvm &jvm_ = FakeJvm::Get();
+};
+
+TEST_F(JniTest, FindsSystemClass) {
+  jclass clazz = OnNativeThread(
+      [this]() { return FindClass("java/lang/String", helper_.activity()); });
+  EXPECT_NE(nullptr, clazz);
+}
+
+// A NativeActivity is a framework class, so its class reports the boot
+// ClassLoader; the app classes are only found through
+// Context.getClassLoader().
+TEST_F(JniTest, FindsAppClassThroughNativeActivityContext) {
+  jclass clazz = OnNativeThread(
+      [this]() { return FindClass(HELPER_CLASSNAME, helper_.activity()); });
+  EXPECT_NE(nullptr, clazz);
+  // Cached from then on, on any thread and without a context.
+  EXPECT_EQ(clazz, FindClass(HELPER_CLASSNAME, nullptr));
+}
+
+TEST_F(JniTest, FindsAppClassThroughAppObject) {
+  jclass clazz = OnNativeThread([this]() {
+    JNIEnv *env = GetJniEnv();
+    jobject account = helper_.NewAccount(env, FakeAccount::Default());
+    jclass found = FindClass(HELPER_CLASSNAME, account);
+    env->DeleteLocalRef(account);
+    return found;
+  });
+  EXPECT_NE(nullptr, clazz);
+}
+
+TEST_F(JniTest, MissingClassReturnsNullWithNoPendingException) {
+  OnNativeThread([this]() {
+    EXPECT_EQ(nullptr, FindClass("com/example/Missing", helper_.activity()));
+    EXPECT_FALSE(GetJniEnv()->ExceptionCheck());
+  });
+}
+
+// Chained lookups of missing methods: the second would abort in the fake,
+// as under CheckJNI, if the first left its NoSuchMethodError pending.
+TEST_F(JniTest, MissingMethodsReturnNullWithNoPendingException) {
+  OnNativeThread([this]() {
+    jclass clazz = FindClass(HELPER_CLASSNAME, helper_.activity());
+    ASSERT_NE(nullptr, clazz);
+    EXPECT_EQ(nullptr, GetMethod(clazz, "missing", "()V"));
+    EXPECT_EQ(nullptr, GetStaticMethod(clazz, "missing", "()V"));
+    EXPECT_FALSE(GetJniEnv()->ExceptionCheck());
+    EXPECT_NE(nullptr, GetStaticMethod(clazz, "signOut",
+                                       "(Landroid/app/Activity;)V"));
+  });
+}
+
+// A context whose getClassLoader() throws: every JNI call after it would
+// abort in the fake if the exception were left pending.
+TEST_F(JniTest, ClassLoaderExceptionIsClearedAndNotCached) {
+  static FakeClass *throwing_class = nullptr;
+  if (!throwing_class) {
+    throwing_class = jvm_.DefineClass("com/example/ThrowingActivity",
+                                      "android/app/Activity", false);
+    jvm_.DefineMethod(throwing_class, "getClassLoader",
+                      "()Ljava/lang/ClassLoader;",
+                      [this](const FakeCall &call) {
+                        jvm_.Throw(call.env, "java/lang/RuntimeException");
+                        return FakeObjectValue(nullptr);
+                      });
+  }
+  jobject throwing = jvm_.NewGlobalRef(jvm_.NewObject(throwing_class));
+  OnNativeThread([this, throwing]() {
+    EXPECT_EQ(nullptr, FindClass(HELPER_CLASSNAME, throwing));
+    EXPECT_FALSE(GetJniEnv()->ExceptionCheck());
+    // The failure is not remembered, a good context still works.
+    EXPECT_NE(nullptr, FindClass(HELPER_CLASSNAME, helper_.activity()));
+  });
+  GetJniEnv()->DeleteGlobalRef(throwing);
+}
+
+TEST_F(JniTest, ConcurrentLookupsShareOneGlobalReference) {
+  size_t global_refs = jvm_.global_refs();
+  std::vector<std::future<jclass>> lookups;
+  for (int i = 0; i < 8; i++) {
+    lookups.push_back(std::async(std::launch::async, [this]() {
+      return FindClass(HELPER_CLASSNAME, helper_.activity());
+    }));
+  }
+  jclass first = lookups[0].get();
+  ASSERT_NE(nullptr, first);
+  for (size_t i = 1; i < lookups.size(); i++) {
+    EXPECT_EQ(first, lookups[i].get());
+  }
+  // The class and the app ClassLoader, the duplicates are deleted.
+  EXPECT_EQ(global_refs + 2, jvm_.global_refs());
+}
+
+// A slow loadClass() must not hold up lookups on other threads.
+TEST_F(JniTest, LookupsDoNotWaitForAnotherThreadsLoadClass) {
+  static FakeClass *loader_class = nullptr;
+  static FakeClass *activity_class = nullptr;
+  static std::mutex mutex;
+  static std::condition_variable changed;
+  static bool loading = false;
+  static bool release = false;
+  if (!loader_class) {
+    loader_class = jvm_.DefineClass("com/example/BlockingClassLoader",
+                                    "java/lang/ClassLoader", false);
+    jvm_.DefineMethod(
+        loader_class, "loadClass", "(Ljava/lang/String;)Ljava/lang/Class;",
+        [this](const FakeCall &call) {
+          std::unique_lock<std::mutex> lock(mutex);
+          loading = true;
+          changed.notify_all();
+          changed.wait(lock, []() { return release; });
+          return FakeObjectValue(FakeJvm::ClassObject(
+              jvm_.FindLoadedClass(HELPER_CLASSNAME)));
+        });
+    activity_class = jvm_.DefineClass("com/example/BlockingActivity",
+                                      "android/app/Activity", false);
+    jvm_.DefineMethod(activity_class, "getClassLoader",
+                      "()Ljava/lang/ClassLoader;",
+                      [this](const FakeCall &call) {
+                        return FakeObjectValue(jvm_.NewObject(loader_class));
+                      });
+  }
+  jobject activity = jvm_.NewGlobalRef(jvm_.NewObject(activity_class));
+
+  std::future<jclass> slow = std::async(std::launch::async, [activity]() {
+    return FindClass(HELPER_CLASSNAME, activity);
+  });
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(changed.wait_for(lock, std::chrono::seconds(5),
+                                 []() { return loading; }));
+  }
+  std::future<jclass> fast = std::async(std::launch::async, [this]() {
+    return FindClass("java/lang/String", helper_.activity());
+  });
+  EXPECT_EQ(std::future_status::ready,
+            fast.wait_for(std::chrono::seconds(5)));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    release = true;
+    changed.notify_all();
+  }
+  EXPECT_NE(nullptr, fast.get());
+  EXPECT_NE(nullptr, slow.get());
+  GetJniEnv()->DeleteGlobalRef(activity);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
@@ -0,0 +1,389 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// Benchmarks of the JNI paths of the plugin against the fake JNI: reading
+// an account into a user, sending the configuration, GetJniEnv(),
+// FindClass(), the session cache, the bridge accessors and the status
+// mapping.  The counters give the JNI calls made per iteration, which is
+// what costs on a device; the times only compare the native work on either
+// side of them.
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "google_signin_bridge.h"
+#include "google_signin_user.h"
+#include "google_signin_user_impl.h"
+#include "jni_init.h"
+#include "session_cache.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+const char kWebClientId[] =
+    "1234567890-abcdefghijklmnopqrstuvwxyz012345.apps.googleusercontent.com";
+
+// The plugin, created on the thread the benchmarks run on, which stands in
+// for the UI thread.
+GoogleSignIn_t g_plugin = nullptr;
+
+void ReportJniCalls(benchmark::State &state, const FakeJniCounts &before) {
+  FakeJniCounts calls = FakeJvm::Get().counts() - before;
+  state.counters["jni_calls"] = benchmark::Counter(
+      static_cast<double>(calls.Total() - calls.calls[kJniGetEnv]),
+      benchmark::Counter::kAvgIterations);
+}
+
+// Signs in with the default account and returns the user.
+GoogleSignInUser_t SignInUser() {
+  GoogleSignIn_Configure(g_plugin, false, kWebClientId, true, false, true,
+                         true, false, nullptr, 0, nullptr);
+  GoogleSignInFuture_t future = GoogleSignIn_SignIn(g_plugin);
+  if (!GoogleSignIn_Wait(future, 10000) || GoogleSignIn_Status(future) != 0) {
+    fprintf(stderr, "sign-in failed\n");
+    abort();
+  }
+  return GoogleSignIn_Result(future);
+}
+
+// Reading an account into a user with the single packAccount() call or one
+// call per getter.  state.range(0) is the cost of a JNI transition in ns,
+// see FakeJvm::SetTransitionCost(), so the times show how the number of
+// calls adds up on a device as well as the native work.
+void BM_UserFromAccount(benchmark::State &state, bool packed) {
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  JNIEnv *env = FakeJvm::CurrentEnv();
+  jobject account = helper.NewAccount(env, FakeAccount::Default());
+  // Make sure the method ids are looked up before they are swapped.
+  GoogleSignInUserImpl::Initialize(account);
+  jmethodID pack = GoogleSignInUserImpl::method_packAccount;
+  if (!packed) {
+    GoogleSignInUserImpl::method_packAccount = nullptr;
+  }
+  FakeJvm::Get().SetTransitionCost(state.range(0));
+  FakeJniCounts before = FakeJvm::Get().counts();
+  for (auto _ : state) {
+    GoogleSignInUser *user = GoogleSignInUserImpl::UserFromAccount(account);
+    benchmark::DoNotOptimize(user);
+    user->Release();
+  }
+  ReportJniCalls(state, before);
+  FakeJvm::Get().SetTransitionCost(0);
+  GoogleSignInUserImpl::method_packAccount = pack;
+  env->DeleteLocalRef(account);
+}
+BENCHMARK_CAPTURE(BM_UserFromAccount, packed, true)->Arg(0)->Arg(100)->Arg(300);
+BENCHMARK_CAPTURE(BM_UserFromAccount, per_field, false)
+    ->Arg(0)
+    ->Arg(100)
+    ->Arg(300);
+
+// Each iteration sends a configuration with state.range(0) scopes.  Two
+// account names alternate so the configuration changes every time and is
+// sent in full rather than resubmitted.
+void BM_CallConfigure(benchmark::State &state) {
+  std::vector<std::string> scopes;
+  for (int i = 0; i < state.range(0); i++) {
+    scopes.push_back("https://www.googleapis.com/auth/scope" +
+                     std::to_string(i));
+  }
+  std::vector<const char *> scope_ptrs;
+  for (const std::string &scope : scopes) {
+    scope_ptrs.push_back(scope.c_str());
+  }
+  const char *accounts[] = {"jane.doe@example.com", "john.doe@example.com"};
+  FakeJniCounts before = FakeJvm::Get().counts();
+  int i = 0;
+  for (auto _ : state) {
+    GoogleSignIn_Configure(g_plugin, false, kWebClientId, true, false, true,
+                           true, false, scope_ptrs.data(),
+                           static_cast<int>(scope_ptrs.size()),
+                           accounts[i++ & 1]);
+  }
+  ReportJniCalls(state, before);
+}
+BENCHMARK(BM_CallConfigure)->Arg(0)->Arg(10)->Arg(100);
+
+// The same configuration again, which is only resubmitted.
+void BM_Reconfigure(benchmark::State &state) {
+  FakeJniCounts before = FakeJvm::Get().counts();
+  for (auto _ : state) {
+    GoogleSignIn_Configure(g_plugin, false, kWebClientId, true, false, true,
+                           true, false, nullptr, 0, nullptr);
+  }
+  ReportJniCalls(state, before);
+}
+BENCHMARK(BM_Reconfigure);
+
+void BM_GetJniEnv(benchmark::State &state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(GetJniEnv());
+  }
+}
+BENCHMARK(BM_GetJniEnv);
+BENCHMARK(BM_GetJniEnv)->Threads(4);
+
+// What GetJniEnv() did before the env was cached per thread: a call into the
+// VM every time.  On a device GetEnv() also reads the thread's TLS slot and
+// checks the version, which the fake does not, so this is a lower bound.
+void BM_JavaVmGetEnv(benchmark::State &state) {
+  JavaVM *vm = FakeJvm::Get().vm();
+  FakeJniCounts before = FakeJvm::Get().counts();
+  for (auto _ : state) {
+    JNIEnv *env = nullptr;
+    vm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6);
+    benchmark::DoNotOptimize(env);
+  }
+  FakeJniCounts calls = FakeJvm::Get().counts() - before;
+  state.counters["vm_calls"] = benchmark::Counter(
+      static_cast<double>(calls.calls[kJniGetEnv]),
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_JavaVmGetEnv);
+
+// The first call on a new native thread, which attaches it to the VM.
+void BM_GetJniEnvFirstCall(benchmark::State &state) {
+  for (auto _ : state) {
+    std::chrono::steady_clock::duration elapsed;
+    std::thread([&elapsed]() {
+      std::chrono::steady_clock::time_point start =
+          std::chrono::steady_clock::now();
+      benchmark::DoNotOptimize(GetJniEnv());
+      elapsed = std::chrono::steady_clock::now() - start;
+    }).join();
+    state.SetIterationTime(
+        std::chrono::duration<double>(elapsed).count());
+  }
+}
+BENCHMARK(BM_GetJniEnvFirstCall)->UseManualTime();
+
+void BM_FindClass(benchmark::State &state, const char *class_name) {
+  jobject activity = FakeSignInHelper::Get().activity();
+  FakeJniCounts before = FakeJvm::Get().counts();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(FindClass(class_name, activity));
+  }
+  ReportJniCalls(state, before);
+}
+BENCHMARK_CAPTURE(BM_FindClass, system, "java/lang/String");
+BENCHMARK_CAPTURE(BM_FindClass, app,
+                  "com/google/googlesignin/GoogleSignInHelper");
+
+// A whole sign-in: a configuration with state.range(0) scopes, the signIn
+// call and the result delivered through nativeOnResult.  find_class counts
+// the lookups that reached the VM, which the FindClass() cache keeps at 0;
+// see jni_benchmark for what each one costs when it is not cached.
+void BM_SignIn(benchmark::State &state) {
+  std::vector<std::string> scopes;
+  for (int i = 0; i < state.range(0); i++) {
+    scopes.push_back("https://www.googleapis.com/auth/scope" +
+                     std::to_string(i));
+  }
+  std::vector<const char *> scope_ptrs;
+  for (const std::string &scope : scopes) {
+    scope_ptrs.push_back(scope.c_str());
+  }
+  const char *accounts[] = {"jane.doe@example.com", "john.doe@example.com"};
+  FakeJniCounts before = FakeJvm::Get().counts();
+  int i = 0;
+  for (auto _ : state) {
+    GoogleSignIn_Configure(g_plugin, false, kWebClientId, true, false, true,
+                           true, false, scope_ptrs.data(),
+                           static_cast<int>(scope_ptrs.size()),
+                           accounts[i++ & 1]);
+    GoogleSignInFuture_t future = GoogleSignIn_SignIn(g_plugin);
+    GoogleSignIn_Wait(future, 10000);
+  }
+  ReportJniCalls(state, before);
+  FakeJniCounts calls = FakeJvm::Get().counts() - before;
+  state.counters["find_class"] = benchmark::Counter(
+      static_cast<double>(calls.calls[kJniFindClass]),
+      benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SignIn)->Arg(0)->Arg(10);
+
+// SessionCache::Store() as the thread delivering a result pays for it: arg 0
+// only hands the user to the writer thread, which coalesces what it can't
+// keep up with; arg 1 also waits for the file to be written, which is what
+// Store() cost before the writer thread.
+void BM_SessionCacheStore(benchmark::State &state) {
+  const bool flush = state.range(0) != 0;
+  SessionCache cache(FakeSignInHelper::Get().files_dir() +
+                     "/benchmark-session.bin");
+  GoogleSignInUser_t user = SignInUser();
+  for (auto _ : state) {
+    cache.Store(*user);
+    if (flush) {
+      cache.Flush();
+    }
+  }
+  GoogleSignIn_ReleaseUser(user);
+  cache.Clear();
+}
+BENCHMARK(BM_SessionCacheStore)->ArgNames({"flush"})->Arg(0)->Arg(1);
+
+// Cold start: a new plugin instance calls SignInSilently() and waits for the
+// first user.  Args are whether the session cache has a user in its file
+// and how long the silent sign-in takes in Java, in microseconds.  Without
+// the cache the user arrives with the result of the silent sign-in, with it
+// the user is read from the file right away.
+void BM_ColdStartFirstUser(benchmark::State &state) {
+  const bool cached = state.range(0) != 0;
+  const int64_t silent_us = state.range(1);
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  helper.RespondWith(FakeAccount::Default(), silent_us);
+  if (cached) {
+    // The file a previous run left, written by SessionCache with the name
+    // SESSION_CACHE_FILENAME in session_cache.cc.
+    SessionCache previous_run(helper.files_dir() +
+                              "/googlesignin-session.bin");
+    GoogleSignInUser_t user = SignInUser();
+    previous_run.Store(*user);
+    previous_run.Flush();
+    GoogleSignIn_ReleaseUser(user);
+  }
+
+  for (auto _ : state) {
+    GoogleSignIn_t plugin = GoogleSignIn_Create(helper.activity());
+    GoogleSignIn_Configure(plugin, false, kWebClientId, false, false, true,
+                           true, false, nullptr, 0, nullptr);
+    GoogleSignIn_EnableSessionCache(plugin, cached);
+    GoogleSignInFuture_t future = GoogleSignIn_SignInSilently(plugin);
+    GoogleSignIn_Wait(future, 10000);
+
+    state.PauseTiming();
+    if (GoogleSignIn_Status(future) !=
+        (cached ? kUnityStatusCodeSuccessCached : kUnityStatusCodeSuccess)) {
+      state.SkipWithError("unexpected sign-in status");
+    }
+    // Let the background sign-in finish, and put the file back in case it
+    // was rewritten.
+    helper.WaitIdle();
+    GoogleSignIn_Dispose(plugin);
+    state.ResumeTiming();
+  }
+  GoogleSignIn_EnableSessionCache(g_plugin, false);
+  helper.SetResponder(FakeSignInHelper::DefaultResponder());
+}
+BENCHMARK(BM_ColdStartFirstUser)
+    ->ArgNames({"cached", "silent_us"})
+    ->Args({0, 0})
+    ->Args({1, 0})
+    ->Args({0, 5000})
+    ->Args({1, 5000})
+    ->Iterations(50)
+    ->UseRealTime();
+
+// Reading every field of the user one accessor at a time, the way the C#
+// code did, against the single GoogleSignIn_GetUserView() call.
+void BM_BridgeGetFields(benchmark::State &state) {
+  GoogleSignInUser_t user = SignInUser();
+  typedef size_t (*Getter)(GoogleSignInUser_t, char *, size_t);
+  static const Getter kGetters[] = {
+      GoogleSignIn_GetDisplayName, GoogleSignIn_GetEmail,
+      GoogleSignIn_GetFamilyName,  GoogleSignIn_GetGivenName,
+      GoogleSignIn_GetIdToken,     GoogleSignIn_GetImageUrl,
+      GoogleSignIn_GetServerAuthCode, GoogleSignIn_GetUserId,
+  };
+  std::vector<char> buf;
+  size_t bytes = 0;
+  for (auto _ : state) {
+    for (Getter getter : kGetters) {
+      // Size, then copy, as the C# wrapper does.
+      size_t len = getter(user, nullptr, 0) + 1;
+      buf.resize(len);
+      bytes += getter(user, buf.data(), len);
+    }
+  }
+  state.SetBytesProcessed(bytes);
+  GoogleSignIn_ReleaseUser(user);
+}
+BENCHMARK(BM_BridgeGetFields);
+
+void BM_BridgeGetUserView(benchmark::State &state) {
+  GoogleSignInUser_t user = SignInUser();
+  GoogleSignInUserView view;
+  for (auto _ : state) {
+    GoogleSignIn_GetUserView(user, &view);
+    benchmark::DoNotOptimize(view);
+  }
+  GoogleSignIn_ReleaseUser(user);
+}
+BENCHMARK(BM_BridgeGetUserView);
+
+// GoogleSignIn_Status() on a future completed with state.range(0).
+void BM_Status(benchmark::State &state) {
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  int status = static_cast<int>(state.range(0));
+  helper.SetResponder([status](const FakeRequest &request, bool silent) {
+    FakeResponse response = {status, nullptr, 0};
+    if (status == kFakeSuccess) {
+      response.account = std::make_shared<FakeAccount>(FakeAccount::Default());
+    }
+    return response;
+  });
+  GoogleSignIn_Configure(g_plugin, false, kWebClientId, true, false, true,
+                         true, false, nullptr, 0, nullptr);
+  GoogleSignInFuture_t future = GoogleSignIn_SignIn(g_plugin);
+  GoogleSignIn_Wait(future, 10000);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(GoogleSignIn_Status(future));
+  }
+  helper.SetResponder(FakeSignInHelper::DefaultResponder());
+}
+BENCHMARK(BM_Status)
+    ->Arg(kFakeSuccess)
+    ->Arg(kFakeNetworkError)
+    ->Arg(kFakeCanceled)
+    ->Arg(kFakeDeveloperError);
+
+void BM_GetResultView(benchmark::State &state) {
+  GoogleSignIn_Configure(g_plugin, false, kWebClientId, true, false, true,
+                         true, false, nullptr, 0, nullptr);
+  GoogleSignInFuture_t future = GoogleSignIn_SignIn(g_plugin);
+  GoogleSignIn_Wait(future, 10000);
+  GoogleSignInResultView view;
+  for (auto _ : state) {
+    GoogleSignIn_GetResultView(future, &view);
+    benchmark::DoNotOptimize(view);
+  }
+}
+BENCHMARK(BM_GetResultView);
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
+
+int main(int argc, char **argv) {
+  using googlesignin::test::FakeSignInHelper;
+  // The benchmarks run on this thread, as the UI thread.
+  googlesignin::test::ScopedJavaThread ui_thread;
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  googlesignin::test::g_plugin = GoogleSignIn_Create(helper.activity());
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+
+  helper.WaitIdle();
+  GoogleSignIn_Dispose(googlesignin::test::g_plugin);
+  return 0;
+}
@@ -0,0 +1,53 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_TEST_PLUGIN_TEST_H
+#define GOOGLESIGNIN_TEST_PLUGIN_TEST_H
+
+#include <gtest/gtest.h>
+
+#include "fake_sign_in_helper.h"
+#include "google_signin_bridge.h"
+
+namespace googlesignin {
+namespace test {
+
+const char kWebClientId[] =
+    "1234567890-abcdefghijklmnopqrstuvwxyz012345.apps.googleusercontent.com";
+
+// Fixture for the tests that sign in through the bridge: each test gets a
+// reset fake helper and a new instance configured for kWebClientId, which
+// is disposed of once the results still scheduled are delivered.  Kept out
+// of fake_sign_in_helper.h since the benchmarks don't link gtest.
+class PluginTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    helper_.Reset();
+    plugin_ = GoogleSignIn_Create(helper_.activity());
+    GoogleSignIn_Configure(plugin_, false, kWebClientId, false, false, true,
+                           true, false, nullptr, 0, nullptr);
+  }
+  void TearDown() override {
+    helper_.WaitIdle();
+    GoogleSignIn_Dispose(plugin_);
+  }
+
+  FakeSignInHelper &helper_ = FakeSignInHelper::Get();
+  GoogleSignIn_t plugin_;
+};
+
+}  // namespace test
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_TEST_PLUGIN_TEST_H
@@ -0,0 +1,81 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// Prewarm() resolving the plugin's classes and methods on its own thread.
+// The lookups are done once per process, so this is a binary of its own and
+// the order of the tests matters.
+
+#include <gtest/gtest.h>
+#include <chrono>
+#include <thread>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "google_signin_bridge.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+const char kWebClientId[] =
+    "1234567890-abcdefghijklmnopqrstuvwxyz012345.apps.googleusercontent.com";
+
+// Prewarms with activity and waits for the thread to finish, which detaches
+// it from the VM.
+void PrewarmAndWait(jobject activity) {
+  FakeJvm &jvm = FakeJvm::Get();
+  uint64_t detached = jvm.counts().calls[kJniDetachCurrentThread];
+  GoogleSignIn_Prewarm(activity);
+  for (int i = 0; i < 10000; i++) {
+    if (jvm.counts().calls[kJniDetachCurrentThread] != detached) return;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  FAIL() << "the prewarm thread did not finish";
+}
+
+// Without an activity the native prewarm thread can't see the app classes,
+// which must leave the lookups to the first instance and the first result
+// rather than mark them done.
+TEST(PrewarmTest, FailedPrewarmIsRetriedOnFirstUse) {
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  PrewarmAndWait(nullptr);
+
+  GoogleSignIn_t plugin = GoogleSignIn_Create(helper.activity());
+  GoogleSignIn_Configure(plugin, false, kWebClientId, false, false, true,
+                         true, false, nullptr, 0, nullptr);
+  GoogleSignInFuture_t future = GoogleSignIn_SignIn(plugin);
+  ASSERT_TRUE(GoogleSignIn_Wait(future, 10000));
+  ASSERT_EQ(0, GoogleSignIn_Status(future));
+  GoogleSignInUser_t user = GoogleSignIn_Result(future);
+  char email[64];
+  GoogleSignIn_GetEmail(user, email, sizeof(email));
+  EXPECT_STREQ(FakeAccount::Default().email.c_str(), email);
+  GoogleSignIn_ReleaseUser(user);
+  helper.WaitIdle();
+  GoogleSignIn_Dispose(plugin);
+}
+
+// Once resolved, prewarming again does no lookups.
+TEST(PrewarmTest, PrewarmAfterFirstUseDoesNothing) {
+  FakeJniCounts before = FakeJvm::Get().counts();
+  PrewarmAndWait(FakeSignInHelper::Get().activity());
+  FakeJniCounts calls = FakeJvm::Get().counts() - before;
+  EXPECT_EQ(0u, calls.calls[kJniFindClass]);
+  EXPECT_EQ(0u, calls.calls[kJniGetStaticMethodID]);
+  EXPECT_EQ(0u, calls.calls[kJniGetMethodID]);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
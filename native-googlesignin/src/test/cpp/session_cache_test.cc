@@ -0,0 +1,132 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "fake_sign_in_helper.h"
+#include "google_signin_user.h"
+#include "google_signin_user_impl.h"
+#include "session_cache.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+class SessionCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = FakeSignInHelper::Get().files_dir() + "/session_cache_test.bin";
+    unlink(path_.c_str());
+  }
+  void TearDown() override { unlink(path_.c_str()); }
+
+  static GoogleSignInUser *NewUser(const std::string &email) {
+    FakeAccount account = FakeAccount::Default();
+    account.email = email;
+    std::vector<unsigned char> packed;
+    FakeSignInHelper::Pack(account, &packed);
+    return GoogleSignInUserImpl::UserFromPackedAccount(packed.data(),
+                                                       packed.size());
+  }
+
+  // The email of the user a fresh cache on the file loads, as on a cold
+  // start, or "" if there is none.
+  std::string LoadEmail() {
+    SessionCache cache(path_);
+    GoogleSignInUser *user = cache.Load();
+    if (!user) return "";
+    std::string email = user->GetEmail();
+    user->Release();
+    return email;
+  }
+
+  bool FileExists() { return access(path_.c_str(), F_OK) == 0; }
+
+  std::string path_;
+};
+
+TEST_F(SessionCacheTest, StoredUserIsWrittenAndLoaded) {
+  SessionCache cache(path_);
+  GoogleSignInUser *user = NewUser("stored@example.com");
+  cache.Store(*user);
+  user->Release();
+  EXPECT_TRUE(cache.Flush());
+  EXPECT_EQ("stored@example.com", LoadEmail());
+}
+
+TEST_F(SessionCacheTest, LoadReturnsAUserThatIsNotWrittenYet) {
+  SessionCache cache(path_);
+  GoogleSignInUser *user = NewUser("pending@example.com");
+  cache.Store(*user);
+  user->Release();
+  GoogleSignInUser *loaded = cache.Load();
+  ASSERT_NE(nullptr, loaded);
+  EXPECT_STREQ("pending@example.com", loaded->GetEmail());
+  loaded->Release();
+}
+
+TEST_F(SessionCacheTest, TheLastStoredUserWins) {
+  SessionCache cache(path_);
+  for (int i = 0; i < 20; i++) {
+    GoogleSignInUser *user =
+        NewUser("user" + std::to_string(i) + "@example.com");
+    cache.Store(*user);
+    user->Release();
+  }
+  EXPECT_TRUE(cache.Flush());
+  EXPECT_EQ("user19@example.com", LoadEmail());
+}
+
+// Clear() can land while the writer holds a snapshot, before or during its
+// write.  Either way no file is left behind.
+TEST_F(SessionCacheTest, ClearIsNotUndoneByAWriteInProgress) {
+  SessionCache cache(path_);
+  GoogleSignInUser *user = NewUser("cleared@example.com");
+  for (int i = 0; i < 200; i++) {
+    cache.Store(*user);
+    if (i % 2) usleep(50);
+    cache.Clear();
+    cache.Flush();
+    ASSERT_FALSE(FileExists()) << "iteration " << i;
+  }
+  user->Release();
+  EXPECT_EQ(nullptr, cache.Load());
+}
+
+TEST_F(SessionCacheTest, InvalidFileIsIgnored) {
+  FILE *file = fopen(path_.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  fputs("not a session cache", file);
+  fclose(file);
+  EXPECT_EQ("", LoadEmail());
+}
+
+TEST_F(SessionCacheTest, DestructorWaitsForThePendingWrite) {
+  {
+    SessionCache cache(path_);
+    GoogleSignInUser *user = NewUser("flushed@example.com");
+    cache.Store(*user);
+    user->Release();
+  }
+  EXPECT_EQ("flushed@example.com", LoadEmail());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
@@ -0,0 +1,159 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// What a sign-in costs the app's CPU, for a release build: build with
+// -DCMAKE_BUILD_TYPE=Release, the label says whether NDEBUG was set.  The
+// result is delivered on the benchmark thread right after the sign-in call,
+// instead of later by the fake's looper, so the time is the plugin's own
+// work on both sides of the JNI calls: the configuration, the signIn call,
+// nativeOnResult reading the account and completing the future, the stats,
+// reading the user through the bridge and releasing it.  Each variant turns
+// on one of the optional features, to show what it adds.  The log
+// benchmarks give the cost of a message at each level of filtering.
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <memory>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "google_signin_bridge.h"
+#include "log.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+const char kWebClientId[] =
+    "1234567890-abcdefghijklmnopqrstuvwxyz012345.apps.googleusercontent.com";
+
+#if defined(NDEBUG)
+const char kBuild[] = "NDEBUG";
+#else
+const char kBuild[] = "debug";
+#endif
+
+enum Feature {
+  kPlain = 0,
+  kDebugLogging = 1,
+  kSessionCache = 2,
+  kTokenRefresh = 4,
+};
+
+// Sign-ins, interactive and silent in turn, each answered with the default
+// account as soon as the sign-in call returns.  Silent sign-ins with the
+// session cache on complete from the cache, and their revalidation is
+// answered the same way.
+void BM_SignInCost(benchmark::State &state, int features) {
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  helper.Reset();
+  std::shared_ptr<std::atomic<jlong>> handle(new std::atomic<jlong>(0));
+  helper.SetResponder([handle](const FakeRequest &request, bool silent) {
+    handle->store(request.handle);
+    FakeResponse response = {kFakeSuccess, nullptr, -1};
+    return response;
+  });
+  FakeAccount account = FakeAccount::Default();
+  GoogleSignIn_t plugin = GoogleSignIn_Create(helper.activity());
+  GoogleSignIn_Configure(plugin, false, kWebClientId, false, false, true, true,
+                         false, nullptr, 0, nullptr);
+  GoogleSignIn_EnableDebugLogging(plugin, (features & kDebugLogging) != 0);
+  GoogleSignIn_EnableSessionCache(plugin, (features & kSessionCache) != 0);
+  GoogleSignIn_EnableTokenRefresh(plugin, (features & kTokenRefresh) != 0);
+
+  FakeJniCounts before = FakeJvm::Get().counts();
+  int i = 0;
+  for (auto _ : state) {
+    handle->store(0);
+    GoogleSignInFuture_t future = i++ & 1 ? GoogleSignIn_SignInSilently(plugin)
+                                          : GoogleSignIn_SignIn(plugin);
+    helper.DeliverResult(handle->load(), kFakeSuccess, &account);
+    GoogleSignInUser_t user = GoogleSignIn_Result(future);
+    if (!user) {
+      state.SkipWithError("sign-in failed");
+      break;
+    }
+    GoogleSignInUserView view;
+    GoogleSignIn_GetUserView(user, &view);
+    benchmark::DoNotOptimize(view.id_token);
+    GoogleSignIn_ReleaseUser(user);
+  }
+  FakeJniCounts calls = FakeJvm::Get().counts() - before;
+  state.counters["jni_calls"] = benchmark::Counter(
+      static_cast<double>(calls.Total() - calls.calls[kJniGetEnv]),
+      benchmark::Counter::kAvgIterations);
+  state.SetLabel(kBuild);
+
+  GoogleSignIn_EnableDebugLogging(plugin, false);
+  GoogleSignIn_EnableSessionCache(plugin, false);
+  GoogleSignIn_EnableTokenRefresh(plugin, false);
+  GoogleSignIn_Dispose(plugin);
+  helper.Reset();
+}
+BENCHMARK_CAPTURE(BM_SignInCost, plain, kPlain);
+BENCHMARK_CAPTURE(BM_SignInCost, debug_logging, kDebugLogging);
+BENCHMARK_CAPTURE(BM_SignInCost, session_cache, kSessionCache);
+BENCHMARK_CAPTURE(BM_SignInCost, token_refresh, kTokenRefresh);
+
+// A debug message, which NDEBUG builds compile out.  With debug logging off
+// it is filtered at runtime otherwise.
+void BM_LogDebug(benchmark::State &state) {
+  Log::SetLevel(GOOGLESIGNIN_LOG_LEVEL_INFO);
+  int i = 0;
+  for (auto _ : state) {
+    GOOGLESIGNIN_LOG_DEBUG("Sign-in %d completed", i++);
+  }
+  state.SetLabel(kBuild);
+}
+BENCHMARK(BM_LogDebug);
+
+// An info message below the runtime level, as with the level set to warn.
+void BM_LogFilteredAtRuntime(benchmark::State &state) {
+  Log::SetLevel(GOOGLESIGNIN_LOG_LEVEL_WARN);
+  int i = 0;
+  for (auto _ : state) {
+    GOOGLESIGNIN_LOG_INFO("Sign-in %d completed", i++);
+  }
+  Log::SetLevel(GOOGLESIGNIN_LOG_LEVEL_INFO);
+}
+BENCHMARK(BM_LogFilteredAtRuntime);
+
+// A warning that is written: formatted into the ring and handed to the
+// writer thread.  Messages arriving while the ring is full are dropped, as
+// in a burst on a device.
+void BM_LogWritten(benchmark::State &state) {
+  Log::SetLevel(GOOGLESIGNIN_LOG_LEVEL_INFO);
+  int i = 0;
+  for (auto _ : state) {
+    GOOGLESIGNIN_LOG_WARN("Sign-in %d failed", i++);
+  }
+}
+BENCHMARK(BM_LogWritten);
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
+
+int main(int argc, char **argv) {
+  // The benchmarks run on this thread, as the UI thread.
+  googlesignin::test::ScopedJavaThread ui_thread;
+  googlesignin::test::FakeSignInHelper::Get();
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
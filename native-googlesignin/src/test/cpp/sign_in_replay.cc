@@ -0,0 +1,176 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// Replays a recording made with GoogleSignIn_EnableRecording() through the
+// plugin on the fake Java side, at the recorded speed or as fast as it
+// goes, and reports how long each phase of the plugin's work took.
+//
+//   sign_in_replay [--max_speed] [--repeat=1] [--jni_cost_ns=0]
+//                  (recording | --sample[=40])
+//
+// The recording is the file GoogleSignIn_ExportRecording() filled, pulled
+// from the device.  --sample records a session of that many sign-ins on
+// the fake first and replays it instead.  --jni_cost_ns adds a cost to
+// every fake JNI transition, to approximate a device.  Play services is
+// stood in for by the recorded results: each is delivered, on a fake UI
+// thread, to the sign-in the replay made in place of the recorded one.  See
+// jni_replayer.h for the phases.  Exits with 1 if the recording can't be
+// read or a delivered result did not complete its sign-in.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "jni_replayer.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+// The names of the JniRecorder kinds.
+const char *const kKindNames[] = {
+    "",       "configure", "resubmit",   "sign_in",
+    "silent", "sign_out",  "disconnect", "result",
+};
+
+struct Options {
+  bool max_speed = false;
+  int repeat = 1;
+  int64_t jni_cost_ns = 0;
+  int sample = 0;
+  std::string path;
+};
+
+bool ParseOptions(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (!strcmp(arg, "--max_speed")) {
+      options->max_speed = true;
+    } else if (!strncmp(arg, "--repeat=", 9)) {
+      options->repeat = std::max(1, atoi(arg + 9));
+    } else if (!strncmp(arg, "--jni_cost_ns=", 14)) {
+      options->jni_cost_ns = atoll(arg + 14);
+    } else if (!strcmp(arg, "--sample")) {
+      options->sample = 40;
+    } else if (!strncmp(arg, "--sample=", 9)) {
+      options->sample = std::max(1, atoi(arg + 9));
+    } else if (arg[0] != '-' && options->path.empty()) {
+      options->path = arg;
+    } else {
+      options->path.clear();
+      break;
+    }
+  }
+  if (options->path.empty() == !options->sample) {
+    fprintf(stderr,
+            "usage: %s [--max_speed] [--repeat=1] [--jni_cost_ns=0] "
+            "(recording | --sample[=40])\n",
+            argv[0]);
+    return false;
+  }
+  return true;
+}
+
+bool ReadFile(const std::string &path, std::string *data) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  char buffer[4096];
+  size_t read;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data->append(buffer, read);
+  }
+  bool ok = !ferror(file);
+  fclose(file);
+  return ok;
+}
+
+int64_t Percentile(const std::vector<int64_t> &sorted, double percentile) {
+  if (sorted.empty()) return 0;
+  size_t index = static_cast<size_t>(percentile / 100 * (sorted.size() - 1));
+  return sorted[index];
+}
+
+void PrintReport(ReplayReport *report) {
+  printf("%-12s %7s %9s %9s %9s %9s\n", "phase", "count", "mean_us",
+         "p50_us", "p99_us", "max_us");
+  for (int phase = 0; phase < kPhaseCount; phase++) {
+    std::vector<int64_t> &samples = report->samples_ns[phase];
+    if (samples.empty()) continue;
+    std::sort(samples.begin(), samples.end());
+    double total = 0;
+    for (size_t i = 0; i < samples.size(); i++) total += samples[i];
+    printf("%-12s %7zu %9.2f %9.2f %9.2f %9.2f\n",
+           ReplayPhaseName(static_cast<ReplayPhase>(phase)), samples.size(),
+           total / samples.size() / 1000, Percentile(samples, 50) / 1000.0,
+           Percentile(samples, 99) / 1000.0,
+           Percentile(samples, 100) / 1000.0);
+  }
+  printf("\n%-12s %9s %9s\n", "java call", "recorded", "replayed");
+  for (int kind = JniRecorder::kRecordConfigure;
+       kind <= JniRecorder::kRecordResult; kind++) {
+    printf("%-12s %9llu %9llu\n", kKindNames[kind],
+           static_cast<unsigned long long>(report->recorded_calls[kind]),
+           static_cast<unsigned long long>(report->replayed_calls[kind]));
+  }
+  printf("\nrecording lasted %.1f ms, a pass took %.1f ms\n",
+         report->recorded_us / 1000.0, report->wall_us / 1000.0);
+  printf("unmatched results %llu, unanswered sign-ins %llu, incomplete %llu\n",
+         static_cast<unsigned long long>(report->unmatched_results),
+         static_cast<unsigned long long>(report->unanswered),
+         static_cast<unsigned long long>(report->incomplete));
+}
+
+int Run(const Options &options) {
+  std::string data;
+  if (options.sample) {
+    RecordSampleSession(options.sample, 2000, 1, &data);
+  } else if (!ReadFile(options.path, &data)) {
+    fprintf(stderr, "can't read %s\n", options.path.c_str());
+    return 1;
+  }
+  std::vector<ReplayEvent> events;
+  std::string error;
+  if (!ParseRecording(data, &events, &error)) {
+    fprintf(stderr, "%s: %s\n",
+            options.sample ? "sample" : options.path.c_str(), error.c_str());
+    return 1;
+  }
+  printf("%zu records, %zu bytes\n\n", events.size(), data.size());
+
+  FakeJvm::Get().SetTransitionCost(options.jni_cost_ns);
+  ReplayOptions replay_options = {options.max_speed, options.repeat};
+  ReplayReport report;
+  Replay(events, replay_options, &report);
+  FakeJvm::Get().SetTransitionCost(0);
+  PrintReport(&report);
+  return report.incomplete ? 1 : 0;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
+
+int main(int argc, char **argv) {
+  googlesignin::test::Options options;
+  if (!googlesignin::test::ParseOptions(argc, argv, &options)) return 2;
+  googlesignin::test::ScopedJavaThread game_thread;
+  return googlesignin::test::Run(options);
+}
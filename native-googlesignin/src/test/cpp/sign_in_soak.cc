@@ -0,0 +1,525 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// Soak and stress harness: drives the plugin through the C bridge, i.e. the
+// real google_signin_bridge.cc and google_signin.cc, against the fake Java
+// side scripted to answer like Play services under real-world timing.  Each
+// scenario runs for a while and reports its throughput, the sign-in latency
+// tail, the results by kind, sign-ins that never completed, broken
+// invariants and what it leaked.
+//
+//   sign_in_soak [--seconds=2] [--scenario=name] [--delivery_threads=4]
+//
+// Results are delivered after a log-normal delay on several fake Java
+// threads, so results due close together arrive in any order, and a share
+// of them fail with the codes Play services returns.  The scenarios:
+//
+//   steady          One sign-in at a time, interactive and silent in turn.
+//   reordered       Several sign-ins in flight, completing out of order.
+//   sign_out_race   Sign-outs landing while results are delivered, with the
+//                   session cache and the token refresh enabled.  Once a
+//                   sign-out returns, neither may hold a user.
+//   recreate        The activity recreated, or the plugin reconfigured,
+//                   while a sign-in is in flight.
+//
+// Results are never polled with PollEvents(): the event ring, once set up,
+// serves the whole process.  Build it with -DGOOGLESIGNIN_SANITIZE=address
+// or thread to run the same scenarios under ASan or TSan.  Exits with 1 if
+// a sign-in got stuck, an invariant broke, a status was unexpected or Java
+// objects were leaked.
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "google_signin_bridge.h"
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define GOOGLESIGNIN_SOAK_SANITIZED 1
+#endif
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const char kWebClientId[] =
+    "1234567890-abcdefghijklmnopqrstuvwxyz012345.apps.googleusercontent.com";
+const char kOtherWebClientId[] =
+    "1234567890-zyxwvutsrqponmlkjihgfedcba543210.apps.googleusercontent.com";
+
+// How long a sign-in may take before it counts as stuck.
+const int kStuckMs = 5000;
+
+// The failures Play services returns, drawn uniformly.
+const int kFailures[] = {kFakeNetworkError, kFakeCanceled, kFakeTimeout,
+                         kFakeInternalError, kFakeInterrupted,
+                         kFakeSignInRequired};
+
+int64_t MicrosSince(Clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() -
+                                                               start)
+      .count();
+}
+
+// How the scripted Play services answer: after a log-normal delay with the
+// given median, failing with one of kFailures at failure_rate.
+struct Script {
+  int64_t median_us;
+  double sigma;
+  double failure_rate;
+};
+
+// Makes a responder following script.  Sign-ins are started on the game
+// thread, the random state is shared so it is guarded.
+FakeSignInHelper::Responder ScriptedResponder(const Script &script,
+                                              uint32_t seed) {
+  struct State {
+    std::mutex mutex;
+    std::mt19937 random;
+    std::lognormal_distribution<double> delay;
+    std::uniform_real_distribution<double> uniform;
+    std::shared_ptr<const FakeAccount> account;
+  };
+  std::shared_ptr<State> state(new State());
+  state->random.seed(seed);
+  state->delay = std::lognormal_distribution<double>(
+      std::log(static_cast<double>(script.median_us)), script.sigma);
+  state->account.reset(new FakeAccount(FakeAccount::Default()));
+  double failure_rate = script.failure_rate;
+  return [state, failure_rate](const FakeRequest &request, bool silent) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    FakeResponse response = {kFakeSuccess, state->account,
+                             static_cast<int64_t>(state->delay(state->random))};
+    if (state->uniform(state->random) < failure_rate) {
+      size_t count = sizeof(kFailures) / sizeof(kFailures[0]);
+      response.status = kFailures[state->random() % count];
+      response.account.reset();
+    }
+    return response;
+  };
+}
+
+// A sign-in followed from start to completion.  The completion time is
+// taken by a callback on the delivering thread.
+struct Tracked {
+  GoogleSignInFuture_t future;
+  Clock::time_point started;
+  std::atomic<int64_t> latency_us;
+
+  static void OnComplete(void *user_data) {
+    Tracked *tracked = static_cast<Tracked *>(user_data);
+    tracked->latency_us.store(MicrosSince(tracked->started));
+  }
+};
+
+// What a scenario did.
+struct Report {
+  uint64_t cycles = 0;
+  uint64_t sign_ins = 0;
+  uint64_t succeeded = 0;
+  uint64_t failed = 0;
+  uint64_t canceled = 0;
+  uint64_t stuck = 0;
+  uint64_t unexpected = 0;
+  uint64_t violations = 0;
+  std::vector<int64_t> latencies_us;
+};
+
+// Runs one scenario on the game thread, the main thread, which is attached
+// as a Java thread like the Unity main thread.
+class Scenario {
+ public:
+  Scenario(FakeSignInHelper &helper, double seconds)
+      : helper_(helper), seconds_(seconds) {}
+  virtual ~Scenario() {}
+
+  virtual const char *name() const = 0;
+  virtual void Run() = 0;
+
+  Report TakeReport() { return std::move(report_); }
+
+ protected:
+  bool TimeLeft() const {
+    return std::chrono::duration<double>(Clock::now() - started_).count() <
+           seconds_;
+  }
+
+  static GoogleSignIn_t NewPlugin(FakeSignInHelper &helper,
+                                  const char *web_client_id) {
+    GoogleSignIn_t plugin = GoogleSignIn_Create(helper.activity());
+    GoogleSignIn_Configure(plugin, false, web_client_id, false, false, true,
+                           true, false, nullptr, 0, nullptr);
+    return plugin;
+  }
+
+  // Starts a sign-in and follows it.  The tracked sign-ins live until the
+  // scenario ends, as their callbacks may still run.
+  Tracked *Start(GoogleSignIn_t plugin, bool silent) {
+    tracked_.emplace_back();
+    Tracked *tracked = &tracked_.back();
+    tracked->started = Clock::now();
+    tracked->latency_us = -1;
+    tracked->future = silent ? GoogleSignIn_SignInSilently(plugin)
+                             : GoogleSignIn_SignIn(plugin);
+    GoogleSignIn_SetCompletionCallback(tracked->future, &Tracked::OnComplete,
+                                       tracked, false);
+    report_.sign_ins++;
+    return tracked;
+  }
+
+  // Waits for a tracked sign-in and counts its result.  Cancellations by
+  // the plugin and the scripted ones are counted together.
+  void Finish(Tracked *tracked) {
+    if (!GoogleSignIn_Wait(tracked->future, kStuckMs)) {
+      report_.stuck++;
+      return;
+    }
+    int status = GoogleSignIn_Status(tracked->future);
+    GoogleSignInUser_t user = GoogleSignIn_Result(tracked->future);
+    bool success = status == kUnityStatusCodeSuccess ||
+                   status == kUnityStatusCodeSuccessCached;
+    if (success != (user != nullptr)) {
+      report_.unexpected++;
+    }
+    GoogleSignIn_ReleaseUser(user);
+    switch (status) {
+      case kUnityStatusCodeSuccess:
+      case kUnityStatusCodeSuccessCached:
+        report_.succeeded++;
+        break;
+      case kUnityStatusCodeCanceled:
+        report_.canceled++;
+        break;
+      case kUnityStatusCodeNetworkError:
+      case kUnityStatusCodeInternalError:
+      case kUnityStatusCodeInterrupted:
+      case kUnityStatusCodeError:
+        report_.failed++;
+        break;
+      default:
+        report_.unexpected++;
+        break;
+    }
+    // The callback may not have run yet if the wait raced it.
+    int64_t latency_us = tracked->latency_us.load();
+    report_.latencies_us.push_back(
+        latency_us >= 0 ? latency_us : MicrosSince(tracked->started));
+  }
+
+  FakeSignInHelper &helper_;
+  double seconds_;
+  Clock::time_point started_ = Clock::now();
+  Report report_;
+  std::deque<Tracked> tracked_;
+};
+
+class SteadyScenario : public Scenario {
+ public:
+  using Scenario::Scenario;
+  const char *name() const override { return "steady"; }
+
+  void Run() override {
+    Script script = {500, 1.0, 0.1};
+    helper_.SetResponder(ScriptedResponder(script, 1));
+    GoogleSignIn_t plugin = NewPlugin(helper_, kWebClientId);
+    while (TimeLeft()) {
+      Finish(Start(plugin, report_.cycles % 2 != 0));
+      report_.cycles++;
+    }
+    helper_.WaitIdle();
+    GoogleSignIn_Dispose(plugin);
+  }
+};
+
+class ReorderedScenario : public Scenario {
+ public:
+  using Scenario::Scenario;
+  const char *name() const override { return "reordered"; }
+
+  void Run() override {
+    // Fewer than the request slots, so no request is evicted.
+    const size_t kInFlight = 6;
+    Script script = {1000, 1.5, 0.1};
+    helper_.SetResponder(ScriptedResponder(script, 2));
+    GoogleSignIn_t plugin = NewPlugin(helper_, kWebClientId);
+    std::deque<Tracked *> in_flight;
+    while (TimeLeft()) {
+      in_flight.push_back(Start(plugin, report_.cycles % 3 == 0));
+      if (in_flight.size() == kInFlight) {
+        Finish(in_flight.front());
+        in_flight.pop_front();
+      }
+      report_.cycles++;
+    }
+    for (Tracked *tracked : in_flight) Finish(tracked);
+    helper_.WaitIdle();
+    GoogleSignIn_Dispose(plugin);
+  }
+};
+
+class SignOutRaceScenario : public Scenario {
+ public:
+  using Scenario::Scenario;
+  const char *name() const override { return "sign_out_race"; }
+
+  void Run() override {
+    Script script = {100, 0.8, 0.05};
+    FakeSignInHelper::Responder responder = ScriptedResponder(script, 3);
+    GoogleSignIn_t plugin = NewPlugin(helper_, kWebClientId);
+    GoogleSignIn_EnableSessionCache(plugin, true);
+    GoogleSignIn_EnableTokenRefresh(plugin, true);
+    std::mt19937 random(4);
+    std::uniform_int_distribution<int> pause_us(0, 300);
+    while (TimeLeft()) {
+      helper_.SetResponder(responder);
+      Tracked *tracked = Start(plugin, report_.cycles % 2 != 0);
+      // Sign out before, while or after the result is delivered.
+      std::this_thread::sleep_for(std::chrono::microseconds(pause_us(random)));
+      GoogleSignIn_Signout(plugin);
+      Finish(tracked);
+      helper_.WaitIdle();
+      if (SignedInAfterSignOut(plugin)) {
+        report_.violations++;
+      }
+      report_.cycles++;
+    }
+    GoogleSignIn_EnableSessionCache(plugin, false);
+    GoogleSignIn_EnableTokenRefresh(plugin, false);
+    GoogleSignIn_Dispose(plugin);
+  }
+
+ private:
+  // Returns whether the refresh or the session cache holds a user.  A
+  // cached user completes a silent sign-in right away, the silent sign-in
+  // then fails as signed out, clearing the cache for the next cycle.
+  bool SignedInAfterSignOut(GoogleSignIn_t plugin) {
+    bool refreshed = GoogleSignIn_GetRefreshedIdToken(plugin, nullptr, 0) != 0;
+    helper_.SetResponder([](const FakeRequest &request, bool silent) {
+      FakeResponse response = {kFakeSignInRequired, nullptr, 0};
+      return response;
+    });
+    GoogleSignInFuture_t probe = GoogleSignIn_SignInSilently(plugin);
+    bool cached = !GoogleSignIn_Pending(probe) &&
+                  GoogleSignIn_Status(probe) == kUnityStatusCodeSuccessCached;
+    helper_.WaitIdle();
+    // The probe's own result clears what it found.
+    GoogleSignIn_Signout(plugin);
+    return refreshed || cached;
+  }
+};
+
+class RecreateScenario : public Scenario {
+ public:
+  using Scenario::Scenario;
+  const char *name() const override { return "recreate"; }
+
+  void Run() override {
+    Script script = {300, 1.0, 0.1};
+    helper_.SetResponder(ScriptedResponder(script, 5));
+    std::mt19937 random(6);
+    std::uniform_int_distribution<int> pause_us(0, 600);
+    GoogleSignIn_t plugin = NewPlugin(helper_, kWebClientId);
+    while (TimeLeft()) {
+      Tracked *first = Start(plugin, report_.cycles % 2 != 0);
+      std::this_thread::sleep_for(std::chrono::microseconds(pause_us(random)));
+      if (report_.cycles % 2) {
+        // The activity is recreated: Unity disposes the plugin and creates
+        // a new one while the result is on its way.
+        GoogleSignIn_Dispose(plugin);
+        plugin = NewPlugin(helper_, kWebClientId);
+      } else {
+        // The game reconfigures, alternating the client ids.
+        GoogleSignIn_Configure(plugin, false,
+                               report_.cycles % 4 ? kWebClientId
+                                                  : kOtherWebClientId,
+                               false, false, true, true, false, nullptr, 0,
+                               nullptr);
+      }
+      Tracked *second = Start(plugin, false);
+      Finish(first);
+      Finish(second);
+      report_.cycles++;
+    }
+    helper_.WaitIdle();
+    GoogleSignIn_Dispose(plugin);
+  }
+};
+
+// Bytes allocated from the heap.  Not known under a sanitizer, which has
+// its own allocator and reports leaks at exit instead.
+#if !defined(GOOGLESIGNIN_SOAK_SANITIZED)
+size_t HeapInUse() {
+  struct mallinfo2 info = mallinfo2();
+  return info.uordblks + info.hblkhd;
+}
+#else
+size_t HeapInUse() { return 0; }
+#endif
+
+int64_t Percentile(const std::vector<int64_t> &sorted, double percentile) {
+  if (sorted.empty()) return 0;
+  size_t index = static_cast<size_t>(percentile / 100 * (sorted.size() - 1));
+  return sorted[index];
+}
+
+struct Options {
+  double seconds = 2;
+  std::string scenario;
+  int delivery_threads = 4;
+};
+
+// Does once what the plugin only does once per process, resolving its
+// classes and creating the session cache, so the scenarios don't count it
+// as leaked.
+void WarmUp(FakeSignInHelper &helper) {
+  GoogleSignIn_t plugin = GoogleSignIn_Create(helper.activity());
+  GoogleSignIn_Configure(plugin, false, kWebClientId, false, false, true, true,
+                         false, nullptr, 0, nullptr);
+  GoogleSignIn_EnableSessionCache(plugin, true);
+  GoogleSignIn_EnableTokenRefresh(plugin, true);
+  GoogleSignInFuture_t future = GoogleSignIn_SignIn(plugin);
+  GoogleSignIn_Wait(future, kStuckMs);
+  GoogleSignIn_Signout(plugin);
+  GoogleSignIn_EnableSessionCache(plugin, false);
+  GoogleSignIn_EnableTokenRefresh(plugin, false);
+  helper.Reset();
+  GoogleSignIn_Dispose(plugin);
+}
+
+bool ParseOptions(int argc, char **argv, Options *options) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    if (!strncmp(arg, "--seconds=", 10)) {
+      options->seconds = atof(arg + 10);
+    } else if (!strncmp(arg, "--scenario=", 11)) {
+      options->scenario = arg + 11;
+    } else if (!strncmp(arg, "--delivery_threads=", 19)) {
+      options->delivery_threads = atoi(arg + 19);
+    } else {
+      fprintf(stderr,
+              "usage: %s [--seconds=2] [--scenario=name] "
+              "[--delivery_threads=4]\n",
+              argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+int Run(const Options &options) {
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  FakeJvm &jvm = FakeJvm::Get();
+  typedef std::function<Scenario *()> Factory;
+  const std::vector<std::pair<std::string, Factory>> scenarios = {
+      {"steady",
+       [&] { return new SteadyScenario(helper, options.seconds); }},
+      {"reordered",
+       [&] { return new ReorderedScenario(helper, options.seconds); }},
+      {"sign_out_race",
+       [&] { return new SignOutRaceScenario(helper, options.seconds); }},
+      {"recreate",
+       [&] { return new RecreateScenario(helper, options.seconds); }},
+  };
+
+  WarmUp(helper);
+  printf("%-14s %7s %9s %8s %8s %8s %6s %6s %6s %5s %5s %7s %9s\n",
+         "scenario", "cycles", "signin/s", "p50 ms", "p99 ms", "max ms",
+         "ok", "failed", "cancel", "stuck", "bad", "leaked", "heap B/c");
+  bool found = false;
+  bool passed = true;
+  for (const auto &entry : scenarios) {
+    if (!options.scenario.empty() && options.scenario != entry.first) {
+      continue;
+    }
+    found = true;
+    helper.Reset();
+    helper.SetDeliveryThreads(options.delivery_threads);
+    size_t objects = jvm.live_objects();
+    size_t global_refs = jvm.global_refs();
+    size_t heap = HeapInUse();
+    Clock::time_point start = Clock::now();
+
+    std::unique_ptr<Scenario> scenario(entry.second());
+    scenario->Run();
+
+    double elapsed = std::chrono::duration<double>(Clock::now() - start)
+                         .count();
+    helper.Reset();
+    Report report = scenario->TakeReport();
+    scenario.reset();
+    // Java objects and global references the scenario left behind, and the
+    // heap it grew by, less the latencies kept for the report.
+    long leaked = static_cast<long>(jvm.live_objects() - objects) +
+                  static_cast<long>(jvm.global_refs() - global_refs);
+    double grown = static_cast<double>(HeapInUse()) - heap -
+                   report.latencies_us.capacity() * sizeof(int64_t);
+    char heap_per_cycle[16] = "n/a";
+#if !defined(GOOGLESIGNIN_SOAK_SANITIZED)
+    snprintf(heap_per_cycle, sizeof(heap_per_cycle), "%.1f",
+             report.cycles ? grown / report.cycles : 0);
+#endif
+    std::vector<int64_t> &latencies = report.latencies_us;
+    std::sort(latencies.begin(), latencies.end());
+    uint64_t bad = report.unexpected + report.violations;
+    printf("%-14s %7llu %9.0f %8.2f %8.2f %8.2f %6llu %6llu %6llu %5llu "
+           "%5llu %7ld %9s\n",
+           entry.first.c_str(),
+           static_cast<unsigned long long>(report.cycles),
+           report.sign_ins / elapsed, Percentile(latencies, 50) / 1000.0,
+           Percentile(latencies, 99) / 1000.0,
+           Percentile(latencies, 100) / 1000.0,
+           static_cast<unsigned long long>(report.succeeded),
+           static_cast<unsigned long long>(report.failed),
+           static_cast<unsigned long long>(report.canceled),
+           static_cast<unsigned long long>(report.stuck),
+           static_cast<unsigned long long>(bad), leaked, heap_per_cycle);
+    // Shown as each scenario ends, and before LeakSanitizer exits.
+    fflush(stdout);
+    if (report.stuck || bad || leaked > 0) {
+      passed = false;
+    }
+  }
+  if (!found) {
+    fprintf(stderr, "unknown scenario %s\n", options.scenario.c_str());
+    return 2;
+  }
+  return passed ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
+
+int main(int argc, char **argv) {
+  googlesignin::test::Options options;
+  if (!googlesignin::test::ParseOptions(argc, argv, &options)) return 2;
+  googlesignin::test::ScopedJavaThread game_thread;
+  return googlesignin::test::Run(options);
+}
@@ -0,0 +1,113 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// Time spent constructing the first instance on the main thread, in a fresh
+// process each time since the classes and method ids are resolved once per
+// process: without Prewarm(), after Prewarm() finished, and after a
+// Prewarm() that failed and left the lookups to the constructor.
+
+#include <benchmark/benchmark.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "google_signin_bridge.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+enum PrewarmMode {
+  kNoPrewarm = 0,
+  kPrewarmed = 1,
+  // Prewarmed without an activity, so the prewarm thread can't find the
+  // app classes.
+  kPrewarmFailed = 2,
+};
+
+void PrewarmAndWait(jobject activity) {
+  FakeJvm &jvm = FakeJvm::Get();
+  uint64_t detached = jvm.counts().calls[kJniDetachCurrentThread];
+  GoogleSignIn_Prewarm(activity);
+  while (jvm.counts().calls[kJniDetachCurrentThread] == detached) {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+}
+
+// Runs in the child: sets up the VM, prewarms as mode says and returns the
+// construction time in ns.
+int64_t ConstructFirstInstance(PrewarmMode mode) {
+  ScopedJavaThread ui_thread;
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  if (mode != kNoPrewarm) {
+    PrewarmAndWait(mode == kPrewarmed ? helper.activity() : nullptr);
+  }
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  GoogleSignIn_t plugin = GoogleSignIn_Create(helper.activity());
+  int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+  benchmark::DoNotOptimize(plugin);
+  return elapsed;
+}
+
+void BM_ConstructFirstInstance(benchmark::State &state) {
+  PrewarmMode mode = static_cast<PrewarmMode>(state.range(0));
+  for (auto _ : state) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      state.SkipWithError("pipe failed");
+      break;
+    }
+    pid_t child = fork();
+    if (child == 0) {
+      close(fds[0]);
+      int64_t elapsed = ConstructFirstInstance(mode);
+      ssize_t written = write(fds[1], &elapsed, sizeof(elapsed));
+      _exit(written == sizeof(elapsed) ? 0 : 1);
+    }
+    close(fds[1]);
+    int64_t elapsed = 0;
+    ssize_t read_size = read(fds[0], &elapsed, sizeof(elapsed));
+    close(fds[0]);
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (read_size != sizeof(elapsed) || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      state.SkipWithError("the child process failed");
+      break;
+    }
+    state.SetIterationTime(elapsed / 1e9);
+  }
+}
+BENCHMARK(BM_ConstructFirstInstance)
+    ->ArgNames({"prewarm"})
+    ->Arg(kNoPrewarm)
+    ->Arg(kPrewarmed)
+    ->Arg(kPrewarmFailed)
+    ->Iterations(20)
+    ->UseManualTime()
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
+
+BENCHMARK_MAIN();
@@ -0,0 +1,121 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// Benchmarks of the sign-in stats: the cost of recording from several
+// threads at once, against one shared counter the shards replace, and the
+// cost of the snapshot a dashboard poll takes.
+
+#include <benchmark/benchmark.h>
+#include <atomic>
+#include <thread>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "google_signin.h"
+#include "google_signin_bridge.h"
+#include "stats.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+// A completion and the JNI traffic of its result, as CompleteRequest and
+// UserFromAccount record them, from state.threads() threads at once.
+void BM_RecordSignIn(benchmark::State &state) {
+  uint64_t latency_ms = state.thread_index();
+  for (auto _ : state) {
+    StatsRecorder::RecordCompletion(SignInStats::kFlowSilent,
+                                    GoogleSignIn::kStatusCodeSuccess,
+                                    latency_ms++ % 4096);
+    StatsRecorder::RecordJni(SignInStats::kOpResult, 6, 600);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RecordSignIn)->ThreadRange(1, 8)->UseRealTime();
+
+// The same three increments on counters every thread shares, for
+// comparison: what the recording would cost without the shards.
+std::atomic<uint64_t> shared_counters[3];
+
+void BM_RecordSignInUnsharded(benchmark::State &state) {
+  for (auto _ : state) {
+    shared_counters[0].fetch_add(1, std::memory_order_relaxed);
+    shared_counters[1].fetch_add(6, std::memory_order_relaxed);
+    shared_counters[2].fetch_add(600, std::memory_order_relaxed);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RecordSignInUnsharded)->ThreadRange(1, 8)->UseRealTime();
+
+// Recording while another thread takes snapshots back to back, as a game
+// thread polling the stats every frame would at worst.
+void BM_RecordWhileSnapshotting(benchmark::State &state) {
+  std::atomic<bool> done(false);
+  std::thread reader([&done] {
+    SignInStats stats;
+    while (!done.load(std::memory_order_relaxed)) {
+      StatsRecorder::Snapshot(&stats);
+      benchmark::DoNotOptimize(stats);
+      std::this_thread::yield();
+    }
+  });
+  uint64_t latency_ms = 0;
+  for (auto _ : state) {
+    StatsRecorder::RecordCompletion(SignInStats::kFlowSilent,
+                                    GoogleSignIn::kStatusCodeSuccess,
+                                    latency_ms++ % 4096);
+    StatsRecorder::RecordJni(SignInStats::kOpResult, 6, 600);
+  }
+  done = true;
+  reader.join();
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_RecordWhileSnapshotting);
+
+void BM_Snapshot(benchmark::State &state) {
+  SignInStats stats;
+  for (auto _ : state) {
+    StatsRecorder::Snapshot(&stats);
+    benchmark::DoNotOptimize(stats);
+  }
+  state.counters["bytes"] = sizeof(stats);
+}
+BENCHMARK(BM_Snapshot);
+
+// GoogleSignIn_GetStats(): the snapshot plus folding the statuses and
+// deriving the ratios and percentiles, as the C# side polls it.
+void BM_BridgeGetStats(benchmark::State &state) {
+  GoogleSignIn_t plugin =
+      GoogleSignIn_Create(FakeSignInHelper::Get().activity());
+  GoogleSignInStats stats;
+  for (auto _ : state) {
+    GoogleSignIn_GetStats(plugin, &stats);
+    benchmark::DoNotOptimize(stats);
+  }
+  GoogleSignIn_Dispose(plugin);
+}
+BENCHMARK(BM_BridgeGetStats);
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
+
+int main(int argc, char **argv) {
+  googlesignin::test::ScopedJavaThread ui_thread;
+  googlesignin::test::FakeSignInHelper::Get();
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -0,0 +1,285 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "google_signin.h"
+#include "google_signin_bridge.h"
+#include "plugin_test.h"
+#include "stats.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+// The stats are process-wide, so the tests compare the counters before and
+// after what they do rather than absolute values.
+SignInStats Snapshot() {
+  SignInStats stats;
+  StatsRecorder::Snapshot(&stats);
+  return stats;
+}
+
+SignInStats EmptyStats() {
+  SignInStats stats;
+  memset(&stats, 0, sizeof(stats));
+  return stats;
+}
+
+TEST(SignInStatsTest, StatusBucketsRoundTrip) {
+  for (int status = -1; status < SignInStats::kStatusBucketOther - 1;
+       status++) {
+    int bucket = SignInStats::StatusBucket(status);
+    EXPECT_NE(SignInStats::kStatusBucketOther, bucket) << status;
+    EXPECT_EQ(status, SignInStats::BucketStatus(bucket));
+  }
+  for (int status : {-5, -2, SignInStats::kStatusBucketOther - 1, 100}) {
+    EXPECT_EQ(SignInStats::kStatusBucketOther,
+              SignInStats::StatusBucket(status))
+        << status;
+  }
+  EXPECT_EQ(GoogleSignIn::kStatusCodeError,
+            SignInStats::BucketStatus(SignInStats::kStatusBucketOther));
+}
+
+// Every latency is in the bucket whose bounds surround it, and buckets above
+// the exact ones are no wider than a quarter of their lower bound.
+TEST(SignInStatsTest, LatencyBucketsBoundTheirValues) {
+  std::vector<uint64_t> values;
+  for (uint64_t base = 1; base < (1ULL << 24); base *= 2) {
+    const uint64_t offsets[] = {0, 1, base / 4, base / 2, base - 1};
+    for (uint64_t offset : offsets) {
+      values.push_back(base + offset);
+    }
+  }
+  values.push_back(0);
+  for (uint64_t value : values) {
+    int bucket = SignInStats::LatencyBucket(value);
+    ASSERT_GE(bucket, 0);
+    ASSERT_LT(bucket, SignInStats::kLatencyBuckets);
+    uint64_t lower = SignInStats::LatencyBucketLowerBound(bucket);
+    uint64_t upper = SignInStats::LatencyBucketLowerBound(bucket + 1);
+    EXPECT_LE(lower, value);
+    EXPECT_LT(value, upper);
+    if (value >= 4) {
+      EXPECT_LE(upper - lower, lower / 4) << value;
+    }
+  }
+  for (int bucket = 0; bucket < SignInStats::kLatencyBuckets; bucket++) {
+    EXPECT_EQ(bucket, SignInStats::LatencyBucket(
+                          SignInStats::LatencyBucketLowerBound(bucket)));
+  }
+}
+
+TEST(SignInStatsTest, LongLatenciesLandInTheLastBucket) {
+  EXPECT_EQ(SignInStats::kLatencyBuckets - 1,
+            SignInStats::LatencyBucket(UINT64_MAX));
+}
+
+TEST(SignInStatsTest, PercentilesAreUpperBoundsOfTheirBucket) {
+  SignInStats stats = EmptyStats();
+  const SignInStats::Flow flow = SignInStats::kFlowInteractive;
+  EXPECT_EQ(0u, stats.LatencyPercentileMs(flow, 50));
+
+  stats.latency_ms[flow][SignInStats::LatencyBucket(10)] = 98;
+  stats.latency_ms[flow][SignInStats::LatencyBucket(1000)] = 2;
+  uint64_t p50 = stats.LatencyPercentileMs(flow, 50);
+  EXPECT_GE(p50, 10u);
+  EXPECT_LT(p50, 13u);
+  EXPECT_EQ(p50, stats.LatencyPercentileMs(flow, 98));
+  uint64_t p99 = stats.LatencyPercentileMs(flow, 99);
+  EXPECT_GE(p99, 1000u);
+  EXPECT_LT(p99, 1250u);
+  EXPECT_EQ(p99, stats.LatencyPercentileMs(flow, 100));
+  EXPECT_EQ(p50, stats.LatencyPercentileMs(flow, 0));
+  EXPECT_EQ(0u, stats.LatencyPercentileMs(SignInStats::kFlowSilent, 99));
+}
+
+TEST(SignInStatsTest, SuccessRatioCountsCachedResults) {
+  SignInStats stats = EmptyStats();
+  const SignInStats::Flow flow = SignInStats::kFlowSilent;
+  EXPECT_EQ(0, stats.SuccessRatio(flow));
+  stats.completed[flow][SignInStats::StatusBucket(
+      GoogleSignIn::kStatusCodeSuccess)] = 2;
+  stats.completed[flow][SignInStats::StatusBucket(
+      GoogleSignIn::kStatusCodeSuccessCached)] = 1;
+  stats.completed[flow][SignInStats::StatusBucket(
+      GoogleSignIn::kStatusCodeNetworkError)] = 1;
+  EXPECT_EQ(4u, stats.Completed(flow));
+  EXPECT_EQ(3u, stats.Succeeded(flow));
+  EXPECT_DOUBLE_EQ(0.75, stats.SuccessRatio(flow));
+}
+
+// More threads than shards record at once while another takes snapshots,
+// which never go backwards, and nothing recorded is lost.
+TEST(StatsRecorderTest, ConcurrentRecordsAreAllCounted) {
+  const int kThreads = 12;
+  const int kRecords = 20000;
+  SignInStats before = Snapshot();
+
+  std::atomic<bool> done(false);
+  std::thread reader([&done] {
+    uint64_t last = 0;
+    while (!done.load()) {
+      SignInStats stats = Snapshot();
+      uint64_t calls = stats.jni_calls[SignInStats::kOpOther];
+      EXPECT_GE(calls, last);
+      last = calls;
+      std::this_thread::yield();
+    }
+  });
+  std::vector<std::thread> recorders;
+  for (int i = 0; i < kThreads; i++) {
+    recorders.emplace_back([i] {
+      SignInStats::Flow flow = static_cast<SignInStats::Flow>(i % 2);
+      for (int j = 0; j < kRecords; j++) {
+        StatsRecorder::RecordStart(flow);
+        StatsRecorder::RecordCompletion(flow, GoogleSignIn::kStatusCodeTimeout,
+                                        j % 5000);
+        StatsRecorder::RecordJni(SignInStats::kOpOther, 2, 3);
+      }
+    });
+  }
+  for (std::thread &recorder : recorders) recorder.join();
+  done = true;
+  reader.join();
+
+  SignInStats after = Snapshot();
+  const uint64_t per_flow = kThreads / 2 * kRecords;
+  const int timeout =
+      SignInStats::StatusBucket(GoogleSignIn::kStatusCodeTimeout);
+  for (int flow = 0; flow < SignInStats::kFlowCount; flow++) {
+    EXPECT_EQ(per_flow, after.started[flow] - before.started[flow]);
+    EXPECT_EQ(per_flow,
+              after.completed[flow][timeout] - before.completed[flow][timeout]);
+    uint64_t latencies = 0;
+    for (int i = 0; i < SignInStats::kLatencyBuckets; i++) {
+      latencies += after.latency_ms[flow][i] - before.latency_ms[flow][i];
+    }
+    EXPECT_EQ(per_flow, latencies);
+  }
+  EXPECT_EQ(2u * kThreads * kRecords,
+            after.jni_calls[SignInStats::kOpOther] -
+                before.jni_calls[SignInStats::kOpOther]);
+  EXPECT_EQ(3u * kThreads * kRecords,
+            after.jni_bytes[SignInStats::kOpOther] -
+                before.jni_bytes[SignInStats::kOpOther]);
+}
+
+// The counters sign-ins through the plugin and the bridge record.
+class PluginStatsTest : public PluginTest {
+ protected:
+  // Makes the fake answer every sign-in with status after delay_us.
+  void RespondWithStatus(int status, int64_t delay_us) {
+    if (status == kFakeSuccess) {
+      helper_.RespondWith(FakeAccount::Default(), delay_us);
+      return;
+    }
+    helper_.SetResponder(
+        [status, delay_us](const FakeRequest &request, bool silent) {
+          FakeResponse response = {status, nullptr, delay_us};
+          return response;
+        });
+  }
+
+  void SignIn(bool silent) {
+    GoogleSignInFuture_t future = silent ? GoogleSignIn_SignInSilently(plugin_)
+                                         : GoogleSignIn_SignIn(plugin_);
+    ASSERT_TRUE(GoogleSignIn_Wait(future, 10000));
+    GoogleSignInUser_t user = GoogleSignIn_Result(future);
+    if (user) GoogleSignIn_ReleaseUser(user);
+  }
+
+  GoogleSignInStats BridgeStats() {
+    GoogleSignInStats stats;
+    GoogleSignIn_GetStats(plugin_, &stats);
+    return stats;
+  }
+};
+
+TEST_F(PluginStatsTest, SignInsAreCountedByFlowAndStatus) {
+  SignInStats before = Snapshot();
+  RespondWithStatus(kFakeSuccess, 20000);
+  SignIn(false);
+  RespondWithStatus(kFakeNetworkError, 0);
+  SignIn(false);
+  SignIn(true);
+  SignInStats after = Snapshot();
+
+  const SignInStats::Flow interactive = SignInStats::kFlowInteractive;
+  const SignInStats::Flow silent = SignInStats::kFlowSilent;
+  const int success = SignInStats::StatusBucket(GoogleSignIn::kStatusCodeSuccess);
+  const int network =
+      SignInStats::StatusBucket(GoogleSignIn::kStatusCodeNetworkError);
+  EXPECT_EQ(2u, after.started[interactive] - before.started[interactive]);
+  EXPECT_EQ(1u, after.started[silent] - before.started[silent]);
+  EXPECT_EQ(1u, after.completed[interactive][success] -
+                    before.completed[interactive][success]);
+  EXPECT_EQ(1u, after.completed[interactive][network] -
+                    before.completed[interactive][network]);
+  EXPECT_EQ(1u, after.completed[silent][network] -
+                    before.completed[silent][network]);
+
+  // The successful sign-in took at least the 20ms the fake waited.
+  uint64_t slow = 0;
+  for (int i = SignInStats::LatencyBucket(20); i < SignInStats::kLatencyBuckets;
+       i++) {
+    slow += after.latency_ms[interactive][i] - before.latency_ms[interactive][i];
+  }
+  EXPECT_EQ(1u, slow);
+
+  EXPECT_GT(after.jni_calls[SignInStats::kOpSignIn],
+            before.jni_calls[SignInStats::kOpSignIn]);
+  // The account's strings came back over JNI or the event ring.
+  EXPECT_GT(after.jni_bytes[SignInStats::kOpResult],
+            before.jni_bytes[SignInStats::kOpResult]);
+}
+
+// The bridge folds the native codes into the ones GoogleSignIn_Status()
+// returns, e.g. a timeout is reported as an internal error.
+TEST_F(PluginStatsTest, BridgeFoldsStatusesLikeGoogleSignInStatus) {
+  GoogleSignInStats before = BridgeStats();
+  RespondWithStatus(kFakeTimeout, 0);
+  SignIn(false);
+  RespondWithStatus(kFakeSuccess, 0);
+  SignIn(false);
+  GoogleSignInStats after = BridgeStats();
+
+  const int internal_error = kUnityStatusCodeInternalError + 1;
+  const int timeout = kUnityStatusCodeTimeout + 1;
+  const int success = kUnityStatusCodeSuccess + 1;
+  EXPECT_EQ(1u, after.completed[0][internal_error] -
+                    before.completed[0][internal_error]);
+  EXPECT_EQ(0u, after.completed[0][timeout] - before.completed[0][timeout]);
+  EXPECT_EQ(1u, after.completed[0][success] - before.completed[0][success]);
+  EXPECT_EQ(2u, after.started[0] - before.started[0]);
+
+  SignInStats totals = Snapshot();
+  EXPECT_DOUBLE_EQ(totals.SuccessRatio(SignInStats::kFlowInteractive),
+                   after.success_ratio[0]);
+  EXPECT_EQ(totals.LatencyPercentileMs(SignInStats::kFlowInteractive, 99),
+            after.latency_p99_ms[0]);
+  EXPECT_LE(after.latency_p50_ms[0], after.latency_p99_ms[0]);
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
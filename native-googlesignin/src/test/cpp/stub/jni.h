@@ -0,0 +1,310 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// Stand-in for the NDK's <jni.h> in the host build.  It has the same types,
+// and the same layout of function tables behind JNIEnv and JavaVM, but only
+// the functions the plugin and the tests use.  The tables are filled in by
+// the fake VM in fake_jvm.cc.
+
+#ifndef GOOGLESIGNIN_TEST_STUB_JNI_H
+#define GOOGLESIGNIN_TEST_STUB_JNI_H
+
+#include <stdarg.h>
+#include <stdint.h>
+
+typedef uint8_t jboolean;
+typedef int8_t jbyte;
+typedef uint16_t jchar;
+typedef int16_t jshort;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef float jfloat;
+typedef double jdouble;
+typedef jint jsize;
+
+class _jobject {};
+class _jclass : public _jobject {};
+class _jstring : public _jobject {};
+class _jthrowable : public _jobject {};
+class _jarray : public _jobject {};
+class _jobjectArray : public _jarray {};
+class _jbyteArray : public _jarray {};
+
+typedef _jobject *jobject;
+typedef _jclass *jclass;
+typedef _jstring *jstring;
+typedef _jthrowable *jthrowable;
+typedef _jarray *jarray;
+typedef _jobjectArray *jobjectArray;
+typedef _jbyteArray *jbyteArray;
+
+struct _jmethodID;
+typedef struct _jmethodID *jmethodID;
+
+union jvalue {
+  jboolean z;
+  jbyte b;
+  jchar c;
+  jshort s;
+  jint i;
+  jlong j;
+  jfloat f;
+  jdouble d;
+  jobject l;
+};
+
+struct JNINativeMethod {
+  const char *name;
+  const char *signature;
+  void *fnPtr;
+};
+
+#define JNI_FALSE 0
+#define JNI_TRUE 1
+
+#define JNI_VERSION_1_6 0x00010006
+
+#define JNI_OK 0
+#define JNI_ERR (-1)
+#define JNI_EDETACHED (-2)
+#define JNI_EVERSION (-3)
+
+#define JNI_COMMIT 1
+#define JNI_ABORT 2
+
+#define JNIEXPORT __attribute__((visibility("default")))
+#define JNICALL
+
+struct _JNIEnv;
+struct _JavaVM;
+typedef _JNIEnv JNIEnv;
+typedef _JavaVM JavaVM;
+
+struct JNINativeInterface {
+  jclass (*FindClass)(JNIEnv *, const char *);
+  jint (*ThrowNew)(JNIEnv *, jclass, const char *);
+  jboolean (*ExceptionCheck)(JNIEnv *);
+  void (*ExceptionClear)(JNIEnv *);
+  jobject (*NewGlobalRef)(JNIEnv *, jobject);
+  void (*DeleteGlobalRef)(JNIEnv *, jobject);
+  void (*DeleteLocalRef)(JNIEnv *, jobject);
+  jboolean (*IsInstanceOf)(JNIEnv *, jobject, jclass);
+  jclass (*GetObjectClass)(JNIEnv *, jobject);
+  jmethodID (*GetMethodID)(JNIEnv *, jclass, const char *, const char *);
+  jobject (*CallObjectMethodV)(JNIEnv *, jobject, jmethodID, va_list);
+  jboolean (*CallBooleanMethodV)(JNIEnv *, jobject, jmethodID, va_list);
+  void (*CallVoidMethodV)(JNIEnv *, jobject, jmethodID, va_list);
+  jmethodID (*GetStaticMethodID)(JNIEnv *, jclass, const char *,
+                                 const char *);
+  jobject (*CallStaticObjectMethodV)(JNIEnv *, jclass, jmethodID, va_list);
+  jboolean (*CallStaticBooleanMethodV)(JNIEnv *, jclass, jmethodID, va_list);
+  void (*CallStaticVoidMethodV)(JNIEnv *, jclass, jmethodID, va_list);
+  jstring (*NewStringUTF)(JNIEnv *, const char *);
+  const char *(*GetStringUTFChars)(JNIEnv *, jstring, jboolean *);
+  void (*ReleaseStringUTFChars)(JNIEnv *, jstring, const char *);
+  jsize (*GetArrayLength)(JNIEnv *, jarray);
+  jobjectArray (*NewObjectArray)(JNIEnv *, jsize, jclass, jobject);
+  jobject (*GetObjectArrayElement)(JNIEnv *, jobjectArray, jsize);
+  void (*SetObjectArrayElement)(JNIEnv *, jobjectArray, jsize, jobject);
+  jbyteArray (*NewByteArray)(JNIEnv *, jsize);
+  void (*SetByteArrayRegion)(JNIEnv *, jbyteArray, jsize, jsize,
+                             const jbyte *);
+  jint (*RegisterNatives)(JNIEnv *, jclass, const JNINativeMethod *, jint);
+  void *(*GetPrimitiveArrayCritical)(JNIEnv *, jarray, jboolean *);
+  void (*ReleasePrimitiveArrayCritical)(JNIEnv *, jarray, void *, jint);
+  jobject (*NewDirectByteBuffer)(JNIEnv *, void *, jlong);
+  void *(*GetDirectBufferAddress)(JNIEnv *, jobject);
+  jlong (*GetDirectBufferCapacity)(JNIEnv *, jobject);
+};
+
+// The C++ wrappers, as in the NDK.  The variadic calls forward to the
+// va_list entries of the table.
+struct _JNIEnv {
+  const struct JNINativeInterface *functions;
+
+  jclass FindClass(const char *name) { return functions->FindClass(this, name); }
+
+  jint ThrowNew(jclass clazz, const char *message) {
+    return functions->ThrowNew(this, clazz, message);
+  }
+
+  jboolean ExceptionCheck() { return functions->ExceptionCheck(this); }
+
+  void ExceptionClear() { functions->ExceptionClear(this); }
+
+  jobject NewGlobalRef(jobject obj) {
+    return functions->NewGlobalRef(this, obj);
+  }
+
+  void DeleteGlobalRef(jobject obj) { functions->DeleteGlobalRef(this, obj); }
+
+  void DeleteLocalRef(jobject obj) { functions->DeleteLocalRef(this, obj); }
+
+  jboolean IsInstanceOf(jobject obj, jclass clazz) {
+    return functions->IsInstanceOf(this, obj, clazz);
+  }
+
+  jclass GetObjectClass(jobject obj) {
+    return functions->GetObjectClass(this, obj);
+  }
+
+  jmethodID GetMethodID(jclass clazz, const char *name, const char *sig) {
+    return functions->GetMethodID(this, clazz, name, sig);
+  }
+
+  jobject CallObjectMethod(jobject obj, jmethodID method, ...) {
+    va_list args;
+    va_start(args, method);
+    jobject result = functions->CallObjectMethodV(this, obj, method, args);
+    va_end(args);
+    return result;
+  }
+
+  jboolean CallBooleanMethod(jobject obj, jmethodID method, ...) {
+    va_list args;
+    va_start(args, method);
+    jboolean result = functions->CallBooleanMethodV(this, obj, method, args);
+    va_end(args);
+    return result;
+  }
+
+  void CallVoidMethod(jobject obj, jmethodID method, ...) {
+    va_list args;
+    va_start(args, method);
+    functions->CallVoidMethodV(this, obj, method, args);
+    va_end(args);
+  }
+
+  jmethodID GetStaticMethodID(jclass clazz, const char *name,
+                              const char *sig) {
+    return functions->GetStaticMethodID(this, clazz, name, sig);
+  }
+
+  jobject CallStaticObjectMethod(jclass clazz, jmethodID method, ...) {
+    va_list args;
+    va_start(args, method);
+    jobject result =
+        functions->CallStaticObjectMethodV(this, clazz, method, args);
+    va_end(args);
+    return result;
+  }
+
+  jboolean CallStaticBooleanMethod(jclass clazz, jmethodID method, ...) {
+    va_list args;
+    va_start(args, method);
+    jboolean result =
+        functions->CallStaticBooleanMethodV(this, clazz, method, args);
+    va_end(args);
+    return result;
+  }
+
+  void CallStaticVoidMethod(jclass clazz, jmethodID method, ...) {
+    va_list args;
+    va_start(args, method);
+    functions->CallStaticVoidMethodV(this, clazz, method, args);
+    va_end(args);
+  }
+
+  jstring NewStringUTF(const char *bytes) {
+    return functions->NewStringUTF(this, bytes);
+  }
+
+  const char *GetStringUTFChars(jstring string, jboolean *is_copy) {
+    return functions->GetStringUTFChars(this, string, is_copy);
+  }
+
+  void ReleaseStringUTFChars(jstring string, const char *utf) {
+    functions->ReleaseStringUTFChars(this, string, utf);
+  }
+
+  jsize GetArrayLength(jarray array) {
+    return functions->GetArrayLength(this, array);
+  }
+
+  jobjectArray NewObjectArray(jsize length, jclass element_class,
+                              jobject initial_element) {
+    return functions->NewObjectArray(this, length, element_class,
+                                     initial_element);
+  }
+
+  jobject GetObjectArrayElement(jobjectArray array, jsize index) {
+    return functions->GetObjectArrayElement(this, array, index);
+  }
+
+  void SetObjectArrayElement(jobjectArray array, jsize index, jobject value) {
+    functions->SetObjectArrayElement(this, array, index, value);
+  }
+
+  jbyteArray NewByteArray(jsize length) {
+    return functions->NewByteArray(this, length);
+  }
+
+  void SetByteArrayRegion(jbyteArray array, jsize start, jsize len,
+                          const jbyte *buf) {
+    functions->SetByteArrayRegion(this, array, start, len, buf);
+  }
+
+  jint RegisterNatives(jclass clazz, const JNINativeMethod *methods,
+                       jint count) {
+    return functions->RegisterNatives(this, clazz, methods, count);
+  }
+
+  void *GetPrimitiveArrayCritical(jarray array, jboolean *is_copy) {
+    return functions->GetPrimitiveArrayCritical(this, array, is_copy);
+  }
+
+  void ReleasePrimitiveArrayCritical(jarray array, void *carray, jint mode) {
+    functions->ReleasePrimitiveArrayCritical(this, array, carray, mode);
+  }
+
+  jobject NewDirectByteBuffer(void *address, jlong capacity) {
+    return functions->NewDirectByteBuffer(this, address, capacity);
+  }
+
+  void *GetDirectBufferAddress(jobject buffer) {
+    return functions->GetDirectBufferAddress(this, buffer);
+  }
+
+  jlong GetDirectBufferCapacity(jobject buffer) {
+    return functions->GetDirectBufferCapacity(this, buffer);
+  }
+};
+
+struct JavaVMAttachArgs {
+  jint version;
+  const char *name;
+  jobject group;
+};
+
+struct JNIInvokeInterface {
+  jint (*AttachCurrentThread)(JavaVM *, JNIEnv **, void *);
+  jint (*DetachCurrentThread)(JavaVM *);
+  jint (*GetEnv)(JavaVM *, void **, jint);
+};
+
+struct _JavaVM {
+  const struct JNIInvokeInterface *functions;
+
+  jint AttachCurrentThread(JNIEnv **env, void *args) {
+    return functions->AttachCurrentThread(this, env, args);
+  }
+
+  jint DetachCurrentThread() { return functions->DetachCurrentThread(this); }
+
+  jint GetEnv(void **env, jint version) {
+    return functions->GetEnv(this, env, version);
+  }
+};
+
+#endif  // GOOGLESIGNIN_TEST_STUB_JNI_H
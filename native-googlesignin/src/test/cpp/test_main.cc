@@ -0,0 +1,28 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// main() of the test binaries.  The tests run on the main thread, attached
+// as a Java thread to stand in for the UI thread, with the plugin loaded.
+
+#include <gtest/gtest.h>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  googlesignin::test::ScopedJavaThread ui_thread;
+  googlesignin::test::FakeSignInHelper::Get();
+  return RUN_ALL_TESTS();
+}
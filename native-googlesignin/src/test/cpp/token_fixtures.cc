@@ -0,0 +1,276 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#include "token_fixtures.h"
+
+#include <random>
+
+namespace googlesignin {
+namespace test {
+
+std::string Base64UrlEncode(const void *data, size_t size) {
+  static const char kAlphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  std::string out;
+  out.reserve((size * 4 + 2) / 3);
+  size_t i = 0;
+  for (; i + 3 <= size; i += 3) {
+    uint32_t block = (bytes[i] << 16) | (bytes[i + 1] << 8) | bytes[i + 2];
+    out.push_back(kAlphabet[(block >> 18) & 63]);
+    out.push_back(kAlphabet[(block >> 12) & 63]);
+    out.push_back(kAlphabet[(block >> 6) & 63]);
+    out.push_back(kAlphabet[block & 63]);
+  }
+  if (size - i == 1) {
+    uint32_t block = bytes[i] << 16;
+    out.push_back(kAlphabet[(block >> 18) & 63]);
+    out.push_back(kAlphabet[(block >> 12) & 63]);
+  } else if (size - i == 2) {
+    uint32_t block = (bytes[i] << 16) | (bytes[i + 1] << 8);
+    out.push_back(kAlphabet[(block >> 18) & 63]);
+    out.push_back(kAlphabet[(block >> 12) & 63]);
+    out.push_back(kAlphabet[(block >> 6) & 63]);
+  }
+  return out;
+}
+
+std::string MakeJwt(const std::string &header_json,
+                    const std::string &payload_json,
+                    const std::string &signature) {
+  return Base64UrlEncode(header_json.data(), header_json.size()) + "." +
+         Base64UrlEncode(payload_json.data(), payload_json.size()) + "." +
+         Base64UrlEncode(signature.data(), signature.size());
+}
+
+std::string MakeIdToken(const std::string &audience, int64_t exp) {
+  std::string header =
+      "{\"alg\":\"RS256\",\"kid\":\"5aaff47c21d06e266cce395b2145c7c6d473"
+      "0ea5\",\"typ\":\"JWT\"}";
+  std::string payload =
+      "{\"iss\":\"https://accounts.google.com\",\"azp\":\"" + audience +
+      "\",\"aud\":\"" + audience +
+      "\",\"sub\":\"110169484474386276334\",\"hd\":\"example.com\","
+      "\"email\":\"jane.doe@example.com\",\"email_verified\":true,"
+      "\"at_hash\":\"HK6E_P6Dh8Y93mRNtsDB1Q\",\"name\":\"Jane Doe\","
+      "\"picture\":\"https://lh3.googleusercontent.com/a/default-user=s96-c\","
+      "\"given_name\":\"Jane\",\"family_name\":\"Doe\",\"locale\":\"en\","
+      "\"iat\":" +
+      std::to_string(exp - 3600) + ",\"exp\":" + std::to_string(exp) + "}";
+  std::string signature(256, '\0');
+  for (size_t i = 0; i < signature.size(); i++) {
+    signature[i] = static_cast<char>(i * 131 + 7);
+  }
+  return MakeJwt(header, payload, signature);
+}
+
+namespace {
+
+const char *const kGivenNames[] = {"Jane", "John", "Zo\\u00eb",
+                                   "André", "Mar\\u00eda", "Li",
+                                   "Oluwaseun", "Siobh\\u00e1n"};
+const char *const kFamilyNames[] = {"Doe", "M\\u00fcller", "Nakamura",
+                                    "O'Brien", "García", "Ng",
+                                    "Van der Berg", "Okonkwo-Adeyemi"};
+const char *const kDomains[] = {"example.com", "corp.example.org",
+                                "mail.example.net", "school.example.edu"};
+
+std::string RandomDigits(std::mt19937 *rng, int count) {
+  std::string digits;
+  for (int i = 0; i < count; i++) {
+    digits.push_back(static_cast<char>('0' + (*rng)() % 10));
+  }
+  return digits;
+}
+
+std::string RandomToken(std::mt19937 *rng, int count) {
+  static const char kAlphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+  std::string token;
+  for (int i = 0; i < count; i++) {
+    token.push_back(kAlphabet[(*rng)() % 64]);
+  }
+  return token;
+}
+
+std::string Lower(const std::string &value) {
+  std::string lower;
+  for (char c : value) {
+    lower.push_back(c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a')
+                                         : c);
+  }
+  return lower;
+}
+
+}  // namespace
+
+std::vector<std::string> MakeIdTokenCorpus(size_t count, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<std::string> corpus;
+  corpus.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    std::string kid;
+    for (int k = 0; k < 40; k++) kid.push_back("0123456789abcdef"[rng() % 16]);
+    std::string header =
+        "{\"alg\":\"RS256\",\"kid\":\"" + kid + "\",\"typ\":\"JWT\"}";
+
+    std::string given = kGivenNames[rng() % 8];
+    std::string family = kFamilyNames[rng() % 8];
+    bool hosted = rng() % 4 == 0;
+    std::string email = Lower(RandomToken(&rng, 4 + rng() % 12)) + "@" +
+                        (hosted ? kDomains[rng() % 4] : "gmail.com");
+    std::string sub = "1" + RandomDigits(&rng, 20);
+    int64_t iat = 1700000000 + static_cast<int64_t>(rng() % 50000000);
+    std::string times = "\"iat\":" + std::to_string(iat) +
+                        ",\"exp\":" + std::to_string(iat + 3600);
+
+    std::string payload;
+    if (rng() % 5 == 0) {
+      // Firebase Auth, once the Google credential has been exchanged.
+      std::string project = "project-" + Lower(RandomToken(&rng, 6));
+      payload = "{\"name\":\"" + given + " " + family +
+                "\",\"picture\":\"https://lh3.googleusercontent.com/a/" +
+                RandomToken(&rng, 60) +
+                "=s96-c\",\"iss\":\"https://securetoken.google.com/" +
+                project + "\",\"aud\":\"" + project +
+                "\",\"auth_time\":" + std::to_string(iat) +
+                ",\"user_id\":\"" + RandomToken(&rng, 28) +
+                "\",\"sub\":\"" + RandomToken(&rng, 28) + "\"," + times +
+                ",\"email\":\"" + email +
+                "\",\"email_verified\":true,\"firebase\":{\"identities\":{"
+                "\"google.com\":[\"" + sub + "\"],\"email\":[\"" + email +
+                "\"]},\"sign_in_provider\":\"google.com\"}}";
+    } else {
+      std::string client = RandomDigits(&rng, 12) + "-" +
+                           Lower(RandomToken(&rng, 32)) +
+                           ".apps.googleusercontent.com";
+      std::string audience = rng() % 10 == 0
+                                 ? "[\"" + client + "\",\"" +
+                                       RandomDigits(&rng, 12) +
+                                       ".apps.googleusercontent.com\"]"
+                                 : "\"" + client + "\"";
+      payload = "{\"iss\":\"https://accounts.google.com\",\"azp\":\"" +
+                client + "\",\"aud\":" + audience + ",\"sub\":\"" + sub +
+                "\"";
+      if (hosted) {
+        payload += ",\"hd\":\"" + email.substr(email.find('@') + 1) + "\"";
+      }
+      payload += ",\"email\":\"" + email +
+                 "\",\"email_verified\":true,\"at_hash\":\"" +
+                 RandomToken(&rng, 22) + "\"";
+      if (rng() % 3 == 0) {
+        payload += ",\"nonce\":\"" + RandomToken(&rng, 43) + "\"";
+      }
+      if (rng() % 4 != 0) {
+        // Requested with the profile scope.
+        payload += ",\"name\":\"" + given + " " + family +
+                   "\",\"picture\":\"https://lh3.googleusercontent.com/a/" +
+                   RandomToken(&rng, 60) + "=s96-c\",\"given_name\":\"" +
+                   given + "\",\"family_name\":\"" + family +
+                   "\",\"locale\":\"" + (rng() % 2 ? "en" : "en-GB") + "\"";
+      }
+      payload += "," + times + "}";
+    }
+
+    std::string signature(256, '\0');
+    for (size_t b = 0; b < signature.size(); b++) {
+      signature[b] = static_cast<char>(rng());
+    }
+    corpus.push_back(MakeJwt(header, payload, signature));
+  }
+  return corpus;
+}
+
+const char kTestAudience[] =
+    "1234567890-abcdefghijklmnopqrstuvwxyz012345.apps.googleusercontent.com";
+
+const char kTestJwks[] =
+    "{\"keys\":[{\"kty\":\"RSA\",\"use\":\"sig\",\"alg\":\"RS256\",\"kid\":\""
+    "test-rsa-2048\",\"n\":\"v7TBkzEp-zSMenDWeTLjdV3pH3GtKbGA6HLpifJxSgH6Dz4X"
+    "1sIX00lk8RupmQIFijx8bTpXEhiCa7P0YloLLM-0PfOjbhBjc2BGKFGtHlSjHNPPjnrCN-R7"
+    "sU0Ouup7fuk47lbKSKlLkRbnN3YcbNqnFJwKSJECAeHYCTGODgbDvWiaOvrnRaWpL5j_Qq9m"
+    "uNLv9u8At4rnfLRzLORpM6-9FHTDEWpLXiFfxgDtQn_Y6iQDzVPOwDs4n_wb1TqWD1j_P5Vw"
+    "VDmOFj8pPgfeYrkRnEa-r1vet4m_oFUFIpZUlgl0sV6NcGcuYX0Sq1z1KsPvEpXRZcQzCB3f"
+    "38-E4Q\",\"e\":\"AQAB\"},{\"kty\":\"EC\",\"use\":\"sig\",\"alg\":\"ES256"
+    "\",\"crv\":\"P-256\",\"kid\":\"test-ec-p256\",\"x\":\"u6bUnECQ0cPE-kLFia"
+    "vvbNcOvY5pU7sxTQEbh4LUGRM\",\"y\":\"OPwJLslpxmkHtgqaOYfxoaxXaD4eeXL1-LDV"
+    "jd2EGUg\"}]}";
+
+const char kRs256IdToken[] =
+    "eyJhbGciOiJSUzI1NiIsImtpZCI6InRlc3QtcnNhLTIwNDgiLCJ0eXAiOiJKV1QifQ.eyJpc"
+    "3MiOiJodHRwczovL2FjY291bnRzLmdvb2dsZS5jb20iLCJhenAiOiIxMjM0NTY3ODkwLWFiY"
+    "2RlZmdoaWprbG1ub3BxcnN0dXZ3eHl6MDEyMzQ1LmFwcHMuZ29vZ2xldXNlcmNvbnRlbnQuY"
+    "29tIiwiYXVkIjoiMTIzNDU2Nzg5MC1hYmNkZWZnaGlqa2xtbm9wcXJzdHV2d3h5ejAxMjM0N"
+    "S5hcHBzLmdvb2dsZXVzZXJjb250ZW50LmNvbSIsInN1YiI6IjExMDE2OTQ4NDQ3NDM4NjI3N"
+    "jMzNCIsImVtYWlsIjoiamFuZS5kb2VAZXhhbXBsZS5jb20iLCJlbWFpbF92ZXJpZmllZCI6d"
+    "HJ1ZSwiaWF0Ijo0MTAyNDQxMjAwLCJleHAiOjQxMDI0NDQ4MDB9.Fmg7F4FcoiYzYXsQKsjS"
+    "Eu_7QoH4cAI0_uZKt9cfYfWZjMuKWj1rQ71nsoBV4yrn5cJULflE8f6NQr22of68rSBi4rp6"
+    "_ZIOXMrhUUpyHbRNa2y7MWOZyT3QKqwlzUbT27fbcYJvSxcLJOsbL0cEmhcYbD7pVQDz_vZA"
+    "RHuUFfGn4u58L3WVIQdesIyZW-ct7FfVujQ_1A4tSGfteBaFEpzbCUO3euZ5BPMBoynV2xxi"
+    "r0QfteflG1dKRgFj1SiYl-b9WlPAdpfmUhbKvXCrWSvMKIWc1cAbZjci4VZMaJDIBMO7hml7"
+    "ZLo4keBnWGL-UxJmYXFOP0OysQLhD7VELA";
+
+const char kEs256IdToken[] =
+    "eyJhbGciOiJFUzI1NiIsImtpZCI6InRlc3QtZWMtcDI1NiIsInR5cCI6IkpXVCJ9.eyJpc3M"
+    "iOiJhY2NvdW50cy5nb29nbGUuY29tIiwiYXpwIjoiMTIzNDU2Nzg5MC1hYmNkZWZnaGlqa2x"
+    "tbm9wcXJzdHV2d3h5ejAxMjM0NS5hcHBzLmdvb2dsZXVzZXJjb250ZW50LmNvbSIsImF1ZCI"
+    "6IjEyMzQ1Njc4OTAtYWJjZGVmZ2hpamtsbW5vcHFyc3R1dnd4eXowMTIzNDUuYXBwcy5nb29"
+    "nbGV1c2VyY29udGVudC5jb20iLCJzdWIiOiIxMTAxNjk0ODQ0NzQzODYyNzYzMzQiLCJlbWF"
+    "pbCI6ImphbmUuZG9lQGV4YW1wbGUuY29tIiwiZW1haWxfdmVyaWZpZWQiOnRydWUsImlhdCI"
+    "6NDEwMjQ0MTIwMCwiZXhwIjo0MTAyNDQ0ODAwfQ.LM_DEcMEaWibuHcy-ewTpYxeewgdi3my"
+    "_dXC8ndUZmjkGwg88Uk3A7_Z0_CT1DdI-kxFXZRrZWDzUZ0mbSZGNA";
+
+const char kWrongIssuerIdToken[] =
+    "eyJhbGciOiJSUzI1NiIsImtpZCI6InRlc3QtcnNhLTIwNDgiLCJ0eXAiOiJKV1QifQ.eyJpc"
+    "3MiOiJodHRwczovL2V2aWwuZXhhbXBsZS5jb20iLCJhenAiOiIxMjM0NTY3ODkwLWFiY2RlZ"
+    "mdoaWprbG1ub3BxcnN0dXZ3eHl6MDEyMzQ1LmFwcHMuZ29vZ2xldXNlcmNvbnRlbnQuY29tI"
+    "iwiYXVkIjoiMTIzNDU2Nzg5MC1hYmNkZWZnaGlqa2xtbm9wcXJzdHV2d3h5ejAxMjM0NS5hc"
+    "HBzLmdvb2dsZXVzZXJjb250ZW50LmNvbSIsInN1YiI6IjExMDE2OTQ4NDQ3NDM4NjI3NjMzN"
+    "CIsImVtYWlsIjoiamFuZS5kb2VAZXhhbXBsZS5jb20iLCJlbWFpbF92ZXJpZmllZCI6dHJ1Z"
+    "SwiaWF0Ijo0MTAyNDQxMjAwLCJleHAiOjQxMDI0NDQ4MDB9.QDa38Xmza0ufjU3iKAnI2qxm"
+    "h82Iw5BTA4RbDm8lCHdjop1ivl-Iv7aadDIrGQDJXLIgaXRNMRvOmJkTnx9gpQOptXZKSFxs"
+    "Wiw_hQ9jBlECHay3Cp8-PKPZt9frBJZ_CZDs7TYJCamqN-DtIQt_g1s1kVGKMyBjEte9r4H4"
+    "eIBii-mJ4ueHnQrXrhJIStCdZ9FtrQeAD6_tiGXhyAjiRqq3B_9nvpTZfBY0YZD9qs-UYMIy"
+    "nKfEC0Hseu_78zJeYi6QT250uazbZaIrIy7u4ksFBr4ZeUNjSkI0aIMvMjoe7cuzFVaJ4lfJ"
+    "bW3a87pf8yAG44B8Jado7kflJH1nDQ";
+
+const char kWrongAudienceIdToken[] =
+    "eyJhbGciOiJSUzI1NiIsImtpZCI6InRlc3QtcnNhLTIwNDgiLCJ0eXAiOiJKV1QifQ.eyJpc"
+    "3MiOiJodHRwczovL2FjY291bnRzLmdvb2dsZS5jb20iLCJhenAiOiJvdGhlci5hcHBzLmdvb"
+    "2dsZXVzZXJjb250ZW50LmNvbSIsImF1ZCI6Im90aGVyLmFwcHMuZ29vZ2xldXNlcmNvbnRlb"
+    "nQuY29tIiwic3ViIjoiMTEwMTY5NDg0NDc0Mzg2Mjc2MzM0IiwiZW1haWwiOiJqYW5lLmRvZ"
+    "UBleGFtcGxlLmNvbSIsImVtYWlsX3ZlcmlmaWVkIjp0cnVlLCJpYXQiOjQxMDI0NDEyMDAsI"
+    "mV4cCI6NDEwMjQ0NDgwMH0.grjPG0UENlXtDSupbrgNZrKoGpcNPZVJin02L4ArsOluEQbNC"
+    "t-GIh_8A1bhUciCuLQ_3NvCo2Szzlq_UADwA_UT5xYOgxBlxAYMr5evBvQaNjtwsNYB2Y0UQ"
+    "1NCb9d9yJDq503G2O5YW_ZHJCxCyAihvuVi5E3yJg5mm565rlPmegKryPDeS8RVWVUi8IZwV"
+    "EEYjoAeu1kxcUlHxLUrPTuldwFcDOnd_nWn9G-p_T11IEyAI_lEiRxsIa6oDeO6tkte33MCH"
+    "MVw3uRVcrIn5XNeFyRQwf-ShrrpvP3-QKhCNxo58iO7zFbGhq9b0CIJv6mc0-kLAIVrqRPsQ"
+    "-12XQ";
+
+const char kExpiredIdToken[] =
+    "eyJhbGciOiJSUzI1NiIsImtpZCI6InRlc3QtcnNhLTIwNDgiLCJ0eXAiOiJKV1QifQ.eyJpc"
+    "3MiOiJodHRwczovL2FjY291bnRzLmdvb2dsZS5jb20iLCJhenAiOiIxMjM0NTY3ODkwLWFiY"
+    "2RlZmdoaWprbG1ub3BxcnN0dXZ3eHl6MDEyMzQ1LmFwcHMuZ29vZ2xldXNlcmNvbnRlbnQuY"
+    "29tIiwiYXVkIjoiMTIzNDU2Nzg5MC1hYmNkZWZnaGlqa2xtbm9wcXJzdHV2d3h5ejAxMjM0N"
+    "S5hcHBzLmdvb2dsZXVzZXJjb250ZW50LmNvbSIsInN1YiI6IjExMDE2OTQ4NDQ3NDM4NjI3N"
+    "jMzNCIsImVtYWlsIjoiamFuZS5kb2VAZXhhbXBsZS5jb20iLCJlbWFpbF92ZXJpZmllZCI6d"
+    "HJ1ZSwiaWF0IjoxNDk5OTk2NDAwLCJleHAiOjE1MDAwMDAwMDB9.hB4vqrcgdv0kkEgdOQQA"
+    "YsoRN3yK6GaFs10ukW8r6_zz7uGK1Y8T6cXe6LG1yBfhurT6glgrgrcI5GmxR8mUJCY5L6hH"
+    "Irj7GYFAe0Ioqj8N89z-XJ0MuL6DL5JH0i-o16Nw2daT_iW0ZaVoLWOejIDz9SCL_NyJZBsT"
+    "t_2dC7cFj_ku_JX2YmXnL6w7-y4cDjyxPHLE1gM5ueK6HqJtxyPHTzSlgK0EAsrB3CNFh93P"
+    "Yg16etR-ttLaOBIIWNwEseHpKGCouYEG2LjROTnV_PLccrh1GOucrQCv9QOd2508m8RFJk-q"
+    "dRJgjvtoA6siN-5pBFQ4kQhTajdUBPsW6Q";
+
+}  // namespace test
+}  // namespace googlesignin
@@ -0,0 +1,65 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+#ifndef GOOGLESIGNIN_TEST_TOKEN_FIXTURES_H
+#define GOOGLESIGNIN_TEST_TOKEN_FIXTURES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace googlesignin {
+namespace test {
+
+// Encodes data as unpadded base64url.
+std::string Base64UrlEncode(const void *data, size_t size);
+
+// Joins the encoded header, payload and signature into a JWT.
+std::string MakeJwt(const std::string &header_json,
+                    const std::string &payload_json,
+                    const std::string &signature);
+
+// An unsigned ID token shaped like the ones Google issues, with a 256 byte
+// signature, for audience and expiring at exp.
+std::string MakeIdToken(const std::string &audience, int64_t exp);
+
+// count ID tokens with the variety a server sees, generated from seed:
+// Google tokens with and without the profile claims, a hosted domain, a
+// nonce or an array audience, names with escaped and raw non-ASCII
+// characters, and Firebase tokens with their nested "firebase" claim.  All
+// have an RS256 shaped signature.
+std::vector<std::string> MakeIdTokenCorpus(size_t count, uint32_t seed);
+
+// Signed with keys generated for the tests by the openssl command line tool:
+//
+//   openssl genpkey -algorithm RSA -pkeyopt rsa_keygen_bits:2048
+//   openssl genpkey -algorithm EC -pkeyopt ec_paramgen_curve:P-256
+//
+// kTestJwks holds their public halves, with the kids "test-rsa-2048" and
+// "test-ec-p256".  The tokens are issued for kTestAudience and, unless
+// named otherwise, are valid until 2100.
+extern const char kTestAudience[];
+extern const char kTestJwks[];
+extern const char kRs256IdToken[];
+extern const char kEs256IdToken[];
+extern const char kWrongIssuerIdToken[];
+extern const char kWrongAudienceIdToken[];
+// Expired in 2017.
+extern const char kExpiredIdToken[];
+
+}  // namespace test
+}  // namespace googlesignin
+
+#endif  // GOOGLESIGNIN_TEST_TOKEN_FIXTURES_H
@@ -0,0 +1,352 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// The token refresh on a fake clock: the schedule of RefreshScheduler, and
+// the plugin feeding it results and starting the refreshes.
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "clock.h"
+#include "fake_sign_in_helper.h"
+#include "google_signin.h"
+#include "google_signin_user.h"
+#include "google_signin_user_impl.h"
+#include "id_token.h"
+#include "refresh_scheduler.h"
+#include "stats.h"
+#include "token_fixtures.h"
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+const char kWebClientId[] =
+    "1234567890-abcdefghijklmnopqrstuvwxyz012345.apps.googleusercontent.com";
+
+// Milliseconds since the epoch the fake clocks start at.
+const int64_t kStartMs = 1700000000000;
+const int64_t kMinuteMs = 60 * 1000;
+const int64_t kHourMs = 60 * kMinuteMs;
+
+// The number of request slots, MAX_OUTSTANDING_REQUESTS in google_signin.cc.
+const int kRequestSlots = 16;
+
+class FakeClock : public Clock {
+ public:
+  FakeClock() : now_ms_(kStartMs) {}
+  int64_t NowMillis() const override {
+    return now_ms_.load(std::memory_order_relaxed);
+  }
+  void Advance(int64_t ms) {
+    now_ms_.fetch_add(ms, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> now_ms_;
+};
+
+// An account whose ID token expires at expiry_ms.
+FakeAccount AccountExpiringAt(int64_t expiry_ms) {
+  FakeAccount account = FakeAccount::Default();
+  account.id_token = MakeIdToken(kWebClientId, expiry_ms / 1000);
+  return account;
+}
+
+GoogleSignInUser *NewUser(int64_t expiry_ms) {
+  std::vector<unsigned char> packed;
+  FakeSignInHelper::Pack(AccountExpiringAt(expiry_ms), &packed);
+  return GoogleSignInUserImpl::UserFromPackedAccount(packed.data(),
+                                                     packed.size());
+}
+
+class RefreshSchedulerTest : public ::testing::Test {
+ protected:
+  RefreshSchedulerTest() {
+    options_.lead_ms = 5 * kMinuteMs;
+    options_.jitter_ms = 0;
+    options_.retry_ms = kMinuteMs;
+  }
+
+  // Advances the clock a second at a time until Poll() returns true, up to
+  // limit_ms.  Returns the time the refresh was due, 0 if it never was.
+  int64_t PollUntilDue(RefreshScheduler *scheduler, int64_t limit_ms) {
+    for (int64_t waited = 0; waited <= limit_ms; waited += 1000) {
+      if (scheduler->Poll()) return clock_.NowMillis();
+      clock_.Advance(1000);
+    }
+    return 0;
+  }
+
+  // Signs user in on a new scheduler.
+  std::unique_ptr<RefreshScheduler> SignedIn(int64_t expiry_ms) {
+    std::unique_ptr<RefreshScheduler> scheduler(
+        new RefreshScheduler(&clock_, options_));
+    GoogleSignInUser *user = NewUser(expiry_ms);
+    scheduler->OnSignedIn(*user);
+    user->Release();
+    return scheduler;
+  }
+
+  FakeClock clock_;
+  RefreshScheduler::Options options_;
+};
+
+TEST_F(RefreshSchedulerTest, RefreshIsDueTheLeadTimeBeforeExpiry) {
+  int64_t expiry_ms = kStartMs + kHourMs;
+  std::unique_ptr<RefreshScheduler> scheduler = SignedIn(expiry_ms);
+  EXPECT_EQ(expiry_ms, scheduler->expiry_ms());
+  ASSERT_NE(nullptr, scheduler->user());
+
+  int64_t due_ms = PollUntilDue(scheduler.get(), 2 * kHourMs);
+  EXPECT_GE(due_ms, expiry_ms - options_.lead_ms);
+  // Within a tick of the timer wheel.
+  EXPECT_LE(due_ms, expiry_ms - options_.lead_ms + 1000);
+}
+
+TEST_F(RefreshSchedulerTest, PollStartsOneRefreshUntilItsResultIsRecorded) {
+  std::unique_ptr<RefreshScheduler> scheduler =
+      SignedIn(kStartMs + kHourMs);
+  ASSERT_NE(0, PollUntilDue(scheduler.get(), 2 * kHourMs));
+  clock_.Advance(10 * kMinuteMs);
+  EXPECT_FALSE(scheduler->Poll());
+
+  // The refresh returns a token valid for another hour.
+  int64_t expiry_ms = clock_.NowMillis() + kHourMs;
+  GoogleSignInUser *refreshed = NewUser(expiry_ms);
+  scheduler->OnSignedIn(*refreshed);
+  refreshed->Release();
+  EXPECT_FALSE(scheduler->Poll());
+  EXPECT_GE(PollUntilDue(scheduler.get(), 2 * kHourMs),
+            expiry_ms - options_.lead_ms);
+}
+
+TEST_F(RefreshSchedulerTest, FailedRefreshIsRetriedAfterTheRetryDelay) {
+  std::unique_ptr<RefreshScheduler> scheduler =
+      SignedIn(kStartMs + kHourMs);
+  ASSERT_NE(0, PollUntilDue(scheduler.get(), 2 * kHourMs));
+  int64_t failed_ms = clock_.NowMillis();
+  scheduler->OnSignInFailed();
+
+  int64_t retry_ms = PollUntilDue(scheduler.get(), kHourMs);
+  EXPECT_GE(retry_ms, failed_ms + options_.retry_ms);
+  EXPECT_LE(retry_ms, failed_ms + options_.retry_ms + 1000);
+  // The user of the last successful sign-in is kept.
+  EXPECT_NE(nullptr, scheduler->user());
+}
+
+TEST_F(RefreshSchedulerTest, JitterIsRepeatableAndOnlyMovesTheRefreshEarlier) {
+  options_.jitter_ms = 2 * kMinuteMs;
+  int64_t expiry_ms = kStartMs + kHourMs;
+  std::vector<int64_t> due;
+  for (int run = 0; run < 2; run++) {
+    int64_t start_ms = clock_.NowMillis();
+    std::unique_ptr<RefreshScheduler> scheduler =
+        SignedIn(start_ms + kHourMs);
+    due.push_back(PollUntilDue(scheduler.get(), 2 * kHourMs) - start_ms);
+  }
+  EXPECT_EQ(due[0], due[1]);
+  EXPECT_GE(due[0], expiry_ms - kStartMs - options_.lead_ms -
+                        options_.jitter_ms);
+  EXPECT_LE(due[0], expiry_ms - kStartMs - options_.lead_ms + 1000);
+}
+
+TEST_F(RefreshSchedulerTest, ResumeRefreshesATokenCloseToExpiry) {
+  std::unique_ptr<RefreshScheduler> scheduler =
+      SignedIn(kStartMs + kHourMs);
+  RefreshScheduler::NotifyActivityResumed();
+  EXPECT_FALSE(scheduler->Poll());
+
+  // As if the timer did not fire while in the background: jump past the
+  // due time without polling, then resume.
+  clock_.Advance(kHourMs - 2 * kMinuteMs);
+  std::unique_ptr<RefreshScheduler> backgrounded =
+      SignedIn(kStartMs + kHourMs);
+  RefreshScheduler::NotifyActivityResumed();
+  EXPECT_TRUE(backgrounded->Poll());
+}
+
+TEST_F(RefreshSchedulerTest, SignOutCancelsTheRefresh) {
+  std::unique_ptr<RefreshScheduler> scheduler =
+      SignedIn(kStartMs + kHourMs);
+  scheduler->OnSignedOut();
+  EXPECT_EQ(nullptr, scheduler->user());
+  EXPECT_EQ(0, PollUntilDue(scheduler.get(), 2 * kHourMs));
+  // Nothing to retry either.
+  scheduler->OnSignInFailed();
+  EXPECT_EQ(0, PollUntilDue(scheduler.get(), kHourMs));
+}
+
+// The plugin on the fake helper.  Results are delivered on the helper's
+// thread until the first PollEvents() in the process, and only by
+// PollEvents() after that, so Complete() polls.
+class TokenRefreshTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    helper_.Reset();
+    SetExpiry(kStartMs + kHourMs);
+    plugin_ = new GoogleSignIn(helper_.activity());
+    GoogleSignIn::Configuration configuration;
+    configuration.use_game_signin = false;
+    configuration.web_client_id = kWebClientId;
+    configuration.request_auth_code = false;
+    configuration.force_token_refresh = false;
+    configuration.request_email = true;
+    configuration.request_id_token = true;
+    configuration.hide_ui_popups = false;
+    plugin_->Configure(configuration);
+    plugin_->EnableTokenRefresh(true, &clock_);
+  }
+  void TearDown() override {
+    plugin_->EnableTokenRefresh(false);
+    helper_.WaitIdle();
+    delete plugin_;
+  }
+
+  // Sign-ins return a token expiring at expiry_ms from now on.
+  void SetExpiry(int64_t expiry_ms) {
+    helper_.RespondWith(AccountExpiringAt(expiry_ms), 0);
+  }
+
+  // Polls until future completes.
+  void Complete(const Future<GoogleSignIn::SignInResult> &future) {
+    for (int i = 0; i < 10000 && future.Pending(); i++) {
+      plugin_->PollEvents();
+      future.WaitFor(1);
+    }
+    ASSERT_FALSE(future.Pending());
+  }
+
+  // Polls a second at a time, for up to limit_ms, until a refresh starts.
+  // Returns whether one did.
+  bool PollUntilRefresh(int64_t limit_ms) {
+    uint64_t started = helper_.counters().sign_in_silently;
+    for (int64_t waited = 0; waited <= limit_ms; waited += 1000) {
+      plugin_->PollEvents();
+      if (helper_.counters().sign_in_silently != started) return true;
+      clock_.Advance(1000);
+    }
+    return false;
+  }
+
+  static int64_t ExpiryOf(std::shared_ptr<const GoogleSignInUser> user) {
+    const IdTokenClaims *claims = user ? user->GetIdTokenClaims() : nullptr;
+    return claims ? claims->exp * 1000 : 0;
+  }
+
+  FakeSignInHelper &helper_ = FakeSignInHelper::Get();
+  FakeClock clock_;
+  GoogleSignIn *plugin_;
+};
+
+// Runs first, before any test polls.
+TEST_F(TokenRefreshTest, ResultsUpdateTheScheduleWithoutPolling) {
+  const Future<GoogleSignIn::SignInResult> &future = plugin_->SignIn();
+  ASSERT_TRUE(future.WaitFor(10000));
+  ASSERT_EQ(GoogleSignIn::kStatusCodeSuccess, future.Status());
+  EXPECT_EQ(kStartMs + kHourMs, ExpiryOf(plugin_->GetRefreshedUser()));
+}
+
+TEST_F(TokenRefreshTest, PollEventsStartsTheRefreshWhenDue) {
+  Complete(plugin_->SignIn());
+  ASSERT_NE(nullptr, plugin_->GetRefreshedUser());
+
+  // The default lead time is 5 minutes, plus up to 2 minutes of jitter.
+  EXPECT_FALSE(PollUntilRefresh(kHourMs - 8 * kMinuteMs));
+  int64_t refreshed_expiry = clock_.NowMillis() + 2 * kHourMs;
+  SetExpiry(refreshed_expiry);
+  ASSERT_TRUE(PollUntilRefresh(3 * kMinuteMs));
+  Complete(*plugin_->GetLastSignInResult());
+  EXPECT_EQ(refreshed_expiry, ExpiryOf(plugin_->GetRefreshedUser()));
+  // The next refresh is over an hour and a half away.
+  EXPECT_FALSE(PollUntilRefresh(90 * kMinuteMs));
+}
+
+// With the session cache enabled, the refresh still only signs in through
+// Java, instead of also completing a cached sign-in with the very token it
+// refreshes.
+TEST_F(TokenRefreshTest, RefreshSkipsTheSessionCache) {
+  plugin_->EnableSessionCache(true);
+  Complete(plugin_->SignIn());
+  const int cached =
+      SignInStats::StatusBucket(GoogleSignIn::kStatusCodeSuccessCached);
+  SignInStats before = plugin_->GetStats();
+
+  SetExpiry(clock_.NowMillis() + 2 * kHourMs);
+  ASSERT_TRUE(PollUntilRefresh(kHourMs));
+  Complete(*plugin_->GetLastSignInResult());
+  SignInStats after = plugin_->GetStats();
+  EXPECT_EQ(1u, after.started[SignInStats::kFlowSilent] -
+                    before.started[SignInStats::kFlowSilent]);
+  EXPECT_EQ(before.completed[SignInStats::kFlowSilent][cached],
+            after.completed[SignInStats::kFlowSilent][cached]);
+  plugin_->EnableSessionCache(false);
+}
+
+// A refresh evicted by too many outstanding sign-ins counts as a failed
+// one, so it is retried instead of blocking every later refresh.
+TEST_F(TokenRefreshTest, EvictedRefreshIsRetried) {
+  Complete(plugin_->SignIn());
+  helper_.SetResponder([](const FakeRequest &request, bool silent) {
+    FakeResponse response = {kFakeSuccess, nullptr, -1};
+    return response;
+  });
+  ASSERT_TRUE(PollUntilRefresh(kHourMs));
+  for (int i = 0; i < kRequestSlots; i++) {
+    plugin_->SignIn();
+  }
+
+  SetExpiry(clock_.NowMillis() + 2 * kHourMs);
+  ASSERT_TRUE(PollUntilRefresh(10 * kMinuteMs));
+  Complete(*plugin_->GetLastSignInResult());
+  EXPECT_EQ(GoogleSignIn::kStatusCodeSuccess,
+            plugin_->GetLastSignInResult()->Status());
+  // Cancel the withheld sign-ins while the clock their scheduler reads is
+  // still alive.
+  plugin_->SignOut();
+}
+
+TEST_F(TokenRefreshTest, SignOutCancelsTheRefresh) {
+  Complete(plugin_->SignIn());
+  plugin_->SignOut();
+  EXPECT_EQ(nullptr, plugin_->GetRefreshedUser());
+  EXPECT_FALSE(PollUntilRefresh(2 * kHourMs));
+}
+
+TEST_F(TokenRefreshTest, RefreshedUserCanBeReadWhileRefreshIsToggled) {
+  Complete(plugin_->SignIn());
+  std::atomic<bool> done(false);
+  std::thread reader([this, &done] {
+    while (!done.load()) {
+      std::shared_ptr<const GoogleSignInUser> user =
+          plugin_->GetRefreshedUser();
+      if (user) EXPECT_NE(nullptr, user->GetIdToken());
+      std::this_thread::yield();
+    }
+  });
+  for (int i = 0; i < 200; i++) {
+    plugin_->EnableTokenRefresh(i % 2 == 1, &clock_);
+    std::this_thread::yield();
+  }
+  done = true;
+  reader.join();
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
@@ -0,0 +1,307 @@
+// Copyright (C) 2017 Google Inc. All Rights Reserved.
+//
+//  Licensed under the Apache License, Version 2.0 (the "License");
+//  you may not use this file except in compliance with the License.
+//  You may obtain a copy of the License at
+//
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//    limitations under the License.
+
+// Counts the allocations made by the user code.  The global operator new is
+// replaced in this binary, which the library picks up too, and only counts
+// on the thread that asked for it.  Also checks that signing in over and
+// over through the bridge keeps the heap and the resident set flat.
+
+#include <gtest/gtest.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <new>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "fake_jvm.h"
+#include "fake_sign_in_helper.h"
+#include "google_signin_bridge.h"
+#include "google_signin_user.h"
+#include "google_signin_user_impl.h"
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+#define GOOGLESIGNIN_TEST_SANITIZED 1
+#endif
+
+namespace {
+
+// Allocations made on this thread while counting.
+struct AllocationCounter {
+  bool counting;
+  size_t count;
+  size_t bytes;
+  size_t largest;
+};
+thread_local AllocationCounter t_allocations;
+
+}  // namespace
+
+#if !defined(GOOGLESIGNIN_TEST_SANITIZED)
+void *operator new(size_t size) {
+  if (t_allocations.counting) {
+    t_allocations.count++;
+    t_allocations.bytes += size;
+    if (size > t_allocations.largest) t_allocations.largest = size;
+  }
+  void *p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+#endif
+
+namespace googlesignin {
+namespace test {
+namespace {
+
+class UserMemoryTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+#if defined(GOOGLESIGNIN_TEST_SANITIZED)
+    GTEST_SKIP() << "operator new is not replaced under a sanitizer";
+#endif
+    FakeAccount account = FakeAccount::Default();
+    const std::string *fields[] = {
+        &account.display_name, &account.email,    &account.family_name,
+        &account.given_name,   &account.id,       &account.id_token,
+        &account.photo_url,    &account.server_auth_code};
+    field_bytes_ = 0;
+    for (const std::string *field : fields) {
+      uint32_t len = static_cast<uint32_t>(field->size());
+      unsigned char header[4] = {
+          static_cast<unsigned char>(len >> 24),
+          static_cast<unsigned char>(len >> 16),
+          static_cast<unsigned char>(len >> 8),
+          static_cast<unsigned char>(len)};
+      packed_.insert(packed_.end(), header, header + 4);
+      packed_.insert(packed_.end(), field->begin(), field->end());
+      field_bytes_ += field->size() + 1;
+    }
+  }
+
+  static void StartCounting() {
+    t_allocations = AllocationCounter();
+    t_allocations.counting = true;
+  }
+  static AllocationCounter StopCounting() {
+    t_allocations.counting = false;
+    return t_allocations;
+  }
+
+  // Empties the pool of released users, returning what was taken.
+  static std::vector<GoogleSignInUser *> DrainPool() {
+    std::vector<GoogleSignInUser *> users;
+    for (int i = 0; i < GoogleSignInUserImpl::kMaxPooledUsers; i++) {
+      users.push_back(GoogleSignInUserImpl::NewUser());
+    }
+    return users;
+  }
+  static void ReleaseAll(const std::vector<GoogleSignInUser *> &users) {
+    for (GoogleSignInUser *user : users) user->Release();
+  }
+
+  std::vector<unsigned char> packed_;
+  // The size of every field with its terminator.
+  size_t field_bytes_;
+};
+
+TEST_F(UserMemoryTest, NewUserIsOneExactAllocation) {
+  std::vector<GoogleSignInUser *> pooled = DrainPool();
+  StartCounting();
+  GoogleSignInUser *user = GoogleSignInUserImpl::UserFromPackedAccount(
+      packed_.data(), packed_.size());
+  AllocationCounter allocations = StopCounting();
+  ASSERT_NE(nullptr, user);
+  // The user, its impl and the field buffer in one block, the buffer sized
+  // to fit the fields exactly.
+  EXPECT_EQ(1u, allocations.count);
+  EXPECT_EQ(GoogleSignInUserImpl::AllocationSize(field_bytes_),
+            allocations.bytes);
+  EXPECT_STREQ(FakeAccount::Default().email.c_str(), user->GetEmail());
+  user->Release();
+  ReleaseAll(pooled);
+}
+
+// The layout the user had before its fields shared a buffer: the user, an
+// impl of eight std::string members, and a heap block for each field too
+// long for the string's inline buffer.
+struct EightStringImpl {
+  std::string fields[GoogleSignInUserImpl::kFieldCount];
+};
+struct EightStringUser {
+  EightStringImpl *impl;
+};
+
+TEST_F(UserMemoryTest, OneAllocationReplacesTheEightStringLayout) {
+  FakeAccount account = FakeAccount::Default();
+  const std::string values[] = {
+      account.display_name, account.email,    account.family_name,
+      account.given_name,   account.id,       account.id_token,
+      account.photo_url,    account.server_auth_code};
+
+  StartCounting();
+  EightStringUser *old_user = new EightStringUser();
+  old_user->impl = new EightStringImpl();
+  for (int i = 0; i < GoogleSignInUserImpl::kFieldCount; i++) {
+    old_user->impl->fields[i].assign(values[i].data(), values[i].size());
+  }
+  AllocationCounter before = StopCounting();
+  delete old_user->impl;
+  delete old_user;
+
+  std::vector<GoogleSignInUser *> pooled = DrainPool();
+  StartCounting();
+  GoogleSignInUser *user = GoogleSignInUserImpl::UserFromPackedAccount(
+      packed_.data(), packed_.size());
+  AllocationCounter after = StopCounting();
+  ASSERT_NE(nullptr, user);
+  user->Release();
+  ReleaseAll(pooled);
+
+  // The default account has five fields too long to be inline.
+  EXPECT_EQ(7u, before.count);
+  EXPECT_EQ(1u, after.count);
+  EXPECT_LT(after.bytes, before.bytes);
+  RecordProperty("eight_string_allocations", static_cast<int>(before.count));
+  RecordProperty("eight_string_bytes", static_cast<int>(before.bytes));
+  RecordProperty("allocations", static_cast<int>(after.count));
+  RecordProperty("bytes", static_cast<int>(after.bytes));
+}
+
+TEST_F(UserMemoryTest, RecycledUserAllocatesNothing) {
+  GoogleSignInUser *user = GoogleSignInUserImpl::UserFromPackedAccount(
+      packed_.data(), packed_.size());
+  ASSERT_NE(nullptr, user);
+  user->Release();
+
+  StartCounting();
+  user = GoogleSignInUserImpl::UserFromPackedAccount(packed_.data(),
+                                                     packed_.size());
+  AllocationCounter allocations = StopCounting();
+  ASSERT_NE(nullptr, user);
+  EXPECT_EQ(0u, allocations.count);
+  EXPECT_STREQ(FakeAccount::Default().id_token.c_str(), user->GetIdToken());
+  user->Release();
+}
+
+TEST_F(UserMemoryTest, ReadingFieldsAllocatesNothing) {
+  GoogleSignInUser *user = GoogleSignInUserImpl::UserFromPackedAccount(
+      packed_.data(), packed_.size());
+  ASSERT_NE(nullptr, user);
+  StartCounting();
+  size_t total = strlen(user->GetDisplayName()) + strlen(user->GetEmail()) +
+                 strlen(user->GetFamilyName()) + strlen(user->GetGivenName()) +
+                 strlen(user->GetIdToken()) + strlen(user->GetImageUrl()) +
+                 strlen(user->GetServerAuthCode()) + strlen(user->GetUserId());
+  AllocationCounter allocations = StopCounting();
+  EXPECT_EQ(field_bytes_ - GoogleSignInUserImpl::kFieldCount, total);
+  EXPECT_EQ(0u, allocations.count);
+  user->Release();
+}
+
+// The eight std::string members the fields used to be kept in cost more
+// than the offsets and lengths before a single byte of data.
+TEST_F(UserMemoryTest, ImplIsSmallerThanEightStrings) {
+  EXPECT_LT(sizeof(GoogleSignInUserImpl),
+            GoogleSignInUserImpl::kFieldCount * sizeof(std::string));
+}
+
+// The bytes malloc has handed out and not taken back.
+int64_t HeapInUse() {
+  struct mallinfo2 info = mallinfo2();
+  return static_cast<int64_t>(info.uordblks + info.hblkhd);
+}
+
+// The resident set size, from /proc/self/statm.
+int64_t ResidentBytes() {
+  FILE *statm = fopen("/proc/self/statm", "r");
+  if (!statm) return 0;
+  long size = 0;
+  long resident = 0;
+  if (fscanf(statm, "%ld %ld", &size, &resident) != 2) resident = 0;
+  fclose(statm);
+  return static_cast<int64_t>(resident) * sysconf(_SC_PAGESIZE);
+}
+
+// Sign-ins through the bridge, as the Unity plugin makes them: sign in,
+// wait, read the user, release it and dispose of the future.  Once the
+// pools are warm a sign-in allocates nothing it does not free, so 100k of
+// them leave the heap and the resident set where they were.
+TEST(SignInCycleTest, HundredThousandSignInsKeepMemoryFlat) {
+#if defined(GOOGLESIGNIN_TEST_SANITIZED)
+  GTEST_SKIP() << "the sanitizers hold on to freed memory";
+#endif
+  const int kWarmUpCycles = 1000;
+  const int kCycles = 100000;
+  FakeSignInHelper &helper = FakeSignInHelper::Get();
+  FakeJvm &jvm = FakeJvm::Get();
+  helper.Reset();
+  GoogleSignIn_t plugin = GoogleSignIn_Create(helper.activity());
+  GoogleSignIn_Configure(
+      plugin, false,
+      "1234567890-abcdefghijklmnopqrstuvwxyz012345.apps.googleusercontent.com",
+      false, false, true, true, false, nullptr, 0, nullptr);
+
+  std::set<GoogleSignInFuture_t> futures;
+  size_t email_bytes = 0;
+  int failed = 0;
+  auto cycle = [&](int i) {
+    GoogleSignInFuture_t future =
+        i % 2 ? GoogleSignIn_SignInSilently(plugin) : GoogleSignIn_SignIn(plugin);
+    futures.insert(future);
+    if (!GoogleSignIn_Wait(future, 10000)) {
+      failed++;
+      return;
+    }
+    GoogleSignInUser_t user = GoogleSignIn_Result(future);
+    if (!user) {
+      failed++;
+    } else {
+      email_bytes += GoogleSignIn_GetEmail(user, nullptr, 0);
+    }
+    GoogleSignIn_ReleaseUser(user);
+    GoogleSignIn_DisposeFuture(future);
+  };
+  for (int i = 0; i < kWarmUpCycles; i++) cycle(i);
+  helper.WaitIdle();
+  int64_t heap = HeapInUse();
+  int64_t resident = ResidentBytes();
+  size_t objects = jvm.live_objects();
+  size_t global_refs = jvm.global_refs();
+
+  for (int i = 0; i < kCycles; i++) cycle(i);
+  helper.WaitIdle();
+  EXPECT_EQ(0, failed);
+  EXPECT_LT(0u, email_bytes);
+  EXPECT_GE(16u, futures.size()) << "one future per request slot";
+  // A leaked byte per sign-in would show as 100 KB.
+  EXPECT_GT(16 * 1024, HeapInUse() - heap);
+  EXPECT_GT(256 * 1024, ResidentBytes() - resident);
+  EXPECT_EQ(objects, jvm.live_objects());
+  EXPECT_EQ(global_refs, jvm.global_refs());
+  GoogleSignIn_Dispose(plugin);
+  helper.Reset();
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace googlesignin
@@ -29,6 +29,14 @@ JavaVM* JNIContext::vm_ = nullptr;
 static pthread_key_t jni_env_key;
 static pthread_once_t pthread_key_initialized = PTHREAD_ONCE_INIT;
 
+// Name given to native threads attached by GetJniEnv(), so they are
+// identifiable in stack traces and the debugger thread list.
+static const char kAttachedThreadName[] = "googlesignin-native";
+
+// Per-thread cache of the JNIEnv.  This is set the first time a thread calls
+// GetJniEnv(), after that the env is returned without calling into the VM.
+static thread_local JNIEnv* t_jni_env = nullptr;
+
 // This will be called by any thread that's attached to the JVM when it exits.
 extern "C" {
 static void DetachJVMThreads(void* stored_java_vm) {
@@ -73,15 +81,30 @@ JNIContext::~JNIContext() {
 // This could be static, but it should never be called before at least one
 // instance is constructed.
 JNIEnv* JNIContext::GetJniEnv() {
+  JNIEnv* env = t_jni_env;
+  if (env) {
+    return env;
+  }
   assert(vm_);
-  // This call allows us to set a thread-local value. Even though there will
-  // only ever be one JavaVM, and every thread will store the same value,
-  // this ensures any thread attaching to the JVM will call the thread
-  // destructor to detach before exiting.
-  pthread_setspecific(jni_env_key, vm_);
-  JNIEnv* env;
-  jint result = vm_->AttachCurrentThread(&env, nullptr);
-  return result == JNI_OK ? env : nullptr;
+  jint result = vm_->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6);
+  if (result == JNI_EDETACHED) {
+    JavaVMAttachArgs args;
+    args.version = JNI_VERSION_1_6;
+    args.name = kAttachedThreadName;
+    args.group = nullptr;
+    result = vm_->AttachCurrentThread(&env, &args);
+    if (result == JNI_OK) {
+      // This call allows us to set a thread-local value. Even though there
+      // will only ever be one JavaVM, and every thread will store the same
+      // value, this ensures any thread we attach to the JVM will call the
+      // thread destructor to detach before exiting.  Threads that were
+      // already attached are owned by someone else and are left alone.
+      pthread_setspecific(jni_env_key, vm_);
+    }
+  }
+  env = result == JNI_OK ? env : nullptr;
+  t_jni_env = env;
+  return env;
 }
 
 // Returns a local reference to the activity used to construct this class.
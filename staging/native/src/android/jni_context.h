@@ -28,8 +28,9 @@ namespace signin {
 // reference to an Activity. You can instantiate this for each activity, though
 // any activity will work for all cases as it's just used to get access to
 // non-system class loaders when using the FindClass method.
-// Any thread that calls GetJniEnv is bound to the JavaVM and will
-// automatically be detached when that thread exits.
+// Any thread that calls GetJniEnv is bound to the JavaVM and, if it was
+// attached by this class, will automatically be detached when that thread
+// exits.  The JNIEnv is cached per thread after the first call.
 class JNIContext {
 public:
   JNIContext(jobject activity, JavaVM *vm);